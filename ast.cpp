@@ -42,6 +42,82 @@ namespace basically::ast
         thread_local Indent indent;
 
 
+        size_t combine_hash(size_t seed, size_t value) noexcept
+        {
+            return seed ^ (value + 0x9e3779b97f4a7c15 + (seed << 6) + (seed >> 2));
+        }
+
+
+        size_t hash_token(lexing::Token const& token) noexcept
+        {
+            return combine_hash(std::hash<int>()(static_cast<int>(token.type)),
+                                std::hash<std::string>()(token.text));
+        }
+
+
+        bool same_token(lexing::Token const& lhs, lexing::Token const& rhs) noexcept
+        {
+            return (lhs.type == rhs.type) && (lhs.text == rhs.text);
+        }
+
+
+        bool same_tokens(lexing::TokenList const& lhs, lexing::TokenList const& rhs) noexcept
+        {
+            return std::equal(lhs.begin(), lhs.end(), rhs.begin(), rhs.end(), same_token);
+        }
+
+
+        std::ostream& write_access(std::ostream& stream,
+                                   lexing::Token const& name,
+                                   OptionalExpression const& subscript,
+                                   lexing::TokenList const& members)
+        {
+            stream << name.text;
+
+            if (subscript)
+            {
+                stream << "[" << subscript.value() << "]";
+            }
+
+            for (auto const& member : members)
+            {
+                stream << "." << member.text;
+            }
+
+            return stream;
+        }
+
+
+        bool same_optional(OptionalExpression const& lhs, OptionalExpression const& rhs) noexcept
+        {
+            if (lhs.has_value() != rhs.has_value())
+            {
+                return false;
+            }
+
+            return !lhs || structurally_equal(lhs.value(), rhs.value());
+        }
+
+
+        bool same_list(ExpressionList const& lhs, ExpressionList const& rhs) noexcept
+        {
+            if (lhs.size() != rhs.size())
+            {
+                return false;
+            }
+
+            for (size_t i = 0; i < lhs.size(); ++i)
+            {
+                if (!structurally_equal(lhs[i], rhs[i]))
+                {
+                    return false;
+                }
+            }
+
+            return true;
+        }
+
+
     }
 
 
@@ -57,20 +133,20 @@ namespace basically::ast
 
     std::ostream& operator <<(std::ostream& stream, VariableReadExpressionPtr const& expression)
     {
-        stream << expression->name.text;
-
-        //if (expression->subscript)
-        //{
-        //    stream << "[" << expression->subscript << "]";
-        //}
-
-        return stream;
+        return write_access(stream, expression->name, expression->subscript, expression->members);
     }
 
 
     std::ostream& operator <<(std::ostream& stream, PrefixExpressionPtr const& expression)
     {
-        stream << expression->operator_type << " " << expression;
+        if (expression->operator_type.type == lexing::Type::KeywordNot)
+        {
+            stream << "not " << expression->expression;
+        }
+        else
+        {
+            stream << "-" << expression->expression;
+        }
 
         return stream;
     }
@@ -174,6 +250,52 @@ namespace basically::ast
     }
 
 
+    std::ostream& operator <<(std::ostream& stream, AttributeList const& attributes)
+    {
+        if (attributes.empty())
+        {
+            return stream;
+        }
+
+        stream << "[";
+
+        for (size_t i = 0; i < attributes.size(); ++i)
+        {
+            auto const& attribute = attributes[i];
+
+            stream << attribute.name.text;
+
+            if (attribute.value.type != lexing::Type::None)
+            {
+                stream << " = " << attribute.value.text;
+            }
+
+            if (i < (attributes.size() - 1))
+            {
+                stream << ", ";
+            }
+        }
+
+        stream << "] ";
+
+        return stream;
+    }
+
+
+    OptionalString find_attribute(AttributeList const& attributes, std::string const& name)
+    {
+        for (auto const& attribute : attributes)
+        {
+            if (attribute.name.text == name)
+            {
+                return attribute.value.text;
+            }
+        }
+
+        return {};
+    }
+
+
     std::ostream& operator <<(std::ostream& stream, DoStatementPtr const& statement)
     {
         auto terminator_to_string = [&]()
@@ -219,7 +341,8 @@ namespace basically::ast
 
     std::ostream& operator <<(std::ostream& stream, SubDeclarationStatementPtr const& statement)
     {
-        stream << "sub " << statement->name.text << "(" << statement->parameters << ")"
+        stream << statement->attributes
+               << "sub " << statement->name.text << "(" << statement->parameters << ")"
                << std::endl;
 
         ++indent;
@@ -235,7 +358,8 @@ namespace basically::ast
     std::ostream& operator <<(std::ostream& stream,
                               FunctionDeclarationStatementPtr const& statement)
     {
-        stream << "function " << statement->name.text << "(" << statement->parameters << ") as "
+        stream << statement->attributes
+               << "function " << statement->name.text << "(" << statement->parameters << ") as "
                << statement->return_type.text
                << std::endl;
 
@@ -348,7 +472,7 @@ namespace basically::ast
     std::ostream& operator <<(std::ostream& stream,
                               StructureDeclarationStatementPtr const& statement)
     {
-        stream << "structure " << statement->name << std::endl;
+        stream << statement->attributes << "structure " << statement->name.text << std::endl;
 
         ++indent;
 
@@ -375,9 +499,16 @@ namespace basically::ast
     std::ostream& operator <<(std::ostream& stream,
                               VariableDeclarationStatementPtr const& statement)
     {
-        stream << "var " << statement->name.text
-               << " as " << statement->type_name.text
-               << " = " << statement->initializer;
+        stream << statement->attributes
+               << "var " << statement->name.text
+               << " as " << statement->type_name.text;
+
+        if (statement->array_count != 0)
+        {
+            stream << "[" << statement->array_count << "]";
+        }
+
+        stream << " = " << statement->initializer;
 
         return stream;
     }
@@ -385,7 +516,8 @@ namespace basically::ast
 
     std::ostream& operator <<(std::ostream& stream, AssignmentStatementPtr const& statement)
     {
-        stream << statement->name.text << " = " << statement->value;
+        write_access(stream, statement->name, statement->subscript, statement->members)
+            << " = " << statement->value;
 
         return stream;
     }
@@ -458,4 +590,202 @@ namespace basically::ast
     }
 
 
+    ExpressionBase& get_base(Expression const& expression) noexcept
+    {
+        auto base = std::visit([](auto const& node) -> ExpressionBase*
+                                   {
+                                       return node.get();
+                                   },
+                               expression);
+
+        assert(base != nullptr);
+        return *base;
+    }
+
+
+    size_t structural_hash(Expression const& expression) noexcept
+    {
+        auto const& base = get_base(expression);
+
+        if (base.cached_hash != 0)
+        {
+            return base.cached_hash;
+        }
+
+        size_t hash = std::hash<size_t>()(expression.index());
+
+        auto add_optional = [&](OptionalExpression const& optional)
+            {
+                hash = combine_hash(hash, optional ? structural_hash(optional.value()) : 0);
+            };
+
+        std::visit(ExpressionHandlers
+            {
+                .literal_expression = [&](auto const& literal)
+                    {
+                        hash = combine_hash(hash, hash_token(literal->value));
+                    },
+
+                .variable_read_expression = [&](auto const& read)
+                    {
+                        hash = combine_hash(hash, hash_token(read->name));
+                        add_optional(read->subscript);
+
+                        for (auto const& member : read->members)
+                        {
+                            hash = combine_hash(hash, hash_token(member));
+                        }
+                    },
+
+                .prefix_expression = [&](auto const& prefix)
+                    {
+                        hash = combine_hash(hash, hash_token(prefix->operator_type));
+                        hash = combine_hash(hash, structural_hash(prefix->expression));
+                    },
+
+                .binary_expression = [&](auto const& binary)
+                    {
+                        hash = combine_hash(hash, hash_token(binary->operator_type));
+                        hash = combine_hash(hash, structural_hash(binary->lhs));
+                        hash = combine_hash(hash, structural_hash(binary->rhs));
+                    },
+
+                .postfix_expression = [&](auto const& postfix)
+                    {
+                        hash = combine_hash(hash, hash_token(postfix->operator_type));
+                        hash = combine_hash(hash, structural_hash(postfix->expression));
+                    },
+
+                .function_call_expression = [&](auto const& call)
+                    {
+                        hash = combine_hash(hash, hash_token(call->name));
+
+                        for (auto const& parameter : call->parameters)
+                        {
+                            hash = combine_hash(hash, structural_hash(parameter));
+                        }
+                    }
+            },
+            expression);
+
+        base.cached_hash = hash != 0 ? hash : 1;
+
+        return base.cached_hash;
+    }
+
+
+    bool structurally_equal(Expression const& lhs, Expression const& rhs) noexcept
+    {
+        if (&get_base(lhs) == &get_base(rhs))
+        {
+            return true;
+        }
+
+        if (   (lhs.index() != rhs.index())
+            || (structural_hash(lhs) != structural_hash(rhs)))
+        {
+            return false;
+        }
+
+        auto other = [&](auto const& node)
+            {
+                return std::get<std::decay_t<decltype(node)>>(rhs);
+            };
+
+        bool equal = false;
+
+        std::visit(ExpressionHandlers
+            {
+                .literal_expression = [&](auto const& literal)
+                    {
+                        equal = same_token(literal->value, other(literal)->value);
+                    },
+
+                .variable_read_expression = [&](auto const& read)
+                    {
+                        auto const& rhs_read = other(read);
+
+                        equal =    same_token(read->name, rhs_read->name)
+                                && same_optional(read->subscript, rhs_read->subscript)
+                                && same_tokens(read->members, rhs_read->members);
+                    },
+
+                .prefix_expression = [&](auto const& prefix)
+                    {
+                        auto const& rhs_prefix = other(prefix);
+
+                        equal =    same_token(prefix->operator_type, rhs_prefix->operator_type)
+                                && structurally_equal(prefix->expression, rhs_prefix->expression);
+                    },
+
+                .binary_expression = [&](auto const& binary)
+                    {
+                        auto const& rhs_binary = other(binary);
+
+                        equal =    same_token(binary->operator_type, rhs_binary->operator_type)
+                                && structurally_equal(binary->lhs, rhs_binary->lhs)
+                                && structurally_equal(binary->rhs, rhs_binary->rhs);
+                    },
+
+                .postfix_expression = [&](auto const& postfix)
+                    {
+                        auto const& rhs_postfix = other(postfix);
+
+                        equal =    same_token(postfix->operator_type, rhs_postfix->operator_type)
+                                && structurally_equal(postfix->expression, rhs_postfix->expression);
+                    },
+
+                .function_call_expression = [&](auto const& call)
+                    {
+                        auto const& rhs_call = other(call);
+
+                        equal =    same_token(call->name, rhs_call->name)
+                                && same_list(call->parameters, rhs_call->parameters);
+                    }
+            },
+            lhs);
+
+        return equal;
+    }
+
+
+    Expression ExpressionPool::intern(Expression const& expression)
+    {
+        ++requests;
+
+        auto [ iterator, inserted ] = expressions.insert(expression);
+
+        if (!inserted)
+        {
+            ++hits;
+        }
+
+        return *iterator;
+    }
+
+
+    void ExpressionPool::clear() noexcept
+    {
+        expressions.clear();
+    }
+
+
+    size_t ExpressionPool::size() const noexcept
+    {
+        return expressions.size();
+    }
+
+
+    size_t ExpressionPool::shared_count() const noexcept
+    {
+        return hits;
+    }
+
+
+    size_t ExpressionPool::request_count() const noexcept
+    {
+        return requests;
+    }
+
+
 }
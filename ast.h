@@ -2,6 +2,34 @@
 #pragma once
 
 
+// Names used in statements and expressions are bound to their symbols once, by symbol resolution in
+// pass 2, so that later passes never have to look a name up again.
+namespace basically::runtime::symbols
+{
+
+
+    struct Symbol;
+    using SymbolPtr = std::shared_ptr<Symbol>;
+
+
+}
+
+
+// After resolution the type checker annotates every expression with its type.
+namespace basically::typing
+{
+
+
+    // The canonical identity of a type within the TypeContext.  Two types are the same type if and
+    // only if their ids are equal.
+    using TypeId = uint32_t;
+
+    constexpr TypeId invalid_type_id = std::numeric_limits<TypeId>::max();
+
+
+}
+
+
 namespace basically::ast
 {
 
@@ -21,6 +49,15 @@ namespace basically::ast
 
     struct ExpressionBase : public Base
     {
+        // Expression nodes are immutable once built, so their structural hash is computed once on
+        // first use and kept here.  Zero means not yet computed.
+        mutable size_t cached_hash = 0;
+
+        // The type of the expression's value.  It depends only on the expression itself, never on
+        // where it's used, so shared nodes agree on it.  Converting the value to what the
+        // surrounding code expects is left to code generation.
+        typing::TypeId type = typing::invalid_type_id;
+
         ExpressionBase(source::Location const& new_location)
         : Base(new_location)
         {
@@ -214,6 +251,24 @@ namespace basically::ast
     using ConditionalBlockList = std::list<ConditionalBlock>;
 
 
+    // Declarations can be preceded by a list of attributes, [name] or [name = value], that tune how
+    // they're compiled.
+    struct Attribute
+    {
+        lexing::Token name;
+        lexing::Token value;
+    };
+
+
+    using AttributeList = std::vector<Attribute>;
+
+
+    std::ostream& operator <<(std::ostream& stream, AttributeList const& attributes);
+
+
+    OptionalString find_attribute(AttributeList const& attributes, std::string const& name);
+
+
     struct LiteralExpression : public ExpressionBase
     {
         const lexing::Token value;
@@ -230,12 +285,17 @@ namespace basically::ast
     {
         const lexing::Token name;
         const OptionalExpression subscript;
+        const lexing::TokenList members;
+
+        runtime::symbols::SymbolPtr symbol;
 
         VariableReadExpression(lexing::Token const& new_name,
-                               OptionalExpression const& new_subscript)
+                               OptionalExpression const& new_subscript,
+                               lexing::TokenList const& new_members = {})
         : ExpressionBase(new_name.location),
           name(new_name),
-          subscript(new_subscript)
+          subscript(new_subscript),
+          members(new_members)
         {
         }
     };
@@ -262,6 +322,10 @@ namespace basically::ast
         const Expression lhs;
         const Expression rhs;
 
+        // Both operands are converted to this type before the operation.  For comparisons it
+        // differs from the type of the result, which is bool.
+        typing::TypeId operand_type = typing::invalid_type_id;
+
         BinaryExpression(lexing::Token const& new_operator_type,
                          Expression const& new_lhs,
                          Expression const& new_rhs)
@@ -294,6 +358,8 @@ namespace basically::ast
         const lexing::Token name;
         const ExpressionList parameters;
 
+        runtime::symbols::SymbolPtr symbol;
+
         FunctionCallExpression(lexing::Token const& new_name,
                                ExpressionList const& new_parameters)
         : ExpressionBase(new_name.location),
@@ -331,6 +397,8 @@ namespace basically::ast
         const OptionalExpression step_value;
         const StatementList body;
 
+        runtime::symbols::SymbolPtr index_symbol;
+
         ForStatement(source::Location const& new_location,
                      lexing::Token const& new_index_name,
                      Expression const& new_start_index,
@@ -353,15 +421,18 @@ namespace basically::ast
         const lexing::Token name;
         const VariableDeclarationList parameters;
         const StatementList body;
+        const AttributeList attributes;
 
         SubDeclarationStatement(source::Location const& new_location,
                                 lexing::Token const& new_name,
                                 VariableDeclarationList const& new_parameters,
-                                StatementList const& new_body)
+                                StatementList const& new_body,
+                                AttributeList const& new_attributes = {})
         : StatementBase(new_location),
           name(new_name),
           parameters(new_parameters),
-          body(new_body)
+          body(new_body),
+          attributes(new_attributes)
         {
         }
     };
@@ -375,8 +446,13 @@ namespace basically::ast
                                      lexing::Token const& new_name,
                                      VariableDeclarationList const& new_parameters,
                                      lexing::Token const& new_return_type,
-                                     StatementList const& new_body)
-        : SubDeclarationStatement(new_location, new_name, new_parameters, new_body),
+                                     StatementList const& new_body,
+                                     AttributeList const& new_attributes = {})
+        : SubDeclarationStatement(new_location,
+                                  new_name,
+                                  new_parameters,
+                                  new_body,
+                                  new_attributes),
           return_type(new_return_type)
         {
         }
@@ -454,13 +530,16 @@ namespace basically::ast
     {
         const lexing::Token name;
         const VariableDeclarationList members;
+        const AttributeList attributes;
 
         StructureDeclarationStatement(source::Location const& new_location,
                                       lexing::Token const& new_name,
-                                      VariableDeclarationList const& new_members)
+                                      VariableDeclarationList const& new_members,
+                                      AttributeList const& new_attributes = {})
         : StatementBase(new_location),
           name(new_name),
-          members(new_members)
+          members(new_members),
+          attributes(new_attributes)
         {
         }
     };
@@ -470,16 +549,24 @@ namespace basically::ast
     {
         const lexing::Token name;
         const lexing::Token type_name;
+        const size_t array_count;
         const OptionalExpression initializer;
+        const AttributeList attributes;
+
+        runtime::symbols::SymbolPtr symbol;
 
         VariableDeclarationStatement(source::Location const& new_location,
                                      lexing::Token const& new_name,
                                      lexing::Token const& new_type_name,
-                                     OptionalExpression const& new_initializer)
+                                     size_t new_array_count,
+                                     OptionalExpression const& new_initializer,
+                                     AttributeList const& new_attributes = {})
         : StatementBase(new_location),
           name(new_name),
           type_name(new_type_name),
-          initializer(new_initializer)
+          array_count(new_array_count),
+          initializer(new_initializer),
+          attributes(new_attributes)
         {
         }
     };
@@ -488,13 +575,24 @@ namespace basically::ast
     struct AssignmentStatement : public StatementBase
     {
         const lexing::Token name;
+        const OptionalExpression subscript;
+        const lexing::TokenList members;
         const Expression value;
 
+        runtime::symbols::SymbolPtr symbol;
+
+        // The type of the element or field being written, set by the type checker.
+        typing::TypeId target_type = typing::invalid_type_id;
+
         AssignmentStatement(source::Location const& new_location,
                             lexing::Token const& new_name,
+                            OptionalExpression const& new_subscript,
+                            lexing::TokenList const& new_members,
                             Expression const& new_value)
         : StatementBase(new_location),
           name(new_name),
+          subscript(new_subscript),
+          members(new_members),
           value(new_value)
         {
         }
@@ -506,6 +604,8 @@ namespace basically::ast
         const lexing::Token name;
         const ExpressionList parameters;
 
+        runtime::symbols::SymbolPtr symbol;
+
         SubCallStatement(source::Location const& new_location,
                          lexing::Token const& new_name,
                          ExpressionList const& new_parameters)
@@ -517,4 +617,64 @@ namespace basically::ast
     };
 
 
+    ExpressionBase& get_base(Expression const& expression) noexcept;
+
+
+    // Structural hashing and equality of expression trees.  Source locations take no part, so two
+    // occurrences of the same expression text anywhere in a script hash and compare the same.
+    size_t structural_hash(Expression const& expression) noexcept;
+    bool structurally_equal(Expression const& lhs, Expression const& rhs) noexcept;
+
+
+    struct ExpressionHash
+    {
+        size_t operator ()(Expression const& expression) const noexcept
+        {
+            return structural_hash(expression);
+        }
+    };
+
+
+    struct ExpressionEqual
+    {
+        bool operator ()(Expression const& lhs, Expression const& rhs) const noexcept
+        {
+            return structurally_equal(lhs, rhs);
+        }
+    };
+
+
+    // Hash-consing table for expression nodes.  Interning a node whose children have already been
+    // interned returns the one shared instance of that structure, so identical subtrees are built
+    // once and later passes can key their own tables on the node pointers.
+    //
+    // A shared node keeps the location of its first occurrence.
+    class ExpressionPool
+    {
+        private:
+            std::unordered_set<Expression, ExpressionHash, ExpressionEqual> expressions;
+
+            size_t requests = 0;
+            size_t hits = 0;
+
+        public:
+            ExpressionPool() = default;
+            ExpressionPool(ExpressionPool const& pool) = default;
+            ExpressionPool(ExpressionPool&& pool) = default;
+            ~ExpressionPool() = default;
+
+        public:
+            ExpressionPool& operator =(ExpressionPool const& pool) = default;
+            ExpressionPool& operator =(ExpressionPool&& pool) = default;
+
+        public:
+            Expression intern(Expression const& expression);
+            void clear() noexcept;
+
+            size_t size() const noexcept;
+            size_t shared_count() const noexcept;
+            size_t request_count() const noexcept;
+    };
+
+
 }
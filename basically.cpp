@@ -12,6 +12,39 @@ namespace
 {
 
 
+    // A whole number no bigger than the limit, with the message as the error for anything else.
+    uintmax_t parse_number(std::string const& value,
+                           char const* message,
+                           uintmax_t limit = std::numeric_limits<size_t>::max())
+    {
+        if (value.empty())
+        {
+            throw std::runtime_error(message);
+        }
+
+        uintmax_t number = 0;
+
+        for (auto character : value)
+        {
+            if (!isdigit(static_cast<unsigned char>(character)))
+            {
+                throw std::runtime_error(message);
+            }
+
+            auto digit = static_cast<uintmax_t>(character - '0');
+
+            if (number > (limit - digit) / 10)
+            {
+                throw std::runtime_error(message);
+            }
+
+            number = number * 10 + digit;
+        }
+
+        return number;
+    }
+
+
     std::fs::path get_system_path(std::fs::path const& executable)
     {
         std::fs::path base_path = executable.is_relative()
@@ -22,6 +55,211 @@ namespace
     }
 
 
+    using Options = basically::runtime::modules::Options;
+
+    // Flags that take a value are given as --flag=value.
+    using FlagHandler = std::function<void(Options&, std::string const&)>;
+    using FlagHandlerMap = std::unordered_map<std::string, FlagHandler>;
+
+
+    struct CommandLine
+    {
+        std::fs::path script_path;
+        Options options;
+
+        // Set to compile the script into a program rather than run it.
+        bool is_compiling = false;
+        std::fs::path output_path;
+    };
+
+
+    CommandLine parse_command_line(int argc, char* argv[])
+    {
+        static const FlagHandlerMap flag_handlers =
+            {
+                {
+                    "--share-expressions",
+                    [](auto& options, auto&) { options.share_expressions = true; }
+                },
+                { "--dump-ir",     [](auto& options, auto&) { options.dump_ir = true; } },
+                { "--no-optimize", [](auto& options, auto&) { options.passes.clear(); } },
+                { "--no-inline",   [](auto& options, auto&) { options.inline_budget = 0; } },
+                { "--unchecked",   [](auto& options, auto&) { options.check_bounds = false; } },
+                { "--no-cache",    [](auto& options, auto&) { options.cache_path.reset(); } },
+                {
+                    "--whole-program",
+                    [](auto& options, auto&) { options.is_whole_program = true; }
+                },
+                { "--tiered",      [](auto& options, auto&) { options.is_tiered = true; } },
+                { "--profile",     [](auto& options, auto&) { options.is_profiling = true; } },
+                { "--no-profile",  [](auto& options, auto&) { options.use_profile = false; } },
+                { "--fast-math",   [](auto& options, auto&) { options.is_fast_math = true; } },
+                { "--lazy",        [](auto& options, auto&) { options.is_lazy = true; } },
+                {
+                    "--march",
+                    [](auto& options, auto& value)
+                    {
+                        if (value.empty())
+                        {
+                            throw std::runtime_error("The target architecture needs a name.");
+                        }
+
+                        options.target_arch = value;
+                    }
+                },
+                {
+                    "--mtune",
+                    [](auto& options, auto& value)
+                    {
+                        if (value.empty())
+                        {
+                            throw std::runtime_error("The target to tune for needs a name.");
+                        }
+
+                        options.target_tune = value;
+                    }
+                },
+                {
+                    "--cache",
+                    [](auto& options, auto& value)
+                    {
+                        if (value.empty())
+                        {
+                            throw std::runtime_error("The cache needs a directory.");
+                        }
+
+                        options.cache_path = value;
+                    }
+                },
+                {
+                    "--cache-size",
+                    [](auto& options, auto& value)
+                    {
+                        const uintmax_t megabyte = 1024 * 1024;
+
+                        auto megabytes = parse_number(value,
+                                                      "The cache size must be a number of "
+                                                      "megabytes.",
+                                                      std::numeric_limits<uintmax_t>::max()
+                                                          / megabyte);
+
+                        options.cache_size_limit = megabytes * megabyte;
+                    }
+                },
+                {
+                    "--passes",
+                    [](auto& options, auto& value)
+                    {
+                        options.passes = basically::runtime::optimizing::parse_passes(value);
+                    }
+                },
+                {
+                    "--inline-budget",
+                    [](auto& options, auto& value)
+                    {
+                        options.inline_budget = parse_number(value,
+                                                             "The inline budget must be a number.");
+                    }
+                },
+                {
+                    "--compile-threads",
+                    [](auto& options, auto& value)
+                    {
+                        options.compile_threads = parse_number(value,
+                                                               "The number of compile threads must "
+                                                               "be a number.");
+                    }
+                },
+                {
+                    "--tier-threshold",
+                    [](auto& options, auto& value)
+                    {
+                        options.tier_threshold = parse_number(value,
+                                                              "The tier threshold must be a "
+                                                              "number.");
+                    }
+                },
+                {
+                    "--evaluation-budget",
+                    [](auto& options, auto& value)
+                    {
+                        options.evaluation_budget = parse_number(value,
+                                                                 "The evaluation budget must be a "
+                                                                 "number.");
+                    }
+                }
+            };
+
+        CommandLine command_line;
+
+        for (int i = 1; i < argc; ++i)
+        {
+            std::string argument = argv[i];
+            std::string value;
+
+            if (auto equals = argument.find('='); equals != std::string::npos)
+            {
+                value = argument.substr(equals + 1);
+                argument.resize(equals);
+            }
+
+            if (argument == "--compile")
+            {
+                command_line.is_compiling = true;
+            }
+            else if (argument == "-o")
+            {
+                if ((i + 1 == argc) || !value.empty())
+                {
+                    throw std::runtime_error("The -o option needs a path to write to.");
+                }
+
+                command_line.output_path = argv[++i];
+            }
+            else if (auto found = flag_handlers.find(argument); found != flag_handlers.end())
+            {
+                found->second(command_line.options, value);
+            }
+            else if (argument.starts_with("--"))
+            {
+                throw std::runtime_error("Unknown option " + argument + ".");
+            }
+            else if (command_line.script_path.empty())
+            {
+                command_line.script_path = argument;
+            }
+            else
+            {
+                throw std::runtime_error("Only one script can be run at a time.");
+            }
+        }
+
+        if (command_line.script_path.empty())
+        {
+            throw std::runtime_error("Need to specifiy a script to run.");
+        }
+
+        if (!command_line.output_path.empty() && !command_line.is_compiling)
+        {
+            throw std::runtime_error("Only a compiled script is written to a file.");
+        }
+
+        // By default script.bas compiles to script.
+        if (command_line.is_compiling && command_line.output_path.empty())
+        {
+            command_line.output_path = command_line.script_path.filename();
+            command_line.output_path.replace_extension();
+
+            if (command_line.output_path == command_line.script_path.filename())
+            {
+                throw std::runtime_error("Need to specify where to write the compiled script.");
+            }
+        }
+
+        return command_line;
+    }
+
+
 }
 
 
@@ -31,12 +269,21 @@ int main(int argc, char* argv[])
 
     try
     {
-        if (argc != 2)
+        auto command_line = parse_command_line(argc, argv);
+
+        if (command_line.is_compiling)
         {
-            throw std::runtime_error("Need to specifiy a script to run.");
+            basically::compile_script(get_system_path(argv[0]),
+                                      command_line.script_path,
+                                      command_line.output_path,
+                                      command_line.options);
+        }
+        else
+        {
+            result = basically::execute_script(get_system_path(argv[0]),
+                                               command_line.script_path,
+                                               command_line.options);
         }
-
-        result = basically::execute_script(get_system_path(argv[0]), argv[1]);
     }
     catch (std::exception& e)
     {
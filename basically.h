@@ -4,6 +4,11 @@
 
 
     #include <cstddef>
+    #include <cstdint>
+    #include <cmath>
+    #include <cstring>
+    #include <csetjmp>
+    #include <limits>
     #include <optional>
     #include <iterator>
     #include <string>
@@ -12,18 +17,32 @@
     #include <fstream>
     #include <unordered_set>
     #include <unordered_map>
+    #include <map>
+    #include <set>
     #include <vector>
+    #include <span>
     #include <list>
+    #include <deque>
+    #include <array>
     #include <tuple>
     #include <memory>
     #include <functional>
+    #include <thread>
+    #include <atomic>
+    #include <mutex>
+    #include <condition_variable>
+    #include <future>
     #include <stdexcept>
     #include <compare>
     #include <variant>
+    #include <chrono>
     #include <filesystem>
     #include <cassert>
+    #include <numeric>
+    #include <algorithm>
 
     #include <unistd.h>
+    #include <dlfcn.h>
     #include <libgccjit.h>
 
 
@@ -59,7 +78,20 @@
     #include "typing.h"
     #include "runtime.h"
     #include "runtime_variables.h"
+    #include "runtime_symbols.h"
+    #include "runtime_inference.h"
+    #include "runtime_ir.h"
+    #include "runtime_lowering.h"
+    #include "runtime_effects.h"
+    #include "runtime_evaluating.h"
+    #include "runtime_optimizing.h"
+    #include "runtime_profiling.h"
+    #include "runtime_strings.h"
+    #include "runtime_inlining.h"
     #include "runtime_jitting.h"
+    #include "runtime_caching.h"
+    #include "runtime_threading.h"
+    #include "runtime_interpreting.h"
     #include "runtime_modules.h"
 
 
@@ -67,15 +99,49 @@
     {
 
         inline int execute_script(std::fs::path const& system_path,
-                                  std::fs::path const& script_path)
+                                  std::fs::path const& script_path,
+                                  runtime::modules::Options const& options = {})
         {
             runtime::modules::Loader loader;
 
             loader.set_system_path(system_path);
+            loader.set_options(options);
 
             auto loaded_script = loader.get_script(script_path);
-            return loaded_script->execute();
 
+            if (options.is_whole_program)
+            {
+                loaded_script->compile_whole_program();
+            }
+
+            auto result = loaded_script->execute();
+
+            if (options.is_profiling)
+            {
+                loaded_script->save_profiles();
+            }
+
+            return result;
+        }
+
+        // An object file is for linking into something else, anything else is a program.
+        inline void compile_script(std::fs::path const& system_path,
+                                   std::fs::path const& script_path,
+                                   std::fs::path const& output_path,
+                                   runtime::modules::Options options = {})
+        {
+            runtime::modules::Loader loader;
+
+            options.is_ahead_of_time = true;
+
+            loader.set_system_path(system_path);
+            loader.set_options(options);
+
+            auto loaded_script = loader.get_script(script_path);
+            auto kind = output_path.extension() == ".o" ? runtime::jitting::OutputKind::ObjectFile
+                                                        : runtime::jitting::OutputKind::Executable;
+
+            loaded_script->compile_program(output_path, kind);
         }
 
     }
@@ -171,29 +171,11 @@ namespace basically::lexing
         }
 
 
-        bool is_number_start(source::Buffer& source_buffer, OptionalChar const& next) noexcept
+        // Signs are not part of number literals, they're parsed as operators so that "n-1" and
+        // "4+1" read the same as "n - 1" and "4 + 1".
+        bool is_number_start(OptionalChar const& next) noexcept
         {
-            if (!next)
-            {
-                return false;
-            }
-
-            auto the_char = next.value();
-
-            if (is_number_char(the_char))
-            {
-                return true;
-            }
-
-            auto later = source_buffer.peek_next(1);
-
-            if (   ((the_char == '+') || (the_char == '-'))
-                && (later && is_number_char(later.value())))
-            {
-                return true;
-            }
-
-            return false;
+            return next && is_number_char(next.value());
         }
 
 
@@ -341,6 +323,12 @@ namespace basically::lexing
             std::string number_string;
             auto location = source_buffer.current_location();
 
+            auto is_exponent_sign = [&](char the_char) -> bool
+                {
+                    return    is_one_of(the_char, { '+', '-' })
+                           && is_one_of(number_string.back(), { 'e', 'E' });
+                };
+
             do
             {
                 source_buffer.next();
@@ -348,7 +336,8 @@ namespace basically::lexing
                 next = source_buffer.peek_next();
             }
             while (next && (   is_number_char(next.value())
-                            || is_one_of(next.value(), { '+', '-', 'e', 'E', '.' })));
+                            || is_one_of(next.value(), { 'e', 'E', '.' })
+                            || is_exponent_sign(next.value())));
 
             return
                 {
@@ -465,7 +454,7 @@ namespace basically::lexing
             {
                 next_token = read_string_token(source_buffer);
             }
-            else if (is_number_start(source_buffer, next))
+            else if (is_number_start(next))
             {
                 next_token = read_number_token(source_buffer);
             }
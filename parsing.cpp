@@ -58,6 +58,81 @@ namespace basically::parsing
         using StatementHandler = std::function<ast::Statement(lexing::Buffer&, lexing::Token&)>;
         using StatementHandlerMap = std::unordered_map<lexing::Type, StatementHandler>;
 
+        using DeclarationHandler = std::function<ast::Statement(lexing::Buffer&,
+                                                                lexing::Token&,
+                                                                ast::AttributeList const&)>;
+        using DeclarationHandlerMap = std::unordered_map<lexing::Type, DeclarationHandler>;
+
+
+        // While hash-consing is enabled this holds one expression pool for each open block,
+        // innermost first.  Blocks intern into their own pool and a pool is emptied after every
+        // variable declaration, so the names visible to a shared node never differ between its
+        // occurrences.
+        thread_local std::list<ast::ExpressionPool>* expression_pools = nullptr;
+
+
+        struct PoolManager
+        {
+            std::list<ast::ExpressionPool>* previous_pools;
+
+            PoolManager(std::list<ast::ExpressionPool>* new_pools)
+            : previous_pools(expression_pools)
+            {
+                expression_pools = new_pools;
+            }
+
+            ~PoolManager()
+            {
+                expression_pools = previous_pools;
+            }
+        };
+
+
+        struct BlockPool
+        {
+            BlockPool()
+            {
+                if (expression_pools != nullptr)
+                {
+                    expression_pools->emplace_front();
+                }
+            }
+
+            ~BlockPool()
+            {
+                if (expression_pools != nullptr)
+                {
+                    assert(!expression_pools->empty());
+                    expression_pools->pop_front();
+                }
+            }
+        };
+
+
+        void end_of_declaration() noexcept
+        {
+            if (expression_pools != nullptr)
+            {
+                assert(!expression_pools->empty());
+                expression_pools->front().clear();
+            }
+        }
+
+
+        template <typename NodeType, typename... ArgumentTypes>
+        ast::Expression make_expression(ArgumentTypes const&... arguments)
+        {
+            ast::Expression expression = std::make_shared<NodeType>(arguments...);
+
+            if (expression_pools != nullptr)
+            {
+                assert(!expression_pools->empty());
+                expression = expression_pools->front().intern(expression);
+            }
+
+            return expression;
+        }
+
 
         [[noreturn]]
         void parse_exception(std::string const& message, source::Location const& location)
@@ -252,7 +327,7 @@ namespace basically::parsing
         ast::Expression parse_literal_expression(lexing::Buffer& buffer,
                                                  lexing::Token const& literal)
         {
-            return std::make_shared<ast::LiteralExpression>(literal);
+            return make_expression<ast::LiteralExpression>(literal);
         }
 
 
@@ -262,7 +337,36 @@ namespace basically::parsing
             auto parameters = parse_parameter_expressions(buffer);
             expect_close_bracket(buffer);
 
-            return std::make_shared<ast::FunctionCallExpression>(name, parameters);
+            return make_expression<ast::FunctionCallExpression>(name, parameters);
+        }
+
+
+        ast::OptionalExpression parse_optional_subscript(lexing::Buffer& buffer)
+        {
+            ast::OptionalExpression subscript;
+
+            if (found_open_square_bracket(buffer))
+            {
+                subscript = parse_expression(buffer);
+                expect_close_square_bracket(buffer);
+            }
+
+            return subscript;
+        }
+
+
+        // Parse the .name.name... that follows a variable name or subscript, selecting fields of a
+        // structure.
+        lexing::TokenList parse_member_names(lexing::Buffer& buffer)
+        {
+            lexing::TokenList members;
+
+            while (found_optional_token(buffer, lexing::Type::SymbolDot))
+            {
+                members.push_back(expect_identifier(buffer));
+            }
+
+            return members;
         }
 
 
@@ -273,15 +377,25 @@ namespace basically::parsing
                 return parse_call_expression(buffer, name);
             }
 
-            ast::Expression subscript;
+            auto subscript = parse_optional_subscript(buffer);
+            auto members = parse_member_names(buffer);
+
+            return make_expression<ast::VariableReadExpression>(name, subscript, members);
+        }
 
-            if (found_open_square_bracket(buffer))
-            {
-                subscript = parse_expression(buffer);
-                expect_close_square_bracket(buffer);
-            }
 
-            return std::make_shared<ast::VariableReadExpression>(name, subscript);
+        // Negation binds tighter than any binary operator, while not applies to a whole comparison,
+        // so "not a = b" is "not (a = b)".
+        ast::Expression parse_prefix_expression(lexing::Buffer& buffer,
+                                                lexing::Token const& operator_token)
+        {
+            auto operand_precedence = operator_token.type == lexing::Type::KeywordNot
+                ? Precedence::Conditional
+                : Precedence::Product;
+
+            auto operand = parse_expression(buffer, operand_precedence);
+
+            return make_expression<ast::PrefixExpression>(operator_token, operand);
         }
 
 
@@ -299,9 +413,9 @@ namespace basically::parsing
                                                 ast::Expression const& left,
                                                 lexing::Token const& operator_token)
         {
-            return std::make_shared<ast::BinaryExpression>(operator_token,
-                                                           left,
-                                                           parse_expression(buffer, precedence));
+            auto right = parse_expression(buffer, precedence);
+
+            return make_expression<ast::BinaryExpression>(operator_token, left, right);
         }
 
 
@@ -313,7 +427,9 @@ namespace basically::parsing
                     { lexing::Type::LiteralInt,        parse_literal_expression },
                     { lexing::Type::LiteralString,     parse_literal_expression },
                     { lexing::Type::Identifier,        parse_name_expression    },
-                    { lexing::Type::SymbolOpenBracket, parse_group_expression   }
+                    { lexing::Type::SymbolOpenBracket, parse_group_expression   },
+                    { lexing::Type::SymbolMinus,       parse_prefix_expression  },
+                    { lexing::Type::KeywordNot,        parse_prefix_expression  }
                 };
 
             static const InfixHandlerMap infix_handlers =
@@ -328,7 +444,6 @@ namespace basically::parsing
                     { lexing::Type::SymbolGreaterThan, Precedence::Equality    },
                     { lexing::Type::SymbolLessThan,    Precedence::Equality    },
 
-                    { lexing::Type::KeywordNot,        Precedence::Conditional },
                     { lexing::Type::KeywordAnd,        Precedence::Conditional },
                     { lexing::Type::KeywordOr,         Precedence::Conditional }
                 };
@@ -394,6 +509,7 @@ namespace basically::parsing
                            && (next.type != lexing::Type::Eof);
                 };
 
+            BlockPool block_pool;
             ast::StatementList body_statements;
 
             while (not_at_end())
@@ -408,8 +524,9 @@ namespace basically::parsing
 
 
         ast::VariableDeclarationStatementPtr parse_variable_declaration(
-                                                                   lexing::Buffer& buffer,
-                                                                   lexing::Token const& start_token)
+                                                      lexing::Buffer& buffer,
+                                                      lexing::Token const& start_token,
+                                                      ast::AttributeList const& attributes = {})
         {
             auto name_token = start_token.type != lexing::Type::Identifier
                 ? expect_identifier(buffer)
@@ -418,13 +535,30 @@ namespace basically::parsing
             expect_as(buffer);
 
             auto type_token = expect_identifier(buffer);
+            size_t array_count = 0;
+
+            if (found_open_square_bracket(buffer))
+            {
+                auto count_token = expect_token(buffer, lexing::Type::LiteralInt);
+                array_count = std::stoull(count_token.text);
+
+                if (array_count == 0)
+                {
+                    parse_exception("Array size must be greater than zero.", count_token.location);
+                }
+
+                expect_close_square_bracket(buffer);
+            }
+
             auto value = found_assign(buffer) ? parse_expression(buffer)
                                               : ast::OptionalExpression();
 
             return std::make_shared<ast::VariableDeclarationStatement>(start_token.location,
                                                                        name_token,
                                                                        type_token,
-                                                                       value);
+                                                                       array_count,
+                                                                       value,
+                                                                       attributes);
         }
 
 
@@ -455,7 +589,8 @@ namespace basically::parsing
                 {
                     vars.push_back(parse_variable_declaration(buffer, {}));
 
-                    if (!found_optional_token(buffer, delimiter))
+                    if (   (delimiter != lexing::Type::None)
+                        && !found_optional_token(buffer, delimiter))
                     {
                         next = { .type = end_token };
                     }
@@ -502,27 +637,41 @@ namespace basically::parsing
         }
 
 
-        ast::Statement parse_sub_statement(lexing::Buffer& buffer, lexing::Token& sub_token)
+        ast::Statement parse_sub_declaration(lexing::Buffer& buffer,
+                                             lexing::Token& sub_token,
+                                             ast::AttributeList const& attributes)
         {
             auto name = expect_identifier(buffer);
             expect_open_bracket(buffer);
-            auto parameters = parse_parameter_declarations(buffer);
+            auto parameters = parse_parameter_declarations(buffer,
+                                                           lexing::Type::SymbolComma,
+                                                           lexing::Type::SymbolCloseBracket);
             expect_close_bracket(buffer);
             auto sub_body = parse_block_body_for(buffer, sub_token);
 
             return std::make_shared<ast::SubDeclarationStatement>(sub_token.location,
                                                                   name,
                                                                   parameters,
-                                                                  sub_body);
+                                                                  sub_body,
+                                                                  attributes);
         }
 
 
-        ast::Statement parse_function_statement(lexing::Buffer& buffer,
-                                                lexing::Token& function_token)
+        ast::Statement parse_sub_statement(lexing::Buffer& buffer, lexing::Token& sub_token)
+        {
+            return parse_sub_declaration(buffer, sub_token, {});
+        }
+
+
+        ast::Statement parse_function_declaration(lexing::Buffer& buffer,
+                                                  lexing::Token& function_token,
+                                                  ast::AttributeList const& attributes)
         {
             auto name = expect_identifier(buffer);
             expect_open_bracket(buffer);
-            auto parameters = parse_parameter_declarations(buffer);
+            auto parameters = parse_parameter_declarations(buffer,
+                                                           lexing::Type::SymbolComma,
+                                                           lexing::Type::SymbolCloseBracket);
             expect_close_bracket(buffer);
             expect_as(buffer);
             auto return_type = expect_identifier(buffer);
@@ -532,7 +681,15 @@ namespace basically::parsing
                                                                        name,
                                                                        parameters,
                                                                        return_type,
-                                                                       function_body);
+                                                                       function_body,
+                                                                       attributes);
+        }
+
+
+        ast::Statement parse_function_statement(lexing::Buffer& buffer,
+                                                lexing::Token& function_token)
+        {
+            return parse_function_declaration(buffer, function_token, {});
         }
 
 
@@ -566,6 +723,7 @@ namespace basically::parsing
 
             auto parse_if_block_statements = [&]() -> ast::StatementList
                 {
+                    BlockPool block_pool;
                     ast::StatementList statements;
 
                     while (!found_end_if_tokens())
@@ -650,6 +808,7 @@ namespace basically::parsing
 
             auto parse_case_block_statements = [&](lexing::Buffer& buffer) -> ast::StatementList
                 {
+                    BlockPool block_pool;
                     ast::StatementList statements;
 
                     while (!found_case_end_tokens(buffer))
@@ -698,45 +857,111 @@ namespace basically::parsing
         }
 
 
-        ast::Statement parse_structure_statement(lexing::Buffer& buffer,
-                                                 lexing::Token& structure_token)
+        ast::Statement parse_structure_declaration(lexing::Buffer& buffer,
+                                                   lexing::Token& structure_token,
+                                                   ast::AttributeList const& attributes)
         {
             auto name = expect_identifier(buffer);
             auto members = parse_parameter_declarations(buffer,
                                                         lexing::Type::None,
                                                         lexing::Type::KeywordEnd);
 
-            expect_token(buffer, structure_token.type);
+            expect_end_for(buffer, structure_token);
 
             return std::make_shared<ast::StructureDeclarationStatement>(structure_token.location,
                                                                         name,
-                                                                        members);
+                                                                        members,
+                                                                        attributes);
+        }
+
+
+        ast::Statement parse_structure_statement(lexing::Buffer& buffer,
+                                                 lexing::Token& structure_token)
+        {
+            return parse_structure_declaration(buffer, structure_token, {});
+        }
+
+
+        ast::Statement parse_var_declaration(lexing::Buffer& buffer,
+                                             lexing::Token& var_token,
+                                             ast::AttributeList const& attributes)
+        {
+            auto declaration = parse_variable_declaration(buffer, var_token, attributes);
+            end_of_declaration();
+
+            return declaration;
         }
 
 
         ast::Statement parse_variable_declaration_statement(lexing::Buffer& buffer,
                                                             lexing::Token& var_token)
         {
-            return parse_variable_declaration(buffer, var_token);
+            return parse_var_declaration(buffer, var_token, {});
+        }
+
+
+        ast::Statement parse_attributed_statement(lexing::Buffer& buffer,
+                                                  lexing::Token& open_token)
+        {
+            static const DeclarationHandlerMap declaration_parse_map =
+                {
+                    { lexing::Type::KeywordFunction,  parse_function_declaration  },
+                    { lexing::Type::KeywordStructure, parse_structure_declaration },
+                    { lexing::Type::KeywordSub,       parse_sub_declaration       },
+                    { lexing::Type::KeywordVar,       parse_var_declaration       }
+                };
+
+            ast::AttributeList attributes;
+
+            do
+            {
+                auto name = expect_identifier(buffer);
+                auto value = found_assign(buffer)
+                    ? expect_one_of<lexing::Type::Identifier,
+                                    lexing::Type::LiteralInt,
+                                    lexing::Type::LiteralFloat,
+                                    lexing::Type::LiteralString>(buffer)
+                    : lexing::Token {};
+
+                attributes.push_back({ .name = name, .value = value });
+            }
+            while (found_comma(buffer));
+
+            expect_close_square_bracket(buffer);
+
+            auto next = buffer.next();
+            auto found_handler = declaration_parse_map.find(next.type);
+
+            if (found_handler == declaration_parse_map.end())
+            {
+                expected_token_exception(declaration_parse_map, next);
+            }
+
+            return found_handler->second(buffer, next, attributes);
         }
 
 
         ast::Statement parse_identifier_statement(lexing::Buffer& buffer,
                                                   lexing::Token& identifier_token)
         {
-            auto next = expect_one_of<lexing::Type::SymbolOpenBracket,
-                                      lexing::Type::SymbolAssign>(buffer);
-
             auto parse_assignment_statement = [&]() -> ast::Statement
                 {
+                    auto subscript = parse_optional_subscript(buffer);
+                    auto members = parse_member_names(buffer);
+                    auto assign_token = expect_token(buffer, lexing::Type::SymbolAssign);
+
                     auto value = parse_expression(buffer);
-                    return std::make_shared<ast::AssignmentStatement>(next.location,
+                    return std::make_shared<ast::AssignmentStatement>(assign_token.location,
                                                                       identifier_token,
+                                                                      subscript,
+                                                                      members,
                                                                       value);
                 };
 
             auto parse_sub_call_statement = [&]() -> ast::Statement
                 {
+                    expect_open_bracket(buffer);
+
                     auto parameters = parse_parameter_expressions(buffer);
                     expect_close_bracket(buffer);
 
@@ -745,12 +970,12 @@ namespace basically::parsing
                                                                    parameters);
                 };
 
-            if (next.type == lexing::Type::SymbolAssign)
+            if (buffer.peek_next().type == lexing::Type::SymbolOpenBracket)
             {
-                return parse_assignment_statement();
+                return parse_sub_call_statement();
             }
 
-            return parse_sub_call_statement();
+            return parse_assignment_statement();
         }
 
 
@@ -768,6 +993,7 @@ namespace basically::parsing
                     { lexing::Type::KeywordSelect,    parse_select_statement               },
                     { lexing::Type::KeywordStructure, parse_structure_statement            },
                     { lexing::Type::KeywordVar,       parse_variable_declaration_statement },
+                    { lexing::Type::SymbolOpenSquare, parse_attributed_statement           },
                     { lexing::Type::Identifier,       parse_identifier_statement           }
                 };
 
@@ -787,8 +1013,11 @@ namespace basically::parsing
     }
 
 
-    ast::StatementList parse_to_ast(lexing::Buffer& buffer)
+    ast::StatementList parse_to_ast(lexing::Buffer& buffer, bool share_expressions)
     {
+        std::list<ast::ExpressionPool> pools(1);
+        PoolManager pool_manager(share_expressions ? &pools : nullptr);
+
         ast::StatementList toplevel;
 
         while (buffer.peek_next().type != lexing::Type::Eof)
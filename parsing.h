@@ -6,7 +6,9 @@ namespace basically::parsing
 {
 
 
-    ast::StatementList parse_to_ast(lexing::Buffer& token_buffer);
+    // When share_expressions is set, structurally identical expressions within a block are
+    // hash-consed into a single shared node.
+    ast::StatementList parse_to_ast(lexing::Buffer& token_buffer, bool share_expressions = false);
 
 
 }
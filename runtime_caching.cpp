@@ -0,0 +1,320 @@
+#include "basically.h"
+
+
+namespace basically::runtime::caching
+{
+
+
+    namespace
+    {
+
+
+        const char build_stamp[] = __DATE__ " " __TIME__;
+
+        const char library_extension[] = ".so";
+        const char profile_extension[] = ".profile";
+        const char temporary_extension[] = ".tmp";
+
+
+        // Code left behind by a process that died while writing it.  Anything younger may still
+        // be in the middle of being written.
+        const auto abandoned_age = std::chrono::hours(1);
+
+
+        // As FIPS 180-4 has it.
+        std::array<uint8_t, 32> sha256(std::string const& text)
+        {
+            static const uint32_t rounds[64] =
+                {
+                    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1,
+                    0x923f82a4, 0xab1c5ed5, 0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+                    0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174, 0xe49b69c1, 0xefbe4786,
+                    0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+                    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147,
+                    0x06ca6351, 0x14292967, 0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+                    0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85, 0xa2bfe8a1, 0xa81a664b,
+                    0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+                    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a,
+                    0x5b9cca4f, 0x682e6ff3, 0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+                    0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+                };
+
+            uint32_t state[8] =
+                {
+                    0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+                    0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+                };
+
+            auto rotate = [](uint32_t value, int bits)
+                {
+                    return (value >> bits) | (value << (32 - bits));
+                };
+
+            // The text, a one bit, zeros up to 8 bytes short of a whole block, and then the
+            // length of the text in bits.
+            std::vector<uint8_t> message(text.begin(), text.end());
+
+            message.push_back(0x80);
+
+            while (message.size() % 64 != 56)
+            {
+                message.push_back(0);
+            }
+
+            uint64_t bits = static_cast<uint64_t>(text.size()) * 8;
+
+            for (int shift = 56; shift >= 0; shift -= 8)
+            {
+                message.push_back(static_cast<uint8_t>(bits >> shift));
+            }
+
+            for (size_t block = 0; block < message.size(); block += 64)
+            {
+                uint32_t words[64];
+
+                for (size_t i = 0; i < 16; ++i)
+                {
+                    auto bytes = &message[block + i * 4];
+
+                    words[i] =   (uint32_t { bytes[0] } << 24) | (uint32_t { bytes[1] } << 16)
+                               | (uint32_t { bytes[2] } << 8) | uint32_t { bytes[3] };
+                }
+
+                for (size_t i = 16; i < 64; ++i)
+                {
+                    auto s0 =   rotate(words[i - 15], 7) ^ rotate(words[i - 15], 18)
+                              ^ (words[i - 15] >> 3);
+                    auto s1 =   rotate(words[i - 2], 17) ^ rotate(words[i - 2], 19)
+                              ^ (words[i - 2] >> 10);
+
+                    words[i] = words[i - 16] + s0 + words[i - 7] + s1;
+                }
+
+                auto [ a, b, c, d, e, f, g, h ] = state;
+
+                for (size_t i = 0; i < 64; ++i)
+                {
+                    auto s1 = rotate(e, 6) ^ rotate(e, 11) ^ rotate(e, 25);
+                    auto choice = (e & f) ^ (~e & g);
+                    auto first = h + s1 + choice + rounds[i] + words[i];
+                    auto s0 = rotate(a, 2) ^ rotate(a, 13) ^ rotate(a, 22);
+                    auto majority = (a & b) ^ (a & c) ^ (b & c);
+                    auto second = s0 + majority;
+
+                    h = g;
+                    g = f;
+                    f = e;
+                    e = d + first;
+                    d = c;
+                    c = b;
+                    b = a;
+                    a = first + second;
+                }
+
+                uint32_t worked[8] = { a, b, c, d, e, f, g, h };
+
+                for (size_t i = 0; i < 8; ++i)
+                {
+                    state[i] += worked[i];
+                }
+            }
+
+            std::array<uint8_t, 32> digest;
+
+            for (size_t i = 0; i < 32; ++i)
+            {
+                digest[i] = static_cast<uint8_t>(state[i / 4] >> (24 - (i % 4) * 8));
+            }
+
+            return digest;
+        }
+
+
+    }
+
+
+    OptionalPath default_path()
+    {
+        if (auto cache_home = std::getenv("XDG_CACHE_HOME"); cache_home && *cache_home)
+        {
+            return std::fs::path(cache_home) / "basically";
+        }
+
+        if (auto home = std::getenv("HOME"); home && *home)
+        {
+            return std::fs::path(home) / ".cache" / "basically";
+        }
+
+        return std::nullopt;
+    }
+
+
+    std::string make_key(std::string const& text)
+    {
+        static const char digits[] = "0123456789abcdef";
+
+        std::string key;
+
+        for (auto byte : sha256(std::string(build_stamp) + "\n" + text))
+        {
+            key += digits[byte >> 4];
+            key += digits[byte & 0xf];
+        }
+
+        return key;
+    }
+
+
+    Cache::Cache(std::fs::path const& new_directory, uintmax_t new_size_limit)
+    : directory(new_directory),
+      size_limit(new_size_limit)
+    {
+    }
+
+
+    OptionalPath Cache::find(std::string const& key) const
+    {
+        auto path = path_of(key);
+        std::error_code error;
+
+        if (!std::fs::is_regular_file(path, error))
+        {
+            return std::nullopt;
+        }
+
+        // Another process may be trimming it away, which only costs a compile.
+        std::fs::last_write_time(path, std::fs::file_time_type::clock::now(), error);
+
+        return path;
+    }
+
+
+    std::fs::path Cache::store(std::string const& key,
+                               std::function<void(std::fs::path const&)> const& write) const
+    {
+        auto path = path_of(key);
+
+        replace(path, key, write);
+        trim(path);
+
+        return path;
+    }
+
+
+    void Cache::remove(std::string const& key) const noexcept
+    {
+        std::error_code error;
+        std::fs::remove(path_of(key), error);
+    }
+
+
+    std::fs::path Cache::profile_path(std::string const& key) const
+    {
+        return directory / (key + profile_extension);
+    }
+
+
+    void Cache::store_profile(std::string const& key,
+                              std::function<void(std::fs::path const&)> const& write) const
+    {
+        replace(profile_path(key), key, write);
+    }
+
+
+    std::fs::path Cache::path_of(std::string const& key) const
+    {
+        return directory / (key + library_extension);
+    }
+
+
+    void Cache::replace(std::fs::path const& path,
+                        std::string const& key,
+                        std::function<void(std::fs::path const&)> const& write) const
+    {
+        std::fs::create_directories(directory);
+
+        auto temporary = directory / (key + "." + std::to_string(getpid()) + temporary_extension);
+
+        try
+        {
+            write(temporary);
+            std::fs::rename(temporary, path);
+        }
+        catch (...)
+        {
+            std::error_code error;
+
+            std::fs::remove(temporary, error);
+            throw;
+        }
+    }
+
+
+    // Other processes may be adding and removing entries at the same time, so anything that's
+    // gone by the time it's looked at is simply passed over.
+    void Cache::trim(std::fs::path const& kept) const
+    {
+        struct Entry
+        {
+            std::fs::path path;
+            std::fs::file_time_type used;
+            uintmax_t size;
+        };
+
+        std::vector<Entry> entries;
+        uintmax_t total = 0;
+
+        std::error_code error;
+        auto now = std::fs::file_time_type::clock::now();
+
+        for (auto const& file : std::fs::directory_iterator(directory, error))
+        {
+            auto const& path = file.path();
+            auto used = file.last_write_time(error);
+
+            if (error)
+            {
+                continue;
+            }
+
+            if (path.extension() == temporary_extension)
+            {
+                if (now - used > abandoned_age)
+                {
+                    std::fs::remove(path, error);
+                }
+
+                continue;
+            }
+
+            auto size = file.file_size(error);
+
+            if (error || (path.extension() != library_extension))
+            {
+                continue;
+            }
+
+            entries.push_back({ path, used, size });
+            total += size;
+        }
+
+        std::sort(entries.begin(),
+                  entries.end(),
+                  [](auto const& lhs, auto const& rhs) { return lhs.used < rhs.used; });
+
+        for (auto const& entry : entries)
+        {
+            if (total <= size_limit)
+            {
+                break;
+            }
+
+            if ((entry.path != kept) && std::fs::remove(entry.path, error))
+            {
+                total -= entry.size;
+            }
+        }
+    }
+
+
+}
@@ -0,0 +1,69 @@
+
+#pragma once
+
+
+// Compiled modules are kept on disk as shared libraries, so that a script that hasn't changed
+// since it was last run is loaded rather than compiled again.  Each one is filed under a key
+// worked out from everything its code depends on, so a change to any of that simply files the
+// new code under a new key.  Old entries are dropped once the cache grows past its limit, the
+// least recently used first.
+namespace basically::runtime::caching
+{
+
+
+    // Where the cache lives unless told otherwise: under $XDG_CACHE_HOME, or ~/.cache if that
+    // isn't set.  Nothing if neither can be found.
+    OptionalPath default_path();
+
+
+    // The SHA-256 digest of the text in hex, for use as a key, so that no two modules' keys
+    // collide, by chance or otherwise.  The build of the interpreter itself is part of every key,
+    // as another build may well generate different code.
+    std::string make_key(std::string const& text);
+
+
+    // A directory of cached code, which any number of processes can use at the same time.
+    class Cache
+    {
+        private:
+            std::fs::path directory;
+            uintmax_t size_limit;
+
+        public:
+            Cache(std::fs::path const& new_directory, uintmax_t new_size_limit);
+
+        public:
+            // The cached code for the key, if there is any, which then counts as recently used.
+            OptionalPath find(std::string const& key) const;
+
+            // Has write produce the code for the key at a path of its own, and then moves it into
+            // place in one step.  Other processes see either all of it or nothing, and two that
+            // store the same key at once both leave complete code behind.  Then drops the least
+            // recently used entries until the cache is back within its limit.
+            std::fs::path store(std::string const& key,
+                                std::function<void(std::fs::path const&)> const& write) const;
+
+            // Drop an entry that turned out not to load.
+            void remove(std::string const& key) const noexcept;
+
+            // Where the profile of the module with the key is kept.  Profiles don't count toward
+            // the cache's limit, and are never dropped to make room.
+            std::fs::path profile_path(std::string const& key) const;
+
+            // Has write produce the profile for the key, which is then moved into place in one
+            // step, just as store does with code.
+            void store_profile(std::string const& key,
+                               std::function<void(std::fs::path const&)> const& write) const;
+
+        private:
+            std::fs::path path_of(std::string const& key) const;
+
+            void replace(std::fs::path const& path,
+                         std::string const& key,
+                         std::function<void(std::fs::path const&)> const& write) const;
+
+            void trim(std::fs::path const& kept) const;
+    };
+
+
+}
@@ -0,0 +1,210 @@
+
+#include "basically.h"
+
+
+namespace basically::runtime::effects
+{
+
+
+    namespace
+    {
+
+
+        struct Estimate
+        {
+            typing::Effect effect = typing::Effect::Pure;
+            bool can_fail = false;
+
+            bool operator ==(Estimate const& estimate) const noexcept = default;
+        };
+
+
+        // The variable an address points into, the LocalAddress or GlobalAddress of its frame, or
+        // whatever else the address was computed from.
+        ir::Instruction const& root_of(ir::Function const& function, ir::ValueId address)
+        {
+            while (   (function[address].opcode == ir::Opcode::ElementAddress)
+                   || (function[address].opcode == ir::Opcode::FieldAddress)
+                   || (function[address].opcode == ir::Opcode::SoaAddress)
+                   || (function[address].opcode == ir::Opcode::Offset))
+            {
+                address = function[address].a;
+            }
+
+            return function[address];
+        }
+
+
+        bool is_integer_division(ir::Instruction const& instruction)
+        {
+            auto number = typing::get_type_context().number_info(instruction.type);
+
+            return    (instruction.opcode == ir::Opcode::Divide)
+                   && number
+                   && (number->is_floating_point != typing::FloatingPointFlag::IsFloatingPoint);
+        }
+
+
+        // A divisor that's a constant other than zero and -1 can't fail.
+        bool is_safe_divisor(ir::Function const& function, ir::ValueId divisor)
+        {
+            if (function[divisor].opcode != ir::Opcode::Constant)
+            {
+                return false;
+            }
+
+            auto bits = std::get<uint64_t>(function.constants[function[divisor].immediate].value);
+            return (bits != 0) && (static_cast<int64_t>(bits) != -1);
+        }
+
+
+        Estimate estimate_of(ir::Unit const& unit,
+                             ir::Function const& function,
+                             std::unordered_map<typing::SubInfo const*, Estimate> const& estimates)
+        {
+            Estimate estimate;
+
+            auto at_least = [&](typing::Effect effect)
+                {
+                    estimate.effect = std::max(estimate.effect, effect);
+                };
+
+            auto touches = [&](ir::ValueId address, typing::Effect effect)
+                {
+                    auto const& root = root_of(function, address);
+
+                    if (root.opcode == ir::Opcode::LocalAddress)
+                    {
+                        return;
+                    }
+
+                    if (   (root.opcode != ir::Opcode::GlobalAddress)
+                        || !unit.globals[root.immediate].is_cache)
+                    {
+                        at_least(effect);
+                    }
+                };
+
+            for (auto const& block : function.blocks)
+            {
+                for (auto id : block.instructions)
+                {
+                    auto const& instruction = function[id];
+
+                    if (instruction.flags & ir::BoundsChecked)
+                    {
+                        estimate.can_fail = true;
+                    }
+
+                    switch (instruction.opcode)
+                    {
+                        case ir::Opcode::Load:
+                            touches(instruction.a, typing::Effect::ReadOnly);
+                            break;
+
+                        case ir::Opcode::Store:
+                        case ir::Opcode::Clear:
+                            touches(instruction.a, typing::Effect::Effectful);
+                            break;
+
+                        case ir::Opcode::Divide:
+                            if (   is_integer_division(instruction)
+                                && !is_safe_divisor(function, instruction.b))
+                            {
+                                estimate.can_fail = true;
+                            }
+                            break;
+
+                        case ir::Opcode::Call:
+                            {
+                                auto const& sub = unit.callees[instruction.immediate].sub;
+                                auto found = estimates.find(sub.get());
+
+                                if (found != estimates.end())
+                                {
+                                    at_least(found->second.effect);
+                                    estimate.can_fail |= found->second.can_fail;
+                                }
+                                else
+                                {
+                                    at_least(sub->effect);
+                                    estimate.can_fail |= sub->can_fail;
+                                }
+                            }
+                            break;
+
+                        default:
+                            break;
+                    }
+                }
+            }
+
+            return estimate;
+        }
+
+
+    }
+
+
+    Summary analyze_effects(ir::Unit const& unit)
+    {
+        std::unordered_map<typing::SubInfo const*, Estimate> estimates;
+
+        for (auto const& function : unit.functions)
+        {
+            if (function.sub)
+            {
+                estimates.insert({ function.sub.get(), {} });
+            }
+        }
+
+        // Estimates only ever get worse, so this ends after at most a few rounds per function.
+        for (auto changed = true; changed; )
+        {
+            changed = false;
+
+            for (auto const& function : unit.functions)
+            {
+                if (!function.sub)
+                {
+                    continue;
+                }
+
+                auto estimate = estimate_of(unit, function, estimates);
+                auto& current = estimates[function.sub.get()];
+
+                if (estimate != current)
+                {
+                    current = estimate;
+                    changed = true;
+                }
+            }
+        }
+
+        Summary summary;
+
+        for (auto const& function : unit.functions)
+        {
+            if (!function.sub)
+            {
+                continue;
+            }
+
+            auto const& estimate = estimates[function.sub.get()];
+
+            function.sub->effect = estimate.effect;
+            function.sub->can_fail = estimate.can_fail;
+
+            switch (estimate.effect)
+            {
+                case typing::Effect::Pure:      ++summary.pure;      break;
+                case typing::Effect::ReadOnly:  ++summary.read_only; break;
+                case typing::Effect::Effectful: ++summary.effectful; break;
+            }
+        }
+
+        return summary;
+    }
+
+
+}
@@ -0,0 +1,25 @@
+
+#pragma once
+
+
+namespace basically::runtime::effects
+{
+
+
+    struct Summary
+    {
+        size_t pure = 0;
+        size_t read_only = 0;
+        size_t effectful = 0;
+    };
+
+
+    // Works out what each sub and function of a unit can do to the variables it doesn't own, and
+    // whether it can fail, and records that in its SubInfo.  Calls to another module's code take
+    // what was found for that module when it was loaded.  Calls within the unit are worked out
+    // together, starting from the assumption that everything is pure and can't fail, until no
+    // function has to give up any more of that.  That way recursive functions can still be pure.
+    Summary analyze_effects(ir::Unit const& unit);
+
+
+}
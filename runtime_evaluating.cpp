@@ -0,0 +1,1118 @@
+
+#include "basically.h"
+
+
+namespace basically::runtime::evaluating
+{
+
+
+    namespace
+    {
+
+
+        // Deep enough for any sensible recursion, shallow enough to stay well within the
+        // compiler's own stack.
+        const size_t max_depth = 256;
+
+
+        // Thrown when the code needs something only known at run time, or runs out of budget.
+        struct Unknown
+        {
+        };
+
+
+        // A byte offset into one of the machine's variables, a global of the unit or a slot of
+        // one of the frames on its stack.
+        struct Address
+        {
+            bool is_global;
+            size_t variable;
+            size_t offset;
+        };
+
+
+        // The constants held in a variable, or in a structure or array value, by byte offset.
+        // Anything never stored to is zero.
+        using Cells = std::map<size_t, ir::Constant>;
+
+        using Value = std::variant<std::monostate, ir::Constant, Address, Cells>;
+
+
+        struct Variable
+        {
+            typing::TypeId type;
+            Cells cells;
+
+            // What a variable of a pointer type, such as a reduced loop's induction pointer,
+            // points to.
+            std::optional<Address> pointer;
+        };
+
+
+        bool is_scalar(typing::TypeId type)
+        {
+            auto const& context = typing::get_type_context();
+
+            return    context.is_number(type)
+                   || context.is_boolean(type)
+                   || context.is_string(type);
+        }
+
+
+        ir::Constant zero_of(typing::TypeId type)
+        {
+            auto const& context = typing::get_type_context();
+
+            if (context.is_string(type))
+            {
+                return { .type = type, .value = std::string() };
+            }
+
+            auto number = context.number_info(type);
+
+            if (   number
+                && (number->is_floating_point == typing::FloatingPointFlag::IsFloatingPoint))
+            {
+                return { .type = type, .value = 0.0 };
+            }
+
+            return { .type = type, .value = uint64_t { 0 } };
+        }
+
+
+        // Signed integers keep their bits sign extended, so this is their value.  Unsigned ones
+        // too large for an int64_t come out negative, which no index or count can be.
+        int64_t integer_of(ir::Constant const& constant)
+        {
+            return static_cast<int64_t>(std::get<uint64_t>(constant.value));
+        }
+
+
+        // One step from the address of a structure or array to the address of something within
+        // it.
+        struct Step
+        {
+            ir::Opcode opcode;
+            typing::TypeId type;
+
+            uint64_t index = 0;
+            uint32_t field = 0;
+        };
+
+
+        // The element and field addresses leading from the start of a variable of the container
+        // type to a value of the target type at the offset.  Nothing if there's no such value
+        // there.
+        std::optional<std::vector<Step>> path_to(typing::TypeId container,
+                                                 size_t offset,
+                                                 typing::TypeId target)
+        {
+            auto& context = typing::get_type_context();
+
+            std::vector<Step> steps;
+            auto type = container;
+
+            while ((offset != 0) || (type != target))
+            {
+                if (context.is_array(type))
+                {
+                    auto const& entry = context.get(type);
+
+                    if (entry.is_soa)
+                    {
+                        auto const& structure = *context.structure_info(entry.element);
+                        auto layout = typing::compute_soa_layout(structure, entry.count);
+
+                        auto field = std::find_if(structure.fields.begin(),
+                                                  structure.fields.end(),
+                                                  [&](auto const& field)
+                                                  {
+                                                      auto index = &field - &structure.fields[0];
+                                                      auto start = layout.field_offsets[index];
+
+                                                      return    (offset >= start)
+                                                             && (  offset - start
+                                                                 < (  entry.count
+                                                                    * context.size_of(
+                                                                               field.type.id)));
+                                                  });
+
+                        if (field == structure.fields.end())
+                        {
+                            return std::nullopt;
+                        }
+
+                        auto index = static_cast<uint32_t>(field - structure.fields.begin());
+                        auto size = context.size_of(field->type.id);
+                        auto within = offset - layout.field_offsets[index];
+
+                        steps.push_back({
+                                .opcode = ir::Opcode::SoaAddress,
+                                .type = context.intern_pointer(field->type.id),
+                                .index = within / size,
+                                .field = index
+                            });
+
+                        type = field->type.id;
+                        offset = within % size;
+                    }
+                    else
+                    {
+                        auto size = context.size_of(entry.element);
+
+                        if (offset / size >= entry.count)
+                        {
+                            return std::nullopt;
+                        }
+
+                        steps.push_back({
+                                .opcode = ir::Opcode::ElementAddress,
+                                .type = context.intern_pointer(entry.element),
+                                .index = offset / size
+                            });
+
+                        type = entry.element;
+                        offset %= size;
+                    }
+                }
+                else if (context.is_structure(type))
+                {
+                    auto const& fields = context.structure_info(type)->fields;
+
+                    auto field = std::find_if(fields.begin(),
+                                              fields.end(),
+                                              [&](auto const& field)
+                                              {
+                                                  return    (offset >= field.offset)
+                                                         && (  offset - field.offset
+                                                             < context.size_of(field.type.id));
+                                              });
+
+                    if (field == fields.end())
+                    {
+                        return std::nullopt;
+                    }
+
+                    steps.push_back({
+                            .opcode = ir::Opcode::FieldAddress,
+                            .type = context.intern_pointer(field->type.id),
+                            .field = static_cast<uint32_t>(field - fields.begin())
+                        });
+
+                    type = field->type.id;
+                    offset -= field->offset;
+                }
+                else
+                {
+                    return std::nullopt;
+                }
+            }
+
+            return steps;
+        }
+
+
+        // The same for an address, which may also be just past the end of an array, as a
+        // finished loop leaves its induction pointer.
+        std::optional<std::vector<Step>> address_path(typing::TypeId container,
+                                                      size_t offset,
+                                                      typing::TypeId target)
+        {
+            auto& context = typing::get_type_context();
+
+            if (auto steps = path_to(container, offset, target); steps)
+            {
+                return steps;
+            }
+
+            auto size = context.size_of(target);
+
+            if (offset < size)
+            {
+                return std::nullopt;
+            }
+
+            auto steps = path_to(container, offset - size, target);
+
+            if (steps)
+            {
+                steps->push_back({
+                        .opcode = ir::Opcode::Offset,
+                        .type = context.intern_pointer(target),
+                        .index = 1
+                    });
+            }
+
+            return steps;
+        }
+
+
+        // An IR interpreter over a unit's own functions and variables.
+        class Machine
+        {
+            public:
+                // Called on the way into each block of the outermost function, with the values
+                // worked out so far.
+                using EntryHook = std::function<void(ir::BlockId, std::vector<Value> const&)>;
+
+            private:
+                ir::Unit const& unit;
+                typing::TypeContext& context;
+
+                size_t budget;
+                size_t steps = 0;
+                size_t depth = 0;
+
+                std::map<uint32_t, Variable> globals;
+
+                // The slots of every frame on the stack, the outermost first.
+                std::vector<Variable> locals;
+
+            public:
+                Machine(ir::Unit const& new_unit, size_t new_budget)
+                : unit(new_unit),
+                  context(typing::get_type_context()),
+                  budget(new_budget)
+                {
+                }
+
+            public:
+                size_t get_steps() const noexcept
+                {
+                    return steps;
+                }
+
+                std::map<uint32_t, Variable> const& get_globals() const noexcept
+                {
+                    return globals;
+                }
+
+                std::vector<Variable> const& get_locals() const noexcept
+                {
+                    return locals;
+                }
+
+                Value run(ir::Function const& function,
+                          std::vector<Value> const& arguments,
+                          EntryHook const& on_entry = {})
+                {
+                    if (++depth > max_depth)
+                    {
+                        throw Unknown();
+                    }
+
+                    auto frame = locals.size();
+
+                    for (auto const& slot : function.slots)
+                    {
+                        locals.push_back({ .type = slot.type });
+                    }
+
+                    std::vector<Value> values(function.instructions.size());
+                    ir::BlockId block = 0;
+
+                    for (;;)
+                    {
+                        if (on_entry)
+                        {
+                            on_entry(block, values);
+                        }
+
+                        for (auto id : function.blocks[block].instructions)
+                        {
+                            if (++steps > budget)
+                            {
+                                throw Unknown();
+                            }
+
+                            auto const& instruction = function[id];
+
+                            switch (instruction.opcode)
+                            {
+                                case ir::Opcode::Jump:
+                                    block = instruction.immediate;
+                                    break;
+
+                                case ir::Opcode::Branch:
+                                    {
+                                        auto const& test = constant(values, instruction.a);
+
+                                        block = std::get<uint64_t>(test.value)
+                                            ? instruction.immediate
+                                            : instruction.extra;
+                                    }
+                                    break;
+
+                                case ir::Opcode::Switch:
+                                    {
+                                        auto const& test = constant(values, instruction.a);
+                                        auto cases = function.cases_of(instruction);
+
+                                        auto found = std::find_if(
+                                                    cases.begin(),
+                                                    cases.end(),
+                                                    [&](auto const& switch_case)
+                                                    {
+                                                        auto const& value =
+                                                          function.constants[switch_case.constant];
+
+                                                        return value.value == test.value;
+                                                    });
+
+                                        block = (found != cases.end()) ? found->target
+                                                                       : instruction.immediate;
+                                    }
+                                    break;
+
+                                case ir::Opcode::Return:
+                                    {
+                                        auto result = (instruction.a != ir::no_id)
+                                            ? values[instruction.a]
+                                            : Value();
+
+                                        locals.resize(frame);
+                                        --depth;
+
+                                        return result;
+                                    }
+
+                                default:
+                                    values[id] = execute(function,
+                                                         instruction,
+                                                         values,
+                                                         arguments,
+                                                         frame);
+                                    break;
+                            }
+                        }
+                    }
+                }
+
+            private:
+                ir::Constant const& constant(std::vector<Value> const& values, ir::ValueId value)
+                {
+                    auto found = std::get_if<ir::Constant>(&values[value]);
+
+                    if (!found)
+                    {
+                        throw Unknown();
+                    }
+
+                    return *found;
+                }
+
+                Address address(std::vector<Value> const& values, ir::ValueId value)
+                {
+                    auto found = std::get_if<Address>(&values[value]);
+
+                    if (!found)
+                    {
+                        throw Unknown();
+                    }
+
+                    return *found;
+                }
+
+                // The element or [soa] index, which has to be in the array's range.
+                uint64_t index_into(typing::TypeId array, ir::Constant const& index)
+                {
+                    auto value = integer_of(index);
+
+                    if ((value < 0) || (static_cast<uint64_t>(value) >= context.get(array).count))
+                    {
+                        throw Unknown();
+                    }
+
+                    return static_cast<uint64_t>(value);
+                }
+
+                Value execute(ir::Function const& function,
+                              ir::Instruction const& instruction,
+                              std::vector<Value> const& values,
+                              std::vector<Value> const& arguments,
+                              size_t frame)
+                {
+                    auto pointee = [&](ir::ValueId value)
+                        {
+                            return context.element_of(function[value].type);
+                        };
+
+                    switch (instruction.opcode)
+                    {
+                        case ir::Opcode::Constant:
+                            return function.constants[instruction.immediate];
+
+                        case ir::Opcode::Parameter:
+                            return arguments[instruction.immediate];
+
+                        case ir::Opcode::LocalAddress:
+                            return Address
+                                {
+                                    .is_global = false,
+                                    .variable = frame + instruction.immediate,
+                                    .offset = 0
+                                };
+
+                        case ir::Opcode::GlobalAddress:
+                            return Address
+                                {
+                                    .is_global = true,
+                                    .variable = instruction.immediate,
+                                    .offset = 0
+                                };
+
+                        case ir::Opcode::ElementAddress:
+                            {
+                                auto result = address(values, instruction.a);
+                                auto array = pointee(instruction.a);
+                                auto index = index_into(array, constant(values, instruction.b));
+
+                                result.offset += index * context.size_of(context.element_of(array));
+                                return result;
+                            }
+
+                        case ir::Opcode::FieldAddress:
+                            {
+                                auto result = address(values, instruction.a);
+                                auto structure = context.structure_info(pointee(instruction.a));
+
+                                result.offset += structure->fields[instruction.immediate].offset;
+                                return result;
+                            }
+
+                        case ir::Opcode::SoaAddress:
+                            {
+                                auto result = address(values, instruction.a);
+                                auto array = pointee(instruction.a);
+                                auto index = index_into(array, constant(values, instruction.b));
+
+                                auto const& entry = context.get(array);
+                                auto const& structure = *context.structure_info(entry.element);
+                                auto const& field = structure.fields[instruction.immediate];
+                                auto layout = typing::compute_soa_layout(structure, entry.count);
+
+                                result.offset +=   layout.field_offsets[instruction.immediate]
+                                                 + index * context.size_of(field.type.id);
+                                return result;
+                            }
+
+                        // Offsets past either end wrap around to something too large for the
+                        // variable, which is caught when the address is used.
+                        case ir::Opcode::Offset:
+                            {
+                                auto result = address(values, instruction.a);
+                                auto count = integer_of(constant(values, instruction.b));
+
+                                result.offset +=   static_cast<uint64_t>(count)
+                                                 * context.size_of(pointee(instruction.a));
+                                return result;
+                            }
+
+                        case ir::Opcode::Load:
+                            return load(address(values, instruction.a), instruction.type);
+
+                        case ir::Opcode::Store:
+                            store(address(values, instruction.a),
+                                  values[instruction.b],
+                                  function[instruction.b].type);
+                            return {};
+
+                        case ir::Opcode::Clear:
+                            store(address(values, instruction.a), Cells(), pointee(instruction.a));
+                            return {};
+
+                        case ir::Opcode::Call:
+                            {
+                                auto const& callee = unit.callees[instruction.immediate];
+                                auto called = unit.find_function(callee.sub.get());
+
+                                if ((callee.module != unit.module) || !called)
+                                {
+                                    throw Unknown();
+                                }
+
+                                std::vector<Value> passed;
+
+                                for (auto operand : function.operands_of(instruction))
+                                {
+                                    passed.push_back(values[operand]);
+                                }
+
+                                return run(*called, passed);
+                            }
+
+                        default:
+                            {
+                                auto const& a = constant(values, instruction.a);
+                                std::optional<ir::Constant> b;
+
+                                if (instruction.b != ir::no_id)
+                                {
+                                    b = constant(values, instruction.b);
+                                }
+
+                                // A division that fails is left for run time, which reports
+                                // it the way the interpreter and compiled code do, for every
+                                // width of integer.
+                                if (   (instruction.opcode == ir::Opcode::Divide)
+                                    && ir::division_fails(a, b.value()))
+                                {
+                                    throw Unknown();
+                                }
+
+                                auto result = ir::evaluate(instruction, a, b);
+
+                                if (!result)
+                                {
+                                    throw Unknown();
+                                }
+
+                                return result.value();
+                            }
+                    }
+                }
+
+                // Other modules' variables hold whatever their code gave them at run time.
+                Variable& variable_at(Address const& address)
+                {
+                    if (!address.is_global)
+                    {
+                        return locals[address.variable];
+                    }
+
+                    auto id = static_cast<uint32_t>(address.variable);
+
+                    if (auto found = globals.find(id); found != globals.end())
+                    {
+                        return found->second;
+                    }
+
+                    auto const& global = unit.globals[id];
+
+                    if (global.module != unit.module)
+                    {
+                        throw Unknown();
+                    }
+
+                    return globals.insert({ id, { .type = global.type } }).first->second;
+                }
+
+                // The cells of a value of the type at the address.  Any cell only partly within
+                // it means the memory is being looked at as something other than what was
+                // stored there, which is left for run time.
+                std::pair<Cells::iterator, Cells::iterator> cells_of(Variable& variable,
+                                                                     size_t offset,
+                                                                     typing::TypeId type)
+                {
+                    auto size = context.size_of(type);
+                    auto variable_size = context.size_of(variable.type);
+
+                    if ((offset > variable_size) || (size > variable_size - offset))
+                    {
+                        throw Unknown();
+                    }
+
+                    auto first = variable.cells.lower_bound(offset);
+                    auto last = variable.cells.lower_bound(offset + size);
+
+                    if (first != variable.cells.begin())
+                    {
+                        auto before = std::prev(first);
+
+                        if (before->first + context.size_of(before->second.type) > offset)
+                        {
+                            throw Unknown();
+                        }
+                    }
+
+                    if (first != last)
+                    {
+                        auto back = std::prev(last);
+
+                        if (back->first + context.size_of(back->second.type) > offset + size)
+                        {
+                            throw Unknown();
+                        }
+                    }
+
+                    return { first, last };
+                }
+
+                // Pointers are only ever kept whole, in variables of their own.
+                Variable& pointer_at(Address const& address, typing::TypeId type)
+                {
+                    auto& variable = variable_at(address);
+
+                    if ((variable.type != type) || (address.offset != 0))
+                    {
+                        throw Unknown();
+                    }
+
+                    return variable;
+                }
+
+                Value load(Address const& address, typing::TypeId type)
+                {
+                    if (context.is_pointer(type))
+                    {
+                        auto const& pointer = pointer_at(address, type).pointer;
+
+                        if (!pointer)
+                        {
+                            throw Unknown();
+                        }
+
+                        return pointer.value();
+                    }
+
+                    auto& variable = variable_at(address);
+                    auto [ first, last ] = cells_of(variable, address.offset, type);
+
+                    if (is_scalar(type))
+                    {
+                        if (first == last)
+                        {
+                            return zero_of(type);
+                        }
+
+                        if ((first->first != address.offset) || (first->second.type != type))
+                        {
+                            throw Unknown();
+                        }
+
+                        return first->second;
+                    }
+
+                    Cells cells;
+
+                    for (auto cell = first; cell != last; ++cell)
+                    {
+                        cells.insert({ cell->first - address.offset, cell->second });
+                    }
+
+                    return cells;
+                }
+
+                void store(Address const& address, Value const& value, typing::TypeId type)
+                {
+                    if (auto pointer = std::get_if<Address>(&value); pointer)
+                    {
+                        pointer_at(address, type).pointer = *pointer;
+                        return;
+                    }
+
+                    if (context.is_pointer(type))
+                    {
+                        throw Unknown();
+                    }
+
+                    auto& variable = variable_at(address);
+                    auto [ first, last ] = cells_of(variable, address.offset, type);
+
+                    variable.cells.erase(first, last);
+
+                    if (auto scalar = std::get_if<ir::Constant>(&value); scalar)
+                    {
+                        variable.cells.insert({ address.offset, *scalar });
+                    }
+                    else if (auto cells = std::get_if<Cells>(&value); cells)
+                    {
+                        for (auto const& [ offset, constant ] : *cells)
+                        {
+                            variable.cells.insert({ address.offset + offset, constant });
+                        }
+                    }
+                    else
+                    {
+                        throw Unknown();
+                    }
+                }
+        };
+
+
+        // Where the initializer can pick up from, and what it needs to do so.
+        struct Snapshot
+        {
+            ir::BlockId block = 0;
+            size_t steps = 0;
+
+            std::map<uint32_t, Variable> globals;
+            std::vector<Variable> slots;
+
+            // The values defined before the block and used from it on.
+            std::vector<std::pair<ir::ValueId, Value>> inputs;
+
+            // Set instead of the rest once all of it has run.
+            std::optional<ir::Constant> result;
+        };
+
+
+        // For each block outside of any loop, the values used by it and the blocks reachable
+        // from it that are defined in blocks that aren't.  Once the block is reached, those are
+        // never computed again.
+        std::vector<std::optional<std::vector<ir::ValueId>>> find_inputs(
+                                                                   ir::Function const& function)
+        {
+            auto count = function.blocks.size();
+
+            std::vector<bool> in_loop(count, false);
+
+            for (auto const& loop : ir::find_loops(function))
+            {
+                for (auto block : loop.blocks)
+                {
+                    in_loop[block] = true;
+                }
+            }
+
+            std::vector<ir::BlockId> defined_in(function.instructions.size(), ir::no_id);
+
+            for (ir::BlockId block = 0; block < count; ++block)
+            {
+                for (auto id : function.blocks[block].instructions)
+                {
+                    defined_in[id] = block;
+                }
+            }
+
+            std::vector<std::optional<std::vector<ir::ValueId>>> inputs(count);
+
+            for (ir::BlockId start = 1; start < count; ++start)
+            {
+                if (in_loop[start])
+                {
+                    continue;
+                }
+
+                std::vector<bool> reached(count, false);
+                std::vector<ir::BlockId> work { start };
+
+                reached[start] = true;
+
+                while (!work.empty())
+                {
+                    auto block = work.back();
+                    work.pop_back();
+
+                    for (auto successor : function.successors(block))
+                    {
+                        if (!reached[successor])
+                        {
+                            reached[successor] = true;
+                            work.push_back(successor);
+                        }
+                    }
+                }
+
+                std::set<ir::ValueId> used;
+
+                auto use = [&](ir::ValueId value)
+                    {
+                        if ((value != ir::no_id) && !reached[defined_in[value]])
+                        {
+                            used.insert(value);
+                        }
+                    };
+
+                for (ir::BlockId block = 0; block < count; ++block)
+                {
+                    if (!reached[block])
+                    {
+                        continue;
+                    }
+
+                    for (auto id : function.blocks[block].instructions)
+                    {
+                        auto const& instruction = function[id];
+
+                        use(instruction.a);
+                        use(instruction.b);
+
+                        for (auto operand : function.operands_of(instruction))
+                        {
+                            use(operand);
+                        }
+                    }
+                }
+
+                inputs[start] = std::vector<ir::ValueId>(used.begin(), used.end());
+            }
+
+            return inputs;
+        }
+
+
+        // The address of a value of the target type at an offset into a variable, built from
+        // the variable's own address.
+        ir::ValueId build_address(ir::Builder& builder,
+                                  ir::ValueId base,
+                                  typing::TypeId variable_type,
+                                  size_t offset,
+                                  typing::TypeId target)
+        {
+            auto const& builtins = modules::get_builtins_module();
+            auto count_type = builtins->find_type("u64")->id;
+
+            auto steps = address_path(variable_type, offset, target).value();
+
+            for (auto const& step : steps)
+            {
+                ir::Instruction instruction { .opcode = step.opcode, .type = step.type, .a = base };
+
+                if (step.opcode != ir::Opcode::FieldAddress)
+                {
+                    instruction.b = builder.constant({ .type = count_type, .value = step.index });
+                }
+
+                if (   (step.opcode == ir::Opcode::FieldAddress)
+                    || (step.opcode == ir::Opcode::SoaAddress))
+                {
+                    instruction.immediate = step.field;
+                }
+
+                base = builder.add(instruction);
+            }
+
+            return base;
+        }
+
+
+    }
+
+
+    std::optional<ir::Constant> evaluate_call(ir::Unit const& unit,
+                                              ir::Function const& function,
+                                              std::vector<ir::Constant> const& arguments,
+                                              size_t budget)
+    {
+        Machine machine(unit, budget);
+
+        try
+        {
+            auto result = machine.run(function,
+                                      std::vector<Value>(arguments.begin(), arguments.end()));
+
+            if (auto constant = std::get_if<ir::Constant>(&result); constant)
+            {
+                return *constant;
+            }
+        }
+        catch (Unknown const&)
+        {
+        }
+
+        return std::nullopt;
+    }
+
+
+    Progress evaluate_initializer(ir::Unit& unit, size_t budget)
+    {
+        auto found = std::find_if(unit.functions.begin(),
+                                  unit.functions.end(),
+                                  [](auto const& function) { return !function.sub; });
+
+        if ((budget == 0) || (found == unit.functions.end()))
+        {
+            return {};
+        }
+
+        auto& function = *found;
+        auto& context = typing::get_type_context();
+
+        auto inputs = find_inputs(function);
+
+        Machine machine(unit, budget);
+        std::optional<Snapshot> snapshot;
+
+        auto type_of = [&](Address const& address)
+            {
+                return address.is_global ? unit.globals[address.variable].type
+                                         : function.slots[address.variable].type;
+            };
+
+        // Only constants, and addresses of whole variables or of what's within them, can be
+        // rebuilt in the new entry block.
+        auto can_rebuild = [&](Value const& value, typing::TypeId type) -> bool
+            {
+                if (std::holds_alternative<ir::Constant>(value))
+                {
+                    return true;
+                }
+
+                auto address = std::get_if<Address>(&value);
+
+                return    address
+                       && address_path(type_of(*address),
+                                  address->offset,
+                                  context.element_of(type)).has_value();
+            };
+
+        // The module's variables can't start out pointing anywhere.
+        auto has_pointers = [&]()
+            {
+                return std::any_of(machine.get_globals().begin(),
+                                   machine.get_globals().end(),
+                                   [](auto const& global) { return global.second.pointer; });
+            };
+
+        auto on_entry = [&](ir::BlockId block, std::vector<Value> const& values)
+            {
+                if (!inputs[block] || has_pointers())
+                {
+                    return;
+                }
+
+                for (auto input : inputs[block].value())
+                {
+                    if (!can_rebuild(values[input], function[input].type))
+                    {
+                        return;
+                    }
+                }
+
+                auto const& slots = machine.get_locals();
+
+                for (auto const& slot : slots)
+                {
+                    for (auto const& [ offset, constant ] : slot.cells)
+                    {
+                        if (!path_to(slot.type, offset, constant.type))
+                        {
+                            return;
+                        }
+                    }
+
+                    if (slot.pointer && !can_rebuild(slot.pointer.value(), slot.type))
+                    {
+                        return;
+                    }
+                }
+
+                snapshot = Snapshot
+                    {
+                        .block = block,
+                        .steps = machine.get_steps(),
+                        .globals = machine.get_globals(),
+                        .slots = slots
+                    };
+
+                for (auto input : inputs[block].value())
+                {
+                    snapshot->inputs.push_back({ input, values[input] });
+                }
+            };
+
+        try
+        {
+            auto result = machine.run(function, {}, on_entry);
+            auto constant = std::get_if<ir::Constant>(&result);
+
+            if (constant && !has_pointers())
+            {
+                snapshot = Snapshot
+                    {
+                        .block = ir::no_id,
+                        .steps = machine.get_steps(),
+                        .globals = machine.get_globals(),
+                        .result = *constant
+                    };
+            }
+        }
+        catch (Unknown const&)
+        {
+        }
+
+        if (!snapshot)
+        {
+            return {};
+        }
+
+        for (auto const& [ id, variable ] : snapshot->globals)
+        {
+            if (!unit.globals[id].is_cache)
+            {
+                unit.globals[id].initial = variable.cells;
+            }
+        }
+
+        // The new entry block sets up the locals and values the rest expects, then goes on from
+        // where evaluation left off.
+        function.blocks[0].instructions.clear();
+
+        ir::Builder builder(function);
+        builder.set_block(0);
+
+        if (snapshot->result)
+        {
+            builder.add({ .opcode = ir::Opcode::Return,
+                          .a = builder.constant(snapshot->result.value()) });
+
+            ir::remove_unreachable_blocks(function);
+            ir::compact(function);
+
+            return { .instructions = snapshot->steps, .is_complete = true };
+        }
+
+        auto address_of = [&](Address const& address, typing::TypeId type)
+            {
+                auto variable_type = type_of(address);
+                auto base = builder.add({
+                        .opcode = address.is_global ? ir::Opcode::GlobalAddress
+                                                    : ir::Opcode::LocalAddress,
+                        .type = context.intern_pointer(variable_type),
+                        .immediate = static_cast<uint32_t>(address.variable)
+                    });
+
+                return build_address(builder, base, variable_type, address.offset, type);
+            };
+
+        for (size_t slot = 0; slot < snapshot->slots.size(); ++slot)
+        {
+            auto const& variable = snapshot->slots[slot];
+            Address whole { .is_global = false, .variable = slot, .offset = 0 };
+
+            for (auto const& [ offset, constant ] : variable.cells)
+            {
+                builder.add({ .opcode = ir::Opcode::Store,
+                              .a = address_of({ .is_global = false,
+                                                .variable = slot,
+                                                .offset = offset },
+                                              constant.type),
+                              .b = builder.constant(constant) });
+            }
+
+            if (variable.pointer)
+            {
+                auto const& pointer = variable.pointer.value();
+
+                builder.add({ .opcode = ir::Opcode::Store,
+                              .a = address_of(whole, variable.type),
+                              .b = address_of(pointer, context.element_of(variable.type)) });
+            }
+        }
+
+        std::vector<ir::ValueId> replacements(function.instructions.size(), ir::no_id);
+
+        for (auto const& [ input, value ] : snapshot->inputs)
+        {
+            if (auto constant = std::get_if<ir::Constant>(&value); constant)
+            {
+                replacements[input] = builder.constant(*constant);
+            }
+            else
+            {
+                replacements[input] = address_of(std::get<Address>(value),
+                                                 context.element_of(function[input].type));
+            }
+        }
+
+        builder.jump(snapshot->block);
+
+        ir::replace_values(function, replacements);
+        ir::remove_unreachable_blocks(function);
+        ir::compact(function);
+
+        return { .instructions = snapshot->steps, .is_complete = false };
+    }
+
+}
@@ -0,0 +1,37 @@
+
+#pragma once
+
+
+namespace basically::runtime::evaluating
+{
+
+
+    // The result of calling one of the unit's functions with constant arguments, worked out at
+    // compile time.  Nothing if it takes more than the budget's worth of instructions, or needs
+    // anything that's only known at run time: the variables of other modules, calls into their
+    // code, or an operation that fails.
+    std::optional<ir::Constant> evaluate_call(ir::Unit const& unit,
+                                              ir::Function const& function,
+                                              std::vector<ir::Constant> const& arguments,
+                                              size_t budget);
+
+
+    struct Progress
+    {
+        // Instructions of the initializer, and of what it calls, run at compile time.
+        size_t instructions = 0;
+
+        // Whether all of it ran, so that at startup it only returns the module's result.
+        bool is_complete = false;
+    };
+
+
+    // Runs as much of a unit's initializer as the budget allows at compile time, and then has it
+    // start from where that left off.  The module's variables start out holding what had been
+    // stored to them, and the initializer's own locals are set to what they held on the way in.
+    // It only ever picks up again at a block outside of any loop, so nothing of a loop's state
+    // needs keeping.
+    Progress evaluate_initializer(ir::Unit& unit, size_t budget);
+
+
+}
@@ -0,0 +1,1034 @@
+
+#include "basically.h"
+
+
+namespace basically::runtime::inference
+{
+
+
+    namespace
+    {
+
+
+        const __int128 max_constant = std::numeric_limits<uint64_t>::max();
+        const __int128 min_constant = std::numeric_limits<int64_t>::min();
+
+
+        std::string to_string(__int128 value)
+        {
+            if (value == 0)
+            {
+                return "0";
+            }
+
+            auto is_negative = value < 0;
+            std::string digits;
+
+            for (; value != 0; value /= 10)
+            {
+                auto digit = static_cast<int>(value % 10);
+                digits.push_back(static_cast<char>('0' + (is_negative ? -digit : digit)));
+            }
+
+            if (is_negative)
+            {
+                digits.push_back('-');
+            }
+
+            return std::string(digits.rbegin(), digits.rend());
+        }
+
+
+        std::string operator_name(lexing::Type type)
+        {
+            static const std::unordered_map<lexing::Type, std::string> names =
+                {
+                    { lexing::Type::SymbolEqual,       "=="  },
+                    { lexing::Type::SymbolNotEqual,    "<>"  },
+                    { lexing::Type::SymbolLessThan,    "<"   },
+                    { lexing::Type::SymbolGreaterThan, ">"   },
+                    { lexing::Type::SymbolPlus,        "+"   },
+                    { lexing::Type::SymbolMinus,       "-"   },
+                    { lexing::Type::SymbolTimes,       "*"   },
+                    { lexing::Type::SymbolDivide,      "/"   },
+                    { lexing::Type::KeywordAnd,        "and" },
+                    { lexing::Type::KeywordOr,         "or"  },
+                    { lexing::Type::KeywordNot,        "not" }
+                };
+
+            auto found = names.find(type);
+            return found != names.end() ? found->second : "???";
+        }
+
+
+        bool is_arithmetic(lexing::Type type) noexcept
+        {
+            return    (type == lexing::Type::SymbolPlus)
+                   || (type == lexing::Type::SymbolMinus)
+                   || (type == lexing::Type::SymbolTimes)
+                   || (type == lexing::Type::SymbolDivide);
+        }
+
+
+        bool is_comparison(lexing::Type type) noexcept
+        {
+            return    (type == lexing::Type::SymbolEqual)
+                   || (type == lexing::Type::SymbolNotEqual)
+                   || (type == lexing::Type::SymbolLessThan)
+                   || (type == lexing::Type::SymbolGreaterThan);
+        }
+
+
+        double as_real(Constant const& constant) noexcept
+        {
+            return constant.is_float ? constant.real : static_cast<double>(constant.integer);
+        }
+
+
+        // The largest integer a float type can hold exactly, along with every integer below it.
+        __int128 exact_integer_limit(size_t float_size) noexcept
+        {
+            return static_cast<__int128>(1) << (float_size == 4 ? 24 : 53);
+        }
+
+
+    }
+
+
+    std::ostream& operator <<(std::ostream& stream, Constant const& constant)
+    {
+        if (constant.is_float)
+        {
+            stream << constant.real;
+        }
+        else
+        {
+            stream << to_string(constant.integer);
+        }
+
+        return stream;
+    }
+
+
+    TypeChecker::TypeChecker(modules::Module const& new_module)
+    : module(new_module),
+      context(typing::get_type_context())
+    {
+        auto const& builtins = modules::get_builtins_module();
+
+        auto builtin = [&](std::string const& name)
+            {
+                auto found = builtins->find_type(name);
+
+                assert(found);
+                return found->id;
+            };
+
+        bool_type = builtin("bool");
+        string_type = builtin("string");
+        i8_type = builtin("i8");
+        i16_type = builtin("i16");
+        i32_type = builtin("i32");
+        i64_type = builtin("i64");
+        u64_type = builtin("u64");
+        f32_type = builtin("f32");
+        f64_type = builtin("f64");
+
+        for (auto const& name : { "i8", "u8", "i16", "u16", "i32", "u32", "f32", "i64", "u64",
+                                  "f64" })
+        {
+            number_types.push_back(builtin(name));
+        }
+    }
+
+
+    void TypeChecker::check_initializer(ast::StatementList const& statements)
+    {
+        check_block(statements);
+    }
+
+
+    void TypeChecker::check_sub(typing::SubInfoPtr const& sub)
+    {
+        for (auto const& parameter : sub->parameters)
+        {
+            if (parameter.initializer)
+            {
+                check_conversion(parameter.initializer.value(), parameter.type.id);
+            }
+        }
+
+        check_block(sub->body);
+    }
+
+
+    size_t TypeChecker::checked() const noexcept
+    {
+        return checked_count;
+    }
+
+
+    size_t TypeChecker::conversions() const noexcept
+    {
+        return conversion_count;
+    }
+
+
+    void TypeChecker::check_block(ast::StatementList const& statements)
+    {
+        for (auto const& statement : statements)
+        {
+            check_statement(statement);
+        }
+    }
+
+
+    void TypeChecker::check_statement(ast::Statement const& statement)
+    {
+        auto check_conditional = [&](ast::ConditionalBlock const& block)
+            {
+                auto const& [ test, body ] = block;
+
+                check_condition(test);
+                check_block(body);
+            };
+
+        // Declarations of structures, subs and functions are checked on their own.
+        auto ignore = [](auto const&) {};
+
+        std::visit(ast::StatementHandlers
+            {
+                .assignment_statement = [&](auto const& assignment)
+                    {
+                        assignment->target_type = check_access(assignment->symbol,
+                                                               assignment->subscript,
+                                                               assignment->members,
+                                                               assignment->location);
+
+                        check_conversion(assignment->value, assignment->target_type);
+                    },
+
+                .do_statement = [&](auto const& do_loop)
+                    {
+                        check_condition(do_loop->test);
+                        check_block(do_loop->body);
+                    },
+
+                .for_statement = [&](auto const& for_loop)
+                    {
+                        check_for_index(for_loop);
+                        check_block(for_loop->body);
+                    },
+
+                .function_declaration_statement = ignore,
+
+                .if_statement = [&](auto const& if_statement)
+                    {
+                        check_conditional(if_statement->main_block);
+
+                        for (auto const& block : if_statement->else_if_blocks)
+                        {
+                            check_conditional(block);
+                        }
+
+                        check_block(if_statement->else_block);
+                    },
+
+                .load_statement = ignore,
+
+                .loop_statement = [&](auto const& loop)
+                    {
+                        check_block(loop->body);
+                    },
+
+                .select_statement = [&](auto const& select)
+                    {
+                        // Each case value is compared to the selected value in its type.
+                        auto test_type = check_expression(select->test);
+
+                        for (auto const& [ value, body ] : select->conditions)
+                        {
+                            check_conversion(value, test_type);
+                            check_block(body);
+                        }
+
+                        check_block(select->default_condition);
+                    },
+
+                .structure_declaration_statement = ignore,
+
+                .sub_call_statement = [&](auto const& call)
+                    {
+                        check_arguments(call->symbol, call->parameters, call->location);
+                    },
+
+                .sub_declaration_statement = ignore,
+
+                .variable_declaration_statement = [&](auto const& declaration)
+                    {
+                        auto const& variable = declaration->symbol->variable;
+
+                        if (declaration->initializer)
+                        {
+                            check_conversion(declaration->initializer.value(), variable->type_id);
+                        }
+                    }
+            },
+            statement);
+    }
+
+
+    typing::TypeId TypeChecker::check_expression(ast::Expression const& expression)
+    {
+        auto& base = ast::get_base(expression);
+
+        // Shared nodes are only checked the first time they're reached.
+        if (base.type != typing::invalid_type_id)
+        {
+            return base.type;
+        }
+
+        std::visit(ast::ExpressionHandlers
+            {
+                .literal_expression = [&](auto const& literal)
+                    {
+                        base.type = check_literal(literal);
+                    },
+
+                .variable_read_expression = [&](auto const& read)
+                    {
+                        base.type = check_access(read->symbol,
+                                                 read->subscript,
+                                                 read->members,
+                                                 read->location);
+                    },
+
+                .prefix_expression = [&](auto const& prefix)
+                    {
+                        base.type = check_prefix(prefix);
+                    },
+
+                .binary_expression = [&](auto const& binary)
+                    {
+                        base.type = check_binary(binary);
+                    },
+
+                .postfix_expression = [&](auto const& postfix)
+                    {
+                        type_error(postfix->location, "Postfix operators are not supported.");
+                    },
+
+                .function_call_expression = [&](auto const& call)
+                    {
+                        base.type = check_call(call);
+                    }
+            },
+            expression);
+
+        ++checked_count;
+
+        return base.type;
+    }
+
+
+    typing::TypeId TypeChecker::check_literal(ast::LiteralExpressionPtr const& literal)
+    {
+        auto const& token = literal->value;
+
+        if (token.type == lexing::Type::LiteralString)
+        {
+            return string_type;
+        }
+
+        Constant constant;
+
+        if (   (token.type == lexing::Type::LiteralFloat)
+            || (token.text.find_first_of("eE") != std::string::npos))
+        {
+            constant.is_float = true;
+            constant.real = std::stod(token.text);
+        }
+        else
+        {
+            for (auto digit : token.text)
+            {
+                constant.integer = (constant.integer * 10) + (digit - '0');
+
+                if (constant.integer > max_constant)
+                {
+                    type_error(token.location,
+                               "The number " + token.text + " is too large for any integer type.");
+                }
+            }
+        }
+
+        constants[literal.get()] = constant;
+
+        return constant_type(constant, token.location);
+    }
+
+
+    typing::TypeId TypeChecker::check_prefix(ast::PrefixExpressionPtr const& prefix)
+    {
+        auto type = check_expression(prefix->expression);
+
+        if (prefix->operator_type.type == lexing::Type::KeywordNot)
+        {
+            // Not is logical for bools and bitwise for integers.
+            if ((type != bool_type) && !is_integer(type))
+            {
+                type_error(prefix->location,
+                           "The operator not can't be used with " + context.name_of(type) + ".");
+            }
+
+            return type;
+        }
+
+        if (auto operand = constant_of(prefix->expression); operand)
+        {
+            auto negated = operand.value();
+
+            negated.integer = -negated.integer;
+            negated.real = -negated.real;
+
+            if (!negated.is_float && (negated.integer < min_constant))
+            {
+                type_error(prefix->location,
+                           "The number -" + to_string(operand->integer)
+                           + " is too small for any integer type.");
+            }
+
+            constants[prefix.get()] = negated;
+
+            return constant_type(negated, prefix->location);
+        }
+
+        auto number = context.is_number(type) ? context.number_info(type) : nullptr;
+
+        if (!number)
+        {
+            type_error(prefix->location,
+                       "The operator - can't be used with " + context.name_of(type) + ".");
+        }
+
+        if (   (number->is_signed == typing::SignedFlag::IsUnsigned)
+            && (number->is_floating_point == typing::FloatingPointFlag::IsInteger))
+        {
+            type_error(prefix->location,
+                       "Values of the unsigned type " + context.name_of(type)
+                       + " can't be negated, convert it to a signed type first.");
+        }
+
+        return type;
+    }
+
+
+    typing::TypeId TypeChecker::check_binary(ast::BinaryExpressionPtr const& binary)
+    {
+        auto op = binary->operator_type.type;
+        auto const& location = binary->location;
+
+        auto lhs = operand_of(binary->lhs);
+        auto rhs = operand_of(binary->rhs);
+
+        auto mismatch = [&]() -> typing::TypeId
+            {
+                type_error(location,
+                           "The operator " + operator_name(op) + " can't be used with "
+                           + context.name_of(lhs.type) + " and " + context.name_of(rhs.type)
+                           + ".");
+            };
+
+        auto both_are = [&](typing::TypeId type)
+            {
+                return (lhs.type == type) && (rhs.type == type);
+            };
+
+        auto both_are_numbers = [&]()
+            {
+                return context.is_number(lhs.type) && context.is_number(rhs.type);
+            };
+
+        auto number_type = [&](std::vector<Operand> const& operands) -> typing::TypeId
+            {
+                auto found = common_type(operands);
+
+                if (!found)
+                {
+                    type_error(location,
+                               "No type can hold both " + context.name_of(lhs.type) + " and "
+                               + context.name_of(rhs.type)
+                               + " without losing information, convert one of them explicitly.");
+                }
+
+                return found.value();
+            };
+
+        if (is_arithmetic(op))
+        {
+            if (both_are(string_type) && (op == lexing::Type::SymbolPlus))
+            {
+                binary->operand_type = string_type;
+                return string_type;
+            }
+
+            if (!both_are_numbers())
+            {
+                return mismatch();
+            }
+
+            // Arithmetic on constants is done now, and works in a type that holds both the operands
+            // and the result.
+            if (lhs.constant && rhs.constant)
+            {
+                auto const& left = lhs.constant.value();
+                auto const& right = rhs.constant.value();
+
+                Constant result;
+
+                if (left.is_float || right.is_float)
+                {
+                    auto a = as_real(left);
+                    auto b = as_real(right);
+
+                    result.is_float = true;
+
+                    switch (op)
+                    {
+                        case lexing::Type::SymbolPlus:   result.real = a + b; break;
+                        case lexing::Type::SymbolMinus:  result.real = a - b; break;
+                        case lexing::Type::SymbolTimes:  result.real = a * b; break;
+                        default:                         result.real = a / b; break;
+                    }
+                }
+                else
+                {
+                    auto a = left.integer;
+                    auto b = right.integer;
+
+                    if ((op == lexing::Type::SymbolDivide) && (b == 0))
+                    {
+                        type_error(location, "Division by zero in a constant expression.");
+                    }
+
+                    auto magnitude = [](__int128 value) { return value < 0 ? -value : value; };
+
+                    // Check before multiplying, as the product could overflow even an __int128.
+                    if (   (op == lexing::Type::SymbolTimes)
+                        && (a != 0)
+                        && (magnitude(b) > max_constant / magnitude(a)))
+                    {
+                        type_error(location, "The constant expression overflows.");
+                    }
+
+                    switch (op)
+                    {
+                        case lexing::Type::SymbolPlus:   result.integer = a + b; break;
+                        case lexing::Type::SymbolMinus:  result.integer = a - b; break;
+                        case lexing::Type::SymbolTimes:  result.integer = a * b; break;
+                        default:                         result.integer = a / b; break;
+                    }
+
+                    if ((result.integer > max_constant) || (result.integer < min_constant))
+                    {
+                        type_error(location, "The constant expression overflows.");
+                    }
+                }
+
+                constants[binary.get()] = result;
+
+                auto result_type = constant_type(result, location);
+
+                binary->operand_type = number_type({ lhs,
+                                                     rhs,
+                                                     { result_type, result } });
+                return binary->operand_type;
+            }
+
+            binary->operand_type = number_type({ lhs, rhs });
+            return binary->operand_type;
+        }
+
+        if (is_comparison(op))
+        {
+            auto is_equality =    (op == lexing::Type::SymbolEqual)
+                               || (op == lexing::Type::SymbolNotEqual);
+
+            if (both_are(string_type) || (is_equality && both_are(bool_type)))
+            {
+                binary->operand_type = lhs.type;
+            }
+            else if (both_are_numbers())
+            {
+                binary->operand_type = number_type({ lhs, rhs });
+            }
+            else
+            {
+                mismatch();
+            }
+
+            return bool_type;
+        }
+
+        // And and or are logical for bools, and bitwise for integers.
+        if (both_are(bool_type))
+        {
+            binary->operand_type = bool_type;
+        }
+        else if (is_integer(lhs.type) && is_integer(rhs.type))
+        {
+            binary->operand_type = number_type({ lhs, rhs });
+        }
+        else
+        {
+            mismatch();
+        }
+
+        return binary->operand_type;
+    }
+
+
+    typing::TypeId TypeChecker::check_call(ast::FunctionCallExpressionPtr const& call)
+    {
+        auto const& symbol = call->symbol;
+        assert(symbol);
+
+        if (symbol->kind != symbols::Kind::Conversion)
+        {
+            check_arguments(symbol, call->parameters, call->location);
+
+            auto function = std::static_pointer_cast<typing::FunctionInfo>(symbol->sub);
+            return function->return_type.id;
+        }
+
+        auto target = symbol->type->id;
+
+        if (call->parameters.size() != 1)
+        {
+            type_error(call->location,
+                       "A conversion to " + symbol->name + " takes exactly one value.");
+        }
+
+        // Explicit conversions may wrap, truncate or round, but only between numbers.
+        auto type = check_expression(call->parameters.front());
+
+        if ((type != target) && !(context.is_number(type) && context.is_number(target)))
+        {
+            type_error(call->location,
+                       "Values of type " + context.name_of(type) + " can't be converted to "
+                       + context.name_of(target) + ".");
+        }
+
+        return target;
+    }
+
+
+    typing::TypeId TypeChecker::check_access(symbols::SymbolPtr const& symbol,
+                                             ast::OptionalExpression const& subscript,
+                                             lexing::TokenList const& members,
+                                             source::Location const& location)
+    {
+        assert(symbol && symbol->variable);
+
+        auto const& variable = symbol->variable;
+        auto type = variable->type_id;
+
+        assert(type != typing::invalid_type_id);
+
+        if (subscript)
+        {
+            if (!variable->is_array())
+            {
+                type_error(location, "The variable " + variable->name + " is not an array.");
+            }
+
+            auto index_type = check_expression(subscript.value());
+
+            if (!is_integer(index_type))
+            {
+                type_error(location,
+                           "Array subscripts must be integers, not "
+                           + context.name_of(index_type) + ".");
+            }
+
+            type = variable->type.id;
+        }
+        else if (variable->is_array())
+        {
+            type_error(location,
+                       "The array " + variable->name + " can only be used one element at a time.");
+        }
+
+        for (auto const& member : members)
+        {
+            auto structure = context.structure_info(type);
+
+            if (!structure)
+            {
+                type_error(member.location,
+                           "The type " + context.name_of(type) + " has no fields, so it has no "
+                           + member.text + ".");
+            }
+
+            auto index = structure->find_field(member.text);
+
+            if (!index)
+            {
+                type_error(member.location,
+                           "The structure " + structure->name + " has no field named "
+                           + member.text + ".");
+            }
+
+            type = structure->fields[index.value()].type.id;
+        }
+
+        return type;
+    }
+
+
+    void TypeChecker::check_condition(ast::Expression const& expression)
+    {
+        auto type = check_expression(expression);
+
+        if (type != bool_type)
+        {
+            type_error(ast::get_base(expression).location,
+                       "Conditions must be bools, not " + context.name_of(type) + ".");
+        }
+    }
+
+
+    void TypeChecker::check_conversion(ast::Expression const& expression, typing::TypeId target)
+    {
+        auto operand = operand_of(expression);
+
+        if (operand.type == target)
+        {
+            return;
+        }
+
+        if (converts(operand, target))
+        {
+            ++conversion_count;
+            return;
+        }
+
+        auto const& location = ast::get_base(expression).location;
+
+        if (operand.constant && context.is_number(target))
+        {
+            std::stringstream message;
+
+            message << "The value " << operand.constant.value() << " doesn't fit in "
+                    << context.name_of(target) << ".";
+
+            type_error(location, message.str());
+        }
+
+        if (context.is_number(operand.type) && context.is_number(target))
+        {
+            type_error(location,
+                       "Converting from " + context.name_of(operand.type) + " to "
+                       + context.name_of(target) + " could lose information, convert it "
+                       + "explicitly with " + context.name_of(target) + "(...).");
+        }
+
+        type_error(location,
+                   "Values of type " + context.name_of(operand.type) + " can't be used as "
+                   + context.name_of(target) + ".");
+    }
+
+
+    void TypeChecker::check_arguments(symbols::SymbolPtr const& symbol,
+                                      ast::ExpressionList const& arguments,
+                                      source::Location const& location)
+    {
+        assert(symbol && symbol->sub);
+
+        auto const& parameters = symbol->sub->parameters;
+
+        if (arguments.size() > parameters.size())
+        {
+            type_error(location,
+                       symbol->name + " takes " + std::to_string(parameters.size())
+                       + " values, but was given " + std::to_string(arguments.size()) + ".");
+        }
+
+        auto argument = arguments.begin();
+
+        for (auto const& parameter : parameters)
+        {
+            if (argument != arguments.end())
+            {
+                check_conversion(*argument, parameter.type.id);
+                ++argument;
+            }
+            else if (!parameter.initializer)
+            {
+                type_error(location,
+                           "Missing a value for " + parameter.name + " in the call to "
+                           + symbol->name + ".");
+            }
+        }
+    }
+
+
+    void TypeChecker::check_for_index(ast::ForStatementPtr const& for_loop)
+    {
+        auto const& index = for_loop->index_symbol->variable;
+
+        std::vector<ast::Expression> bounds = { for_loop->start_index, for_loop->end_index };
+
+        if (for_loop->step_value)
+        {
+            bounds.push_back(for_loop->step_value.value());
+        }
+
+        // An index the loop declared itself takes the type of its bounds, but never narrower than
+        // an i32, so that stepping past the end doesn't overflow.
+        if (index->type_id == typing::invalid_type_id)
+        {
+            std::vector<Operand> operands = { { i32_type, std::nullopt } };
+
+            for (auto const& bound : bounds)
+            {
+                operands.push_back(operand_of(bound));
+
+                if (!context.is_number(operands.back().type))
+                {
+                    type_error(ast::get_base(bound).location,
+                               "Loop bounds must be numbers, not "
+                               + context.name_of(operands.back().type) + ".");
+                }
+            }
+
+            auto found = common_type(operands);
+
+            if (!found)
+            {
+                type_error(for_loop->location,
+                           "No type can hold all of the loop's bounds without losing "
+                           "information, declare the index variable with a type.");
+            }
+
+            auto type = found.value();
+
+            index->type_id = type;
+            index->type.id = type;
+            index->type.resolved_type = context.get(type).info;
+            index->type.type_name = context.name_of(type);
+        }
+
+        if (!context.is_number(index->type_id))
+        {
+            type_error(for_loop->location,
+                       "Loop indices must be numbers, not " + context.name_of(index->type_id)
+                       + ".");
+        }
+
+        for (auto const& bound : bounds)
+        {
+            check_conversion(bound, index->type_id);
+        }
+    }
+
+
+    TypeChecker::Operand TypeChecker::operand_of(ast::Expression const& expression)
+    {
+        auto type = check_expression(expression);
+        return { type, constant_of(expression) };
+    }
+
+
+    std::optional<Constant> TypeChecker::constant_of(ast::Expression const& expression) const
+    {
+        auto found = constants.find(&ast::get_base(expression));
+
+        if (found == constants.end())
+        {
+            return std::nullopt;
+        }
+
+        return found->second;
+    }
+
+
+    bool TypeChecker::is_integer(typing::TypeId type) const noexcept
+    {
+        auto number = context.number_info(type);
+
+        return    number
+               && (number->is_floating_point == typing::FloatingPointFlag::IsInteger);
+    }
+
+
+    bool TypeChecker::is_widening(typing::TypeId from, typing::TypeId to) const noexcept
+    {
+        if (from == to)
+        {
+            return true;
+        }
+
+        auto source = context.number_info(from);
+        auto target = context.number_info(to);
+
+        if (!source || !target)
+        {
+            return false;
+        }
+
+        auto is_float = [](auto const& number)
+            {
+                return number->is_floating_point == typing::FloatingPointFlag::IsFloatingPoint;
+            };
+
+        auto is_signed = [](auto const& number)
+            {
+                return number->is_signed == typing::SignedFlag::IsSigned;
+            };
+
+        if (is_float(target))
+        {
+            if (is_float(source))
+            {
+                return source->size <= target->size;
+            }
+
+            auto magnitude_bits = (source->size * 8) - (is_signed(source) ? 1 : 0);
+            return (static_cast<__int128>(1) << magnitude_bits)
+                   <= exact_integer_limit(target->size);
+        }
+
+        if (is_float(source))
+        {
+            return false;
+        }
+
+        if (is_signed(source) == is_signed(target))
+        {
+            return source->size <= target->size;
+        }
+
+        // Unsigned values fit in strictly wider signed types, signed values never fit in unsigned
+        // ones.
+        return !is_signed(source) && (source->size < target->size);
+    }
+
+
+    bool TypeChecker::fits(Constant const& constant, typing::TypeId to) const noexcept
+    {
+        auto target = context.number_info(to);
+
+        if (!target)
+        {
+            return false;
+        }
+
+        if (target->is_floating_point == typing::FloatingPointFlag::IsFloatingPoint)
+        {
+            if (constant.is_float)
+            {
+                return    (target->size == 8)
+                       || (std::abs(constant.real) <= std::numeric_limits<float>::max());
+            }
+
+            auto limit = exact_integer_limit(target->size);
+            return (constant.integer <= limit) && (constant.integer >= -limit);
+        }
+
+        if (constant.is_float)
+        {
+            return false;
+        }
+
+        auto bits = target->size * 8;
+
+        if (target->is_signed == typing::SignedFlag::IsSigned)
+        {
+            auto limit = static_cast<__int128>(1) << (bits - 1);
+            return (constant.integer >= -limit) && (constant.integer < limit);
+        }
+
+        auto limit = static_cast<__int128>(1) << bits;
+        return (constant.integer >= 0) && (constant.integer < limit);
+    }
+
+
+    bool TypeChecker::converts(Operand const& operand, typing::TypeId to) const noexcept
+    {
+        if (operand.constant)
+        {
+            return fits(operand.constant.value(), to);
+        }
+
+        return is_widening(operand.type, to);
+    }
+
+
+    typing::TypeId TypeChecker::constant_type(Constant const& constant,
+                                              source::Location const& location) const
+    {
+        if (constant.is_float)
+        {
+            auto narrowed = static_cast<float>(constant.real);
+            return (static_cast<double>(narrowed) == constant.real) ? f32_type : f64_type;
+        }
+
+        // Integers are signed unless only an unsigned type is big enough.
+        for (auto type : { i8_type, i16_type, i32_type, i64_type, u64_type })
+        {
+            if (fits(constant, type))
+            {
+                return type;
+            }
+        }
+
+        type_error(location, "The number " + to_string(constant.integer) + " is out of range.");
+    }
+
+
+    std::optional<typing::TypeId> TypeChecker::common_type(
+                                                   std::vector<Operand> const& operands) const
+    {
+        auto holds_all = [&](typing::TypeId type)
+            {
+                return std::all_of(operands.begin(),
+                                   operands.end(),
+                                   [&](auto const& operand) { return converts(operand, type); });
+            };
+
+        // Prefer the type of one of the operands, looking at variables before constants.
+        for (auto want_constant : { false, true })
+        {
+            for (auto const& operand : operands)
+            {
+                if (operand.constant.has_value() == want_constant && holds_all(operand.type))
+                {
+                    return operand.type;
+                }
+            }
+        }
+
+        for (auto type : number_types)
+        {
+            if (holds_all(type))
+            {
+                return type;
+            }
+        }
+
+        return std::nullopt;
+    }
+
+
+    void TypeChecker::type_error(source::Location const& location,
+                                 std::string const& message) const
+    {
+        std::stringstream stream;
+
+        stream << "Error in " << location << ": " << message;
+        throw std::runtime_error(stream.str());
+    }
+
+
+}
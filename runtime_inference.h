@@ -0,0 +1,117 @@
+
+#pragma once
+
+
+namespace basically::runtime::inference
+{
+
+
+    // A value known at compile time: a literal, or arithmetic made only of literals.  Constants
+    // have a type of their own, the narrowest that holds them, but they can be used wherever their
+    // value fits, so "var b as u8 = 200" is fine while "var b as u8 = 300" is not.
+    struct Constant
+    {
+        bool is_float = false;
+
+        __int128 integer = 0;
+        double real = 0.0;
+    };
+
+
+    std::ostream& operator <<(std::ostream& stream, Constant const& constant);
+
+
+    // Gives every expression of a module its type, after symbol resolution.  Types are inferred
+    // bottom up, each operator working in the narrowest type that holds both of its operands.
+    // Values may be widened implicitly wherever that can't lose information, anything else needs
+    // an explicit conversion, written as a call through the type's name, such as i32(x).
+    class TypeChecker
+    {
+        private:
+            struct Operand
+            {
+                typing::TypeId type;
+                std::optional<Constant> constant;
+            };
+
+            modules::Module const& module;
+            typing::TypeContext& context;
+
+            typing::TypeId bool_type;
+            typing::TypeId string_type;
+
+            typing::TypeId i8_type;
+            typing::TypeId i16_type;
+            typing::TypeId i32_type;
+            typing::TypeId i64_type;
+            typing::TypeId u64_type;
+            typing::TypeId f32_type;
+            typing::TypeId f64_type;
+
+            // Number types from narrowest to widest, the order in which a common type for two
+            // operands is searched for.
+            std::vector<typing::TypeId> number_types;
+
+            std::unordered_map<ast::ExpressionBase const*, Constant> constants;
+
+            size_t checked_count = 0;
+            size_t conversion_count = 0;
+
+        public:
+            TypeChecker(modules::Module const& new_module);
+            TypeChecker(TypeChecker const& checker) = delete;
+            TypeChecker(TypeChecker&& checker) = delete;
+            ~TypeChecker() = default;
+
+        public:
+            TypeChecker& operator =(TypeChecker const& checker) = delete;
+            TypeChecker& operator =(TypeChecker&& checker) = delete;
+
+        public:
+            void check_initializer(ast::StatementList const& statements);
+            void check_sub(typing::SubInfoPtr const& sub);
+
+            size_t checked() const noexcept;
+            size_t conversions() const noexcept;
+
+        private:
+            void check_block(ast::StatementList const& statements);
+            void check_statement(ast::Statement const& statement);
+
+            typing::TypeId check_expression(ast::Expression const& expression);
+            typing::TypeId check_literal(ast::LiteralExpressionPtr const& literal);
+            typing::TypeId check_prefix(ast::PrefixExpressionPtr const& prefix);
+            typing::TypeId check_binary(ast::BinaryExpressionPtr const& binary);
+            typing::TypeId check_call(ast::FunctionCallExpressionPtr const& call);
+
+            typing::TypeId check_access(symbols::SymbolPtr const& symbol,
+                                        ast::OptionalExpression const& subscript,
+                                        lexing::TokenList const& members,
+                                        source::Location const& location);
+
+            void check_condition(ast::Expression const& expression);
+            void check_conversion(ast::Expression const& expression, typing::TypeId target);
+            void check_arguments(symbols::SymbolPtr const& symbol,
+                                 ast::ExpressionList const& arguments,
+                                 source::Location const& location);
+
+            void check_for_index(ast::ForStatementPtr const& for_loop);
+
+            Operand operand_of(ast::Expression const& expression);
+            std::optional<Constant> constant_of(ast::Expression const& expression) const;
+
+            bool is_integer(typing::TypeId type) const noexcept;
+            bool is_widening(typing::TypeId from, typing::TypeId to) const noexcept;
+            bool fits(Constant const& constant, typing::TypeId to) const noexcept;
+            bool converts(Operand const& operand, typing::TypeId to) const noexcept;
+
+            typing::TypeId constant_type(Constant const& constant,
+                                         source::Location const& location) const;
+            std::optional<typing::TypeId> common_type(std::vector<Operand> const& operands) const;
+
+            [[noreturn]]
+            void type_error(source::Location const& location, std::string const& message) const;
+    };
+
+
+}
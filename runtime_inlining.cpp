@@ -0,0 +1,475 @@
+
+#include "basically.h"
+
+
+namespace basically::runtime::inlining
+{
+
+
+    namespace
+    {
+
+
+        // Saved along with the call itself when a body is inlined.
+        const size_t call_cost = 5;
+
+        // How deep the calls of inlined bodies are themselves inlined.
+        const size_t max_depth = 4;
+
+        // A function stops taking in callees once it's grown this large.
+        const size_t max_function_cost = 4000;
+
+        // How many times the budget a call the profile found hot gets.
+        const size_t hot_budget_factor = 4;
+
+
+        struct PendingCall
+        {
+            ir::ValueId call;
+            size_t depth;
+
+            // The callees whose bodies the call was copied out of.
+            std::vector<typing::SubInfo const*> chain;
+        };
+
+
+    }
+
+
+    size_t cost_of(ir::Function const& function)
+    {
+        size_t cost = 0;
+
+        for (auto const& block : function.blocks)
+        {
+            for (auto id : block.instructions)
+            {
+                switch (function[id].opcode)
+                {
+                    case ir::Opcode::Constant:
+                    case ir::Opcode::Parameter:
+                    case ir::Opcode::LocalAddress:
+                    case ir::Opcode::GlobalAddress:
+                    case ir::Opcode::Jump:
+                    case ir::Opcode::Return:
+                        break;
+
+                    case ir::Opcode::Call:
+                        cost += call_cost;
+                        break;
+
+                    default:
+                        ++cost;
+                        break;
+                }
+            }
+        }
+
+        return cost;
+    }
+
+
+    Inliner::Inliner(ir::Unit& new_unit,
+                     size_t new_budget,
+                     profiling::Profile const* new_profile)
+    : unit(new_unit),
+      budget(new_budget),
+      profile(new_profile)
+    {
+        for (uint32_t i = 0; i < unit.globals.size(); ++i)
+        {
+            global_ids.insert({ { unit.globals[i].module, unit.globals[i].slot }, i });
+        }
+
+        for (uint32_t i = 0; i < unit.callees.size(); ++i)
+        {
+            callee_ids.insert({ unit.callees[i].sub.get(), i });
+        }
+    }
+
+
+    void Inliner::inline_calls()
+    {
+        for (auto& function : unit.functions)
+        {
+            inline_calls(function);
+        }
+    }
+
+
+    size_t Inliner::get_inlined() const noexcept
+    {
+        return inlined;
+    }
+
+
+    void Inliner::inline_calls(ir::Function& function)
+    {
+        std::deque<PendingCall> pending;
+
+        for (auto const& block : function.blocks)
+        {
+            for (auto id : block.instructions)
+            {
+                if (function[id].opcode == ir::Opcode::Call)
+                {
+                    pending.push_back({ .call = id, .depth = 0 });
+                }
+            }
+        }
+
+        auto cost = cost_of(function);
+        auto changed = false;
+
+        while (!pending.empty() && (cost < max_function_cost))
+        {
+            auto next = pending.front();
+            pending.pop_front();
+
+            auto const& callee_info = unit.callees[function[next.call].immediate];
+            auto sub = callee_info.sub.get();
+
+            if (   !callee_info.sub->is_inlinable
+                || (sub == function.sub.get())
+                || (next.depth >= max_depth)
+                || (std::find(next.chain.begin(), next.chain.end(), sub) != next.chain.end()))
+            {
+                continue;
+            }
+
+            auto [ callee_unit, callee ] = find_body(callee_info);
+
+            if ((callee == nullptr) || (callee == &function))
+            {
+                continue;
+            }
+
+            auto callee_cost = cost_of(*callee);
+
+            if (callee_cost > budget_of(function, function[next.call]))
+            {
+                continue;
+            }
+
+            auto chain = next.chain;
+            chain.push_back(sub);
+
+            for (auto call : inline_call(function, next.call, *callee_unit, *callee))
+            {
+                pending.push_back({ .call = call, .depth = next.depth + 1, .chain = chain });
+            }
+
+            cost += callee_cost;
+            changed = true;
+
+            ++inlined;
+        }
+
+        // A callee that never returns leaves the code after its call unreachable.
+        if (changed)
+        {
+            ir::remove_unreachable_blocks(function);
+        }
+    }
+
+
+    // Only what the call costs is saved by inlining a call that's never made, while the caller
+    // grows all the same.
+    size_t Inliner::budget_of(ir::Function const& function, ir::Instruction const& call) const
+    {
+        if (!profile || (call.site == ir::no_id))
+        {
+            return budget;
+        }
+
+        auto const& site = function.sites[call.site];
+        auto calls = profile->calls_at(site);
+
+        if (!calls)
+        {
+            return budget;
+        }
+
+        if (*calls == 0)
+        {
+            return 0;
+        }
+
+        return profile->is_hot_call(site) ? budget * hot_budget_factor : budget;
+    }
+
+
+    std::pair<ir::Unit const*, ir::Function const*> Inliner::find_body(ir::Callee const& callee)
+    {
+        if (callee.module == nullptr)
+        {
+            return { nullptr, nullptr };
+        }
+
+        auto const& owner = callee.module == unit.module ? unit : callee.module->get_unit();
+
+        return { &owner, owner.find_function(callee.sub.get()) };
+    }
+
+
+    std::vector<ir::ValueId> Inliner::inline_call(ir::Function& function,
+                                                  ir::ValueId call,
+                                                  ir::Unit const& callee_unit,
+                                                  ir::Function const& callee)
+    {
+        auto& context = typing::get_type_context();
+
+        auto const call_instruction = function[call];
+        auto const operands = function.operands_of(call_instruction);
+        auto const arguments = std::vector<ir::ValueId>(operands.begin(), operands.end());
+
+        // Everything after the call moves to a block of its own, where the copied body returns to.
+        auto block = ir::no_id;
+        size_t position = 0;
+
+        for (ir::BlockId i = 0; (i < function.blocks.size()) && (block == ir::no_id); ++i)
+        {
+            auto const& body = function.blocks[i].instructions;
+
+            if (auto found = std::find(body.begin(), body.end(), call); found != body.end())
+            {
+                block = i;
+                position = found - body.begin();
+            }
+        }
+
+        assert(block != ir::no_id);
+
+        auto continuation = static_cast<ir::BlockId>(function.blocks.size());
+        function.blocks.push_back({});
+
+        auto& caller_body = function.blocks[block].instructions;
+
+        function.blocks[continuation].instructions.assign(caller_body.begin() + position + 1,
+                                                          caller_body.end());
+        caller_body.resize(position);
+
+        // The callee's variables become more of the caller's.  Its result lives in a slot of its
+        // own, as the body may return from more than one place.
+        auto slot_offset = static_cast<uint32_t>(function.slots.size());
+
+        for (auto const& slot : callee.slots)
+        {
+            function.add_slot(callee.name + "." + slot.name, slot.type);
+        }
+
+        auto result_slot = ir::no_id;
+
+        if (call_instruction.type != typing::invalid_type_id)
+        {
+            result_slot = function.add_slot("<" + callee.name + ">", call_instruction.type);
+        }
+
+        auto block_offset = static_cast<ir::BlockId>(function.blocks.size());
+        function.blocks.resize(function.blocks.size() + callee.blocks.size());
+
+        // Parameters are replaced by the arguments, every other value gets a new id up front so
+        // that uses can be mapped before their definitions are copied.
+        std::vector<ir::ValueId> values(callee.instructions.size(), ir::no_id);
+        auto next_id = static_cast<ir::ValueId>(function.instructions.size());
+
+        for (auto const& callee_block : callee.blocks)
+        {
+            for (auto id : callee_block.instructions)
+            {
+                values[id] = callee[id].opcode == ir::Opcode::Parameter
+                    ? arguments[callee[id].immediate]
+                    : next_id++;
+            }
+        }
+
+        function.instructions.resize(next_id, { .opcode = ir::Opcode::Constant });
+
+        auto value_of = [&](ir::ValueId value)
+            {
+                return value == ir::no_id ? ir::no_id : values[value];
+            };
+
+        auto add = [&](ir::Instruction const& instruction)
+            {
+                function.instructions.push_back(instruction);
+                return static_cast<ir::ValueId>(function.instructions.size() - 1);
+            };
+
+        std::vector<ir::ValueId> calls;
+
+        for (ir::BlockId i = 0; i < callee.blocks.size(); ++i)
+        {
+            auto& body = function.blocks[block_offset + i].instructions;
+
+            for (auto id : callee.blocks[i].instructions)
+            {
+                auto const& original = callee[id];
+                auto instruction = original;
+
+                if (original.opcode == ir::Opcode::Parameter)
+                {
+                    continue;
+                }
+
+                instruction.a = value_of(original.a);
+                instruction.b = value_of(original.b);
+
+                if (original.location != ir::no_id)
+                {
+                    auto const& location = callee.locations[original.location];
+                    instruction.location = function.add_location(location);
+                }
+
+                if (original.site != ir::no_id)
+                {
+                    instruction.site = function.add_site(callee.sites[original.site]);
+                }
+
+                switch (original.opcode)
+                {
+                    case ir::Opcode::Constant:
+                        instruction.immediate =
+                            function.add_constant(callee.constants[original.immediate]);
+                        break;
+
+                    case ir::Opcode::LocalAddress:
+                        instruction.immediate = original.immediate + slot_offset;
+                        break;
+
+                    case ir::Opcode::GlobalAddress:
+                        instruction.immediate = global_id(callee_unit.globals[original.immediate]);
+                        break;
+
+                    case ir::Opcode::Call:
+                        instruction.immediate = callee_id(callee_unit.callees[original.immediate]);
+                        instruction.first = static_cast<uint32_t>(function.operands.size());
+
+                        for (auto operand : callee.operands_of(original))
+                        {
+                            function.operands.push_back(values[operand]);
+                        }
+
+                        calls.push_back(values[id]);
+                        break;
+
+                    case ir::Opcode::Jump:
+                        instruction.immediate = original.immediate + block_offset;
+                        break;
+
+                    case ir::Opcode::Branch:
+                        instruction.immediate = original.immediate + block_offset;
+                        instruction.extra = original.extra + block_offset;
+                        break;
+
+                    case ir::Opcode::Switch:
+                        instruction.immediate = original.immediate + block_offset;
+                        instruction.first = static_cast<uint32_t>(function.cases.size());
+
+                        for (auto const& switch_case : callee.cases_of(original))
+                        {
+                            auto const& constant = callee.constants[switch_case.constant];
+
+                            function.cases.push_back({
+                                    .constant = function.add_constant(constant),
+                                    .target = switch_case.target + block_offset
+                                });
+                        }
+                        break;
+
+                    case ir::Opcode::Return:
+                        if ((result_slot != ir::no_id) && (original.a != ir::no_id))
+                        {
+                            auto address = add({
+                                    .opcode = ir::Opcode::LocalAddress,
+                                    .type = context.intern_pointer(call_instruction.type),
+                                    .immediate = result_slot
+                                });
+
+                            body.push_back(address);
+                            body.push_back(add({
+                                    .opcode = ir::Opcode::Store,
+                                    .a = address,
+                                    .b = instruction.a
+                                }));
+                        }
+
+                        instruction = { .opcode = ir::Opcode::Jump, .immediate = continuation };
+                        break;
+
+                    default:
+                        break;
+                }
+
+                function.instructions[values[id]] = instruction;
+                body.push_back(values[id]);
+            }
+        }
+
+        function.blocks[block].instructions.push_back(add({
+                .opcode = ir::Opcode::Jump,
+                .immediate = block_offset
+            }));
+
+        // Whatever used the call's value now loads it from the result slot.
+        if (result_slot != ir::no_id)
+        {
+            auto address = add({
+                    .opcode = ir::Opcode::LocalAddress,
+                    .type = context.intern_pointer(call_instruction.type),
+                    .immediate = result_slot
+                });
+            auto result = add({
+                    .opcode = ir::Opcode::Load,
+                    .type = call_instruction.type,
+                    .a = address
+                });
+
+            auto& body = function.blocks[continuation].instructions;
+            body.insert(body.begin(), { address, result });
+
+            std::vector<ir::ValueId> replacements(function.instructions.size(), ir::no_id);
+            replacements[call] = result;
+
+            ir::replace_values(function, replacements);
+        }
+
+        return calls;
+    }
+
+
+    uint32_t Inliner::global_id(ir::Global global)
+    {
+        auto key = std::make_pair(global.module, global.slot);
+
+        if (auto found = global_ids.find(key); found != global_ids.end())
+        {
+            return found->second;
+        }
+
+        auto id = static_cast<uint32_t>(unit.globals.size());
+
+        unit.globals.push_back(global);
+        global_ids.insert({ key, id });
+
+        return id;
+    }
+
+
+    uint32_t Inliner::callee_id(ir::Callee callee)
+    {
+        if (auto found = callee_ids.find(callee.sub.get()); found != callee_ids.end())
+        {
+            return found->second;
+        }
+
+        auto id = static_cast<uint32_t>(unit.callees.size());
+
+        callee_ids.insert({ callee.sub.get(), id });
+        unit.callees.push_back(std::move(callee));
+
+        return id;
+    }
+
+
+}
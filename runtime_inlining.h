@@ -0,0 +1,74 @@
+
+#pragma once
+
+
+namespace basically::runtime::inlining
+{
+
+
+    // What a function's body costs to copy into a caller, roughly the number of instructions that
+    // will survive code generation.  Constants, addresses and jumps come for free, calls cost more
+    // than anything else.
+    size_t cost_of(ir::Function const& function);
+
+
+    // Replaces calls to small subs and functions with copies of their bodies, including those of
+    // callees loaded from other modules, whose IR is otherwise in a JIT context of its own.
+    //
+    // A callee is only copied into a caller if its cost is within the budget, it's not marked
+    // [noinline] and it isn't already being inlined at that call, which guards against recursion.
+    // The calls in a copied body are considered in turn, up to a limited depth.
+    //
+    // With a profile, the calls it found hot get a larger budget, and those it never saw made
+    // get none.
+    class Inliner
+    {
+        private:
+            ir::Unit& unit;
+            size_t budget;
+            profiling::Profile const* profile;
+
+            size_t inlined = 0;
+
+            std::map<std::pair<modules::Module const*, size_t>, uint32_t> global_ids;
+            std::unordered_map<typing::SubInfo const*, uint32_t> callee_ids;
+
+        public:
+            Inliner(ir::Unit& new_unit,
+                    size_t new_budget,
+                    profiling::Profile const* new_profile = nullptr);
+            Inliner(Inliner const& inliner) = delete;
+            Inliner(Inliner&& inliner) = delete;
+            ~Inliner() = default;
+
+        public:
+            Inliner& operator =(Inliner const& inliner) = delete;
+            Inliner& operator =(Inliner&& inliner) = delete;
+
+        public:
+            void inline_calls();
+
+            size_t get_inlined() const noexcept;
+
+        private:
+            void inline_calls(ir::Function& function);
+
+            size_t budget_of(ir::Function const& function, ir::Instruction const& call) const;
+
+            // The unit holding the callee's body and the body itself, null if the callee has no IR
+            // to copy, as is the case for builtins.
+            std::pair<ir::Unit const*, ir::Function const*> find_body(ir::Callee const& callee);
+
+            // Splices a copy of the callee's body in place of the call, returning the calls made
+            // by the copy.
+            std::vector<ir::ValueId> inline_call(ir::Function& function,
+                                                 ir::ValueId call,
+                                                 ir::Unit const& callee_unit,
+                                                 ir::Function const& callee);
+
+            uint32_t global_id(ir::Global global);
+            uint32_t callee_id(ir::Callee callee);
+    };
+
+
+}
@@ -0,0 +1,753 @@
+#include "basically.h"
+
+
+namespace basically::runtime::interpreting
+{
+
+
+    namespace
+    {
+
+
+        // Every value is held in a word.  Numbers, bools, strings and pointers as the bits they
+        // have in memory, with the signed integers sign extended.  Structures and arrays as the
+        // address of their bytes.
+        const size_t word_size = sizeof(uint64_t);
+
+
+        // Variables of type string start out null, which reads as the empty string.
+        char const* text_of(uint64_t cell) noexcept
+        {
+            auto text = reinterpret_cast<char const*>(static_cast<uintptr_t>(cell));
+            return text ? text : "";
+        }
+
+
+        void* address_of(uint64_t cell) noexcept
+        {
+            return reinterpret_cast<void*>(static_cast<uintptr_t>(cell));
+        }
+
+
+        uint64_t cell_of(void const* address) noexcept
+        {
+            return static_cast<uint64_t>(reinterpret_cast<uintptr_t>(address));
+        }
+
+
+        bool is_aggregate(typing::TypeId type)
+        {
+            auto const& types = typing::get_type_context();
+            return types.is_structure(type) || types.is_array(type);
+        }
+
+
+        bool is_float(typing::TypeId type)
+        {
+            auto number = typing::get_type_context().number_info(type);
+
+            return    number
+                   && (number->is_floating_point == typing::FloatingPointFlag::IsFloatingPoint);
+        }
+
+
+        size_t words_of(typing::TypeId type)
+        {
+            auto size = typing::get_type_context().size_of(type);
+            return std::max<size_t>((size + word_size - 1) / word_size, 1);
+        }
+
+
+        uint64_t load(typing::TypeId type, void const* address)
+        {
+            auto const& types = typing::get_type_context();
+
+            auto read = [&](auto value) -> uint64_t
+                {
+                    std::memcpy(&value, address, sizeof(value));
+                    return value;
+                };
+
+            uint64_t bits = 0;
+            auto size = types.size_of(type);
+
+            switch (size)
+            {
+                case 1:  bits = read(uint8_t {});   break;
+                case 2:  bits = read(uint16_t {});  break;
+                case 4:  bits = read(uint32_t {});  break;
+                default: bits = read(uint64_t {});  break;
+            }
+
+            auto number = types.number_info(type);
+
+            if (   number
+                && (number->is_signed == typing::SignedFlag::IsSigned)
+                && (number->is_floating_point == typing::FloatingPointFlag::IsInteger)
+                && (size < word_size)
+                && (bits & (uint64_t { 1 } << (size * 8 - 1))))
+            {
+                bits |= ~((uint64_t { 1 } << (size * 8)) - 1);
+            }
+
+            return bits;
+        }
+
+
+        void store(typing::TypeId type, void* address, uint64_t bits)
+        {
+            auto write = [&](auto value)
+                {
+                    std::memcpy(address, &value, sizeof(value));
+                };
+
+            switch (typing::get_type_context().size_of(type))
+            {
+                case 1:  write(static_cast<uint8_t>(bits));   break;
+                case 2:  write(static_cast<uint16_t>(bits));  break;
+                case 4:  write(static_cast<uint32_t>(bits));  break;
+                default: write(bits);                         break;
+            }
+        }
+
+
+        // Numbers and bools only, strings are worked on where they are.
+        ir::Constant constant_of(typing::TypeId type, uint64_t cell)
+        {
+            if (!is_float(type))
+            {
+                return { .type = type, .value = cell };
+            }
+
+            if (typing::get_type_context().size_of(type) == 4)
+            {
+                float real;
+                auto bits = static_cast<uint32_t>(cell);
+
+                std::memcpy(&real, &bits, sizeof(real));
+                return { .type = type, .value = static_cast<double>(real) };
+            }
+
+            double real;
+
+            std::memcpy(&real, &cell, sizeof(real));
+            return { .type = type, .value = real };
+        }
+
+
+        // The text of a string constant stays where it is, in the unit.
+        uint64_t cell_of(ir::Constant const& constant)
+        {
+            if (auto text = std::get_if<std::string>(&constant.value); text)
+            {
+                return cell_of(text->c_str());
+            }
+
+            if (auto real = std::get_if<double>(&constant.value); real)
+            {
+                if (typing::get_type_context().size_of(constant.type) == 4)
+                {
+                    auto narrow = static_cast<float>(*real);
+                    uint32_t bits;
+
+                    std::memcpy(&bits, &narrow, sizeof(bits));
+                    return bits;
+                }
+
+                uint64_t bits;
+
+                std::memcpy(&bits, real, sizeof(bits));
+                return bits;
+            }
+
+            return std::get<uint64_t>(constant.value);
+        }
+
+
+        bool is_equal(typing::TypeId type, uint64_t a, uint64_t b)
+        {
+            if (typing::get_type_context().is_string(type))
+            {
+                return std::strcmp(text_of(a), text_of(b)) == 0;
+            }
+
+            if (is_float(type))
+            {
+                return    std::get<double>(constant_of(type, a).value)
+                       == std::get<double>(constant_of(type, b).value);
+            }
+
+            return a == b;
+        }
+
+
+    }
+
+
+    Interpreter::Interpreter(ir::Unit const& new_unit, size_t new_threshold, Promote new_promote)
+    : unit(new_unit),
+      threshold(new_threshold),
+      promote(std::move(new_promote)),
+      codes(new_unit.functions.size()),
+      entries(new_unit.functions.size())
+    {
+        // Zeroed, then set to what they start out holding, as compiled code has them.
+        for (auto const& global : unit.globals)
+        {
+            if (global.module != unit.module)
+            {
+                globals.push_back(global.module->get_interpreter()->get_global(global.name));
+                continue;
+            }
+
+            auto& bytes = storage.emplace_back(new uint64_t[words_of(global.type)]());
+
+            for (auto const& [ offset, constant ] : global.initial)
+            {
+                store(constant.type,
+                      reinterpret_cast<uint8_t*>(bytes.get()) + offset,
+                      cell_of(constant));
+            }
+
+            globals.push_back(bytes.get());
+            own_globals.insert({ global.name, bytes.get() });
+        }
+
+        for (size_t index = 0; index < unit.functions.size(); ++index)
+        {
+            auto const& function = unit.functions[index];
+            auto& code = codes[index];
+            auto& entry = entries[index];
+
+            code.interpreter = this;
+            code.function = &function;
+
+            // The initializer only ever runs the once, so it's only worth compiling when every
+            // function is compiled on its first call.
+            code.is_promoted = !function.sub && (threshold > 1);
+
+            layout(code, function);
+
+            entry.interpret = &Interpreter::interpret;
+            entry.data = &code;
+
+            own_entries.insert({ function.name, &entry });
+        }
+
+        for (auto const& callee : unit.callees)
+        {
+            callees.push_back(callee.module == unit.module
+                                ? own_entries.at(callee.name)
+                                : callee.module->get_interpreter()->get_entry(callee.name));
+        }
+    }
+
+
+    int Interpreter::run_initializer()
+    {
+        strings::Running running;
+
+        auto initializer = unit.initializer();
+        uint64_t result = 0;
+
+        run(codes[initializer - unit.functions.data()], nullptr, &result);
+
+        // As it's returned to the compiled code's caller.
+        return static_cast<int8_t>(load(initializer->result, &result));
+    }
+
+
+    void* Interpreter::get_global(std::string const& name) const
+    {
+        auto found = own_globals.find(name);
+
+        if (found == own_globals.end())
+        {
+            throw std::runtime_error("No storage was set aside for " + unit.name + "." + name
+                                     + ".");
+        }
+
+        return found->second;
+    }
+
+
+    jitting::Entry* Interpreter::get_entry(std::string const& name)
+    {
+        auto found = own_entries.find(name);
+
+        if (found == own_entries.end())
+        {
+            throw std::runtime_error("There is no function " + name + " to call.");
+        }
+
+        return found->second;
+    }
+
+
+    // The code's thunk is what the interpreter checks for, so it's set last.
+    void Interpreter::set_code(ir::Function const& function, void* code, jitting::Thunk thunk)
+    {
+        auto& entry = entries[&function - unit.functions.data()];
+
+        entry.code.store(code, std::memory_order_release);
+        entry.thunk.store(thunk, std::memory_order_release);
+    }
+
+
+    // A frame is a word for each instruction's value, followed by the memory of its slots and
+    // of the copies made by its instructions.  A call's place holds its result, then its
+    // arguments as compiled code would hold them, then the pointers to them.
+    void Interpreter::layout(Code& code, ir::Function const& function)
+    {
+        size_t words = 0;
+
+        for (auto const& slot : function.slots)
+        {
+            code.slots.push_back(words);
+            words += words_of(slot.type);
+        }
+
+        code.places.assign(function.instructions.size(), 0);
+
+        for (ir::ValueId id = 0; id < function.instructions.size(); ++id)
+        {
+            auto const& instruction = function[id];
+
+            if ((instruction.opcode == ir::Opcode::Load) && is_aggregate(instruction.type))
+            {
+                code.places[id] = words;
+                words += words_of(instruction.type);
+            }
+            else if (instruction.opcode == ir::Opcode::Call)
+            {
+                auto const& callee = unit.callees[instruction.immediate];
+
+                code.places[id] = words;
+                words +=   ((callee.result != typing::invalid_type_id) ? words_of(callee.result)
+                                                                       : 1)
+                         + 2 * instruction.count;
+            }
+        }
+
+        code.memory = words;
+
+        code.is_header.assign(function.blocks.size(), false);
+
+        for (auto const& loop : ir::find_loops(function))
+        {
+            code.is_header[loop.header] = true;
+        }
+
+        code.dominators = ir::dominators(function);
+    }
+
+
+    void Interpreter::run(Code& code, void* const* arguments, void* result)
+    {
+        heat_up(code);
+
+        // Compiled by the time it's been promoted, so there's no need to interpret this call.
+        auto& entry = entries[&code - codes.data()];
+
+        if (auto thunk = entry.thunk.load(std::memory_order_acquire); thunk)
+        {
+            jitting::call(thunk, arguments, result);
+            return;
+        }
+
+        auto const& types = typing::get_type_context();
+        auto const& function = *code.function;
+
+        std::vector<uint64_t> frame(function.instructions.size() + code.memory, 0);
+        strings::Root root(frame.data(), frame.size() * word_size);
+
+        auto cells = frame.data();
+        auto memory = frame.data() + function.instructions.size();
+
+        auto bytes = [&](ir::ValueId id)
+            {
+                return static_cast<uint8_t*>(address_of(cells[id]));
+            };
+
+        auto pointee = [&](ir::ValueId id)
+            {
+                return types.element_of(function[id].type);
+            };
+
+        auto check_index = [&](ir::Instruction const& instruction, size_t count)
+            {
+                if (   (instruction.flags & ir::BoundsChecked)
+                    && (cells[instruction.b] >= count))
+                {
+                    fail(function, instruction, "Array index out of bounds.");
+                }
+
+                return static_cast<int64_t>(cells[instruction.b]);
+            };
+
+        ir::BlockId block = 0;
+
+        while (true)
+        {
+            ir::BlockId next = ir::no_id;
+
+            for (auto id : function.blocks[block].instructions)
+            {
+                auto const& instruction = function[id];
+
+                switch (instruction.opcode)
+                {
+                    case ir::Opcode::Constant:
+                        cells[id] = cell_of(function.constants[instruction.immediate]);
+                        break;
+
+                    case ir::Opcode::Parameter:
+                        {
+                            auto type = function.parameters[instruction.immediate];
+                            auto argument = arguments[instruction.immediate];
+
+                            cells[id] = is_aggregate(type) ? cell_of(argument)
+                                                           : load(type, argument);
+                        }
+                        break;
+
+                    case ir::Opcode::LocalAddress:
+                        cells[id] = cell_of(memory + code.slots[instruction.immediate]);
+                        break;
+
+                    case ir::Opcode::GlobalAddress:
+                        cells[id] = cell_of(globals[instruction.immediate]);
+                        break;
+
+                    case ir::Opcode::ElementAddress:
+                        {
+                            auto const& array = types.get(pointee(instruction.a));
+                            auto index = check_index(instruction, array.count);
+
+                            cells[id] = cell_of(bytes(instruction.a)
+                                                + index * types.size_of(array.element));
+                        }
+                        break;
+
+                    case ir::Opcode::FieldAddress:
+                        {
+                            auto structure = types.structure_info(pointee(instruction.a));
+                            auto const& field = structure->fields[instruction.immediate];
+
+                            cells[id] = cell_of(bytes(instruction.a) + field.offset);
+                        }
+                        break;
+
+                    case ir::Opcode::SoaAddress:
+                        {
+                            auto const& array = types.get(pointee(instruction.a));
+                            auto const& structure = *types.structure_info(array.element);
+                            auto const& field = structure.fields[instruction.immediate];
+                            auto const& soa = soa_layout(pointee(instruction.a));
+                            auto index = check_index(instruction, array.count);
+
+                            cells[id] = cell_of(bytes(instruction.a)
+                                                + soa.field_offsets[instruction.immediate]
+                                                + index * types.size_of(field.type.id));
+                        }
+                        break;
+
+                    case ir::Opcode::Offset:
+                        cells[id] = cell_of(bytes(instruction.a)
+                                            +   static_cast<int64_t>(cells[instruction.b])
+                                              * types.size_of(pointee(instruction.a)));
+                        break;
+
+                    case ir::Opcode::Load:
+                        if (is_aggregate(instruction.type))
+                        {
+                            auto copy = memory + code.places[id];
+
+                            std::memcpy(copy,
+                                        bytes(instruction.a),
+                                        types.size_of(instruction.type));
+                            cells[id] = cell_of(copy);
+                        }
+                        else
+                        {
+                            cells[id] = load(instruction.type, bytes(instruction.a));
+                        }
+                        break;
+
+                    case ir::Opcode::Store:
+                        {
+                            auto stored = function[instruction.b].type;
+
+                            if (is_aggregate(stored))
+                            {
+                                std::memmove(bytes(instruction.a),
+                                             bytes(instruction.b),
+                                             types.size_of(stored));
+                            }
+                            else
+                            {
+                                store(stored, bytes(instruction.a), cells[instruction.b]);
+                            }
+                        }
+                        break;
+
+                    case ir::Opcode::Clear:
+                        std::memset(bytes(instruction.a), 0, types.size_of(pointee(instruction.a)));
+                        break;
+
+                    case ir::Opcode::Call:
+                        {
+                            auto const& callee = unit.callees[instruction.immediate];
+                            auto operands = function.operands_of(instruction);
+
+                            auto has_result = callee.result != typing::invalid_type_id;
+                            auto returned = memory + code.places[id];
+                            auto staged = returned + (has_result ? words_of(callee.result) : 1);
+                            auto pointers = reinterpret_cast<void**>(staged + operands.size());
+
+                            for (size_t index = 0; index < operands.size(); ++index)
+                            {
+                                auto type = callee.parameters[index];
+                                auto operand = operands[index];
+
+                                if (is_aggregate(type))
+                                {
+                                    pointers[index] = address_of(cells[operand]);
+                                }
+                                else
+                                {
+                                    store(type, &staged[index], cells[operand]);
+                                    pointers[index] = &staged[index];
+                                }
+                            }
+
+                            call(*callees[instruction.immediate], pointers, returned);
+
+                            if (has_result)
+                            {
+                                cells[id] = is_aggregate(callee.result) ? cell_of(returned)
+                                                                        : load(callee.result,
+                                                                               returned);
+                            }
+                        }
+                        break;
+
+                    case ir::Opcode::Jump:
+                        next = instruction.immediate;
+                        break;
+
+                    case ir::Opcode::Branch:
+                        next = cells[instruction.a] ? instruction.immediate : instruction.extra;
+                        break;
+
+                    case ir::Opcode::Switch:
+                        {
+                            auto type = function[instruction.a].type;
+
+                            next = instruction.immediate;
+
+                            for (auto const& switch_case : function.cases_of(instruction))
+                            {
+                                auto value = cell_of(function.constants[switch_case.constant]);
+
+                                if (is_equal(type, cells[instruction.a], value))
+                                {
+                                    next = switch_case.target;
+                                    break;
+                                }
+                            }
+                        }
+                        break;
+
+                    case ir::Opcode::Return:
+                        if ((instruction.a != ir::no_id) && is_aggregate(function.result))
+                        {
+                            std::memcpy(result,
+                                        bytes(instruction.a),
+                                        types.size_of(function.result));
+                        }
+                        else if (instruction.a != ir::no_id)
+                        {
+                            store(function.result, result, cells[instruction.a]);
+                        }
+                        return;
+
+                    default:
+                        cells[id] = operate(function, instruction, cells);
+                        break;
+                }
+            }
+
+            // Going back to the start of a loop counts toward compiling the function, so that
+            // one called rarely but looping for long still gets compiled, for its next call.
+            if (code.is_header[next] && ir::dominates(code.dominators, next, block))
+            {
+                heat_up(code);
+            }
+
+            block = next;
+        }
+    }
+
+
+    // Straight into the interpreter unless there's compiled code, which might be in the middle
+    // of being switched over to.
+    void Interpreter::call(jitting::Entry& entry, void* const* arguments, void* result)
+    {
+        if (auto thunk = entry.thunk.load(std::memory_order_acquire); thunk)
+        {
+            jitting::call(thunk, arguments, result);
+            return;
+        }
+
+        auto& code = *static_cast<Code*>(entry.data);
+        code.interpreter->run(code, arguments, result);
+    }
+
+
+    void Interpreter::heat_up(Code& code)
+    {
+        if (code.is_promoted || (++code.heat < threshold))
+        {
+            return;
+        }
+
+        code.heat = 0;
+        code.is_promoted = promote && promote(*code.function);
+    }
+
+
+    // Called by compiled code, into which a failure can't be thrown, so it's unwound instead.
+    // Nothing that needs destroying is left on the stack by then.
+    void Interpreter::interpret(void* data, void* const* arguments, void* result)
+    {
+        thread_local std::string message;
+
+        try
+        {
+            auto& code = *static_cast<Code*>(data);
+
+            code.interpreter->run(code, arguments, result);
+            return;
+        }
+        catch (std::runtime_error const& error)
+        {
+            message = error.what();
+        }
+
+        jitting::fail(message.c_str());
+    }
+
+
+    // The same as compiled code works it out, which is the same as it's worked out at compile
+    // time, apart from the operations that fail.
+    uint64_t Interpreter::operate(ir::Function const& function,
+                                  ir::Instruction const& instruction,
+                                  uint64_t const* cells)
+    {
+        auto const& types = typing::get_type_context();
+
+        auto type = function[instruction.a].type;
+        auto a = cells[instruction.a];
+        auto b = (instruction.b != ir::no_id) ? cells[instruction.b] : 0;
+
+        if (types.is_string(type))
+        {
+            auto compared = [&]()
+                {
+                    return std::strcmp(text_of(a), text_of(b));
+                };
+
+            switch (instruction.opcode)
+            {
+                case ir::Opcode::Concatenate:
+                    return cell_of(strings::concatenate(text_of(a), text_of(b)));
+
+                case ir::Opcode::Equal:     return compared() == 0;
+                case ir::Opcode::NotEqual:  return compared() != 0;
+                case ir::Opcode::Less:      return compared() < 0;
+                case ir::Opcode::Greater:   return compared() > 0;
+
+                case ir::Opcode::Hash:
+                    return ir::hash_string(text_of(a), instruction.immediate) % instruction.extra;
+
+                default:
+                    break;
+            }
+        }
+
+        auto number = types.number_info(type);
+
+        if (   (instruction.opcode == ir::Opcode::Divide)
+            && number
+            && (number->is_floating_point == typing::FloatingPointFlag::IsInteger))
+        {
+            if (b == 0)
+            {
+                fail(function, instruction, "Division by zero.");
+            }
+
+            auto lowest = ~uint64_t { 0 } << (number->size * 8 - 1);
+
+            if (   (number->is_signed == typing::SignedFlag::IsSigned)
+                && (b == ~uint64_t { 0 })
+                && (a == lowest))
+            {
+                fail(function, instruction, "Division overflows.");
+            }
+        }
+
+        std::optional<ir::Constant> operand;
+
+        if (instruction.b != ir::no_id)
+        {
+            operand = constant_of(function[instruction.b].type, b);
+        }
+
+        auto value = ir::evaluate(instruction, constant_of(type, a), operand);
+
+        if (!value)
+        {
+            throw std::runtime_error("Can not interpret the instruction.");
+        }
+
+        return cell_of(value.value());
+    }
+
+
+    typing::SoaLayout const& Interpreter::soa_layout(typing::TypeId type)
+    {
+        if (auto found = soa_layouts.find(type); found != soa_layouts.end())
+        {
+            return found->second;
+        }
+
+        auto const& types = typing::get_type_context();
+        auto const& array = types.get(type);
+        auto layout = typing::compute_soa_layout(*types.structure_info(array.element), array.count);
+
+        return soa_layouts.emplace(type, std::move(layout)).first->second;
+    }
+
+
+    // Worded the same as the failures of compiled code.
+    void Interpreter::fail(ir::Function const& function,
+                           ir::Instruction const& instruction,
+                           std::string const& message) const
+    {
+        std::stringstream stream;
+
+        stream << "Error";
+
+        if (instruction.location != ir::no_id)
+        {
+            stream << " in " << function.locations[instruction.location];
+        }
+
+        stream << ": " << message;
+
+        throw std::runtime_error(stream.str());
+    }
+
+
+}
@@ -0,0 +1,111 @@
+
+#pragma once
+
+
+// Runs a module's IR directly, so that a script starts at once rather than waiting on gcc, which
+// for a short script takes longer than the script does.
+//
+// The memory it works on is laid out the way compiled code lays it out, so its functions can be
+// compiled one at a time as they get hot, and carry on with the same globals.  Every function is
+// called through its entry, which is switched over to the compiled code once that's ready.
+namespace basically::runtime::interpreting
+{
+
+
+    class Interpreter
+    {
+        public:
+            // Asked to compile a function once it's been called, or gone around its loops, often
+            // enough.  Returns false if it can't be just now, in which case it's asked again once
+            // the function has run that much more.
+            using Promote = std::function<bool(ir::Function const&)>;
+
+        private:
+            // A function of the unit, and where everything it works on goes in its frame.
+            struct Code
+            {
+                Interpreter* interpreter = nullptr;
+                ir::Function const* function = nullptr;
+
+                // Offsets into the frame's memory, in words, of each slot, and of the copies and
+                // arguments of the instructions that need them.
+                std::vector<size_t> slots;
+                std::vector<size_t> places;
+                size_t memory = 0;
+
+                // For telling the jumps back to the start of a loop.
+                std::vector<bool> is_header;
+                std::vector<ir::BlockId> dominators;
+
+                // Calls and loop iterations run here since last counted.
+                size_t heat = 0;
+                bool is_promoted = false;
+            };
+
+            ir::Unit const& unit;
+            size_t threshold;
+            Promote promote;
+
+            // The module's own globals, and where all of the globals the unit uses are.
+            std::vector<std::unique_ptr<uint64_t[]>> storage;
+            std::vector<void*> globals;
+            std::unordered_map<std::string, void*> own_globals;
+
+            // One for each of the unit's functions, in the same order.
+            std::vector<Code> codes;
+            std::vector<jitting::Entry> entries;
+            std::unordered_map<std::string, jitting::Entry*> own_entries;
+
+            // The entries of the unit's callees, in the order of its list.
+            std::vector<jitting::Entry*> callees;
+
+            std::unordered_map<typing::TypeId, typing::SoaLayout> soa_layouts;
+
+        public:
+            // The modules the unit uses have to have their interpreters by now.
+            Interpreter(ir::Unit const& new_unit, size_t new_threshold, Promote new_promote);
+            Interpreter(Interpreter const& interpreter) = delete;
+            Interpreter(Interpreter&& interpreter) = delete;
+
+        public:
+            Interpreter& operator =(Interpreter const& interpreter) = delete;
+            Interpreter& operator =(Interpreter&& interpreter) = delete;
+
+        public:
+            // Run the unit's initializer, for the module's result.  A failure is thrown as a
+            // std::runtime_error, as it is for compiled code.
+            int run_initializer();
+
+            // The storage of one of the module's own globals.
+            void* get_global(std::string const& name) const;
+
+            // Where one of the unit's functions is called from, by its IR name.
+            jitting::Entry* get_entry(std::string const& name);
+
+            // Switch a function over to its compiled code, from any thread.  Calls already under
+            // way finish in the interpreter.
+            void set_code(ir::Function const& function, void* code, jitting::Thunk thunk);
+
+        private:
+            void layout(Code& code, ir::Function const& function);
+
+            void run(Code& code, void* const* arguments, void* result);
+            void call(jitting::Entry& entry, void* const* arguments, void* result);
+            void heat_up(Code& code);
+
+            static void interpret(void* data, void* const* arguments, void* result);
+
+            uint64_t operate(ir::Function const& function,
+                             ir::Instruction const& instruction,
+                             uint64_t const* cells);
+
+            typing::SoaLayout const& soa_layout(typing::TypeId type);
+
+            [[noreturn]]
+            void fail(ir::Function const& function,
+                      ir::Instruction const& instruction,
+                      std::string const& message) const;
+    };
+
+
+}
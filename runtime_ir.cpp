@@ -0,0 +1,1892 @@
+
+#include "basically.h"
+
+
+namespace basically::runtime::ir
+{
+
+
+    namespace
+    {
+
+
+        bool is_float(typing::NumberInfo const& number) noexcept
+        {
+            return number.is_floating_point == typing::FloatingPointFlag::IsFloatingPoint;
+        }
+
+
+        bool is_signed(typing::NumberInfo const& number) noexcept
+        {
+            return number.is_signed == typing::SignedFlag::IsSigned;
+        }
+
+
+        bool is_integer(typing::TypeId type) noexcept
+        {
+            auto number = typing::get_type_context().number_info(type);
+            return number && !is_float(*number);
+        }
+
+
+        // Integer constants are kept widened to 64 bits, sign extended for the signed types, so
+        // that equal values of the same type always have the same bits.
+        uint64_t normalize(uint64_t bits, typing::NumberInfo const& number) noexcept
+        {
+            auto width = number.size * 8;
+
+            if (width >= 64)
+            {
+                return bits;
+            }
+
+            bits &= (uint64_t { 1 } << width) - 1;
+
+            if (is_signed(number) && (bits & (uint64_t { 1 } << (width - 1))))
+            {
+                bits |= ~((uint64_t { 1 } << width) - 1);
+            }
+
+            return bits;
+        }
+
+
+        // Wide enough to hold any value of any integer type, and the products of two int64_ts.
+        using WideInt = __int128;
+
+
+        std::pair<WideInt, WideInt> limits_of(typing::NumberInfo const& number) noexcept
+        {
+            auto width = number.size * 8;
+
+            if (is_signed(number))
+            {
+                return { -(WideInt { 1 } << (width - 1)), (WideInt { 1 } << (width - 1)) - 1 };
+            }
+
+            return { 0, (WideInt { 1 } << width) - 1 };
+        }
+
+
+        // The range, if all of it is made of values of the type that also fit an int64_t.
+        OptionalRange narrow(WideInt low, WideInt high, typing::TypeId type) noexcept
+        {
+            auto number = typing::get_type_context().number_info(type);
+
+            if (!number || is_float(*number))
+            {
+                return std::nullopt;
+            }
+
+            auto [ type_low, type_high ] = limits_of(*number);
+
+            if (   (low < type_low)
+                || (high > type_high)
+                || (low < std::numeric_limits<int64_t>::min())
+                || (high > std::numeric_limits<int64_t>::max()))
+            {
+                return std::nullopt;
+            }
+
+            return Range { .low = static_cast<int64_t>(low), .high = static_cast<int64_t>(high) };
+        }
+
+
+        Constant make_bool(typing::TypeId type, bool value)
+        {
+            return { .type = type, .value = uint64_t { value ? 1u : 0u } };
+        }
+
+
+        // Integer results are wrapped back into their type, as they would be at run time.
+        std::optional<Constant> make_integer(typing::TypeId type, uint64_t bits)
+        {
+            return convert_constant({ .type = type, .value = bits }, type);
+        }
+
+
+        std::optional<Constant> fold_unary(Opcode opcode, Constant const& operand)
+        {
+            auto type = operand.type;
+
+            if (auto real = std::get_if<double>(&operand.value); real)
+            {
+                if (opcode != Opcode::Negate)
+                {
+                    return std::nullopt;
+                }
+
+                return Constant { .type = type, .value = -*real };
+            }
+
+            auto bits = std::get<uint64_t>(operand.value);
+
+            if (typing::get_type_context().is_boolean(type))
+            {
+                return make_bool(type, bits == 0);
+            }
+
+            return make_integer(type, opcode == Opcode::Negate ? uint64_t { 0 } - bits : ~bits);
+        }
+
+
+        std::optional<Constant> fold_binary(Opcode opcode,
+                                                Constant const& lhs,
+                                                Constant const& rhs,
+                                                typing::TypeId result_type)
+        {
+            auto type = lhs.type;
+
+            if (auto text = std::get_if<std::string>(&lhs.value); text)
+            {
+                auto const& other = std::get<std::string>(rhs.value);
+
+                switch (opcode)
+                {
+                    case Opcode::Concatenate:
+                        return Constant { .type = type, .value = *text + other };
+
+                    case Opcode::Equal:     return make_bool(result_type, *text == other);
+                    case Opcode::NotEqual:  return make_bool(result_type, *text != other);
+                    case Opcode::Less:      return make_bool(result_type, *text < other);
+                    case Opcode::Greater:   return make_bool(result_type, *text > other);
+
+                    default:
+                        return std::nullopt;
+                }
+            }
+
+            if (auto real = std::get_if<double>(&lhs.value); real)
+            {
+                auto a = *real;
+                auto b = std::get<double>(rhs.value);
+
+                auto make_real = [&](double value)
+                    {
+                        if (typing::get_type_context().size_of(type) == 4)
+                        {
+                            value = static_cast<float>(value);
+                        }
+
+                        return Constant { .type = type, .value = value };
+                    };
+
+                switch (opcode)
+                {
+                    case Opcode::Add:       return make_real(a + b);
+                    case Opcode::Subtract:  return make_real(a - b);
+                    case Opcode::Multiply:  return make_real(a * b);
+                    case Opcode::Divide:    return make_real(a / b);
+
+                    case Opcode::Equal:     return make_bool(result_type, a == b);
+                    case Opcode::NotEqual:  return make_bool(result_type, a != b);
+                    case Opcode::Less:      return make_bool(result_type, a < b);
+                    case Opcode::Greater:   return make_bool(result_type, a > b);
+
+                    default:
+                        return std::nullopt;
+                }
+            }
+
+            auto a = std::get<uint64_t>(lhs.value);
+            auto b = std::get<uint64_t>(rhs.value);
+
+            if (typing::get_type_context().is_boolean(type))
+            {
+                switch (opcode)
+                {
+                    case Opcode::And:       return make_bool(type, a && b);
+                    case Opcode::Or:        return make_bool(type, a || b);
+                    case Opcode::Equal:     return make_bool(result_type, a == b);
+                    case Opcode::NotEqual:  return make_bool(result_type, a != b);
+
+                    default:
+                        return std::nullopt;
+                }
+            }
+
+            auto number = typing::get_type_context().number_info(type);
+            auto is_signed_type = number && is_signed(*number);
+            auto signed_a = static_cast<int64_t>(a);
+            auto signed_b = static_cast<int64_t>(b);
+
+            switch (opcode)
+            {
+                case Opcode::Add:       return make_integer(type, a + b);
+                case Opcode::Subtract:  return make_integer(type, a - b);
+                case Opcode::Multiply:  return make_integer(type, a * b);
+                case Opcode::And:       return make_integer(type, a & b);
+                case Opcode::Or:        return make_integer(type, a | b);
+
+                case Opcode::Divide:
+                    // Left for run time, where it fails the way it should.
+                    if (division_fails(lhs, rhs))
+                    {
+                        return std::nullopt;
+                    }
+
+                    return make_integer(type,
+                                        is_signed_type ? static_cast<uint64_t>(signed_a / signed_b)
+                                                       : a / b);
+
+                case Opcode::Equal:     return make_bool(result_type, a == b);
+                case Opcode::NotEqual:  return make_bool(result_type, a != b);
+
+                case Opcode::Less:
+                    return make_bool(result_type, is_signed_type ? signed_a < signed_b : a < b);
+
+                case Opcode::Greater:
+                    return make_bool(result_type, is_signed_type ? signed_a > signed_b : a > b);
+
+                default:
+                    return std::nullopt;
+            }
+        }
+
+
+        // The constants a global starts out with can be whole tables, only the first few of
+        // which are worth reading in a dump.
+        const size_t max_initial_shown = 8;
+
+
+        std::ostream& write_value(std::ostream& stream, ValueId value)
+        {
+            if (value == no_id)
+            {
+                return stream << "%?";
+            }
+
+            return stream << "%" << value;
+        }
+
+
+        std::ostream& write_constant(std::ostream& stream, Constant const& constant)
+        {
+            auto const& context = typing::get_type_context();
+
+            if (auto text = std::get_if<std::string>(&constant.value); text)
+            {
+                stream << "\"";
+
+                for (auto character : *text)
+                {
+                    switch (character)
+                    {
+                        case '\n': stream << "\\n";  break;
+                        case '\t': stream << "\\t";  break;
+                        case '"':  stream << "\\\""; break;
+                        case '\\': stream << "\\\\"; break;
+                        default:   stream << character; break;
+                    }
+                }
+
+                return stream << "\"";
+            }
+
+            if (auto real = std::get_if<double>(&constant.value); real)
+            {
+                return stream << *real;
+            }
+
+            auto bits = std::get<uint64_t>(constant.value);
+            auto number = context.number_info(constant.type);
+
+            if (context.is_boolean(constant.type))
+            {
+                return stream << (bits ? "true" : "false");
+            }
+
+            if (number && is_signed(*number))
+            {
+                return stream << static_cast<int64_t>(bits);
+            }
+
+            return stream << bits;
+        }
+
+
+        void write_instruction(std::ostream& stream,
+                               Unit const& unit,
+                               Function const& function,
+                               ValueId id)
+        {
+            auto const& context = typing::get_type_context();
+            auto const& instruction = function[id];
+
+            stream << "    ";
+
+            if (instruction.type != typing::invalid_type_id)
+            {
+                write_value(stream, id) << " = ";
+            }
+
+            stream << instruction.opcode;
+
+            if (instruction.flags & BoundsChecked)
+            {
+                stream << ".checked";
+            }
+
+            auto field_name = [&](ValueId address)
+                {
+                    auto type = context.element_of(function[address].type);
+
+                    if (context.is_array(type))
+                    {
+                        type = context.element_of(type);
+                    }
+
+                    auto structure = context.structure_info(type);
+
+                    return    structure && (instruction.immediate < structure->fields.size())
+                           ? structure->fields[instruction.immediate].name
+                           : "?";
+                };
+
+            switch (instruction.opcode)
+            {
+                case Opcode::Constant:
+                    stream << " ";
+                    write_constant(stream, function.constants[instruction.immediate]);
+                    break;
+
+                case Opcode::Parameter:
+                    stream << " " << instruction.immediate;
+                    break;
+
+                case Opcode::LocalAddress:
+                    stream << " s" << instruction.immediate;
+                    break;
+
+                case Opcode::GlobalAddress:
+                    {
+                        auto const& global = unit.globals[instruction.immediate];
+                        stream << " @" << global.module->get_name() << "." << global.name;
+                    }
+                    break;
+
+                case Opcode::FieldAddress:
+                    stream << " ";
+                    write_value(stream, instruction.a) << ", " << field_name(instruction.a);
+                    break;
+
+                case Opcode::SoaAddress:
+                    stream << " ";
+                    write_value(stream, instruction.a) << "[";
+                    write_value(stream, instruction.b) << "], " << field_name(instruction.a);
+                    break;
+
+                case Opcode::Call:
+                    stream << " " << unit.callees[instruction.immediate].name << "(";
+
+                    for (size_t i = 0; i < instruction.count; ++i)
+                    {
+                        write_value(stream, function.operands[instruction.first + i])
+                            << ((i + 1 < instruction.count) ? ", " : "");
+                    }
+
+                    stream << ")";
+                    break;
+
+                case Opcode::Jump:
+                    stream << " b" << instruction.immediate;
+                    break;
+
+                case Opcode::Branch:
+                    stream << " ";
+                    write_value(stream, instruction.a) << ", b" << instruction.immediate
+                                                       << ", b" << instruction.extra;
+                    break;
+
+                case Opcode::Hash:
+                    stream << " ";
+                    write_value(stream, instruction.a) << ", seed " << instruction.immediate
+                                                       << ", size " << instruction.extra;
+                    break;
+
+                case Opcode::Switch:
+                    stream << " ";
+                    write_value(stream, instruction.a) << ", default b" << instruction.immediate;
+
+                    for (auto const& switch_case : function.cases_of(instruction))
+                    {
+                        stream << ", ";
+                        write_constant(stream, function.constants[switch_case.constant])
+                            << " b" << switch_case.target;
+                    }
+                    break;
+
+                default:
+                    if (instruction.a != no_id)
+                    {
+                        stream << " ";
+                        write_value(stream, instruction.a);
+                    }
+
+                    if (instruction.b != no_id)
+                    {
+                        stream << ", ";
+                        write_value(stream, instruction.b);
+                    }
+                    break;
+            }
+
+            if (instruction.type != typing::invalid_type_id)
+            {
+                stream << " : " << context.name_of(instruction.type);
+            }
+
+            stream << std::endl;
+        }
+
+
+        // The blocks reachable from the entry block, each after all of its predecessors except
+        // through back edges.
+        std::vector<BlockId> reverse_postorder(Function const& function)
+        {
+            std::vector<BlockId> order;
+
+            if (function.blocks.empty())
+            {
+                return order;
+            }
+
+            std::vector<bool> visited(function.blocks.size(), false);
+            std::vector<std::pair<BlockId, size_t>> stack = { { 0, 0 } };
+
+            visited[0] = true;
+
+            while (!stack.empty())
+            {
+                auto& [ block, next ] = stack.back();
+                auto successors = function.successors(block);
+
+                if (next < successors.size())
+                {
+                    auto successor = successors[next++];
+
+                    if (!visited[successor])
+                    {
+                        visited[successor] = true;
+                        stack.push_back({ successor, 0 });
+                    }
+
+                    continue;
+                }
+
+                order.push_back(block);
+                stack.pop_back();
+            }
+
+            std::reverse(order.begin(), order.end());
+
+            return order;
+        }
+
+
+    }
+
+
+    std::ostream& operator <<(std::ostream& stream, Opcode opcode)
+    {
+        static const std::unordered_map<Opcode, std::string> names =
+            {
+                { Opcode::Constant,       "constant"        },
+                { Opcode::Parameter,      "parameter"       },
+                { Opcode::LocalAddress,   "local_address"   },
+                { Opcode::GlobalAddress,  "global_address"  },
+                { Opcode::ElementAddress, "element_address" },
+                { Opcode::FieldAddress,   "field_address"   },
+                { Opcode::SoaAddress,     "soa_address"     },
+                { Opcode::Offset,         "offset"          },
+                { Opcode::Load,           "load"            },
+                { Opcode::Store,          "store"           },
+                { Opcode::Clear,          "clear"           },
+                { Opcode::Add,            "add"             },
+                { Opcode::Subtract,       "subtract"        },
+                { Opcode::Multiply,       "multiply"        },
+                { Opcode::Divide,         "divide"          },
+                { Opcode::And,            "and"             },
+                { Opcode::Or,             "or"              },
+                { Opcode::Concatenate,    "concatenate"     },
+                { Opcode::Negate,         "negate"          },
+                { Opcode::Not,            "not"             },
+                { Opcode::Equal,          "equal"           },
+                { Opcode::NotEqual,       "not_equal"       },
+                { Opcode::Less,           "less"            },
+                { Opcode::Greater,        "greater"         },
+                { Opcode::Convert,        "convert"         },
+                { Opcode::Hash,           "hash"            },
+                { Opcode::Call,           "call"            },
+                { Opcode::Jump,           "jump"            },
+                { Opcode::Branch,         "branch"          },
+                { Opcode::Switch,         "switch"          },
+                { Opcode::Return,         "return"          }
+            };
+
+        auto found = names.find(opcode);
+        return stream << (found != names.end() ? found->second : "???");
+    }
+
+
+    bool is_terminator(Opcode opcode) noexcept
+    {
+        return    (opcode == Opcode::Jump)
+               || (opcode == Opcode::Branch)
+               || (opcode == Opcode::Switch)
+               || (opcode == Opcode::Return);
+    }
+
+
+    bool is_binary(Opcode opcode) noexcept
+    {
+        return (opcode >= Opcode::Add) && (opcode <= Opcode::Concatenate);
+    }
+
+
+    bool is_comparison(Opcode opcode) noexcept
+    {
+        return (opcode >= Opcode::Equal) && (opcode <= Opcode::Greater);
+    }
+
+
+    bool has_side_effects(Opcode opcode) noexcept
+    {
+        return    (opcode == Opcode::Store)
+               || (opcode == Opcode::Clear)
+               || (opcode == Opcode::Call)
+               || is_terminator(opcode);
+    }
+
+
+    std::optional<Constant> convert_constant(Constant const& constant, typing::TypeId type)
+    {
+        auto const& context = typing::get_type_context();
+
+        auto source = context.number_info(constant.type);
+        auto target = context.number_info(type);
+
+        if (!source || !target)
+        {
+            return std::nullopt;
+        }
+
+        if (is_float(*target))
+        {
+            double value;
+
+            if (is_float(*source))
+            {
+                value = std::get<double>(constant.value);
+            }
+            else
+            {
+                auto bits = std::get<uint64_t>(constant.value);
+
+                value = is_signed(*source) ? static_cast<double>(static_cast<int64_t>(bits))
+                                           : static_cast<double>(bits);
+            }
+
+            if (target->size == 4)
+            {
+                value = static_cast<float>(value);
+            }
+
+            return Constant { .type = type, .value = value };
+        }
+
+        uint64_t bits;
+
+        if (is_float(*source))
+        {
+            auto value = std::get<double>(constant.value);
+
+            bits = is_signed(*target) ? static_cast<uint64_t>(static_cast<int64_t>(value))
+                                      : static_cast<uint64_t>(value);
+        }
+        else
+        {
+            bits = std::get<uint64_t>(constant.value);
+        }
+
+        return Constant { .type = type, .value = normalize(bits, *target) };
+    }
+
+
+    std::optional<Constant> evaluate(Instruction const& instruction,
+                                     Constant const& a,
+                                     std::optional<Constant> const& b)
+    {
+        auto opcode = instruction.opcode;
+
+        switch (opcode)
+        {
+            case Opcode::Convert:
+                return convert_constant(a, instruction.type);
+
+            case Opcode::Hash:
+                {
+                    auto hash = hash_string(std::get<std::string>(a.value), instruction.immediate);
+                    return make_integer(instruction.type, hash % instruction.extra);
+                }
+
+            case Opcode::Negate:
+            case Opcode::Not:
+                return fold_unary(opcode, a);
+
+            default:
+                if ((!is_binary(opcode) && !is_comparison(opcode)) || !b)
+                {
+                    return std::nullopt;
+                }
+
+                return fold_binary(opcode, a, b.value(), instruction.type);
+        }
+    }
+
+
+    bool division_fails(Constant const& dividend, Constant const& divisor)
+    {
+        auto number = typing::get_type_context().number_info(dividend.type);
+
+        if (!number || is_float(*number))
+        {
+            return false;
+        }
+
+        auto a = std::get<uint64_t>(dividend.value);
+        auto b = std::get<uint64_t>(divisor.value);
+
+        if (b == 0)
+        {
+            return true;
+        }
+
+        // Constants are sign extended, so the smallest value of a narrower type is also the
+        // smallest it can be as an int64_t.
+        return    is_signed(*number)
+               && (static_cast<int64_t>(b) == -1)
+               && (WideInt { static_cast<int64_t>(a) } == limits_of(*number).first);
+    }
+
+
+    OptionalRange range_of_type(typing::TypeId type) noexcept
+    {
+        auto number = typing::get_type_context().number_info(type);
+
+        if (!number || is_float(*number))
+        {
+            return std::nullopt;
+        }
+
+        auto [ low, high ] = limits_of(*number);
+        return narrow(low, high, type);
+    }
+
+
+    OptionalRange range_of_constant(Constant const& constant) noexcept
+    {
+        auto number = typing::get_type_context().number_info(constant.type);
+
+        if (!number || is_float(*number))
+        {
+            return std::nullopt;
+        }
+
+        auto bits = std::get<uint64_t>(constant.value);
+        auto value = is_signed(*number) ? WideInt { static_cast<int64_t>(bits) } : WideInt { bits };
+
+        return narrow(value, value, constant.type);
+    }
+
+
+    OptionalRange combine_ranges(Opcode opcode,
+                                 Range lhs,
+                                 Range rhs,
+                                 typing::TypeId type) noexcept
+    {
+        switch (opcode)
+        {
+            case Opcode::Add:
+                return narrow(WideInt { lhs.low } + rhs.low, WideInt { lhs.high } + rhs.high, type);
+
+            case Opcode::Subtract:
+                return narrow(WideInt { lhs.low } - rhs.high, WideInt { lhs.high } - rhs.low, type);
+
+            case Opcode::Multiply:
+                {
+                    WideInt products[] =
+                        {
+                            WideInt { lhs.low } * rhs.low,
+                            WideInt { lhs.low } * rhs.high,
+                            WideInt { lhs.high } * rhs.low,
+                            WideInt { lhs.high } * rhs.high
+                        };
+
+                    auto [ low, high ] = std::minmax_element(std::begin(products),
+                                                             std::end(products));
+                    return narrow(*low, *high, type);
+                }
+
+            default:
+                return std::nullopt;
+        }
+    }
+
+
+    OptionalRange convert_range(Range range, typing::TypeId type) noexcept
+    {
+        return narrow(range.low, range.high, type);
+    }
+
+
+    bool is_within(Range range, size_t count) noexcept
+    {
+        return (range.low >= 0) && (static_cast<uint64_t>(range.high) < count);
+    }
+
+
+    uint64_t hash_string(std::string const& text, uint32_t seed) noexcept
+    {
+        const uint64_t basis = 14695981039346656037ull;
+        const uint64_t prime = 1099511628211ull;
+
+        auto hash = basis ^ (seed * prime);
+
+        for (auto character : text)
+        {
+            hash = (hash ^ static_cast<uint8_t>(character)) * prime;
+        }
+
+        return hash;
+    }
+
+
+    Instruction const& Function::operator [](ValueId id) const noexcept
+    {
+        assert(id < instructions.size());
+        return instructions[id];
+    }
+
+
+    Instruction& Function::operator [](ValueId id) noexcept
+    {
+        assert(id < instructions.size());
+        return instructions[id];
+    }
+
+
+    std::span<ValueId const> Function::operands_of(Instruction const& instruction) const noexcept
+    {
+        if (instruction.opcode != Opcode::Call)
+        {
+            return {};
+        }
+
+        return std::span<ValueId const>(operands).subspan(instruction.first, instruction.count);
+    }
+
+
+    std::span<SwitchCase const> Function::cases_of(Instruction const& instruction) const noexcept
+    {
+        if (instruction.opcode != Opcode::Switch)
+        {
+            return {};
+        }
+
+        return std::span<SwitchCase const>(cases).subspan(instruction.first, instruction.count);
+    }
+
+
+    Instruction const& Function::terminator(BlockId block) const noexcept
+    {
+        assert((block < blocks.size()) && !blocks[block].instructions.empty());
+        return instructions[blocks[block].instructions.back()];
+    }
+
+
+    std::vector<BlockId> Function::successors(BlockId block) const
+    {
+        auto const& body = blocks[block].instructions;
+
+        if (body.empty() || !is_terminator(instructions[body.back()].opcode))
+        {
+            return {};
+        }
+
+        auto const& instruction = terminator(block);
+
+        switch (instruction.opcode)
+        {
+            case Opcode::Jump:
+                return { instruction.immediate };
+
+            case Opcode::Branch:
+                return { instruction.immediate, instruction.extra };
+
+            case Opcode::Switch:
+                {
+                    std::vector<BlockId> targets = { instruction.immediate };
+
+                    for (auto const& switch_case : cases_of(instruction))
+                    {
+                        targets.push_back(switch_case.target);
+                    }
+
+                    return targets;
+                }
+
+            default:
+                return {};
+        }
+    }
+
+
+    uint32_t Function::add_slot(std::string const& name, typing::TypeId type)
+    {
+        slots.push_back({ name, type });
+        return static_cast<uint32_t>(slots.size() - 1);
+    }
+
+
+    uint32_t Function::add_constant(Constant const& constant)
+    {
+        auto found = std::find(constants.begin(), constants.end(), constant);
+
+        if (found != constants.end())
+        {
+            return static_cast<uint32_t>(found - constants.begin());
+        }
+
+        constants.push_back(constant);
+        return static_cast<uint32_t>(constants.size() - 1);
+    }
+
+
+    uint32_t Function::add_location(source::Location const& location)
+    {
+        locations.push_back(location);
+        return static_cast<uint32_t>(locations.size() - 1);
+    }
+
+
+    uint32_t Function::add_site(std::string const& site)
+    {
+        sites.push_back(site);
+        return static_cast<uint32_t>(sites.size() - 1);
+    }
+
+
+    Function const* Unit::find_function(typing::SubInfo const* sub) const noexcept
+    {
+        for (auto const& function : functions)
+        {
+            if (function.sub.get() == sub)
+            {
+                return &function;
+            }
+        }
+
+        return nullptr;
+    }
+
+
+    Function const* Unit::initializer() const noexcept
+    {
+        return find_function(nullptr);
+    }
+
+
+    Builder::Builder(Function& new_function)
+    : function(new_function)
+    {
+    }
+
+
+    BlockId Builder::new_block()
+    {
+        function.blocks.push_back({});
+        return static_cast<BlockId>(function.blocks.size() - 1);
+    }
+
+
+    void Builder::set_block(BlockId block) noexcept
+    {
+        assert(block < function.blocks.size());
+        current = block;
+    }
+
+
+    BlockId Builder::get_block() const noexcept
+    {
+        return current;
+    }
+
+
+    bool Builder::is_terminated() const noexcept
+    {
+        auto const& body = function.blocks[current].instructions;
+        return !body.empty() && is_terminator(function[body.back()].opcode);
+    }
+
+
+    ValueId Builder::add(Instruction instruction)
+    {
+        if ((current == no_id) || is_terminated())
+        {
+            set_block(new_block());
+        }
+
+        auto id = static_cast<ValueId>(function.instructions.size());
+
+        if (   ((instruction.opcode == Opcode::Branch) || (instruction.opcode == Opcode::Call))
+            && (instruction.site == no_id))
+        {
+            instruction.site = function.add_site(function.name + "#"
+                                                 + std::to_string(function.sites.size()));
+        }
+
+        function.instructions.push_back(instruction);
+        function.blocks[current].instructions.push_back(id);
+
+        return id;
+    }
+
+
+    ValueId Builder::add(Instruction instruction, std::vector<ValueId> const& operands)
+    {
+        instruction.first = static_cast<uint32_t>(function.operands.size());
+        instruction.count = static_cast<uint32_t>(operands.size());
+
+        function.operands.insert(function.operands.end(), operands.begin(), operands.end());
+
+        return add(instruction);
+    }
+
+
+    ValueId Builder::constant(Constant const& constant)
+    {
+        return add({
+                .opcode = Opcode::Constant,
+                .type = constant.type,
+                .immediate = function.add_constant(constant)
+            });
+    }
+
+
+    ValueId Builder::convert(ValueId value, typing::TypeId type)
+    {
+        auto const source = function[value];
+
+        if (source.type == type)
+        {
+            return value;
+        }
+
+        // Constants are converted now rather than at run time.
+        if (source.opcode == Opcode::Constant)
+        {
+            if (auto converted = convert_constant(function.constants[source.immediate], type);
+                converted)
+            {
+                return constant(converted.value());
+            }
+        }
+
+        return add({ .opcode = Opcode::Convert, .type = type, .a = value });
+    }
+
+
+    void Builder::jump(BlockId target)
+    {
+        add({ .opcode = Opcode::Jump, .immediate = target });
+    }
+
+
+    void Builder::branch(ValueId condition, BlockId if_true, BlockId if_false)
+    {
+        add({ .opcode = Opcode::Branch, .a = condition, .immediate = if_true, .extra = if_false });
+    }
+
+
+    void Builder::switch_on(ValueId value,
+                            std::vector<SwitchCase> const& cases,
+                            BlockId default_block)
+    {
+        add({
+                .opcode = Opcode::Switch,
+                .a = value,
+                .immediate = default_block,
+                .first = static_cast<uint32_t>(function.cases.size()),
+                .count = static_cast<uint32_t>(cases.size())
+            });
+
+        function.cases.insert(function.cases.end(), cases.begin(), cases.end());
+    }
+
+
+    std::ostream& operator <<(std::ostream& stream, Unit const& unit)
+    {
+        stream << "unit " << unit.name << std::endl;
+
+        // Other modules' globals are set up by their own units.
+        for (auto const& global : unit.globals)
+        {
+            if ((global.module != unit.module) || global.initial.empty())
+            {
+                continue;
+            }
+
+            stream << std::endl << "global @" << global.module->get_name() << "." << global.name
+                   << " : " << typing::get_type_context().name_of(global.type) << " =";
+
+            size_t shown = 0;
+
+            for (auto const& [ offset, constant ] : global.initial)
+            {
+                if (shown++ == max_initial_shown)
+                {
+                    stream << " ...";
+                    break;
+                }
+
+                stream << " +" << offset << " ";
+                write_constant(stream, constant);
+            }
+
+            stream << std::endl;
+        }
+
+        for (auto const& function : unit.functions)
+        {
+            stream << std::endl;
+            dump_function(stream, unit, function);
+        }
+
+        return stream;
+    }
+
+
+    void dump_function(std::ostream& stream, Unit const& unit, Function const& function)
+    {
+        auto const& context = typing::get_type_context();
+
+        stream << "function " << function.name << "(";
+
+        for (size_t i = 0; i < function.parameters.size(); ++i)
+        {
+            stream << context.name_of(function.parameters[i])
+                   << ((i + 1 < function.parameters.size()) ? ", " : "");
+        }
+
+        stream << ")";
+
+        if (function.result != typing::invalid_type_id)
+        {
+            stream << " as " << context.name_of(function.result);
+        }
+
+        stream << std::endl;
+
+        for (size_t i = 0; i < function.slots.size(); ++i)
+        {
+            auto const& slot = function.slots[i];
+
+            stream << "    s" << i << ": var " << slot.name << " as " << context.name_of(slot.type)
+                   << std::endl;
+        }
+
+        for (BlockId block = 0; block < function.blocks.size(); ++block)
+        {
+            stream << "  b" << block << ":" << std::endl;
+
+            for (auto id : function.blocks[block].instructions)
+            {
+                write_instruction(stream, unit, function, id);
+            }
+        }
+    }
+
+
+    std::vector<std::vector<BlockId>> predecessors(Function const& function)
+    {
+        std::vector<std::vector<BlockId>> result(function.blocks.size());
+
+        for (BlockId block = 0; block < function.blocks.size(); ++block)
+        {
+            for (auto successor : function.successors(block))
+            {
+                result[successor].push_back(block);
+            }
+        }
+
+        return result;
+    }
+
+
+    // Cooper, Harvey and Kennedy's iterative algorithm, walking the blocks in reverse postorder
+    // until the immediate dominators stop changing.
+    std::vector<BlockId> dominators(Function const& function)
+    {
+        std::vector<BlockId> idoms(function.blocks.size(), no_id);
+
+        auto order = reverse_postorder(function);
+
+        if (order.empty())
+        {
+            return idoms;
+        }
+
+        std::vector<size_t> position(function.blocks.size(), 0);
+
+        for (size_t i = 0; i < order.size(); ++i)
+        {
+            position[order[i]] = i;
+        }
+
+        auto preds = predecessors(function);
+
+        auto intersect = [&](BlockId lhs, BlockId rhs)
+            {
+                while (lhs != rhs)
+                {
+                    while (position[lhs] > position[rhs])
+                    {
+                        lhs = idoms[lhs];
+                    }
+
+                    while (position[rhs] > position[lhs])
+                    {
+                        rhs = idoms[rhs];
+                    }
+                }
+
+                return lhs;
+            };
+
+        // The entry block is its own dominator while iterating.
+        idoms[0] = 0;
+
+        for (auto changed = true; changed; )
+        {
+            changed = false;
+
+            for (size_t i = 1; i < order.size(); ++i)
+            {
+                auto block = order[i];
+                auto idom = no_id;
+
+                for (auto predecessor : preds[block])
+                {
+                    if (idoms[predecessor] == no_id)
+                    {
+                        continue;
+                    }
+
+                    idom = (idom == no_id) ? predecessor : intersect(predecessor, idom);
+                }
+
+                if (idoms[block] != idom)
+                {
+                    idoms[block] = idom;
+                    changed = true;
+                }
+            }
+        }
+
+        idoms[0] = no_id;
+
+        return idoms;
+    }
+
+
+    bool dominates(std::vector<BlockId> const& idoms, BlockId dominator, BlockId block) noexcept
+    {
+        for (; block != no_id; block = idoms[block])
+        {
+            if (block == dominator)
+            {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+
+    bool Loop::contains(BlockId block) const noexcept
+    {
+        return std::binary_search(blocks.begin(), blocks.end(), block);
+    }
+
+
+    // Every edge to a block that dominates where it comes from closes a loop.  The loop's body is
+    // found by walking back from there to the header.
+    std::vector<Loop> find_loops(Function const& function)
+    {
+        auto idoms = dominators(function);
+        auto preds = predecessors(function);
+
+        std::map<BlockId, std::vector<bool>> bodies;
+
+        for (BlockId block = 0; block < function.blocks.size(); ++block)
+        {
+            if ((block != 0) && (idoms[block] == no_id))
+            {
+                continue;
+            }
+
+            for (auto header : function.successors(block))
+            {
+                if (!dominates(idoms, header, block))
+                {
+                    continue;
+                }
+
+                auto& body = bodies[header];
+
+                body.resize(function.blocks.size(), false);
+                body[header] = true;
+
+                std::vector<BlockId> work = { block };
+
+                while (!work.empty())
+                {
+                    auto next = work.back();
+                    work.pop_back();
+
+                    if (body[next])
+                    {
+                        continue;
+                    }
+
+                    body[next] = true;
+
+                    for (auto predecessor : preds[next])
+                    {
+                        work.push_back(predecessor);
+                    }
+                }
+            }
+        }
+
+        std::vector<Loop> loops;
+
+        for (auto const& [ header, body ] : bodies)
+        {
+            Loop loop { .header = header };
+
+            for (BlockId block = 0; block < body.size(); ++block)
+            {
+                if (body[block])
+                {
+                    loop.blocks.push_back(block);
+                }
+            }
+
+            loops.push_back(std::move(loop));
+        }
+
+        std::stable_sort(loops.begin(),
+                         loops.end(),
+                         [](auto const& lhs, auto const& rhs)
+                         {
+                             return lhs.blocks.size() < rhs.blocks.size();
+                         });
+
+        return loops;
+    }
+
+
+    BlockId insert_preheader(Function& function, Loop const& loop)
+    {
+        if (loop.header == 0)
+        {
+            return no_id;
+        }
+
+        auto preds = predecessors(function);
+        std::vector<BlockId> outside;
+
+        for (auto predecessor : preds[loop.header])
+        {
+            if (   !loop.contains(predecessor)
+                && (std::find(outside.begin(), outside.end(), predecessor) == outside.end()))
+            {
+                outside.push_back(predecessor);
+            }
+        }
+
+        if (   (outside.size() == 1)
+            && (function.terminator(outside.front()).opcode == Opcode::Jump))
+        {
+            return outside.front();
+        }
+
+        auto preheader = static_cast<BlockId>(function.blocks.size());
+
+        function.instructions.push_back({ .opcode = Opcode::Jump, .immediate = loop.header });
+        function.blocks.push_back({
+                .instructions = { static_cast<ValueId>(function.instructions.size() - 1) }
+            });
+
+        auto retarget = [&](uint32_t& target)
+            {
+                if (target == loop.header)
+                {
+                    target = preheader;
+                }
+            };
+
+        for (auto block : outside)
+        {
+            auto& instruction = function[function.blocks[block].instructions.back()];
+
+            switch (instruction.opcode)
+            {
+                case Opcode::Jump:
+                    retarget(instruction.immediate);
+                    break;
+
+                case Opcode::Branch:
+                    retarget(instruction.immediate);
+                    retarget(instruction.extra);
+                    break;
+
+                case Opcode::Switch:
+                    retarget(instruction.immediate);
+
+                    for (uint32_t i = 0; i < instruction.count; ++i)
+                    {
+                        retarget(function.cases[instruction.first + i].target);
+                    }
+                    break;
+
+                default:
+                    break;
+            }
+        }
+
+        return preheader;
+    }
+
+
+    void remove_unreachable_blocks(Function& function)
+    {
+        auto order = reverse_postorder(function);
+
+        if (order.size() == function.blocks.size())
+        {
+            return;
+        }
+
+        std::vector<bool> reachable(function.blocks.size(), false);
+
+        for (auto block : order)
+        {
+            reachable[block] = true;
+        }
+
+        std::vector<BlockId> renumbered(function.blocks.size(), no_id);
+        std::vector<Block> blocks;
+
+        for (BlockId block = 0; block < function.blocks.size(); ++block)
+        {
+            if (reachable[block])
+            {
+                renumbered[block] = static_cast<BlockId>(blocks.size());
+                blocks.push_back(std::move(function.blocks[block]));
+            }
+        }
+
+        function.blocks = std::move(blocks);
+
+        for (auto const& block : function.blocks)
+        {
+            auto& instruction = function[block.instructions.back()];
+
+            switch (instruction.opcode)
+            {
+                case Opcode::Jump:
+                    instruction.immediate = renumbered[instruction.immediate];
+                    break;
+
+                case Opcode::Branch:
+                    instruction.immediate = renumbered[instruction.immediate];
+                    instruction.extra = renumbered[instruction.extra];
+                    break;
+
+                case Opcode::Switch:
+                    instruction.immediate = renumbered[instruction.immediate];
+
+                    for (uint32_t i = 0; i < instruction.count; ++i)
+                    {
+                        auto& target = function.cases[instruction.first + i].target;
+                        target = renumbered[target];
+                    }
+                    break;
+
+                default:
+                    break;
+            }
+        }
+    }
+
+
+    void replace_values(Function& function, std::vector<ValueId> const& replacements)
+    {
+        // Follow chains, a value replaced by a value that is itself replaced.
+        auto resolve = [&](ValueId value)
+            {
+                while (   (value < replacements.size())
+                       && (replacements[value] != no_id)
+                       && (replacements[value] != value))
+                {
+                    value = replacements[value];
+                }
+
+                return value;
+            };
+
+        for (auto const& block : function.blocks)
+        {
+            for (auto id : block.instructions)
+            {
+                auto& instruction = function[id];
+
+                if (instruction.a != no_id)
+                {
+                    instruction.a = resolve(instruction.a);
+                }
+
+                if (instruction.b != no_id)
+                {
+                    instruction.b = resolve(instruction.b);
+                }
+
+                if (instruction.opcode == Opcode::Call)
+                {
+                    for (uint32_t i = 0; i < instruction.count; ++i)
+                    {
+                        auto& operand = function.operands[instruction.first + i];
+                        operand = resolve(operand);
+                    }
+                }
+            }
+        }
+    }
+
+
+    void remove_instructions(Function& function, std::vector<bool> const& removed)
+    {
+        for (auto& block : function.blocks)
+        {
+            std::erase_if(block.instructions,
+                          [&](ValueId id) { return (id < removed.size()) && removed[id]; });
+        }
+    }
+
+
+    void compact(Function& function)
+    {
+        std::vector<ValueId> renumbered(function.instructions.size(), no_id);
+        std::vector<Instruction> instructions;
+        std::vector<ValueId> operands;
+
+        for (auto& block : function.blocks)
+        {
+            for (auto& id : block.instructions)
+            {
+                renumbered[id] = static_cast<ValueId>(instructions.size());
+                instructions.push_back(function[id]);
+                id = renumbered[id];
+            }
+        }
+
+        auto renumber = [&](ValueId value)
+            {
+                return value == no_id ? no_id : renumbered[value];
+            };
+
+        for (auto& instruction : instructions)
+        {
+            instruction.a = renumber(instruction.a);
+            instruction.b = renumber(instruction.b);
+
+            if (instruction.opcode == Opcode::Call)
+            {
+                auto first = static_cast<uint32_t>(operands.size());
+
+                for (uint32_t i = 0; i < instruction.count; ++i)
+                {
+                    operands.push_back(renumber(function.operands[instruction.first + i]));
+                }
+
+                instruction.first = first;
+            }
+        }
+
+        function.instructions = std::move(instructions);
+        function.operands = std::move(operands);
+    }
+
+
+    void verify(Unit const& unit)
+    {
+        auto& context = typing::get_type_context();
+
+        for (auto const& function : unit.functions)
+        {
+            auto current_block = no_id;
+            auto current_value = no_id;
+
+            auto verify_error = [&](std::string const& message)
+                {
+                    std::stringstream stream;
+
+                    stream << "Error in the IR of " << function.name;
+
+                    if (current_block != no_id)
+                    {
+                        stream << ", block b" << current_block;
+                    }
+
+                    if (current_value != no_id)
+                    {
+                        stream << ", value %" << current_value;
+                    }
+
+                    stream << ": " << message;
+
+                    throw std::runtime_error(stream.str());
+                };
+
+            auto check = [&](bool condition, std::string const& message)
+                {
+                    if (!condition)
+                    {
+                        verify_error(message);
+                    }
+                };
+
+            if (function.blocks.empty())
+            {
+                verify_error("The function has no blocks.");
+            }
+
+            // Where each value is defined, and its position in that block.
+            std::vector<BlockId> defined_in(function.instructions.size(), no_id);
+            std::vector<size_t> defined_at(function.instructions.size(), 0);
+
+            for (BlockId block = 0; block < function.blocks.size(); ++block)
+            {
+                current_block = block;
+
+                auto const& body = function.blocks[block].instructions;
+
+                check(!body.empty(), "The block is empty.");
+
+                for (size_t i = 0; i < body.size(); ++i)
+                {
+                    current_value = body[i];
+
+                    check(current_value < function.instructions.size(), "No such instruction.");
+                    check(defined_in[current_value] == no_id,
+                          "The instruction appears more than once.");
+                    check(is_terminator(function[current_value].opcode) == (i + 1 == body.size()),
+                          "Blocks must end in exactly one terminator.");
+
+                    defined_in[current_value] = block;
+                    defined_at[current_value] = i;
+                }
+
+                current_value = no_id;
+            }
+
+            auto idoms = dominators(function);
+
+            for (BlockId block = 0; block < function.blocks.size(); ++block)
+            {
+                current_block = block;
+
+                auto is_reachable = (block == 0) || (idoms[block] != no_id);
+
+                for (size_t i = 0; i < function.blocks[block].instructions.size(); ++i)
+                {
+                    current_value = function.blocks[block].instructions[i];
+
+                    auto const& instruction = function[current_value];
+
+                    // Every operand must be a value defined before it's used, along every path.
+                    auto type_of = [&](ValueId operand) -> typing::TypeId
+                        {
+                            check(operand < function.instructions.size(), "Missing an operand.");
+
+                            auto const& definition = function[operand];
+
+                            check(definition.type != typing::invalid_type_id,
+                                  "Uses %" + std::to_string(operand) + ", which has no value.");
+                            check(defined_in[operand] != no_id,
+                                  "Uses %" + std::to_string(operand) + ", which isn't in a block.");
+
+                            if (is_reachable)
+                            {
+                                auto dominated = (defined_in[operand] == block)
+                                    ? defined_at[operand] < i
+                                    : dominates(idoms, defined_in[operand], block);
+
+                                check(dominated,
+                                      "Uses %" + std::to_string(operand)
+                                      + " where it might not be defined.");
+                            }
+
+                            return definition.type;
+                        };
+
+                    auto pointee = [&](ValueId address)
+                        {
+                            auto type = type_of(address);
+
+                            check(context.is_pointer(type),
+                                  "Expected an address, not " + context.name_of(type) + ".");
+
+                            return context.element_of(type);
+                        };
+
+                    auto expect = [&](typing::TypeId type, typing::TypeId expected)
+                        {
+                            check(type == expected,
+                                  "Expected " + context.name_of(expected) + ", not "
+                                  + context.name_of(type) + ".");
+                        };
+
+                    auto check_block = [&](BlockId target)
+                        {
+                            check(target < function.blocks.size(),
+                                  "Jumps to the missing block b" + std::to_string(target) + ".");
+                        };
+
+                    auto field_type = [&](typing::TypeId structure_type)
+                        {
+                            auto structure = context.structure_info(structure_type);
+
+                            check(structure != nullptr,
+                                  "Expected a structure, not " + context.name_of(structure_type)
+                                  + ".");
+                            check(instruction.immediate < structure->fields.size(),
+                                  "No such field.");
+
+                            return structure->fields[instruction.immediate].type.id;
+                        };
+
+                    auto has_type = instruction.type != typing::invalid_type_id;
+                    auto result = instruction.type;
+
+                    switch (instruction.opcode)
+                    {
+                        case Opcode::Constant:
+                            check(instruction.immediate < function.constants.size(),
+                                  "No such constant.");
+                            expect(result, function.constants[instruction.immediate].type);
+                            break;
+
+                        case Opcode::Parameter:
+                            check(instruction.immediate < function.parameters.size(),
+                                  "No such parameter.");
+                            expect(result, function.parameters[instruction.immediate]);
+                            break;
+
+                        case Opcode::LocalAddress:
+                            check(instruction.immediate < function.slots.size(), "No such slot.");
+                            expect(result,
+                                   context.intern_pointer(
+                                                      function.slots[instruction.immediate].type));
+                            break;
+
+                        case Opcode::GlobalAddress:
+                            check(instruction.immediate < unit.globals.size(), "No such global.");
+                            expect(result,
+                                   context.intern_pointer(
+                                                       unit.globals[instruction.immediate].type));
+                            break;
+
+                        case Opcode::ElementAddress:
+                            {
+                                auto array = pointee(instruction.a);
+
+                                check(context.is_array(array) && !context.get(array).is_soa,
+                                      "Expected an array, not " + context.name_of(array) + ".");
+                                check(is_integer(type_of(instruction.b)),
+                                      "Array indices must be integers.");
+                                expect(result,
+                                       context.intern_pointer(
+                                                                    context.element_of(array)));
+                            }
+                            break;
+
+                        case Opcode::FieldAddress:
+                            expect(result,
+                                   context.intern_pointer(
+                                                               field_type(pointee(instruction.a))));
+                            break;
+
+                        case Opcode::SoaAddress:
+                            {
+                                auto array = pointee(instruction.a);
+
+                                check(context.is_array(array) && context.get(array).is_soa,
+                                      "Expected a [soa] array, not " + context.name_of(array)
+                                      + ".");
+                                check(is_integer(type_of(instruction.b)),
+                                      "Array indices must be integers.");
+                                expect(result,
+                                       context.intern_pointer(
+                                                           field_type(context.element_of(array))));
+                            }
+                            break;
+
+                        case Opcode::Offset:
+                            pointee(instruction.a);
+                            check(is_integer(type_of(instruction.b)),
+                                  "Offsets must be integers.");
+                            expect(result, type_of(instruction.a));
+                            break;
+
+                        case Opcode::Load:
+                            expect(result, pointee(instruction.a));
+                            break;
+
+                        case Opcode::Store:
+                            check(!has_type, "Stores have no value.");
+                            expect(type_of(instruction.b), pointee(instruction.a));
+                            break;
+
+                        case Opcode::Clear:
+                            check(!has_type, "Clears have no value.");
+                            pointee(instruction.a);
+                            break;
+
+                        case Opcode::Add:
+                        case Opcode::Subtract:
+                        case Opcode::Multiply:
+                        case Opcode::Divide:
+                            check(context.is_number(result), "Arithmetic needs numbers.");
+                            expect(type_of(instruction.a), result);
+                            expect(type_of(instruction.b), result);
+                            break;
+
+                        case Opcode::And:
+                        case Opcode::Or:
+                            check(context.is_boolean(result) || is_integer(result),
+                                  "Logic needs bools or integers.");
+                            expect(type_of(instruction.a), result);
+                            expect(type_of(instruction.b), result);
+                            break;
+
+                        case Opcode::Concatenate:
+                            check(context.is_string(result), "Concatenation needs strings.");
+                            expect(type_of(instruction.a), result);
+                            expect(type_of(instruction.b), result);
+                            break;
+
+                        case Opcode::Negate:
+                            check(context.is_number(result), "Negation needs a number.");
+                            expect(type_of(instruction.a), result);
+                            break;
+
+                        case Opcode::Not:
+                            check(context.is_boolean(result) || is_integer(result),
+                                  "Not needs a bool or an integer.");
+                            expect(type_of(instruction.a), result);
+                            break;
+
+                        case Opcode::Equal:
+                        case Opcode::NotEqual:
+                        case Opcode::Less:
+                        case Opcode::Greater:
+                            check(context.is_boolean(result), "Comparisons give bools.");
+                            expect(type_of(instruction.b), type_of(instruction.a));
+                            break;
+
+                        case Opcode::Convert:
+                            check(   context.is_number(result)
+                                  && context.is_number(type_of(instruction.a)),
+                                  "Only numbers can be converted.");
+                            break;
+
+                        case Opcode::Hash:
+                            check(context.is_string(type_of(instruction.a)), "Only strings hash.");
+                            check(is_integer(result), "Hashes are integers.");
+                            check(instruction.extra > 0, "Hash tables need a size.");
+                            break;
+
+                        case Opcode::Call:
+                            {
+                                check(instruction.immediate < unit.callees.size(),
+                                      "No such callee.");
+
+                                auto const& callee = unit.callees[instruction.immediate];
+                                auto arguments = function.operands_of(instruction);
+
+                                check(arguments.size() == callee.parameters.size(),
+                                      "Wrong number of arguments in the call to " + callee.name
+                                      + ".");
+
+                                for (size_t j = 0; j < arguments.size(); ++j)
+                                {
+                                    expect(type_of(arguments[j]), callee.parameters[j]);
+                                }
+
+                                expect(result, callee.result);
+                            }
+                            break;
+
+                        case Opcode::Jump:
+                            check_block(instruction.immediate);
+                            break;
+
+                        case Opcode::Branch:
+                            check(context.is_boolean(type_of(instruction.a)),
+                                  "Branches need a bool.");
+                            check_block(instruction.immediate);
+                            check_block(instruction.extra);
+                            break;
+
+                        case Opcode::Switch:
+                            {
+                                auto type = type_of(instruction.a);
+
+                                check(is_integer(type) || context.is_string(type),
+                                      "Switches need an integer or a string.");
+                                check_block(instruction.immediate);
+
+                                for (auto const& switch_case : function.cases_of(instruction))
+                                {
+                                    check(switch_case.constant < function.constants.size(),
+                                          "No such constant.");
+                                    expect(function.constants[switch_case.constant].type, type);
+                                    check_block(switch_case.target);
+                                }
+                            }
+                            break;
+
+                        case Opcode::Return:
+                            if (function.result == typing::invalid_type_id)
+                            {
+                                check(instruction.a == no_id, "Subs don't return a value.");
+                            }
+                            else
+                            {
+                                expect(type_of(instruction.a), function.result);
+                            }
+                            break;
+                    }
+                }
+
+                current_value = no_id;
+            }
+        }
+    }
+
+
+}
@@ -0,0 +1,402 @@
+
+#pragma once
+
+
+// A typed, flat intermediate representation of a module's code, lowered from the resolved and type
+// checked AST.  Optimizations work on it, and code generation consumes it.
+//
+// Each function keeps its instructions in a single vector and refers to them by index.  Every
+// instruction that produces a value is that value, defined exactly once.  Variables live in memory,
+// the slots of the function's frame or the globals of a module, and are only ever reached through
+// explicit loads and stores of their addresses.
+namespace basically::runtime::ir
+{
+
+
+    using ValueId = uint32_t;
+    using BlockId = uint32_t;
+
+    constexpr uint32_t no_id = std::numeric_limits<uint32_t>::max();
+
+
+    enum class Opcode : uint8_t
+    {
+        // immediate: index of the function's constant.
+        Constant,
+
+        // immediate: position of the parameter.
+        Parameter,
+
+        // immediate: frame slot.
+        LocalAddress,
+
+        // immediate: index of the unit's global.
+        GlobalAddress,
+
+        // a: array address, b: integer index.
+        ElementAddress,
+
+        // a: structure address, immediate: field index.
+        FieldAddress,
+
+        // a: address of a [soa] array, b: integer index, immediate: field index.
+        SoaAddress,
+
+        // a: address of an array element or [soa] field, b: integer count, the address that many
+        // elements further along the same array.
+        Offset,
+
+        // a: address.
+        Load,
+
+        // a: address, b: value.
+        Store,
+
+        // a: address, sets all of the memory there to zero.
+        Clear,
+
+        // a, b: operands of the same type as the result.
+        Add,
+        Subtract,
+        Multiply,
+        Divide,
+        And,
+        Or,
+        Concatenate,
+
+        // a: operand of the same type as the result.
+        Negate,
+        Not,
+
+        // a, b: operands of the same type, the result is a bool.
+        Equal,
+        NotEqual,
+        Less,
+        Greater,
+
+        // a: value, converted to the instruction's type.
+        Convert,
+
+        // a: string, immediate: seed, extra: table size.  The string's hash_string modulo the
+        // table's size.
+        Hash,
+
+        // immediate: index of the unit's callee, operands: the arguments.
+        Call,
+
+        // The terminators, every block ends with exactly one of these and has no others.
+
+        // immediate: target block.
+        Jump,
+
+        // a: bool condition, immediate: block if true, extra: block if false.
+        Branch,
+
+        // a: value, cases: constant and target block for each case, immediate: default block.
+        Switch,
+
+        // a: result, or no_id when there isn't one.
+        Return
+    };
+
+
+    std::ostream& operator <<(std::ostream& stream, Opcode opcode);
+
+
+    bool is_terminator(Opcode opcode) noexcept;
+    bool is_binary(Opcode opcode) noexcept;
+    bool is_comparison(Opcode opcode) noexcept;
+    bool has_side_effects(Opcode opcode) noexcept;
+
+
+    enum Flags : uint8_t
+    {
+        NoFlags = 0,
+
+        // An element or [soa] address whose index must be checked against the array's size.
+        BoundsChecked = 1
+    };
+
+
+    struct Instruction
+    {
+        Opcode opcode;
+        uint8_t flags = NoFlags;
+
+        // The type of the value produced, if any.
+        typing::TypeId type = typing::invalid_type_id;
+
+        ValueId a = no_id;
+        ValueId b = no_id;
+
+        uint32_t immediate = no_id;
+        uint32_t extra = no_id;
+
+        // A range of the function's operands, or of its cases for a switch.
+        uint32_t first = 0;
+        uint32_t count = 0;
+
+        // Index of the source location reported if the instruction fails at run time.
+        uint32_t location = no_id;
+
+        // Index of the site a branch or call is counted under when the code is profiled.
+        uint32_t site = no_id;
+    };
+
+
+    struct Block
+    {
+        std::vector<ValueId> instructions;
+    };
+
+
+    struct Constant
+    {
+        typing::TypeId type;
+
+        // Integers and bools keep their two's complement bits, floats their value and strings their
+        // text.
+        std::variant<uint64_t, double, std::string> value;
+
+        bool operator ==(Constant const& constant) const = default;
+    };
+
+
+    // The same value in another number type, wrapping, truncating or rounding as a Convert
+    // instruction would at run time.  Nothing if either type isn't a number.
+    std::optional<Constant> convert_constant(Constant const& constant, typing::TypeId type);
+
+    // What a Convert, Hash, unary, binary or comparison instruction computes from constant
+    // operands, the same as it would at run time.  Nothing for any other instruction, and for
+    // operations that would fail, which are left to fail when they run.
+    std::optional<Constant> evaluate(Instruction const& instruction,
+                                     Constant const& a,
+                                     std::optional<Constant> const& b = std::nullopt);
+
+    // Whether an integer division of the constants fails when it runs, by dividing by zero or by
+    // dividing the smallest value of a signed type by -1, whatever the width of the type.
+    bool division_fails(Constant const& dividend, Constant const& divisor);
+
+
+    // The integer values something is known to take, from low to high inclusive.
+    struct Range
+    {
+        int64_t low;
+        int64_t high;
+    };
+
+    using OptionalRange = std::optional<Range>;
+
+    // Every value of an integer type.  Nothing for other types, and for u64, whose values don't
+    // all fit.
+    OptionalRange range_of_type(typing::TypeId type) noexcept;
+
+    OptionalRange range_of_constant(Constant const& constant) noexcept;
+
+    // The values an Add, Subtract or Multiply of the given type can produce from operands in the
+    // given ranges.  Nothing if any of them would wrap around, or for any other opcode.
+    OptionalRange combine_ranges(Opcode opcode,
+                                 Range lhs,
+                                 Range rhs,
+                                 typing::TypeId type) noexcept;
+
+    // The same range after a Convert to the type, nothing if the conversion could change a value.
+    OptionalRange convert_range(Range range, typing::TypeId type) noexcept;
+
+    // Whether every value in the range is a valid index of an array of the given size.
+    bool is_within(Range range, size_t count) noexcept;
+
+
+    // FNV-1a over the text's bytes, starting from a basis varied by the seed.  Changing the seed
+    // is how a perfect hash for a set of strings is searched for.
+    uint64_t hash_string(std::string const& text, uint32_t seed) noexcept;
+
+
+    struct SwitchCase
+    {
+        uint32_t constant;
+        BlockId target;
+    };
+
+
+    struct Slot
+    {
+        std::string name;
+        typing::TypeId type;
+    };
+
+
+    struct Function
+    {
+        // Qualified with the module's name.
+        std::string name;
+
+        // The sub or function this was lowered from, null for a module's initializer.
+        typing::SubInfoPtr sub;
+
+        std::vector<typing::TypeId> parameters;
+        typing::TypeId result = typing::invalid_type_id;
+
+        std::vector<Slot> slots;
+
+        std::vector<Instruction> instructions;
+        std::vector<Block> blocks;
+
+        std::vector<ValueId> operands;
+        std::vector<SwitchCase> cases;
+        std::vector<Constant> constants;
+        std::vector<source::Location> locations;
+
+        // What each branch and call is called in a profile, the function it was lowered in and
+        // its place there.  Copies made by inlining keep the original's name, so a profile taken
+        // of code inlined one way still applies to code inlined another.
+        std::vector<std::string> sites;
+
+        Instruction const& operator [](ValueId id) const noexcept;
+        Instruction& operator [](ValueId id) noexcept;
+
+        std::span<ValueId const> operands_of(Instruction const& instruction) const noexcept;
+        std::span<SwitchCase const> cases_of(Instruction const& instruction) const noexcept;
+
+        Instruction const& terminator(BlockId block) const noexcept;
+        std::vector<BlockId> successors(BlockId block) const;
+
+        uint32_t add_slot(std::string const& name, typing::TypeId type);
+        uint32_t add_constant(Constant const& constant);
+        uint32_t add_location(source::Location const& location);
+        uint32_t add_site(std::string const& site);
+    };
+
+
+    // A variable of this module or of one of the modules it uses.
+    struct Global
+    {
+        std::string name;
+        typing::TypeId type;
+
+        modules::Module const* module;
+        size_t slot;
+
+        // The table of a [memoize]d function.  Reading and writing it can only be noticed as the
+        // function answering faster.
+        bool is_cache = false;
+
+        // What the global starts out holding, worked out at compile time, as the constants at
+        // each byte offset.  Everything else starts out zero.
+        std::map<size_t, Constant> initial;
+    };
+
+
+    // A sub or function called by this unit, possibly from another module.
+    struct Callee
+    {
+        std::string name;
+
+        modules::Module const* module;
+        typing::SubInfoPtr sub;
+
+        std::vector<typing::TypeId> parameters;
+        typing::TypeId result = typing::invalid_type_id;
+    };
+
+
+    // The code of one module.  Its own globals come first in the list of globals, in slot order.
+    struct Unit
+    {
+        std::string name;
+        modules::Module const* module = nullptr;
+
+        std::vector<Global> globals;
+        std::vector<Callee> callees;
+        std::vector<Function> functions;
+
+        Function const* find_function(typing::SubInfo const* sub) const noexcept;
+        Function const* initializer() const noexcept;
+    };
+
+
+    // Appends instructions to the end of a current block.  Each new branch and call is given a site
+    // of its own.
+    class Builder
+    {
+        private:
+            Function& function;
+            BlockId current = no_id;
+
+        public:
+            Builder(Function& new_function);
+
+        public:
+            BlockId new_block();
+            void set_block(BlockId block) noexcept;
+            BlockId get_block() const noexcept;
+
+            // Whether the current block already ends in a terminator.  Anything added after that
+            // goes into a new block, which is unreachable unless something jumps to it later.
+            bool is_terminated() const noexcept;
+
+            ValueId add(Instruction instruction);
+            ValueId add(Instruction instruction, std::vector<ValueId> const& operands);
+
+            ValueId constant(Constant const& constant);
+            ValueId convert(ValueId value, typing::TypeId type);
+
+            void jump(BlockId target);
+            void branch(ValueId condition, BlockId if_true, BlockId if_false);
+            void switch_on(ValueId value,
+                           std::vector<SwitchCase> const& cases,
+                           BlockId default_block);
+    };
+
+
+    std::ostream& operator <<(std::ostream& stream, Unit const& unit);
+    void dump_function(std::ostream& stream, Unit const& unit, Function const& function);
+
+
+    std::vector<std::vector<BlockId>> predecessors(Function const& function);
+
+    // The immediate dominator of each block, no_id for the entry block and for unreachable blocks.
+    std::vector<BlockId> dominators(Function const& function);
+
+    bool dominates(std::vector<BlockId> const& idoms, BlockId dominator, BlockId block) noexcept;
+
+    // A natural loop, the header and every block that can get back to it without going through
+    // it first.
+    struct Loop
+    {
+        BlockId header;
+
+        // In ascending order, including the header.
+        std::vector<BlockId> blocks;
+
+        bool contains(BlockId block) const noexcept;
+    };
+
+
+    // Loops sharing a header are merged, and inner loops come before the loops around them.
+    std::vector<Loop> find_loops(Function const& function);
+
+    // The block outside of the loop that's the only way into it, added if there isn't one yet.
+    // Loops that start at the entry block have none, so for those this is no_id.
+    BlockId insert_preheader(Function& function, Loop const& loop);
+
+    // Drop the blocks that can't be reached from the entry block, renumbering the rest.
+    void remove_unreachable_blocks(Function& function);
+
+    // Rewrite every use of a value to use its replacement instead.  Values that aren't replaced
+    // map to no_id, or to themselves.
+    void replace_values(Function& function, std::vector<ValueId> const& replacements);
+
+    // Take the marked instructions out of their blocks.
+    void remove_instructions(Function& function, std::vector<bool> const& removed);
+
+    // Renumber the instructions in block order, dropping those no longer in any block.
+    void compact(Function& function);
+
+
+    // Throws if the unit is malformed: a block without exactly one terminator at its end, a use of
+    // a value that doesn't dominate it, or operands of the wrong types.
+    void verify(Unit const& unit);
+
+
+}
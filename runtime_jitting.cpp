@@ -59,11 +59,2748 @@ namespace basically::runtime::jitting
             SET_OPTION(GCC_JIT_BOOL_OPTION_SELFCHECK_GC, selfcheck_gc);
             SET_OPTION(GCC_JIT_BOOL_OPTION_KEEP_INTERMEDIATES, keep_intermediates);
             SET_OPTION(GCC_JIT_INT_OPTION_OPTIMIZATION_LEVEL, optimization_level);
+
+            for (auto const& option : options.command_line_options)
+            {
+                gcc_jit_context_add_command_line_option(context, option.c_str());
+            }
+        }
+
+
+        #undef SET_OPTION
+
+
+        // Where a failing run picks up again, and why it failed.
+        thread_local std::jmp_buf* failure_point = nullptr;
+        thread_local std::string failure_message;
+
+
+        // Variables of type string start out null, which reads as the empty string.
+        char const* text_of(char const* text) noexcept
+        {
+            return text ? text : "";
+        }
+
+
+        // The support the generated code calls on, reached through its table of imports, along
+        // with fail and strings::concatenate.
+
+        int compare_strings(char const* a, char const* b) noexcept
+        {
+            return std::strcmp(text_of(a), text_of(b));
+        }
+
+
+        uint64_t hash_text(char const* text, uint32_t seed) noexcept
+        {
+            return ir::hash_string(text_of(text), seed);
+        }
+
+
+        enum class Helper : uint8_t
+        {
+            Fail,
+            Concatenate,
+            CompareStrings,
+            HashText
+        };
+
+
+        void* address_of(Helper helper) noexcept
+        {
+            switch (helper)
+            {
+                case Helper::Fail:            return reinterpret_cast<void*>(&fail);
+                case Helper::Concatenate:     return reinterpret_cast<void*>(&strings::concatenate);
+                case Helper::CompareStrings:  return reinterpret_cast<void*>(&compare_strings);
+                case Helper::HashText:        return reinterpret_cast<void*>(&hash_text);
+            }
+
+            return nullptr;
+        }
+
+
+        const std::vector<Helper> helpers =
+            {
+                Helper::Fail,
+                Helper::Concatenate,
+                Helper::CompareStrings,
+                Helper::HashText
+            };
+
+
+        // Exported names are C identifiers.  Letters and digits are kept, underscores doubled and
+        // anything else written as an underscore and two hex digits, so that no two IR names
+        // share a symbol.
+        std::string symbol_of(std::string const& name)
+        {
+            static const char digits[] = "0123456789abcdef";
+
+            std::string symbol = "basically_";
+
+            for (unsigned char next : name)
+            {
+                if (std::isalnum(next))
+                {
+                    symbol += static_cast<char>(next);
+                }
+                else if (next == '_')
+                {
+                    symbol += "__";
+                }
+                else
+                {
+                    symbol += '_';
+                    symbol += digits[next >> 4];
+                    symbol += digits[next & 0xf];
+                }
+            }
+
+            return symbol;
+        }
+
+
+        const char imports_symbol[] = "basically_imports";
+        const char counters_symbol[] = "basically_counters";
+
+        // Added to a function's symbol for its thunk.  No other symbol has an underscore followed
+        // by anything but another underscore or a hex digit.
+        const char thunk_suffix[] = "_thunk";
+
+
+        // Everything the generated code uses from outside of its own context: the support
+        // above, and the globals and functions of other modules.  Their addresses are filled
+        // into a table once the code is compiled.
+        //
+        // A function compiled for an interpreted module uses the interpreter's storage for every
+        // global, its module's own included, and the entries of the functions it calls.
+        struct Import
+        {
+            enum class Kind : uint8_t
+            {
+                Helper,
+                Global,
+                Function,
+                Storage,
+                Entry
+            };
+
+            Kind kind;
+            Helper helper = Helper::Fail;
+
+            // The index of the unit's global or callee.
+            uint32_t id = 0;
+
+            modules::Module const* module = nullptr;
+            std::string name;
+        };
+
+
+        // Every helper, then the globals and callees of other modules, in the order of the unit's
+        // lists.  Code loaded from a library has its table filled in the same order as when it
+        // was generated.  For a single function of an interpreted module, every global and every
+        // callee but the function itself.
+        std::vector<Import> imports_of(ir::Unit const& unit, ir::Function const* tiered = nullptr)
+        {
+            std::vector<Import> imports;
+
+            for (auto helper : helpers)
+            {
+                imports.push_back({ .kind = Import::Kind::Helper, .helper = helper });
+            }
+
+            for (uint32_t id = 0; id < unit.globals.size(); ++id)
+            {
+                auto const& global = unit.globals[id];
+
+                if (tiered || (global.module != unit.module))
+                {
+                    imports.push_back({
+                            .kind = tiered ? Import::Kind::Storage : Import::Kind::Global,
+                            .id = id,
+                            .module = global.module,
+                            .name = global.name
+                        });
+                }
+            }
+
+            for (uint32_t id = 0; id < unit.callees.size(); ++id)
+            {
+                auto const& callee = unit.callees[id];
+
+                auto is_imported = tiered ? (callee.sub != tiered->sub)
+                                          : (callee.module != unit.module);
+
+                if (is_imported)
+                {
+                    imports.push_back({
+                            .kind = tiered ? Import::Kind::Entry : Import::Kind::Function,
+                            .id = id,
+                            .module = callee.module,
+                            .name = callee.name
+                        });
+                }
+            }
+
+            return imports;
+        }
+
+
+        // Where each of the unit's counters is, when its code counts what it does.  Every function
+        // has two, for its calls and for the times its loops go around.  After them come two for
+        // each branch with a site, for the times it's taken and the times it's reached, and one
+        // for each call with a site.  Reading the counters back finds them the same way.
+        struct Counters
+        {
+            std::vector<size_t> functions;
+            std::vector<std::map<ir::ValueId, size_t>> sites;
+            size_t count = 0;
+        };
+
+
+        Counters counters_of(ir::Unit const& unit)
+        {
+            Counters counters;
+
+            for (auto const& function : unit.functions)
+            {
+                counters.functions.push_back(counters.count);
+                counters.count += 2;
+
+                auto& sites = counters.sites.emplace_back();
+
+                for (auto const& block : function.blocks)
+                {
+                    for (auto id : block.instructions)
+                    {
+                        auto const& instruction = function[id];
+
+                        if (instruction.site == ir::no_id)
+                        {
+                            continue;
+                        }
+
+                        sites[id] = counters.count;
+                        counters.count += (instruction.opcode == ir::Opcode::Branch) ? 2 : 1;
+                    }
+                }
+            }
+
+            return counters;
+        }
+
+
+        void* resolve(Import const& import)
+        {
+            switch (import.kind)
+            {
+                case Import::Kind::Helper:
+                    return address_of(import.helper);
+
+                case Import::Kind::Global:
+                    return import.module->get_jit().get_global(import.module->get_name(),
+                                                               import.name);
+
+                case Import::Kind::Function:
+                    return import.module->get_jit().get_code(import.name);
+
+                case Import::Kind::Storage:
+                    return import.module->get_interpreter()->get_global(import.name);
+
+                case Import::Kind::Entry:
+                    return import.module->get_interpreter()->get_entry(import.name);
+            }
+
+            return nullptr;
+        }
+
+
+        // Every module's context is a child of this one, which declares what they all use once:
+        // the types the code is made of, the builtins it calls, the signatures of the helpers
+        // and the options they share.  It's never released, so that it outlives the contexts of
+        // the modules however they're torn down.
+        //
+        // libgccjit only lets one thread at a time use a family of contexts, so every use of
+        // them, from creating a child to compiling it, holds the lock.
+        class Parent
+        {
+            public:
+                gcc_jit_context* context;
+                std::mutex lock;
+
+                gcc_jit_type* void_type;
+                gcc_jit_type* bool_type;
+                gcc_jit_type* int_type;
+                gcc_jit_type* long_type;
+                gcc_jit_type* size_type;
+                gcc_jit_type* offset_type;
+                gcc_jit_type* u32_type;
+                gcc_jit_type* u64_type;
+                gcc_jit_type* string_type;
+                gcc_jit_type* byte_type;
+                gcc_jit_type* bytes_type;
+                gcc_jit_type* void_pointer_type;
+                gcc_jit_type* const_void_pointer_type;
+
+                gcc_jit_function* memcpy_function;
+                gcc_jit_function* memset_function;
+                gcc_jit_function* expect_function;
+
+                // Pointers to the helpers, as they're found in a module's table of imports.
+                std::map<Helper, gcc_jit_type*> helper_types;
+
+            public:
+                Parent()
+                : context(gcc_jit_context_acquire())
+                {
+                    if (context == nullptr)
+                    {
+                        throw std::runtime_error("Could not aquire JIT context.");
+                    }
+
+                    // Integers wrap around in the IR, and so they have to in the generated code.
+                    gcc_jit_context_add_command_line_option(context, "-fwrapv");
+
+                    void_type = gcc_jit_context_get_type(context, GCC_JIT_TYPE_VOID);
+                    bool_type = gcc_jit_context_get_type(context, GCC_JIT_TYPE_BOOL);
+                    int_type = gcc_jit_context_get_type(context, GCC_JIT_TYPE_INT);
+                    long_type = gcc_jit_context_get_type(context, GCC_JIT_TYPE_LONG);
+                    size_type = gcc_jit_context_get_type(context, GCC_JIT_TYPE_SIZE_T);
+                    offset_type = gcc_jit_context_get_int_type(context, 8, 1);
+                    u32_type = gcc_jit_context_get_int_type(context, 4, 0);
+                    u64_type = gcc_jit_context_get_int_type(context, 8, 0);
+                    string_type = gcc_jit_context_get_type(context, GCC_JIT_TYPE_CONST_CHAR_PTR);
+                    byte_type = gcc_jit_context_get_type(context, GCC_JIT_TYPE_UNSIGNED_CHAR);
+                    bytes_type = gcc_jit_type_get_pointer(byte_type);
+                    void_pointer_type = gcc_jit_context_get_type(context, GCC_JIT_TYPE_VOID_PTR);
+                    const_void_pointer_type = gcc_jit_type_get_pointer(
+                                                               gcc_jit_type_get_const(void_type));
+
+                    memcpy_function = gcc_jit_context_get_builtin_function(context,
+                                                                           "__builtin_memcpy");
+                    memset_function = gcc_jit_context_get_builtin_function(context,
+                                                                           "__builtin_memset");
+                    expect_function = gcc_jit_context_get_builtin_function(context,
+                                                                           "__builtin_expect");
+
+                    helper_types[Helper::Fail] = pointer_type(void_type, { string_type });
+                    helper_types[Helper::Concatenate] = pointer_type(string_type,
+                                                                     { string_type, string_type });
+                    helper_types[Helper::CompareStrings] = pointer_type(int_type,
+                                                                        { string_type,
+                                                                          string_type });
+                    helper_types[Helper::HashText] = pointer_type(u64_type,
+                                                                  { string_type, u32_type });
+                }
+
+            private:
+                gcc_jit_type* pointer_type(gcc_jit_type* result_type,
+                                           std::vector<gcc_jit_type*> parameters)
+                {
+                    return gcc_jit_context_new_function_ptr_type(
+                                                            context,
+                                                            nullptr,
+                                                            result_type,
+                                                            static_cast<int>(parameters.size()),
+                                                            parameters.data(),
+                                                            0);
+                }
+        };
+
+
+        Parent& get_parent()
+        {
+            static Parent* parent = new Parent();
+            return *parent;
+        }
+
+
+        // What the units compiled into one context share.  Each unit's globals and functions are
+        // reached directly by those after it, rather than through a table of imports, so gcc
+        // can inline and specialize across modules.  Only what's public is exported, everything
+        // else has internal linkage.
+        //
+        // A program of its own has the helpers generated along with the code.  Code run by the
+        // interpreter reaches the interpreter's helpers through a table that all of the units
+        // share.
+        struct Linkage
+        {
+            std::unordered_map<std::string, gcc_jit_lvalue*> globals;
+            std::unordered_map<std::string, gcc_jit_function*> functions;
+
+            std::map<Helper, gcc_jit_function*> helpers;
+            gcc_jit_lvalue* helper_table = nullptr;
+        };
+
+
+        bool is_public(typing::Visibility visibility) noexcept
+        {
+            return typing::check_visibility<typing::Visibility::Public>(visibility,
+                                                                        typing::Visibility::Public);
         }
 
 
-        #undef SET_OPTION
+        // The helpers for a program of its own, which only needs the C library.  They do what
+        // the interpreter's do, except that a failure prints its message and exits, as the
+        // interpreter would after unwinding.
+        std::map<Helper, gcc_jit_function*> generate_runtime(gcc_jit_context* context)
+        {
+            auto void_type = gcc_jit_context_get_type(context, GCC_JIT_TYPE_VOID);
+            auto int_type = gcc_jit_context_get_type(context, GCC_JIT_TYPE_INT);
+            auto size_type = gcc_jit_context_get_type(context, GCC_JIT_TYPE_SIZE_T);
+            auto u32_type = gcc_jit_context_get_int_type(context, 4, 0);
+            auto u64_type = gcc_jit_context_get_int_type(context, 8, 0);
+            auto string_type = gcc_jit_context_get_type(context, GCC_JIT_TYPE_CONST_CHAR_PTR);
+            auto byte_type = gcc_jit_context_get_type(context, GCC_JIT_TYPE_UNSIGNED_CHAR);
+            auto bytes_type = gcc_jit_type_get_pointer(byte_type);
+            auto void_pointer_type = gcc_jit_context_get_type(context, GCC_JIT_TYPE_VOID_PTR);
+
+            using Parameters = std::vector<std::pair<gcc_jit_type*, char const*>>;
+
+            auto new_function = [&](gcc_jit_function_kind kind,
+                                     gcc_jit_type* result_type,
+                                     char const* name,
+                                     Parameters const& parameters)
+                {
+                    std::vector<gcc_jit_param*> params;
+
+                    for (auto const& [ type, parameter_name ] : parameters)
+                    {
+                        params.push_back(gcc_jit_context_new_param(context,
+                                                                   nullptr,
+                                                                   type,
+                                                                   parameter_name));
+                    }
+
+                    return gcc_jit_context_new_function(context,
+                                                        nullptr,
+                                                        kind,
+                                                        result_type,
+                                                        name,
+                                                        static_cast<int>(params.size()),
+                                                        params.data(),
+                                                        0);
+                };
+
+            auto imported = [&](gcc_jit_type* result_type,
+                                char const* name,
+                                Parameters const& parameters)
+                {
+                    return new_function(GCC_JIT_FUNCTION_IMPORTED, result_type, name, parameters);
+                };
+
+            auto internal = [&](gcc_jit_type* result_type,
+                                char const* name,
+                                Parameters const& parameters)
+                {
+                    return new_function(GCC_JIT_FUNCTION_INTERNAL, result_type, name, parameters);
+                };
+
+            auto call = [&](gcc_jit_function* function, std::vector<gcc_jit_rvalue*> arguments)
+                {
+                    return gcc_jit_context_new_call(context,
+                                                    nullptr,
+                                                    function,
+                                                    static_cast<int>(arguments.size()),
+                                                    arguments.data());
+                };
+
+            auto param = [&](gcc_jit_function* function, int index)
+                {
+                    return gcc_jit_param_as_rvalue(gcc_jit_function_get_param(function, index));
+                };
+
+            auto c_fputs = imported(int_type,
+                                    "fputs",
+                                    { { string_type, "text" }, { void_pointer_type, "stream" } });
+            auto c_exit = imported(void_type, "exit", { { int_type, "status" } });
+            auto c_strlen = imported(size_type, "strlen", { { string_type, "text" } });
+            auto c_strcmp = imported(int_type,
+                                     "strcmp",
+                                     { { string_type, "a" }, { string_type, "b" } });
+            auto c_malloc = imported(void_pointer_type, "malloc", { { size_type, "size" } });
+            auto c_memcpy = gcc_jit_context_get_builtin_function(context, "__builtin_memcpy");
+
+            auto c_stderr = gcc_jit_context_new_global(context,
+                                                       nullptr,
+                                                       GCC_JIT_GLOBAL_IMPORTED,
+                                                       void_pointer_type,
+                                                       "stderr");
+
+            std::map<Helper, gcc_jit_function*> helpers;
+
+            // Variables of type string start out null, which reads as the empty string.
+            auto text_of = internal(string_type, "basically_text_of", { { string_type, "text" } });
+            {
+                auto entry = gcc_jit_function_new_block(text_of, "entry");
+                auto empty = gcc_jit_function_new_block(text_of, "empty");
+                auto given = gcc_jit_function_new_block(text_of, "given");
+
+                gcc_jit_block_end_with_conditional(
+                                    entry,
+                                    nullptr,
+                                    gcc_jit_context_new_comparison(
+                                                            context,
+                                                            nullptr,
+                                                            GCC_JIT_COMPARISON_EQ,
+                                                            param(text_of, 0),
+                                                            gcc_jit_context_null(context,
+                                                                                 string_type)),
+                                    empty,
+                                    given);
+
+                gcc_jit_block_end_with_return(empty,
+                                              nullptr,
+                                              gcc_jit_context_new_string_literal(context, ""));
+                gcc_jit_block_end_with_return(given, nullptr, param(text_of, 0));
+            }
+
+            auto fail = internal(void_type, "basically_fail", { { string_type, "message" } });
+            {
+                auto block = gcc_jit_function_new_block(fail, "entry");
+                auto stream = gcc_jit_lvalue_as_rvalue(c_stderr);
+
+                gcc_jit_block_add_eval(block, nullptr, call(c_fputs, { param(fail, 0), stream }));
+                gcc_jit_block_add_eval(block,
+                                       nullptr,
+                                       call(c_fputs,
+                                            {
+                                                gcc_jit_context_new_string_literal(context, "\n"),
+                                                stream
+                                            }));
+                gcc_jit_block_add_eval(block,
+                                       nullptr,
+                                       call(c_exit,
+                                            { gcc_jit_context_one(context, int_type) }));
+                gcc_jit_block_end_with_void_return(block, nullptr);
+            }
+
+            helpers[Helper::Fail] = fail;
+
+            // Strings built at run time are kept until the program exits.
+            auto concatenate = internal(string_type,
+                                        "basically_concatenate",
+                                        { { string_type, "a" }, { string_type, "b" } });
+            {
+                auto block = gcc_jit_function_new_block(concatenate, "entry");
+
+                auto local = [&](gcc_jit_type* type, char const* name, gcc_jit_rvalue* value)
+                    {
+                        auto variable = gcc_jit_function_new_local(concatenate,
+                                                                   nullptr,
+                                                                   type,
+                                                                   name);
+
+                        gcc_jit_block_add_assignment(block, nullptr, variable, value);
+                        return gcc_jit_lvalue_as_rvalue(variable);
+                    };
+
+                auto a = local(string_type, "text_a", call(text_of, { param(concatenate, 0) }));
+                auto b = local(string_type, "text_b", call(text_of, { param(concatenate, 1) }));
+                auto size_a = local(size_type, "size_a", call(c_strlen, { a }));
+                auto size_b = local(size_type, "size_b", call(c_strlen, { b }));
+
+                auto total = gcc_jit_context_new_binary_op(
+                                                context,
+                                                nullptr,
+                                                GCC_JIT_BINARY_OP_PLUS,
+                                                size_type,
+                                                gcc_jit_context_new_binary_op(
+                                                                        context,
+                                                                        nullptr,
+                                                                        GCC_JIT_BINARY_OP_PLUS,
+                                                                        size_type,
+                                                                        size_a,
+                                                                        size_b),
+                                                gcc_jit_context_one(context, size_type));
+
+                auto text = local(bytes_type,
+                                  "text",
+                                  gcc_jit_context_new_cast(context,
+                                                           nullptr,
+                                                           call(c_malloc, { total }),
+                                                           bytes_type));
+
+                auto after_a = gcc_jit_lvalue_get_address(
+                                        gcc_jit_context_new_array_access(context,
+                                                                         nullptr,
+                                                                         text,
+                                                                         size_a),
+                                        nullptr);
+
+                auto as_void = [&](gcc_jit_rvalue* pointer)
+                    {
+                        return gcc_jit_context_new_cast(context,
+                                                        nullptr,
+                                                        pointer,
+                                                        void_pointer_type);
+                    };
+
+                gcc_jit_block_add_eval(block,
+                                       nullptr,
+                                       call(c_memcpy, { as_void(text), as_void(a), size_a }));
+                gcc_jit_block_add_eval(block,
+                                       nullptr,
+                                       call(c_memcpy,
+                                            {
+                                                as_void(after_a),
+                                                as_void(b),
+                                                gcc_jit_context_new_binary_op(
+                                                            context,
+                                                            nullptr,
+                                                            GCC_JIT_BINARY_OP_PLUS,
+                                                            size_type,
+                                                            size_b,
+                                                            gcc_jit_context_one(context,
+                                                                                size_type))
+                                            }));
+
+                gcc_jit_block_end_with_return(block,
+                                              nullptr,
+                                              gcc_jit_context_new_cast(context,
+                                                                       nullptr,
+                                                                       text,
+                                                                       string_type));
+            }
+
+            helpers[Helper::Concatenate] = concatenate;
+
+            auto compare_strings = internal(int_type,
+                                            "basically_compare_strings",
+                                            { { string_type, "a" }, { string_type, "b" } });
+            {
+                auto block = gcc_jit_function_new_block(compare_strings, "entry");
+
+                gcc_jit_block_end_with_return(
+                                    block,
+                                    nullptr,
+                                    call(c_strcmp,
+                                         {
+                                             call(text_of, { param(compare_strings, 0) }),
+                                             call(text_of, { param(compare_strings, 1) })
+                                         }));
+            }
+
+            helpers[Helper::CompareStrings] = compare_strings;
+
+            // The same as ir::hash_string, so that hashes worked out at compile time match.
+            auto hash_text = internal(u64_type,
+                                      "basically_hash_text",
+                                      { { string_type, "text" }, { u32_type, "seed" } });
+            {
+                auto entry = gcc_jit_function_new_block(hash_text, "entry");
+                auto test = gcc_jit_function_new_block(hash_text, "test");
+                auto step = gcc_jit_function_new_block(hash_text, "step");
+                auto done = gcc_jit_function_new_block(hash_text, "done");
+
+                auto basis = gcc_jit_context_new_rvalue_from_long(
+                                                    context,
+                                                    u64_type,
+                                                    static_cast<long>(14695981039346656037ull));
+                auto prime = gcc_jit_context_new_rvalue_from_long(
+                                                    context,
+                                                    u64_type,
+                                                    static_cast<long>(1099511628211ull));
+
+                auto hash = gcc_jit_function_new_local(hash_text, nullptr, u64_type, "hash");
+                auto next = gcc_jit_function_new_local(hash_text, nullptr, bytes_type, "next");
+
+                auto seed = gcc_jit_context_new_cast(context,
+                                                     nullptr,
+                                                     param(hash_text, 1),
+                                                     u64_type);
+
+                gcc_jit_block_add_assignment(entry,
+                                             nullptr,
+                                             hash,
+                                             gcc_jit_context_new_binary_op(
+                                                        context,
+                                                        nullptr,
+                                                        GCC_JIT_BINARY_OP_BITWISE_XOR,
+                                                        u64_type,
+                                                        basis,
+                                                        gcc_jit_context_new_binary_op(
+                                                                        context,
+                                                                        nullptr,
+                                                                        GCC_JIT_BINARY_OP_MULT,
+                                                                        u64_type,
+                                                                        seed,
+                                                                        prime)));
+                gcc_jit_block_add_assignment(entry,
+                                             nullptr,
+                                             next,
+                                             gcc_jit_context_new_cast(
+                                                            context,
+                                                            nullptr,
+                                                            call(text_of, { param(hash_text, 0) }),
+                                                            bytes_type));
+                gcc_jit_block_end_with_jump(entry, nullptr, test);
+
+                auto character = gcc_jit_lvalue_as_rvalue(
+                                        gcc_jit_rvalue_dereference(gcc_jit_lvalue_as_rvalue(next),
+                                                                   nullptr));
+
+                gcc_jit_block_end_with_conditional(
+                                    test,
+                                    nullptr,
+                                    gcc_jit_context_new_comparison(
+                                                            context,
+                                                            nullptr,
+                                                            GCC_JIT_COMPARISON_EQ,
+                                                            character,
+                                                            gcc_jit_context_zero(context,
+                                                                                 byte_type)),
+                                    done,
+                                    step);
+
+                gcc_jit_block_add_assignment(
+                            step,
+                            nullptr,
+                            hash,
+                            gcc_jit_context_new_binary_op(
+                                        context,
+                                        nullptr,
+                                        GCC_JIT_BINARY_OP_MULT,
+                                        u64_type,
+                                        gcc_jit_context_new_binary_op(
+                                                    context,
+                                                    nullptr,
+                                                    GCC_JIT_BINARY_OP_BITWISE_XOR,
+                                                    u64_type,
+                                                    gcc_jit_lvalue_as_rvalue(hash),
+                                                    gcc_jit_context_new_cast(context,
+                                                                             nullptr,
+                                                                             character,
+                                                                             u64_type)),
+                                        prime));
+                gcc_jit_block_add_assignment(
+                            step,
+                            nullptr,
+                            next,
+                            gcc_jit_lvalue_get_address(
+                                    gcc_jit_context_new_array_access(
+                                                    context,
+                                                    nullptr,
+                                                    gcc_jit_lvalue_as_rvalue(next),
+                                                    gcc_jit_context_one(context, int_type)),
+                                    nullptr));
+                gcc_jit_block_end_with_jump(step, nullptr, test);
+
+                gcc_jit_block_end_with_return(done, nullptr, gcc_jit_lvalue_as_rvalue(hash));
+            }
+
+            helpers[Helper::HashText] = hash_text;
+
+            return helpers;
+        }
+
+
+        // Runs the initializers in order, as loading the script would have, and exits with the
+        // last one's result.
+        void generate_main(gcc_jit_context* context,
+                           std::vector<gcc_jit_function*> const& initializers)
+        {
+            auto int_type = gcc_jit_context_get_type(context, GCC_JIT_TYPE_INT);
+            auto main = gcc_jit_context_new_function(context,
+                                                     nullptr,
+                                                     GCC_JIT_FUNCTION_EXPORTED,
+                                                     int_type,
+                                                     "main",
+                                                     0,
+                                                     nullptr,
+                                                     0);
+
+            auto block = gcc_jit_function_new_block(main, "entry");
+            gcc_jit_rvalue* result = gcc_jit_context_zero(context, int_type);
+
+            for (auto initializer : initializers)
+            {
+                auto call = gcc_jit_context_new_call(context, nullptr, initializer, 0, nullptr);
+
+                if (initializer == initializers.back())
+                {
+                    result = gcc_jit_context_new_cast(context, nullptr, call, int_type);
+                }
+                else
+                {
+                    gcc_jit_block_add_eval(block, nullptr, call);
+                }
+            }
+
+            gcc_jit_block_end_with_return(block, nullptr, result);
+        }
+
+
+        // Generates the code of a unit into a JIT context.
+        //
+        // Every value is kept in a local of its own, assigned where its instruction runs, which
+        // gcc folds away again.  Memory is reached through pointers to the scalar types, or to
+        // bytes for structures and arrays, whose values are the addresses of copies of them.
+        // Globals and structure or array locals are plain arrays of integers, laid out by the
+        // type context rather than by gcc.
+        class Generator
+        {
+            private:
+                gcc_jit_context* context;
+                ir::Unit const& unit;
+                typing::TypeContext& types;
+
+                // Null when the unit is compiled on its own.
+                Linkage* linkage;
+
+                // What the module's profile has to say about its code, if it has one.
+                profiling::Profile const* profile;
+
+                typing::TypeTable<gcc_jit_type*> value_types;
+
+                gcc_jit_type* void_type;
+                gcc_jit_type* bool_type;
+                gcc_jit_type* int_type;
+                gcc_jit_type* long_type;
+                gcc_jit_type* size_type;
+                gcc_jit_type* offset_type;
+                gcc_jit_type* u64_type;
+                gcc_jit_type* string_type;
+                gcc_jit_type* byte_type;
+                gcc_jit_type* bytes_type;
+                gcc_jit_type* void_pointer_type;
+                gcc_jit_type* const_void_pointer_type;
+
+                gcc_jit_function* memcpy_function;
+                gcc_jit_function* memset_function;
+                gcc_jit_function* expect_function;
+
+                // Only set when the code counts what it does.
+                Counters counters;
+                gcc_jit_lvalue* counter_table = nullptr;
+
+                std::vector<Import> imports;
+                std::map<Helper, uint32_t> helper_imports;
+                std::map<uint32_t, uint32_t> global_imports;
+                std::map<uint32_t, uint32_t> callee_imports;
+                std::map<uint32_t, uint32_t> entry_imports;
+                gcc_jit_lvalue* import_table = nullptr;
+
+                std::vector<gcc_jit_lvalue*> globals;
+                std::unordered_map<typing::SubInfo const*, gcc_jit_function*> functions;
+
+                // The state of the function being generated.
+                ir::Function const* function = nullptr;
+                gcc_jit_function* generated = nullptr;
+                gcc_jit_type* return_type = nullptr;
+                gcc_jit_block* current = nullptr;
+                ir::BlockId current_block = ir::no_id;
+                std::vector<gcc_jit_block*> blocks;
+                std::vector<gcc_jit_lvalue*> slots;
+                std::vector<gcc_jit_rvalue*> values;
+                gcc_jit_param* result_param = nullptr;
+
+                // For counting the function's calls, loops and sites.
+                size_t function_counters = 0;
+                std::map<ir::ValueId, size_t> const* site_counters = nullptr;
+                std::vector<bool> is_header;
+                std::vector<ir::BlockId> dominators;
+
+            public:
+                Generator(gcc_jit_context* new_context,
+                          ir::Unit const& new_unit,
+                          Linkage* new_linkage = nullptr)
+                : context(new_context),
+                  unit(new_unit),
+                  types(typing::get_type_context()),
+                  linkage(new_linkage),
+                  profile(new_unit.module ? new_unit.module->get_profile() : nullptr)
+                {
+                    auto const& parent = get_parent();
+
+                    void_type = parent.void_type;
+                    bool_type = parent.bool_type;
+                    int_type = parent.int_type;
+                    long_type = parent.long_type;
+                    size_type = parent.size_type;
+                    offset_type = parent.offset_type;
+                    u64_type = parent.u64_type;
+                    string_type = parent.string_type;
+                    byte_type = parent.byte_type;
+                    bytes_type = parent.bytes_type;
+                    void_pointer_type = parent.void_pointer_type;
+                    const_void_pointer_type = parent.const_void_pointer_type;
+
+                    memcpy_function = parent.memcpy_function;
+                    memset_function = parent.memset_function;
+                    expect_function = parent.expect_function;
+                }
+
+            public:
+                // Code that's instrumented counts what it does, for a profile of the module.
+                void generate(bool is_instrumented = false)
+                {
+                    if (linkage)
+                    {
+                        link_callees();
+                        link_helpers();
+                    }
+                    else
+                    {
+                        collect_imports();
+                    }
+
+                    if (is_instrumented)
+                    {
+                        declare_counters();
+                    }
+
+                    for (auto const& global : unit.globals)
+                    {
+                        globals.push_back(global.module == unit.module ? declare_global(global)
+                                                                       : linked_global(global));
+                    }
+
+                    std::vector<gcc_jit_function*> declared;
+
+                    for (auto const& unit_function : unit.functions)
+                    {
+                        declared.push_back(declare_function(unit_function));
+
+                        if (unit_function.sub)
+                        {
+                            functions.insert({ unit_function.sub.get(), declared.back() });
+                        }
+                    }
+
+                    for (size_t index = 0; index < unit.functions.size(); ++index)
+                    {
+                        generate_function(unit.functions[index], declared[index]);
+                    }
+                }
+
+                // Only the one function, with everything else it uses imported.  What it calls
+                // goes through a stub for each callee, only its calls to itself are direct.
+                void generate_tiered(ir::Function const& tiered)
+                {
+                    collect_imports(&tiered);
+
+                    globals.assign(unit.globals.size(), nullptr);
+
+                    auto declared = declare_function(tiered);
+                    functions.insert({ tiered.sub.get(), declared });
+
+                    for (auto [ id, import ] : entry_imports)
+                    {
+                        auto const& callee = unit.callees[id];
+                        functions.insert({ callee.sub.get(), generate_stub(callee, import) });
+                    }
+
+                    generate_thunk(tiered, declared);
+                    generate_function(tiered, declared);
+                }
+
+            private:
+                bool is_aggregate(typing::TypeId type) const
+                {
+                    return types.is_structure(type) || types.is_array(type);
+                }
+
+                gcc_jit_type* value_type(typing::TypeId type)
+                {
+                    if (auto found = value_types.find(type); found)
+                    {
+                        return *found;
+                    }
+
+                    gcc_jit_type* generated_type = nullptr;
+
+                    if (types.is_boolean(type))
+                    {
+                        generated_type = bool_type;
+                    }
+                    else if (types.is_string(type))
+                    {
+                        generated_type = string_type;
+                    }
+                    else if (types.is_pointer(type))
+                    {
+                        generated_type = address_type(types.element_of(type));
+                    }
+                    else if (is_aggregate(type))
+                    {
+                        generated_type = bytes_type;
+                    }
+                    else
+                    {
+                        auto number = types.number_info(type);
+
+                        if (number->is_floating_point == typing::FloatingPointFlag::IsFloatingPoint)
+                        {
+                            generated_type = gcc_jit_context_get_type(context,
+                                                                      number->size == 4
+                                                                          ? GCC_JIT_TYPE_FLOAT
+                                                                          : GCC_JIT_TYPE_DOUBLE);
+                        }
+                        else
+                        {
+                            generated_type = gcc_jit_context_get_int_type(
+                                        context,
+                                        static_cast<int>(number->size),
+                                        number->is_signed == typing::SignedFlag::IsSigned);
+                        }
+                    }
+
+                    return value_types.set(type, generated_type);
+                }
+
+                gcc_jit_type* address_type(typing::TypeId pointee)
+                {
+                    return is_aggregate(pointee) ? bytes_type
+                                                 : gcc_jit_type_get_pointer(value_type(pointee));
+                }
+
+                // Enough integers as wide as the type's alignment to hold a value of it, which
+                // aligns it, and lets a global start out with a blob of bytes.
+                gcc_jit_type* storage_type(typing::TypeId type)
+                {
+                    auto alignment = types.alignment_of(type);
+                    auto width = gcc_jit_context_get_int_type(context,
+                                                              static_cast<int>(alignment),
+                                                              0);
+
+                    auto count = storage_size(type) / alignment;
+
+                    return gcc_jit_context_new_array_type(context,
+                                                          nullptr,
+                                                          width,
+                                                          static_cast<int>(count));
+                }
+
+                size_t storage_size(typing::TypeId type)
+                {
+                    auto alignment = types.alignment_of(type);
+                    return (types.size_of(type) + alignment - 1) / alignment * alignment;
+                }
+
+                gcc_jit_location* location_of(ir::Instruction const& instruction)
+                {
+                    if (instruction.location == ir::no_id)
+                    {
+                        return nullptr;
+                    }
+
+                    auto const& location = function->locations[instruction.location];
+
+                    return gcc_jit_context_new_location(context,
+                                                        location.path.string().c_str(),
+                                                        static_cast<int>(location.line),
+                                                        static_cast<int>(location.column));
+                }
+
+                // The other units of the program come first, so what this one uses of theirs
+                // has already been declared.
+                void link_callees()
+                {
+                    for (auto const& callee : unit.callees)
+                    {
+                        if (callee.module != unit.module)
+                        {
+                            functions.insert({ callee.sub.get(),
+                                               linkage->functions.at(symbol_of(callee.name)) });
+                        }
+                    }
+                }
+
+                void link_helpers()
+                {
+                    if (linkage->helper_table == nullptr)
+                    {
+                        return;
+                    }
+
+                    import_table = linkage->helper_table;
+
+                    for (uint32_t index = 0; index < helpers.size(); ++index)
+                    {
+                        helper_imports[helpers[index]] = index;
+                    }
+                }
+
+                gcc_jit_lvalue* linked_global(ir::Global const& global)
+                {
+                    if (!linkage)
+                    {
+                        return nullptr;
+                    }
+
+                    return linkage->globals.at(symbol_of(global.module->get_name() + "."
+                                                         + global.name));
+                }
+
+                void collect_imports(ir::Function const* tiered = nullptr)
+                {
+                    imports = imports_of(unit, tiered);
+
+                    for (uint32_t index = 0; index < imports.size(); ++index)
+                    {
+                        auto const& import = imports[index];
+
+                        switch (import.kind)
+                        {
+                            case Import::Kind::Helper:
+                                helper_imports[import.helper] = index;
+                                break;
+
+                            case Import::Kind::Global:
+                                global_imports[import.id] = index;
+                                break;
+
+                            case Import::Kind::Function:
+                                callee_imports[import.id] = index;
+                                break;
+
+                            case Import::Kind::Storage:
+                                global_imports[import.id] = index;
+                                break;
+
+                            case Import::Kind::Entry:
+                                entry_imports[import.id] = index;
+                                break;
+                        }
+                    }
+
+                    auto table_type = gcc_jit_context_new_array_type(
+                                                            context,
+                                                            nullptr,
+                                                            void_pointer_type,
+                                                            static_cast<int>(imports.size()));
+
+                    import_table = gcc_jit_context_new_global(context,
+                                                              nullptr,
+                                                              GCC_JIT_GLOBAL_EXPORTED,
+                                                              table_type,
+                                                              imports_symbol);
+                }
+
+                gcc_jit_rvalue* imported(uint32_t import, gcc_jit_type* type)
+                {
+                    auto entry = gcc_jit_context_new_array_access(
+                                    context,
+                                    nullptr,
+                                    gcc_jit_lvalue_as_rvalue(import_table),
+                                    gcc_jit_context_new_rvalue_from_int(context, int_type, import));
+
+                    return gcc_jit_context_new_cast(context,
+                                                    nullptr,
+                                                    gcc_jit_lvalue_as_rvalue(entry),
+                                                    type);
+                }
+
+                gcc_jit_lvalue* declare_global(ir::Global const& global)
+                {
+                    auto symbol = symbol_of(global.module->get_name() + "." + global.name);
+                    auto kind = GCC_JIT_GLOBAL_EXPORTED;
+
+                    if (linkage)
+                    {
+                        auto variable = global.module->find_global(global.name);
+
+                        if (!variable || !is_public(variable->visibility))
+                        {
+                            kind = GCC_JIT_GLOBAL_INTERNAL;
+                        }
+                    }
+
+                    auto lvalue = gcc_jit_context_new_global(context,
+                                                             nullptr,
+                                                             kind,
+                                                             storage_type(global.type),
+                                                             symbol.c_str());
+
+                    std::vector<uint8_t> blob(storage_size(global.type), 0);
+                    auto is_zero = true;
+
+                    for (auto const& [ offset, constant ] : global.initial)
+                    {
+                        if (types.is_string(constant.type))
+                        {
+                            continue;
+                        }
+
+                        write_constant(&blob[offset], constant);
+                        is_zero = false;
+                    }
+
+                    if (!is_zero)
+                    {
+                        gcc_jit_global_set_initializer(lvalue, blob.data(), blob.size());
+                    }
+
+                    if (linkage)
+                    {
+                        linkage->globals.insert({ symbol, lvalue });
+                    }
+
+                    return lvalue;
+                }
+
+                // The constant's bytes, as the machine would have stored them.
+                void write_constant(uint8_t* bytes, ir::Constant const& constant)
+                {
+                    auto size = types.size_of(constant.type);
+
+                    auto write = [&](auto value)
+                        {
+                            std::memcpy(bytes, &value, sizeof(value));
+                        };
+
+                    if (auto real = std::get_if<double>(&constant.value); real)
+                    {
+                        if (size == 4)
+                        {
+                            write(static_cast<float>(*real));
+                        }
+                        else
+                        {
+                            write(*real);
+                        }
+
+                        return;
+                    }
+
+                    auto bits = std::get<uint64_t>(constant.value);
+
+                    switch (size)
+                    {
+                        case 1:  write(static_cast<uint8_t>(bits));   break;
+                        case 2:  write(static_cast<uint16_t>(bits));  break;
+                        case 4:  write(static_cast<uint32_t>(bits));  break;
+                        default: write(bits);                         break;
+                    }
+                }
+
+                // Structures and arrays are returned through a pointer to the caller's copy,
+                // passed ahead of the arguments.
+                gcc_jit_function* declare_function(ir::Function const& declared)
+                {
+                    std::vector<gcc_jit_param*> params;
+                    auto result_type = void_type;
+
+                    if (declared.result != typing::invalid_type_id)
+                    {
+                        if (is_aggregate(declared.result))
+                        {
+                            params.push_back(gcc_jit_context_new_param(context,
+                                                                       nullptr,
+                                                                       bytes_type,
+                                                                       "result"));
+                        }
+                        else
+                        {
+                            result_type = value_type(declared.result);
+                        }
+                    }
+
+                    for (size_t index = 0; index < declared.parameters.size(); ++index)
+                    {
+                        auto name = "p" + std::to_string(index);
+
+                        params.push_back(gcc_jit_context_new_param(
+                                                           context,
+                                                           nullptr,
+                                                           value_type(declared.parameters[index]),
+                                                           name.c_str()));
+                    }
+
+                    auto symbol = symbol_of(declared.name);
+                    auto kind = GCC_JIT_FUNCTION_EXPORTED;
+
+                    // Initializers stay exported, they're where the code is entered.
+                    if (linkage && declared.sub && !is_public(declared.sub->visibility))
+                    {
+                        kind = GCC_JIT_FUNCTION_INTERNAL;
+                    }
+
+                    auto generated_function = gcc_jit_context_new_function(
+                                                            context,
+                                                            nullptr,
+                                                            kind,
+                                                            result_type,
+                                                            symbol.c_str(),
+                                                            static_cast<int>(params.size()),
+                                                            params.data(),
+                                                            0);
+
+                    if (linkage)
+                    {
+                        linkage->functions.insert({ symbol, generated_function });
+                    }
+
+                    // A function marked [cold], or that the profile never saw called, is compiled
+                    // for size and kept out of the way of the code that does run.  Its callers
+                    // treat the paths that lead to it as unlikely.
+                    #ifdef LIBGCCJIT_HAVE_ATTRIBUTES
+                        auto is_marked = declared.sub && (declared.sub->heat == typing::Heat::Cold);
+                        auto is_unused = profile && profile->is_cold(declared.name);
+
+                        if (is_marked || is_unused)
+                        {
+                            gcc_jit_function_add_attribute(generated_function,
+                                                           GCC_JIT_FN_ATTRIBUTE_COLD);
+                        }
+                    #endif
+
+                    return generated_function;
+                }
+
+                gcc_jit_type* function_pointer_type(ir::Callee const& callee)
+                {
+                    std::vector<gcc_jit_type*> parameters;
+                    auto result_type = void_type;
+
+                    if (callee.result != typing::invalid_type_id)
+                    {
+                        if (is_aggregate(callee.result))
+                        {
+                            parameters.push_back(bytes_type);
+                        }
+                        else
+                        {
+                            result_type = value_type(callee.result);
+                        }
+                    }
+
+                    for (auto parameter : callee.parameters)
+                    {
+                        parameters.push_back(value_type(parameter));
+                    }
+
+                    return gcc_jit_context_new_function_ptr_type(
+                                                            context,
+                                                            nullptr,
+                                                            result_type,
+                                                            static_cast<int>(parameters.size()),
+                                                            parameters.data(),
+                                                            0);
+                }
+
+                gcc_jit_type* thunk_type()
+                {
+                    std::array<gcc_jit_type*, 3> parameters =
+                        {
+                            void_pointer_type,
+                            gcc_jit_type_get_pointer(void_pointer_type),
+                            void_pointer_type
+                        };
+
+                    return gcc_jit_context_new_function_ptr_type(context,
+                                                                 nullptr,
+                                                                 void_type,
+                                                                 3,
+                                                                 parameters.data(),
+                                                                 0);
+                }
+
+                // Calls the compiled code of the callee's entry directly once there is some, and
+                // has the interpreter run the callee until then.  It takes the same parameters
+                // as the callee, so the calls to it are generated the same way.
+                gcc_jit_function* generate_stub(ir::Callee const& callee, uint32_t import)
+                {
+                    auto has_result_param =    (callee.result != typing::invalid_type_id)
+                                            && is_aggregate(callee.result);
+                    auto result_type = (   (callee.result == typing::invalid_type_id)
+                                        || has_result_param) ? void_type
+                                                             : value_type(callee.result);
+
+                    std::vector<gcc_jit_param*> params;
+
+                    if (has_result_param)
+                    {
+                        params.push_back(gcc_jit_context_new_param(context,
+                                                                   nullptr,
+                                                                   bytes_type,
+                                                                   "result"));
+                    }
+
+                    for (size_t index = 0; index < callee.parameters.size(); ++index)
+                    {
+                        auto name = "p" + std::to_string(index);
+
+                        params.push_back(gcc_jit_context_new_param(
+                                                            context,
+                                                            nullptr,
+                                                            value_type(callee.parameters[index]),
+                                                            name.c_str()));
+                    }
+
+                    auto name = "stub" + std::to_string(import);
+                    auto stub = gcc_jit_context_new_function(context,
+                                                             nullptr,
+                                                             GCC_JIT_FUNCTION_INTERNAL,
+                                                             result_type,
+                                                             name.c_str(),
+                                                             static_cast<int>(params.size()),
+                                                             params.data(),
+                                                             0);
+
+                    auto element = [&](gcc_jit_rvalue* array, size_t index)
+                        {
+                            return gcc_jit_context_new_array_access(
+                                    context,
+                                    nullptr,
+                                    array,
+                                    gcc_jit_context_new_rvalue_from_int(context,
+                                                                        int_type,
+                                                                        static_cast<int>(index)));
+                        };
+
+                    // The fields of the entry, in the order they're declared.
+                    auto entry = imported(import, gcc_jit_type_get_pointer(void_pointer_type));
+                    auto field = [&](size_t index)
+                        {
+                            return gcc_jit_lvalue_as_rvalue(element(entry, index));
+                        };
+
+                    auto start = gcc_jit_function_new_block(stub, "start");
+                    auto compiled = gcc_jit_function_new_block(stub, "compiled");
+                    auto interpreted = gcc_jit_function_new_block(stub, "interpreted");
+
+                    auto code = gcc_jit_function_new_local(stub,
+                                                           nullptr,
+                                                           void_pointer_type,
+                                                           "code");
+
+                    gcc_jit_block_add_assignment(start, nullptr, code, field(0));
+                    gcc_jit_block_end_with_conditional(
+                                        start,
+                                        nullptr,
+                                        gcc_jit_context_new_comparison(
+                                                        context,
+                                                        nullptr,
+                                                        GCC_JIT_COMPARISON_NE,
+                                                        gcc_jit_lvalue_as_rvalue(code),
+                                                        gcc_jit_context_null(context,
+                                                                             void_pointer_type)),
+                                        compiled,
+                                        interpreted);
+
+                    std::vector<gcc_jit_rvalue*> arguments;
+
+                    for (auto param : params)
+                    {
+                        arguments.push_back(gcc_jit_param_as_rvalue(param));
+                    }
+
+                    auto call = gcc_jit_context_new_call_through_ptr(
+                                            context,
+                                            nullptr,
+                                            gcc_jit_context_new_cast(context,
+                                                                     nullptr,
+                                                                     gcc_jit_lvalue_as_rvalue(code),
+                                                                     function_pointer_type(callee)),
+                                            static_cast<int>(arguments.size()),
+                                            arguments.data());
+
+                    if (result_type == void_type)
+                    {
+                        gcc_jit_block_add_eval(compiled, nullptr, call);
+                        gcc_jit_block_end_with_void_return(compiled, nullptr);
+                    }
+                    else
+                    {
+                        gcc_jit_block_end_with_return(compiled, nullptr, call);
+                    }
+
+                    // Otherwise the interpreter is handed pointers to the arguments, and to where
+                    // the result goes.
+                    auto count = std::max<size_t>(callee.parameters.size(), 1);
+                    auto pointers = gcc_jit_function_new_local(
+                                            stub,
+                                            nullptr,
+                                            gcc_jit_context_new_array_type(context,
+                                                                           nullptr,
+                                                                           void_pointer_type,
+                                                                           static_cast<int>(count)),
+                                            "arguments");
+
+                    for (size_t index = 0; index < callee.parameters.size(); ++index)
+                    {
+                        auto param = params[index + (has_result_param ? 1 : 0)];
+                        auto pointer = is_aggregate(callee.parameters[index])
+                                        ? gcc_jit_param_as_rvalue(param)
+                                        : gcc_jit_lvalue_get_address(gcc_jit_param_as_lvalue(param),
+                                                                     nullptr);
+
+                        gcc_jit_block_add_assignment(interpreted,
+                                                     nullptr,
+                                                     element(gcc_jit_lvalue_as_rvalue(pointers),
+                                                             index),
+                                                     gcc_jit_context_new_cast(context,
+                                                                              nullptr,
+                                                                              pointer,
+                                                                              void_pointer_type));
+                    }
+
+                    gcc_jit_lvalue* value = nullptr;
+                    gcc_jit_rvalue* result = gcc_jit_context_null(context, void_pointer_type);
+
+                    if (has_result_param)
+                    {
+                        result = gcc_jit_context_new_cast(context,
+                                                          nullptr,
+                                                          gcc_jit_param_as_rvalue(params[0]),
+                                                          void_pointer_type);
+                    }
+                    else if (result_type != void_type)
+                    {
+                        value = gcc_jit_function_new_local(stub, nullptr, result_type, "value");
+                        result = gcc_jit_context_new_cast(context,
+                                                          nullptr,
+                                                          gcc_jit_lvalue_get_address(value,
+                                                                                     nullptr),
+                                                          void_pointer_type);
+                    }
+
+                    std::array<gcc_jit_rvalue*, 3> thunk_arguments =
+                        {
+                            field(3),
+                            gcc_jit_lvalue_get_address(element(gcc_jit_lvalue_as_rvalue(pointers),
+                                                               0),
+                                                       nullptr),
+                            result
+                        };
+
+                    gcc_jit_block_add_eval(interpreted,
+                                           nullptr,
+                                           gcc_jit_context_new_call_through_ptr(
+                                                    context,
+                                                    nullptr,
+                                                    gcc_jit_context_new_cast(context,
+                                                                             nullptr,
+                                                                             field(2),
+                                                                             thunk_type()),
+                                                    3,
+                                                    thunk_arguments.data()));
+
+                    if (value)
+                    {
+                        gcc_jit_block_end_with_return(interpreted,
+                                                      nullptr,
+                                                      gcc_jit_lvalue_as_rvalue(value));
+                    }
+                    else
+                    {
+                        gcc_jit_block_end_with_void_return(interpreted, nullptr);
+                    }
+
+                    return stub;
+                }
+
+                // Calls the function with its arguments and result held in memory, the way the
+                // interpreter calls it.
+                void generate_thunk(ir::Function const& thunked, gcc_jit_function* target)
+                {
+                    std::array<gcc_jit_param*, 3> params =
+                        {
+                            gcc_jit_context_new_param(context, nullptr, void_pointer_type, "data"),
+                            gcc_jit_context_new_param(context,
+                                                      nullptr,
+                                                      gcc_jit_type_get_pointer(void_pointer_type),
+                                                      "arguments"),
+                            gcc_jit_context_new_param(context, nullptr, void_pointer_type, "result")
+                        };
+
+                    auto symbol = symbol_of(thunked.name) + thunk_suffix;
+                    auto thunk = gcc_jit_context_new_function(context,
+                                                              nullptr,
+                                                              GCC_JIT_FUNCTION_EXPORTED,
+                                                              void_type,
+                                                              symbol.c_str(),
+                                                              3,
+                                                              params.data(),
+                                                              0);
+
+                    auto block = gcc_jit_function_new_block(thunk, "entry");
+                    auto result = gcc_jit_param_as_rvalue(params[2]);
+                    auto has_result = thunked.result != typing::invalid_type_id;
+
+                    std::vector<gcc_jit_rvalue*> arguments;
+
+                    if (has_result && is_aggregate(thunked.result))
+                    {
+                        arguments.push_back(gcc_jit_context_new_cast(context,
+                                                                     nullptr,
+                                                                     result,
+                                                                     bytes_type));
+                    }
+
+                    for (size_t index = 0; index < thunked.parameters.size(); ++index)
+                    {
+                        auto type = thunked.parameters[index];
+                        auto pointer = gcc_jit_lvalue_as_rvalue(
+                                gcc_jit_context_new_array_access(
+                                        context,
+                                        nullptr,
+                                        gcc_jit_param_as_rvalue(params[1]),
+                                        gcc_jit_context_new_rvalue_from_int(
+                                                                    context,
+                                                                    int_type,
+                                                                    static_cast<int>(index))));
+
+                        arguments.push_back(
+                                is_aggregate(type)
+                                  ? gcc_jit_context_new_cast(context, nullptr, pointer, bytes_type)
+                                  : gcc_jit_lvalue_as_rvalue(
+                                            gcc_jit_rvalue_dereference(
+                                                    pointee_of(nullptr, pointer, type),
+                                                    nullptr)));
+                    }
+
+                    auto call = gcc_jit_context_new_call(context,
+                                                         nullptr,
+                                                         target,
+                                                         static_cast<int>(arguments.size()),
+                                                         arguments.data());
+
+                    if (has_result && !is_aggregate(thunked.result))
+                    {
+                        gcc_jit_block_add_assignment(
+                                            block,
+                                            nullptr,
+                                            gcc_jit_rvalue_dereference(
+                                                        pointee_of(nullptr, result, thunked.result),
+                                                        nullptr),
+                                            call);
+                    }
+                    else
+                    {
+                        gcc_jit_block_add_eval(block, nullptr, call);
+                    }
+
+                    gcc_jit_block_end_with_void_return(block, nullptr);
+                }
+
+                gcc_jit_rvalue* call_helper(gcc_jit_location* location,
+                                            Helper helper,
+                                            std::vector<gcc_jit_rvalue*> arguments)
+                {
+                    if (linkage && (linkage->helper_table == nullptr))
+                    {
+                        return gcc_jit_context_new_call(context,
+                                                        location,
+                                                        linkage->helpers.at(helper),
+                                                        static_cast<int>(arguments.size()),
+                                                        arguments.data());
+                    }
+
+                    return gcc_jit_context_new_call_through_ptr(
+                                                context,
+                                                location,
+                                                imported(helper_imports[helper],
+                                                         get_parent().helper_types.at(helper)),
+                                                static_cast<int>(arguments.size()),
+                                                arguments.data());
+                }
+
+                gcc_jit_rvalue* integer(gcc_jit_type* type, int64_t value)
+                {
+                    return gcc_jit_context_new_rvalue_from_long(context, type, value);
+                }
+
+                gcc_jit_rvalue* constant(ir::Constant const& constant)
+                {
+                    auto type = value_type(constant.type);
+
+                    if (auto text = std::get_if<std::string>(&constant.value); text)
+                    {
+                        return gcc_jit_context_new_string_literal(context, text->c_str());
+                    }
+
+                    if (auto real = std::get_if<double>(&constant.value); real)
+                    {
+                        return gcc_jit_context_new_rvalue_from_double(context, type, *real);
+                    }
+
+                    auto bits = std::get<uint64_t>(constant.value);
+
+                    if (types.is_boolean(constant.type))
+                    {
+                        return gcc_jit_context_new_rvalue_from_int(context, type, bits != 0);
+                    }
+
+                    return integer(type, static_cast<int64_t>(bits));
+                }
+
+                // A value nothing cares about, returned from blocks that never get that far.
+                gcc_jit_rvalue* placeholder(gcc_jit_type* type)
+                {
+                    if ((type == string_type) || (type == bytes_type))
+                    {
+                        return gcc_jit_context_null(context, type);
+                    }
+
+                    return gcc_jit_context_zero(context, type);
+                }
+
+                // The byte address the given number of bytes past an address.
+                gcc_jit_rvalue* advance(gcc_jit_location* location,
+                                        gcc_jit_rvalue* address,
+                                        gcc_jit_rvalue* bytes)
+                {
+                    auto base = gcc_jit_context_new_cast(context, location, address, bytes_type);
+                    auto element = gcc_jit_context_new_array_access(context,
+                                                                    location,
+                                                                    base,
+                                                                    bytes);
+
+                    return gcc_jit_lvalue_get_address(element, location);
+                }
+
+                gcc_jit_rvalue* as_offset(gcc_jit_location* location, gcc_jit_rvalue* value)
+                {
+                    return gcc_jit_context_new_cast(context, location, value, offset_type);
+                }
+
+                gcc_jit_rvalue* scaled(gcc_jit_location* location,
+                                       gcc_jit_rvalue* index,
+                                       size_t size)
+                {
+                    return gcc_jit_context_new_binary_op(context,
+                                                         location,
+                                                         GCC_JIT_BINARY_OP_MULT,
+                                                         offset_type,
+                                                         as_offset(location, index),
+                                                         integer(offset_type,
+                                                                 static_cast<int64_t>(size)));
+                }
+
+                // Goes on in a new block if the condition is false, and fails with the message
+                // at the instruction's location if it's true.
+                void fail_if(gcc_jit_location* location,
+                             ir::Instruction const& instruction,
+                             gcc_jit_rvalue* condition,
+                             std::string const& message)
+                {
+                    auto failed = gcc_jit_function_new_block(generated, "failed");
+                    auto passed = gcc_jit_function_new_block(generated, nullptr);
+
+                    gcc_jit_block_end_with_conditional(current,
+                                                       location,
+                                                       condition,
+                                                       failed,
+                                                       passed);
+
+                    std::stringstream stream;
+
+                    stream << "Error";
+
+                    if (instruction.location != ir::no_id)
+                    {
+                        stream << " in " << function->locations[instruction.location];
+                    }
+
+                    stream << ": " << message;
+
+                    gcc_jit_block_add_eval(failed,
+                                           location,
+                                           call_helper(location,
+                                                       Helper::Fail,
+                                                       {
+                                                           gcc_jit_context_new_string_literal(
+                                                                           context,
+                                                                           stream.str().c_str())
+                                                       }));
+
+                    if (return_type == void_type)
+                    {
+                        gcc_jit_block_end_with_void_return(failed, location);
+                    }
+                    else
+                    {
+                        gcc_jit_block_end_with_return(failed, location, placeholder(return_type));
+                    }
+
+                    current = passed;
+                }
+
+                void check_index(gcc_jit_location* location,
+                                 ir::Instruction const& instruction,
+                                 gcc_jit_rvalue* index,
+                                 size_t count)
+                {
+                    if ((instruction.flags & ir::BoundsChecked) == 0)
+                    {
+                        return;
+                    }
+
+                    auto unsigned_index = gcc_jit_context_new_cast(context,
+                                                                   location,
+                                                                   index,
+                                                                   u64_type);
+
+                    auto is_outside = gcc_jit_context_new_comparison(
+                                        context,
+                                        location,
+                                        GCC_JIT_COMPARISON_GE,
+                                        unsigned_index,
+                                        integer(u64_type, static_cast<int64_t>(count)));
+
+                    fail_if(location, instruction, is_outside, "Array index out of bounds.");
+                }
+
+                void copy(gcc_jit_location* location,
+                          gcc_jit_rvalue* to,
+                          gcc_jit_rvalue* from,
+                          size_t size)
+                {
+                    std::array<gcc_jit_rvalue*, 3> arguments =
+                        {
+                            gcc_jit_context_new_cast(context, location, to, void_pointer_type),
+                            gcc_jit_context_new_cast(context,
+                                                     location,
+                                                     from,
+                                                     const_void_pointer_type),
+                            gcc_jit_context_new_rvalue_from_long(context,
+                                                                 size_type,
+                                                                 static_cast<long>(size))
+                        };
+
+                    gcc_jit_block_add_eval(current,
+                                           location,
+                                           gcc_jit_context_new_call(context,
+                                                                    location,
+                                                                    memcpy_function,
+                                                                    3,
+                                                                    arguments.data()));
+                }
+
+                // Keeps the value of an instruction as it was when the instruction ran.
+                gcc_jit_rvalue* assign(gcc_jit_location* location,
+                                       ir::ValueId id,
+                                       gcc_jit_rvalue* value)
+                {
+                    auto name = "v" + std::to_string(id);
+                    auto local = gcc_jit_function_new_local(generated,
+                                                            location,
+                                                            gcc_jit_rvalue_get_type(value),
+                                                            name.c_str());
+
+                    gcc_jit_block_add_assignment(current, location, local, value);
+                    return gcc_jit_lvalue_as_rvalue(local);
+                }
+
+                // A copy of a structure or array, for the instruction's value.
+                gcc_jit_rvalue* new_copy(gcc_jit_location* location,
+                                         ir::ValueId id,
+                                         typing::TypeId type)
+                {
+                    auto name = "c" + std::to_string(id);
+                    auto local = gcc_jit_function_new_local(generated,
+                                                            location,
+                                                            storage_type(type),
+                                                            name.c_str());
+
+                    return gcc_jit_context_new_cast(context,
+                                                    location,
+                                                    gcc_jit_lvalue_get_address(local, location),
+                                                    bytes_type);
+                }
+
+                void generate_function(ir::Function const& generating, gcc_jit_function* target)
+                {
+                    function = &generating;
+                    generated = target;
+
+                    auto has_result_param =    (generating.result != typing::invalid_type_id)
+                                            && is_aggregate(generating.result);
+
+                    result_param = has_result_param ? gcc_jit_function_get_param(generated, 0)
+                                                    : nullptr;
+                    return_type = (   (generating.result == typing::invalid_type_id)
+                                   || has_result_param) ? void_type
+                                                        : value_type(generating.result);
+
+                    slots.clear();
+
+                    for (auto const& slot : generating.slots)
+                    {
+                        auto name = "s" + std::to_string(slots.size());
+                        auto type = is_aggregate(slot.type) ? storage_type(slot.type)
+                                                            : value_type(slot.type);
+
+                        slots.push_back(gcc_jit_function_new_local(generated,
+                                                                   nullptr,
+                                                                   type,
+                                                                   name.c_str()));
+                    }
+
+                    // Blocks go in reverse postorder, so every value is generated before its
+                    // uses.  Unreachable blocks are left out, gcc won't take them.
+                    auto order = reverse_postorder(generating);
+
+                    blocks.assign(generating.blocks.size(), nullptr);
+
+                    for (auto index : order)
+                    {
+                        auto name = "b" + std::to_string(index);
+                        blocks[index] = gcc_jit_function_new_block(generated, name.c_str());
+                    }
+
+                    values.assign(generating.instructions.size(), nullptr);
+
+                    if (counter_table)
+                    {
+                        auto position = &generating - unit.functions.data();
+
+                        function_counters = counters.functions[position];
+                        site_counters = &counters.sites[position];
+
+                        is_header.assign(generating.blocks.size(), false);
+
+                        for (auto const& loop : ir::find_loops(generating))
+                        {
+                            is_header[loop.header] = true;
+                        }
+
+                        dominators = ir::dominators(generating);
+                    }
+
+                    for (auto index : order)
+                    {
+                        current = blocks[index];
+                        current_block = index;
+
+                        if ((index == 0) && !generating.sub)
+                        {
+                            set_initial_strings();
+                        }
+
+                        if ((index == 0) && counter_table)
+                        {
+                            count(nullptr, function_counters, one_count());
+                        }
+
+                        for (auto id : generating.blocks[index].instructions)
+                        {
+                            generate_instruction(id, generating[id]);
+                        }
+                    }
+                }
+
+                std::vector<ir::BlockId> reverse_postorder(ir::Function const& generating)
+                {
+                    std::vector<ir::BlockId> order;
+                    std::vector<bool> visited(generating.blocks.size(), false);
+
+                    // Each entry is a block and how many of its successors have been visited.
+                    std::vector<std::pair<ir::BlockId, size_t>> stack { { 0, 0 } };
+                    visited[0] = true;
+
+                    while (!stack.empty())
+                    {
+                        auto& [ block, next ] = stack.back();
+                        auto successors = generating.successors(block);
+
+                        if (next == successors.size())
+                        {
+                            order.push_back(block);
+                            stack.pop_back();
+                            continue;
+                        }
+
+                        auto successor = successors[next++];
+
+                        if (!visited[successor])
+                        {
+                            visited[successor] = true;
+                            stack.push_back({ successor, 0 });
+                        }
+                    }
+
+                    std::reverse(order.begin(), order.end());
+                    return order;
+                }
+
+                // Strings can't be part of a global's blob, so the initializer stores those of
+                // the module's globals before anything else.
+                void set_initial_strings()
+                {
+                    for (size_t id = 0; id < unit.globals.size(); ++id)
+                    {
+                        if (!globals[id])
+                        {
+                            continue;
+                        }
+
+                        for (auto const& [ offset, constant ] : unit.globals[id].initial)
+                        {
+                            if (!types.is_string(constant.type))
+                            {
+                                continue;
+                            }
+
+                            auto address = advance(nullptr,
+                                                   gcc_jit_lvalue_get_address(globals[id],
+                                                                              nullptr),
+                                                   integer(offset_type,
+                                                           static_cast<int64_t>(offset)));
+                            auto typed = gcc_jit_context_new_cast(
+                                                        context,
+                                                        nullptr,
+                                                        address,
+                                                        gcc_jit_type_get_pointer(string_type));
+
+                            gcc_jit_block_add_assignment(current,
+                                                         nullptr,
+                                                         gcc_jit_rvalue_dereference(typed,
+                                                                                    nullptr),
+                                                         this->constant(constant));
+                        }
+                    }
+                }
+
+                gcc_jit_rvalue* pointee_of(gcc_jit_location* location,
+                                           gcc_jit_rvalue* address,
+                                           typing::TypeId type)
+                {
+                    return gcc_jit_context_new_cast(context, location, address, address_type(type));
+                }
+
+                void generate_instruction(ir::ValueId id, ir::Instruction const& instruction)
+                {
+                    auto location = location_of(instruction);
+
+                    auto value = [&](ir::ValueId value_id)
+                        {
+                            return values[value_id];
+                        };
+
+                    auto pointee = [&](ir::ValueId value_id)
+                        {
+                            return types.element_of((*function)[value_id].type);
+                        };
+
+                    switch (instruction.opcode)
+                    {
+                        case ir::Opcode::Constant:
+                            values[id] = constant(function->constants[instruction.immediate]);
+                            break;
+
+                        case ir::Opcode::Parameter:
+                            {
+                                auto index = instruction.immediate + (result_param ? 1 : 0);
+
+                                values[id] = gcc_jit_param_as_rvalue(
+                                            gcc_jit_function_get_param(generated,
+                                                                       static_cast<int>(index)));
+                            }
+                            break;
+
+                        case ir::Opcode::LocalAddress:
+                            values[id] = pointee_of(
+                                        location,
+                                        gcc_jit_lvalue_get_address(slots[instruction.immediate],
+                                                                   location),
+                                        types.element_of(instruction.type));
+                            break;
+
+                        case ir::Opcode::GlobalAddress:
+                            {
+                                auto pointee_type = types.element_of(instruction.type);
+
+                                if (auto global = globals[instruction.immediate]; global)
+                                {
+                                    values[id] = pointee_of(location,
+                                                            gcc_jit_lvalue_get_address(global,
+                                                                                       location),
+                                                            pointee_type);
+                                }
+                                else
+                                {
+                                    values[id] = assign(
+                                                location,
+                                                id,
+                                                imported(global_imports[instruction.immediate],
+                                                         address_type(pointee_type)));
+                                }
+                            }
+                            break;
+
+                        case ir::Opcode::ElementAddress:
+                            {
+                                auto const& array = types.get(pointee(instruction.a));
+                                auto index = value(instruction.b);
+
+                                check_index(location, instruction, index, array.count);
+
+                                auto bytes = scaled(location, index, types.size_of(array.element));
+
+                                values[id] = assign(
+                                            location,
+                                            id,
+                                            pointee_of(location,
+                                                       advance(location,
+                                                               value(instruction.a),
+                                                               bytes),
+                                                       array.element));
+                            }
+                            break;
+
+                        case ir::Opcode::FieldAddress:
+                            {
+                                auto structure = types.structure_info(pointee(instruction.a));
+                                auto const& field = structure->fields[instruction.immediate];
+
+                                values[id] = assign(
+                                            location,
+                                            id,
+                                            pointee_of(location,
+                                                       advance(location,
+                                                               value(instruction.a),
+                                                               integer(offset_type,
+                                                                       static_cast<int64_t>(
+                                                                                field.offset))),
+                                                       field.type.id));
+                            }
+                            break;
+
+                        case ir::Opcode::SoaAddress:
+                            {
+                                auto const& array = types.get(pointee(instruction.a));
+                                auto const& structure = *types.structure_info(array.element);
+                                auto const& field = structure.fields[instruction.immediate];
+                                auto layout = typing::compute_soa_layout(structure, array.count);
+                                auto index = value(instruction.b);
+
+                                check_index(location, instruction, index, array.count);
+
+                                auto field_offset = layout.field_offsets[instruction.immediate];
+                                auto start = advance(location,
+                                                     value(instruction.a),
+                                                     integer(offset_type,
+                                                             static_cast<int64_t>(field_offset)));
+
+                                auto bytes = scaled(location, index, types.size_of(field.type.id));
+
+                                values[id] = assign(location,
+                                                    id,
+                                                    pointee_of(location,
+                                                               advance(location, start, bytes),
+                                                               field.type.id));
+                            }
+                            break;
+
+                        case ir::Opcode::Offset:
+                            {
+                                auto element = pointee(instruction.a);
+
+                                values[id] = assign(
+                                            location,
+                                            id,
+                                            pointee_of(location,
+                                                       advance(location,
+                                                               value(instruction.a),
+                                                               scaled(location,
+                                                                      value(instruction.b),
+                                                                      types.size_of(element))),
+                                                       element));
+                            }
+                            break;
+
+                        case ir::Opcode::Load:
+                            if (is_aggregate(instruction.type))
+                            {
+                                values[id] = new_copy(location, id, instruction.type);
+                                copy(location,
+                                     values[id],
+                                     value(instruction.a),
+                                     types.size_of(instruction.type));
+                            }
+                            else
+                            {
+                                values[id] = assign(
+                                            location,
+                                            id,
+                                            gcc_jit_lvalue_as_rvalue(
+                                                    gcc_jit_rvalue_dereference(value(instruction.a),
+                                                                               location)));
+                            }
+                            break;
+
+                        case ir::Opcode::Store:
+                            {
+                                auto stored = (*function)[instruction.b].type;
+
+                                if (is_aggregate(stored))
+                                {
+                                    copy(location,
+                                         value(instruction.a),
+                                         value(instruction.b),
+                                         types.size_of(stored));
+                                }
+                                else
+                                {
+                                    gcc_jit_block_add_assignment(
+                                                current,
+                                                location,
+                                                gcc_jit_rvalue_dereference(value(instruction.a),
+                                                                           location),
+                                                value(instruction.b));
+                                }
+                            }
+                            break;
+
+                        case ir::Opcode::Clear:
+                            {
+                                std::array<gcc_jit_rvalue*, 3> arguments =
+                                    {
+                                        gcc_jit_context_new_cast(context,
+                                                                 location,
+                                                                 value(instruction.a),
+                                                                 void_pointer_type),
+                                        gcc_jit_context_zero(context, int_type),
+                                        gcc_jit_context_new_rvalue_from_long(
+                                                    context,
+                                                    size_type,
+                                                    static_cast<long>(
+                                                            types.size_of(pointee(instruction.a))))
+                                    };
+
+                                gcc_jit_block_add_eval(current,
+                                                       location,
+                                                       gcc_jit_context_new_call(context,
+                                                                                location,
+                                                                                memset_function,
+                                                                                3,
+                                                                                arguments.data()));
+                            }
+                            break;
+
+                        case ir::Opcode::Call:
+                            count_site(location, id, nullptr);
+                            generate_call(location, id, instruction);
+                            break;
+
+                        case ir::Opcode::Jump:
+                            if (is_back_edge(instruction.immediate))
+                            {
+                                count(location, function_counters + 1, one_count());
+                            }
+
+                            gcc_jit_block_end_with_jump(current,
+                                                        location,
+                                                        blocks[instruction.immediate]);
+                            break;
+
+                        case ir::Opcode::Branch:
+                            generate_branch(location, id, instruction);
+                            break;
+
+                        case ir::Opcode::Switch:
+                            generate_switch(location, instruction);
+                            break;
+
+                        case ir::Opcode::Return:
+                            if (result_param)
+                            {
+                                copy(location,
+                                     gcc_jit_param_as_rvalue(result_param),
+                                     value(instruction.a),
+                                     types.size_of(function->result));
+                                gcc_jit_block_end_with_void_return(current, location);
+                            }
+                            else if (instruction.a != ir::no_id)
+                            {
+                                gcc_jit_block_end_with_return(current,
+                                                              location,
+                                                              value(instruction.a));
+                            }
+                            else
+                            {
+                                gcc_jit_block_end_with_void_return(current, location);
+                            }
+                            break;
+
+                        default:
+                            values[id] = assign(location,
+                                                id,
+                                                generate_operation(location, instruction));
+                            break;
+                    }
+                }
+
+                gcc_jit_rvalue* generate_operation(gcc_jit_location* location,
+                                                   ir::Instruction const& instruction)
+                {
+                    auto a = values[instruction.a];
+                    auto b = (instruction.b != ir::no_id) ? values[instruction.b] : nullptr;
+
+                    auto operand_type = (*function)[instruction.a].type;
+                    auto result_type = value_type(instruction.type);
+
+                    auto is_bool = types.is_boolean(operand_type);
+                    auto is_string = types.is_string(operand_type);
+                    auto number = types.number_info(operand_type);
+                    auto is_integer =    number
+                                      && (   number->is_floating_point
+                                          == typing::FloatingPointFlag::IsInteger);
+
+                    auto binary = [&](gcc_jit_binary_op op)
+                        {
+                            return gcc_jit_context_new_binary_op(context,
+                                                                 location,
+                                                                 op,
+                                                                 result_type,
+                                                                 a,
+                                                                 b);
+                        };
+
+                    auto compare = [&](gcc_jit_comparison op)
+                        {
+                            if (is_string)
+                            {
+                                return gcc_jit_context_new_comparison(
+                                            context,
+                                            location,
+                                            op,
+                                            call_helper(location,
+                                                        Helper::CompareStrings,
+                                                        { a, b }),
+                                            gcc_jit_context_zero(context, int_type));
+                            }
+
+                            return gcc_jit_context_new_comparison(context, location, op, a, b);
+                        };
+
+                    switch (instruction.opcode)
+                    {
+                        case ir::Opcode::Add:       return binary(GCC_JIT_BINARY_OP_PLUS);
+                        case ir::Opcode::Subtract:  return binary(GCC_JIT_BINARY_OP_MINUS);
+                        case ir::Opcode::Multiply:  return binary(GCC_JIT_BINARY_OP_MULT);
+
+                        case ir::Opcode::Divide:
+                            if (is_integer)
+                            {
+                                check_division(location, instruction, a, b, *number);
+                            }
+
+                            return binary(GCC_JIT_BINARY_OP_DIVIDE);
+
+                        case ir::Opcode::And:
+                            return binary(is_bool ? GCC_JIT_BINARY_OP_LOGICAL_AND
+                                                  : GCC_JIT_BINARY_OP_BITWISE_AND);
+
+                        case ir::Opcode::Or:
+                            return binary(is_bool ? GCC_JIT_BINARY_OP_LOGICAL_OR
+                                                  : GCC_JIT_BINARY_OP_BITWISE_OR);
+
+                        case ir::Opcode::Concatenate:
+                            return call_helper(location,
+                                               Helper::Concatenate,
+                                               { a, b });
+
+                        case ir::Opcode::Negate:
+                            return gcc_jit_context_new_unary_op(context,
+                                                                location,
+                                                                GCC_JIT_UNARY_OP_MINUS,
+                                                                result_type,
+                                                                a);
+
+                        case ir::Opcode::Not:
+                            return gcc_jit_context_new_unary_op(
+                                                        context,
+                                                        location,
+                                                        is_bool ? GCC_JIT_UNARY_OP_LOGICAL_NEGATE
+                                                                : GCC_JIT_UNARY_OP_BITWISE_NEGATE,
+                                                        result_type,
+                                                        a);
+
+                        case ir::Opcode::Equal:     return compare(GCC_JIT_COMPARISON_EQ);
+                        case ir::Opcode::NotEqual:  return compare(GCC_JIT_COMPARISON_NE);
+                        case ir::Opcode::Less:      return compare(GCC_JIT_COMPARISON_LT);
+                        case ir::Opcode::Greater:   return compare(GCC_JIT_COMPARISON_GT);
+
+                        case ir::Opcode::Convert:
+                            return convert(location, a, operand_type, instruction.type);
+
+                        case ir::Opcode::Hash:
+                            {
+                                auto hash = call_helper(
+                                            location,
+                                            Helper::HashText,
+                                            {
+                                                a,
+                                                gcc_jit_context_new_rvalue_from_long(
+                                                    context,
+                                                    gcc_jit_context_get_int_type(context, 4, 0),
+                                                    instruction.immediate)
+                                            });
+
+                                auto bucket = gcc_jit_context_new_binary_op(
+                                            context,
+                                            location,
+                                            GCC_JIT_BINARY_OP_MODULO,
+                                            u64_type,
+                                            hash,
+                                            integer(u64_type, instruction.extra));
+
+                                return gcc_jit_context_new_cast(context,
+                                                                location,
+                                                                bucket,
+                                                                result_type);
+                            }
+
+                        default:
+                            throw std::runtime_error("Can not generate code for the "
+                                                     "instruction.");
+                    }
+                }
+
+                // Integer division fails by zero, and for the one quotient too large for its
+                // type, rather than trapping.
+                void check_division(gcc_jit_location* location,
+                                    ir::Instruction const& instruction,
+                                    gcc_jit_rvalue* a,
+                                    gcc_jit_rvalue* b,
+                                    typing::NumberInfo const& number)
+                {
+                    auto type = gcc_jit_rvalue_get_type(b);
+
+                    fail_if(location,
+                            instruction,
+                            gcc_jit_context_new_comparison(context,
+                                                           location,
+                                                           GCC_JIT_COMPARISON_EQ,
+                                                           b,
+                                                           gcc_jit_context_zero(context, type)),
+                            "Division by zero.");
+
+                    if (number.is_signed != typing::SignedFlag::IsSigned)
+                    {
+                        return;
+                    }
+
+                    auto bits = static_cast<int>(number.size * 8);
+                    auto lowest = static_cast<int64_t>(uint64_t { 1 } << (bits - 1));
+
+                    if (bits < 64)
+                    {
+                        lowest = -(int64_t { 1 } << (bits - 1));
+                    }
+
+                    auto overflows = gcc_jit_context_new_binary_op(
+                                    context,
+                                    location,
+                                    GCC_JIT_BINARY_OP_LOGICAL_AND,
+                                    bool_type,
+                                    gcc_jit_context_new_comparison(context,
+                                                                   location,
+                                                                   GCC_JIT_COMPARISON_EQ,
+                                                                   b,
+                                                                   integer(type, -1)),
+                                    gcc_jit_context_new_comparison(context,
+                                                                   location,
+                                                                   GCC_JIT_COMPARISON_EQ,
+                                                                   a,
+                                                                   integer(type, lowest)));
+
+                    fail_if(location, instruction, overflows, "Division overflows.");
+                }
+
+                // Floats are converted to integers through 64 bits, truncating toward zero, and
+                // then wrapped into the narrower type, the same as at compile time.
+                gcc_jit_rvalue* convert(gcc_jit_location* location,
+                                        gcc_jit_rvalue* value,
+                                        typing::TypeId from,
+                                        typing::TypeId to)
+                {
+                    auto source = types.number_info(from);
+                    auto target = types.number_info(to);
+
+                    if (   source
+                        && target
+                        && (source->is_floating_point == typing::FloatingPointFlag::IsFloatingPoint)
+                        && (target->is_floating_point == typing::FloatingPointFlag::IsInteger))
+                    {
+                        value = gcc_jit_context_new_cast(
+                                    context,
+                                    location,
+                                    value,
+                                    target->is_signed == typing::SignedFlag::IsSigned ? offset_type
+                                                                                     : u64_type);
+                    }
+
+                    return gcc_jit_context_new_cast(context, location, value, value_type(to));
+                }
+
+                void generate_call(gcc_jit_location* location,
+                                   ir::ValueId id,
+                                   ir::Instruction const& instruction)
+                {
+                    auto const& callee = unit.callees[instruction.immediate];
+
+                    std::vector<gcc_jit_rvalue*> arguments;
+                    gcc_jit_rvalue* result_copy = nullptr;
+
+                    if ((callee.result != typing::invalid_type_id) && is_aggregate(callee.result))
+                    {
+                        result_copy = new_copy(location, id, callee.result);
+                        arguments.push_back(result_copy);
+                    }
+
+                    for (auto operand : function->operands_of(instruction))
+                    {
+                        arguments.push_back(values[operand]);
+                    }
+
+                    gcc_jit_rvalue* call = nullptr;
+
+                    if (auto found = callee_imports.find(instruction.immediate);
+                        found != callee_imports.end())
+                    {
+                        call = gcc_jit_context_new_call_through_ptr(
+                                                        context,
+                                                        location,
+                                                        imported(found->second,
+                                                                 function_pointer_type(callee)),
+                                                        static_cast<int>(arguments.size()),
+                                                        arguments.data());
+                    }
+                    else
+                    {
+                        call = gcc_jit_context_new_call(context,
+                                                        location,
+                                                        functions.at(callee.sub.get()),
+                                                        static_cast<int>(arguments.size()),
+                                                        arguments.data());
+                    }
+
+                    if ((callee.result == typing::invalid_type_id) || result_copy)
+                    {
+                        gcc_jit_block_add_eval(current, location, call);
+                        values[id] = result_copy;
+                    }
+                    else
+                    {
+                        values[id] = assign(location, id, call);
+                    }
+                }
+
+                // A branch the profile saw go the same way nearly every time is expected to go that
+                // way, which has gcc lay that path out straight through and move the other out of
+                // the way.
+                void generate_branch(gcc_jit_location* location,
+                                     ir::ValueId id,
+                                     ir::Instruction const& instruction)
+                {
+                    auto condition = values[instruction.a];
+
+                    count_site(location, id, condition);
+
+                    if (is_back_edge(instruction.immediate))
+                    {
+                        count(location, function_counters + 1, as_count(location, condition));
+                    }
+
+                    if (is_back_edge(instruction.extra))
+                    {
+                        auto negated = gcc_jit_context_new_unary_op(context,
+                                                                    location,
+                                                                    GCC_JIT_UNARY_OP_LOGICAL_NEGATE,
+                                                                    bool_type,
+                                                                    condition);
 
+                        count(location, function_counters + 1, as_count(location, negated));
+                    }
+
+                    if (profile && (instruction.site != ir::no_id))
+                    {
+                        auto const& site = function->sites[instruction.site];
+
+                        if (auto expected = profile->expected_branch(site); expected)
+                        {
+                            condition = expect(location, condition, expected.value());
+                        }
+                    }
+
+                    gcc_jit_block_end_with_conditional(current,
+                                                       location,
+                                                       condition,
+                                                       blocks[instruction.immediate],
+                                                       blocks[instruction.extra]);
+                }
+
+                gcc_jit_rvalue* expect(gcc_jit_location* location,
+                                       gcc_jit_rvalue* condition,
+                                       bool expected)
+                {
+                    std::array<gcc_jit_rvalue*, 2> arguments
+                        {
+                            gcc_jit_context_new_cast(context, location, condition, long_type),
+                            gcc_jit_context_new_rvalue_from_int(context, long_type, expected)
+                        };
+
+                    auto call = gcc_jit_context_new_call(context,
+                                                         location,
+                                                         expect_function,
+                                                         static_cast<int>(arguments.size()),
+                                                         arguments.data());
+
+                    return gcc_jit_context_new_comparison(context,
+                                                          location,
+                                                          GCC_JIT_COMPARISON_NE,
+                                                          call,
+                                                          gcc_jit_context_zero(context,
+                                                                               long_type));
+                }
+
+                void declare_counters()
+                {
+                    counters = counters_of(unit);
+
+                    auto table_type = gcc_jit_context_new_array_type(
+                                                            context,
+                                                            nullptr,
+                                                            u64_type,
+                                                            static_cast<int>(counters.count));
+
+                    counter_table = gcc_jit_context_new_global(context,
+                                                               nullptr,
+                                                               GCC_JIT_GLOBAL_EXPORTED,
+                                                               table_type,
+                                                               counters_symbol);
+                }
+
+                void count(gcc_jit_location* location, size_t counter, gcc_jit_rvalue* amount)
+                {
+                    if (!counter_table)
+                    {
+                        return;
+                    }
+
+                    auto index = gcc_jit_context_new_rvalue_from_long(context,
+                                                                      size_type,
+                                                                      static_cast<long>(counter));
+
+                    gcc_jit_block_add_assignment_op(
+                                    current,
+                                    location,
+                                    gcc_jit_context_new_array_access(
+                                                        context,
+                                                        location,
+                                                        gcc_jit_lvalue_as_rvalue(counter_table),
+                                                        index),
+                                    GCC_JIT_BINARY_OP_PLUS,
+                                    amount);
+                }
+
+                // A call counts once, a branch both when it's reached and when it's taken.
+                void count_site(gcc_jit_location* location,
+                                ir::ValueId id,
+                                gcc_jit_rvalue* condition)
+                {
+                    if (!counter_table)
+                    {
+                        return;
+                    }
+
+                    auto found = site_counters->find(id);
+
+                    if (found == site_counters->end())
+                    {
+                        return;
+                    }
+
+                    if (condition)
+                    {
+                        count(location, found->second, as_count(location, condition));
+                        count(location, found->second + 1, one_count());
+                    }
+                    else
+                    {
+                        count(location, found->second, one_count());
+                    }
+                }
+
+                gcc_jit_rvalue* one_count()
+                {
+                    return gcc_jit_context_one(context, u64_type);
+                }
+
+                gcc_jit_rvalue* as_count(gcc_jit_location* location, gcc_jit_rvalue* condition)
+                {
+                    return gcc_jit_context_new_cast(context, location, condition, u64_type);
+                }
+
+                // Back to the start of a loop that's entered before the current block is reached.
+                bool is_back_edge(ir::BlockId target) const
+                {
+                    return    counter_table
+                           && is_header[target]
+                           && ir::dominates(dominators, target, current_block);
+                }
+
+                // Integer switches become gcc's own, anything else a chain of comparisons.
+                void generate_switch(gcc_jit_location* location, ir::Instruction const& instruction)
+                {
+                    auto tested = values[instruction.a];
+                    auto type = (*function)[instruction.a].type;
+                    auto number = types.number_info(type);
+                    auto cases = function->cases_of(instruction);
+
+                    if (   number
+                        && (number->is_floating_point == typing::FloatingPointFlag::IsInteger)
+                        && !cases.empty())
+                    {
+                        std::vector<gcc_jit_case*> generated_cases;
+
+                        for (auto const& switch_case : cases)
+                        {
+                            auto value = constant(function->constants[switch_case.constant]);
+
+                            generated_cases.push_back(gcc_jit_context_new_case(
+                                                                    context,
+                                                                    value,
+                                                                    value,
+                                                                    blocks[switch_case.target]));
+                        }
+
+                        gcc_jit_block_end_with_switch(current,
+                                                      location,
+                                                      tested,
+                                                      blocks[instruction.immediate],
+                                                      static_cast<int>(generated_cases.size()),
+                                                      generated_cases.data());
+                        return;
+                    }
+
+                    for (auto const& switch_case : cases)
+                    {
+                        auto value = constant(function->constants[switch_case.constant]);
+                        auto next = gcc_jit_function_new_block(generated, nullptr);
+
+                        auto is_equal = types.is_string(type)
+                            ? gcc_jit_context_new_comparison(
+                                            context,
+                                            location,
+                                            GCC_JIT_COMPARISON_EQ,
+                                            call_helper(location,
+                                                        Helper::CompareStrings,
+                                                        { tested, value }),
+                                            gcc_jit_context_zero(context, int_type))
+                            : gcc_jit_context_new_comparison(context,
+                                                             location,
+                                                             GCC_JIT_COMPARISON_EQ,
+                                                             tested,
+                                                             value);
+
+                        gcc_jit_block_end_with_conditional(current,
+                                                           location,
+                                                           is_equal,
+                                                           blocks[switch_case.target],
+                                                           next);
+                        current = next;
+                    }
+
+                    gcc_jit_block_end_with_jump(current, location, blocks[instruction.immediate]);
+                }
+        };
 
     }
 
@@ -79,19 +2816,28 @@ namespace basically::runtime::jitting
 
 
     Jit::Jit(Options const& options)
-    : context(gcc_jit_context_acquire()),
-      result(nullptr)
+    : context(nullptr),
+      result(nullptr),
+      library(nullptr),
+      tiered(nullptr)
     {
+        auto& parent = get_parent();
+        std::lock_guard<std::mutex> guard(parent.lock);
+
+        context = gcc_jit_context_new_child_context(parent.context);
         set_context_options(context, options);
     }
 
 
     Jit::Jit(Jit&& jit) noexcept
     : context(jit.context),
-      result(jit.result)
+      result(jit.result),
+      library(jit.library),
+      tiered(jit.tiered)
     {
         jit.context = nullptr;
         jit.result = nullptr;
+        jit.library = nullptr;
     }
 
 
@@ -110,9 +2856,12 @@ namespace basically::runtime::jitting
 
             context = jit.context;
             result = jit.result;
+            library = jit.library;
+            tiered = jit.tiered;
 
             jit.context = nullptr;
             jit.result = nullptr;
+            jit.library = nullptr;
         }
 
         return *this;
@@ -120,10 +2869,276 @@ namespace basically::runtime::jitting
 
 
 
+    void Jit::generate(ir::Unit const& unit, bool is_instrumented)
+    {
+        std::lock_guard<std::mutex> guard(get_parent().lock);
+
+        Generator generator(context, unit);
+        generator.generate(is_instrumented);
+    }
+
+
+    void Jit::generate_function(ir::Unit const& unit, ir::Function const& function)
+    {
+        std::lock_guard<std::mutex> guard(get_parent().lock);
+
+        tiered = &function;
+
+        Generator generator(context, unit);
+        generator.generate_tiered(function);
+    }
+
+
+    void Jit::compile(ir::Unit const& unit)
+    {
+        std::lock_guard<std::mutex> guard(get_parent().lock);
+
+        result = gcc_jit_context_compile(context);
+
+        if (result == nullptr)
+        {
+            auto error = gcc_jit_context_get_first_error(context);
+
+            throw std::runtime_error("Could not compile " + unit.name + ": "
+                                     + (error ? error : "unknown error") + ".");
+        }
+    }
+
+
+    void Jit::compile_to_file(ir::Unit const& unit, std::fs::path const& path)
+    {
+        std::lock_guard<std::mutex> guard(get_parent().lock);
+
+        gcc_jit_context_compile_to_file(context,
+                                        GCC_JIT_OUTPUT_KIND_DYNAMIC_LIBRARY,
+                                        path.c_str());
+
+        if (auto error = gcc_jit_context_get_first_error(context); error)
+        {
+            throw std::runtime_error("Could not compile " + unit.name + ": " + error + ".");
+        }
+    }
+
+
+    bool Jit::load(ir::Unit const& unit, std::fs::path const& path)
+    {
+        library = dlopen(path.c_str(), RTLD_NOW | RTLD_LOCAL);
+
+        if (library == nullptr)
+        {
+            return false;
+        }
+
+        auto has_code = [&](ir::Function const& function)
+            {
+                return find_symbol(symbol_of(function.name), true) != nullptr;
+            };
+
+        auto is_complete =    (find_symbol(imports_symbol, false) != nullptr)
+                           && std::all_of(unit.functions.begin(), unit.functions.end(), has_code);
+
+        if (!is_complete)
+        {
+            dlclose(library);
+            library = nullptr;
+
+            return false;
+        }
+
+        return true;
+    }
+
+
+    void Jit::compile_program(std::vector<ir::Unit const*> const& units,
+                              std::fs::path const& path,
+                              OutputKind kind)
+    {
+        std::lock_guard<std::mutex> guard(get_parent().lock);
+
+        Linkage linkage;
+        std::vector<gcc_jit_function*> initializers;
+
+        linkage.helpers = generate_runtime(context);
+
+        for (auto unit : units)
+        {
+            Generator generator(context, *unit, &linkage);
+            generator.generate();
+
+            initializers.push_back(linkage.functions.at(symbol_of(unit->initializer()->name)));
+        }
+
+        generate_main(context, initializers);
+
+        gcc_jit_context_compile_to_file(context,
+                                        kind == OutputKind::Executable
+                                            ? GCC_JIT_OUTPUT_KIND_EXECUTABLE
+                                            : GCC_JIT_OUTPUT_KIND_OBJECT_FILE,
+                                        path.c_str());
+
+        if (auto error = gcc_jit_context_get_first_error(context); error)
+        {
+            throw std::runtime_error("Could not compile " + path.string() + ": " + error + ".");
+        }
+    }
+
+
+    void Jit::compile_whole_program(std::vector<ir::Unit const*> const& units)
+    {
+        std::lock_guard<std::mutex> guard(get_parent().lock);
+
+        Linkage linkage;
+
+        auto table_type = gcc_jit_context_new_array_type(
+                                            context,
+                                            nullptr,
+                                            get_parent().void_pointer_type,
+                                            static_cast<int>(helpers.size()));
+
+        linkage.helper_table = gcc_jit_context_new_global(context,
+                                                          nullptr,
+                                                          GCC_JIT_GLOBAL_EXPORTED,
+                                                          table_type,
+                                                          imports_symbol);
+
+        for (auto unit : units)
+        {
+            Generator generator(context, *unit, &linkage);
+            generator.generate();
+        }
+
+        result = gcc_jit_context_compile(context);
+
+        if (result == nullptr)
+        {
+            auto error = gcc_jit_context_get_first_error(context);
+
+            throw std::runtime_error("Could not compile " + units.back()->name + ": "
+                                     + (error ? error : "unknown error") + ".");
+        }
+
+        auto table = static_cast<void**>(find_symbol(imports_symbol, false));
+
+        for (size_t index = 0; index < helpers.size(); ++index)
+        {
+            table[index] = address_of(helpers[index]);
+        }
+    }
+
+
+    void* Jit::get_code(std::string const& name) const
+    {
+        auto code = find_symbol(symbol_of(name), true);
+
+        if (code == nullptr)
+        {
+            throw std::runtime_error("No code was compiled for " + name + ".");
+        }
+
+        return code;
+    }
+
+
+    Thunk Jit::get_thunk(std::string const& name) const
+    {
+        auto thunk = find_symbol(symbol_of(name) + thunk_suffix, true);
+
+        if (thunk == nullptr)
+        {
+            throw std::runtime_error("No thunk was compiled for " + name + ".");
+        }
+
+        return reinterpret_cast<Thunk>(thunk);
+    }
+
+
+    void* Jit::get_global(std::string const& module_name, std::string const& name) const
+    {
+        auto global = find_symbol(symbol_of(module_name + "." + name), false);
+
+        if (global == nullptr)
+        {
+            throw std::runtime_error("No storage was compiled for " + module_name + "." + name
+                                     + ".");
+        }
+
+        return global;
+    }
+
+
+    bool Jit::read_profile(ir::Unit const& unit, profiling::Profile& profile) const
+    {
+        auto table = static_cast<uint64_t const*>(find_symbol(counters_symbol, false));
+
+        if (table == nullptr)
+        {
+            return false;
+        }
+
+        auto counters = counters_of(unit);
+
+        for (size_t index = 0; index < unit.functions.size(); ++index)
+        {
+            auto const& function = unit.functions[index];
+            auto first = counters.functions[index];
+
+            profile.count_function(function.name, table[first], table[first + 1]);
+
+            for (auto [ id, counter ] : counters.sites[index])
+            {
+                auto const& instruction = function[id];
+                auto const& site = function.sites[instruction.site];
+
+                if (instruction.opcode == ir::Opcode::Branch)
+                {
+                    profile.count_branch(site, table[counter], table[counter + 1]);
+                }
+                else
+                {
+                    profile.count_call(site, table[counter]);
+                }
+            }
+        }
+
+        return true;
+    }
+
+
+    void* Jit::find_symbol(std::string const& symbol, bool is_code) const noexcept
+    {
+        if (library != nullptr)
+        {
+            return dlsym(library, symbol.c_str());
+        }
+
+        if (result == nullptr)
+        {
+            return nullptr;
+        }
+
+        return is_code ? gcc_jit_result_get_code(result, symbol.c_str())
+                       : gcc_jit_result_get_global(result, symbol.c_str());
+    }
+
+
+    void Jit::link(ir::Unit const& unit)
+    {
+        auto table = static_cast<void**>(find_symbol(imports_symbol, false));
+        auto imports = imports_of(unit, tiered);
+
+        for (size_t index = 0; index < imports.size(); ++index)
+        {
+            table[index] = resolve(imports[index]);
+        }
+    }
+
+
     void Jit::release() noexcept
     {
         if (context != nullptr)
         {
+            std::lock_guard<std::mutex> guard(get_parent().lock);
+
             gcc_jit_context_release(context);
             context = nullptr;
         }
@@ -133,6 +3148,60 @@ namespace basically::runtime::jitting
             gcc_jit_result_release(result);
             result = nullptr;
         }
+
+        if (library != nullptr)
+        {
+            dlclose(library);
+            library = nullptr;
+        }
+    }
+
+
+    int run(EntryPoint entry_point)
+    {
+        strings::Running running;
+        std::jmp_buf point;
+        auto outer = failure_point;
+
+        failure_point = &point;
+
+        if (setjmp(point) != 0)
+        {
+            failure_point = outer;
+            throw std::runtime_error(failure_message);
+        }
+
+        auto result = entry_point();
+
+        failure_point = outer;
+        return result;
+    }
+
+
+    void call(Thunk thunk, void* const* arguments, void* result)
+    {
+        strings::Running running;
+        std::jmp_buf point;
+        auto outer = failure_point;
+
+        failure_point = &point;
+
+        if (setjmp(point) != 0)
+        {
+            failure_point = outer;
+            throw std::runtime_error(failure_message);
+        }
+
+        thunk(nullptr, arguments, result);
+
+        failure_point = outer;
+    }
+
+
+    void fail(char const* message)
+    {
+        failure_message = message;
+        std::longjmp(*failure_point, 1);
     }
 
 
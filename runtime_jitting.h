@@ -20,14 +20,63 @@ namespace basically::runtime::jitting
         OptionalBool selfcheck_gc;
         OptionalBool keep_intermediates;
         OptionalInt optimization_level;
+
+        // Passed on to gcc as they are, such as -march=native or -ffast-math.
+        std::vector<std::string> command_line_options;
+    };
+
+
+    enum class OutputKind : uint8_t
+    {
+        Executable,
+        ObjectFile
     };
 
 
+    // A function called with pointers to its arguments, and to where its result goes.  The
+    // arguments and result are held the way compiled code holds them in memory, a structure or
+    // array as its bytes.
+    using Thunk = void (*)(void* data, void* const* arguments, void* result);
+
+
+    // Where the functions of an interpreted module are called from, both by the interpreter and by
+    // code compiled for it.  Each starts out run by the interpreter, and is switched over to
+    // compiled code once that's ready, which can happen at any time from any thread.
+    //
+    // Compiled code reads the fields by position, so they stay in this order.
+    struct Entry
+    {
+        // The compiled function, null until it's ready.
+        std::atomic<void*> code = nullptr;
+
+        // The compiled function through a thunk, for calls from the interpreter.
+        std::atomic<Thunk> thunk = nullptr;
+
+        // Runs the function in the interpreter, which is handed the data.
+        Thunk interpret = nullptr;
+        void* data = nullptr;
+    };
+
+
+    // Turns a module's IR into machine code, kept for as long as the Jit is.  The code is either
+    // compiled in memory, or written out as a shared library and loaded from there.
+    //
+    // Each Jit's context is a child of one that's shared by all of them, which declares the
+    // types, builtins and helper signatures every module uses, so they're only set up the once.
+    //
+    // Generating the code reads the type context, and so has to happen on the thread that's
+    // loading modules.  The compile, which is where almost all of the time goes, only reads the
+    // unit and can run on any thread.  As the contexts are all related, libgccjit only has them
+    // used by one thread at a time, which the Jits see to themselves.
     class Jit
     {
         private:
             gcc_jit_context* context;
             gcc_jit_result* result;
+            void* library;
+
+            // The one function generated, for code of an interpreted module.
+            ir::Function const* tiered;
 
         public:
             Jit();
@@ -41,16 +90,78 @@ namespace basically::runtime::jitting
             Jit& operator =(Jit&& jit) noexcept;
 
         public:
-            // create_type
+            // Generate the code for every function of the unit, and its globals, ready to compile.
+            // Instrumented code counts its calls, branches and loops as it runs.
+            void generate(ir::Unit const& unit, bool is_instrumented = false);
+
+            // Generate the code of just one of the unit's functions, for a module that's otherwise
+            // run by the interpreter, along with a thunk for calling it.  Its globals are the
+            // interpreter's, and it calls other functions through their entries, however they're
+            // run by then.
+            void generate_function(ir::Unit const& unit, ir::Function const& function);
 
-            void create_local(variables::Info variable);
+            // Compile the generated code in memory.  The same code can be compiled more than once,
+            // to a file and then in memory should the file be of no use.
+            void compile(ir::Unit const& unit);
 
-            // create_sub
-            // create_function
+            // Compile the generated code to a shared library at the path, rather than load it.
+            void compile_to_file(ir::Unit const& unit, std::fs::path const& path);
+
+            // Load the code of the unit from a shared library compiled from the very same IR.
+            // Returns false, with nothing loaded, if the library can't be opened or isn't
+            // complete.
+            bool load(ir::Unit const& unit, std::fs::path const& path);
+
+            // Fill in the table of everything the compiled or loaded code uses from outside of
+            // it.  The modules the unit uses have to have been compiled by then.
+            void link(ir::Unit const& unit);
+
+            // Compile the units into a program of its own, which runs their initializers in the
+            // order given and exits with the last one's result.  They're linked together
+            // directly, and the program needs nothing but the C library to run.
+            void compile_program(std::vector<ir::Unit const*> const& units,
+                                 std::fs::path const& path,
+                                 OutputKind kind);
+
+            // Compile the units into one context in memory, so that gcc can optimize across
+            // them, for running here.  Their initializers are left to be run in order, as they
+            // would be if each was compiled on its own.
+            void compile_whole_program(std::vector<ir::Unit const*> const& units);
+
+            // The compiled code of one of the unit's functions, by its IR name.
+            void* get_code(std::string const& name) const;
+
+            // The thunk generated along with a single function.
+            Thunk get_thunk(std::string const& name) const;
+
+            // The compiled storage of one of the unit's own globals.
+            void* get_global(std::string const& module_name, std::string const& name) const;
+
+            // Add what instrumented code has counted so far to the profile.  Returns false, with
+            // nothing added, if the code isn't instrumented.
+            bool read_profile(ir::Unit const& unit, profiling::Profile& profile) const;
 
         private:
+            void* find_symbol(std::string const& symbol, bool is_code) const noexcept;
+
             void release() noexcept;
     };
 
 
+    using EntryPoint = int8_t (*)();
+
+    // Run a module's compiled initializer.  A failure within it, such as an array index out of
+    // bounds, is thrown as a std::runtime_error.
+    int run(EntryPoint entry_point);
+
+    // Call compiled code from the interpreter, failures are thrown the same way.
+    void call(Thunk thunk, void* const* arguments, void* result);
+
+    // Unwind the compiled code back to where it was entered, as it does itself when it fails.
+    // Only for code called from compiled code, such as the interpreter running a function that
+    // hasn't been compiled yet.
+    [[noreturn]]
+    void fail(char const* message);
+
+
 }
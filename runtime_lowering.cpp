@@ -0,0 +1,1924 @@
+
+#include "basically.h"
+
+
+namespace basically::runtime::lowering
+{
+
+
+    namespace
+    {
+
+
+        const std::string initializer_name = "<initializer>";
+
+
+        ir::Opcode binary_opcode(lexing::Type type) noexcept
+        {
+            switch (type)
+            {
+                case lexing::Type::SymbolPlus:        return ir::Opcode::Add;
+                case lexing::Type::SymbolMinus:       return ir::Opcode::Subtract;
+                case lexing::Type::SymbolTimes:       return ir::Opcode::Multiply;
+                case lexing::Type::SymbolDivide:      return ir::Opcode::Divide;
+                case lexing::Type::KeywordAnd:        return ir::Opcode::And;
+                case lexing::Type::KeywordOr:         return ir::Opcode::Or;
+                case lexing::Type::SymbolEqual:       return ir::Opcode::Equal;
+                case lexing::Type::SymbolNotEqual:    return ir::Opcode::NotEqual;
+                case lexing::Type::SymbolLessThan:    return ir::Opcode::Less;
+                default:                              return ir::Opcode::Greater;
+            }
+        }
+
+
+        bool is_negative(ir::Constant const& constant) noexcept
+        {
+            auto number = typing::get_type_context().number_info(constant.type);
+
+            if (auto real = std::get_if<double>(&constant.value); real)
+            {
+                return *real < 0.0;
+            }
+
+            return    (number->is_signed == typing::SignedFlag::IsSigned)
+                   && (static_cast<int64_t>(std::get<uint64_t>(constant.value)) < 0);
+        }
+
+
+        ir::OptionalRange constant_range(ir::Function const& function, ir::ValueId value)
+        {
+            if (function[value].opcode != ir::Opcode::Constant)
+            {
+                return std::nullopt;
+            }
+
+            return ir::range_of_constant(function.constants[function[value].immediate]);
+        }
+
+
+        // The entries of a memo table looked at for a call's arguments before giving up and
+        // replacing the first of them.
+        const size_t memo_probes = 4;
+
+        // Strings are hashed to 32 bits before they're mixed in with the other arguments.
+        const uint32_t memo_string_range = std::numeric_limits<uint32_t>::max();
+
+        const uint64_t memo_multiplier = 1099511628211ull;
+
+
+        // Up to this many cases of a select are tested one by one rather than put in a table.
+        const size_t max_case_tests = 3;
+
+        // A jump table is used when at least one in this many of its entries is a case.
+        const uint64_t max_table_spread = 3;
+
+        // How many seeds are tried for each size of a perfect hash's table.
+        const uint32_t max_hash_seeds = 64;
+
+
+        // Orders integer case values by their value, whether or not they're signed.
+        uint64_t case_key(ir::Constant const& constant) noexcept
+        {
+            auto bits = std::get<uint64_t>(constant.value);
+            auto number = typing::get_type_context().number_info(constant.type);
+
+            return number->is_signed == typing::SignedFlag::IsSigned ? bits ^ (uint64_t { 1 } << 63)
+                                                                      : bits;
+        }
+
+
+        struct PerfectHash
+        {
+            uint32_t seed;
+            uint32_t size;
+        };
+
+
+        // A seed that hashes each of the keys to a slot of its own, in a table at most twice
+        // their number in size.  The smallest table that works is used.
+        std::optional<PerfectHash> find_perfect_hash(std::vector<std::string> const& keys)
+        {
+            auto count = static_cast<uint32_t>(keys.size());
+            std::vector<bool> used;
+
+            for (auto size = count; size <= 2 * count; ++size)
+            {
+                for (uint32_t seed = 0; seed < max_hash_seeds; ++seed)
+                {
+                    used.assign(size, false);
+
+                    auto is_perfect = std::all_of(keys.begin(),
+                                                  keys.end(),
+                                                  [&](auto const& key)
+                                                  {
+                                                      auto slot = ir::hash_string(key, seed) % size;
+
+                                                      if (used[slot])
+                                                      {
+                                                          return false;
+                                                      }
+
+                                                      used[slot] = true;
+                                                      return true;
+                                                  });
+
+                    if (is_perfect)
+                    {
+                        return PerfectHash { .seed = seed, .size = size };
+                    }
+                }
+            }
+
+            return std::nullopt;
+        }
+
+
+        // Whether evaluating the expression calls a sub or function.
+        bool makes_calls(ast::Expression const& expression)
+        {
+            auto found = false;
+
+            std::visit(ast::ExpressionHandlers
+                {
+                    .literal_expression = [&](auto const& literal)
+                        {
+                        },
+
+                    .variable_read_expression = [&](auto const& read)
+                        {
+                            found = read->subscript && makes_calls(read->subscript.value());
+                        },
+
+                    .prefix_expression = [&](auto const& prefix)
+                        {
+                            found = makes_calls(prefix->expression);
+                        },
+
+                    .binary_expression = [&](auto const& binary)
+                        {
+                            found = makes_calls(binary->lhs) || makes_calls(binary->rhs);
+                        },
+
+                    .postfix_expression = [&](auto const& postfix)
+                        {
+                            found = makes_calls(postfix->expression);
+                        },
+
+                    .function_call_expression = [&](auto const& call)
+                        {
+                            found =    (call->symbol->kind != symbols::Kind::Conversion)
+                                    || makes_calls(call->parameters.front());
+                        }
+                },
+                expression);
+
+            return found;
+        }
+
+
+        // Whether any of the statements, or any nested in them, assign to the variable.
+        bool assigns(ast::StatementList const& statements, variables::InfoPtr const& variable)
+        {
+            auto in = [&](ast::StatementList const& body) { return assigns(body, variable); };
+
+            auto in_blocks = [&](ast::ConditionalBlockList const& blocks)
+                {
+                    return std::any_of(blocks.begin(),
+                                       blocks.end(),
+                                       [&](auto const& block) { return in(std::get<1>(block)); });
+                };
+
+            for (auto const& statement : statements)
+            {
+                auto found = false;
+
+                std::visit(ast::StatementHandlers
+                    {
+                        .assignment_statement = [&](auto const& assignment)
+                            {
+                                found = assignment->symbol->variable == variable;
+                            },
+
+                        .do_statement = [&](auto const& do_loop) { found = in(do_loop->body); },
+
+                        .for_statement = [&](auto const& for_loop)
+                            {
+                                found =    (for_loop->index_symbol->variable == variable)
+                                        || in(for_loop->body);
+                            },
+
+                        .if_statement = [&](auto const& if_statement)
+                            {
+                                found =    in(std::get<1>(if_statement->main_block))
+                                        || in_blocks(if_statement->else_if_blocks)
+                                        || in(if_statement->else_block);
+                            },
+
+                        .loop_statement = [&](auto const& loop) { found = in(loop->body); },
+
+                        .select_statement = [&](auto const& select)
+                            {
+                                found =    in_blocks(select->conditions)
+                                        || in(select->default_condition);
+                            },
+
+                        .default_handler = [](auto const&) {}
+                    },
+                    statement);
+
+                if (found)
+                {
+                    return true;
+                }
+            }
+
+            return false;
+        }
+
+
+    }
+
+
+    Lowerer::Lowerer(modules::Module const& new_module,
+                     variables::FramePtr const& globals,
+                     ir::Unit& new_unit,
+                     bool new_check_bounds)
+    : module(new_module),
+      unit(new_unit),
+      context(typing::get_type_context()),
+      check_bounds(new_check_bounds)
+    {
+        auto const& builtins = modules::get_builtins_module();
+
+        bool_type = builtins->find_type("bool")->id;
+        string_type = builtins->find_type("string")->id;
+        count_type = builtins->find_type("u64")->id;
+
+        unit.name = module.get_name();
+        unit.module = &module;
+
+        for (auto const& variable : globals->slots)
+        {
+            global_id(&module, variable);
+        }
+    }
+
+
+    void Lowerer::lower_initializer(ast::StatementList const& statements,
+                                    variables::FramePtr const& frame)
+    {
+        auto result = module.find_global("result");
+        assert(result);
+
+        begin_function(module.get_name() + "." + initializer_name, nullptr, frame);
+
+        function->result = result->type_id;
+
+        lower_block(statements);
+
+        auto address = builder->add({
+                .opcode = ir::Opcode::GlobalAddress,
+                .type = context.intern_pointer(result->type_id),
+                .immediate = global_id(&module, result)
+            });
+
+        end_function(load(address));
+    }
+
+
+    void Lowerer::lower_sub(typing::SubInfoPtr const& sub)
+    {
+        lower_body(sub, typing::invalid_type_id);
+    }
+
+
+    void Lowerer::lower_function(typing::FunctionInfoPtr const& function_info)
+    {
+        lower_body(function_info, function_info->return_type.id);
+    }
+
+
+    size_t Lowerer::get_bounds_checks() const noexcept
+    {
+        return bounds_checks;
+    }
+
+
+    size_t Lowerer::get_proven_checks() const noexcept
+    {
+        return proven_checks;
+    }
+
+
+    void Lowerer::lower_body(typing::SubInfoPtr const& sub, typing::TypeId result_type)
+    {
+        auto is_function = result_type != typing::invalid_type_id;
+
+        begin_function(module.get_name() + "." + sub->name, sub, sub->frame);
+
+        std::vector<ir::ValueId> arguments;
+
+        // Parameters arrive as values, but live in their slots like any other variable.
+        for (uint32_t i = 0; i < sub->parameters.size(); ++i)
+        {
+            auto type = sub->parameters[i].type.id;
+
+            function->parameters.push_back(type);
+
+            auto address = builder->add({
+                    .opcode = ir::Opcode::LocalAddress,
+                    .type = context.intern_pointer(type),
+                    .immediate = i
+                });
+
+            arguments.push_back(
+                builder->add({ .opcode = ir::Opcode::Parameter, .type = type, .immediate = i }));
+            store(address, arguments.back());
+        }
+
+        // Functions return whatever was last assigned to their result, which starts out zero.
+        ir::ValueId result_address = ir::no_id;
+
+        if (is_function)
+        {
+            auto type = result_type;
+            auto slot = static_cast<uint32_t>(sub->parameters.size());
+
+            function->result = type;
+
+            result_address = builder->add({
+                    .opcode = ir::Opcode::LocalAddress,
+                    .type = context.intern_pointer(type),
+                    .immediate = slot
+                });
+
+            if (context.is_number(type) || context.is_boolean(type) || context.is_string(type))
+            {
+                store(result_address, zero(type));
+            }
+            else
+            {
+                builder->add({ .opcode = ir::Opcode::Clear, .a = result_address });
+            }
+        }
+
+        auto is_memoized = is_function && sub->is_memoized;
+        auto entry_slot = is_memoized ? lower_memo_lookup(sub, arguments) : ir::no_id;
+
+        lower_block(sub->body);
+
+        auto result = is_function ? load(result_address) : ir::no_id;
+
+        if (is_memoized)
+        {
+            lower_memo_update(sub, arguments, entry_slot, result);
+        }
+
+        end_function(result);
+    }
+
+
+    // The arguments are hashed together, and the entries starting from where they land are
+    // looked at in turn.  An unused entry is taken for the result, one with the same arguments
+    // already has it.
+    uint32_t Lowerer::lower_memo_lookup(typing::SubInfoPtr const& sub,
+                                        std::vector<ir::ValueId> const& arguments)
+    {
+        auto const& used = module.find_global(symbols::memo_table_name(sub->name, "used"));
+        assert(used);
+
+        auto count = [&](uint64_t value)
+            {
+                return builder->constant({ .type = count_type, .value = value });
+            };
+
+        auto mask = count(used->array_count - 1);
+        auto hash = ir::no_id;
+
+        for (auto argument : arguments)
+        {
+            auto value = context.is_string((*function)[argument].type)
+                ? builder->add({
+                          .opcode = ir::Opcode::Hash,
+                          .type = count_type,
+                          .a = argument,
+                          .immediate = 0,
+                          .extra = memo_string_range
+                      })
+                : builder->convert(argument, count_type);
+
+            if (hash != ir::no_id)
+            {
+                value = binary(ir::Opcode::Add, count_type, hash, value);
+            }
+
+            hash = binary(ir::Opcode::Multiply, count_type, value, count(memo_multiplier));
+        }
+
+        // Without arguments there's only the one entry to keep.
+        if (hash == ir::no_id)
+        {
+            hash = count(0);
+        }
+
+        // The multiplications leave the low bits the table is indexed by the least mixed.
+        hash = binary(ir::Opcode::Add,
+                      count_type,
+                      hash,
+                      binary(ir::Opcode::Divide, count_type, hash, count(uint64_t { 1 } << 32)));
+
+        auto home = binary(ir::Opcode::And, count_type, hash, mask);
+
+        auto entry_slot = function->add_slot("<memo entry>", count_type);
+        auto entry_address = [&]()
+            {
+                return builder->add({
+                        .opcode = ir::Opcode::LocalAddress,
+                        .type = context.intern_pointer(count_type),
+                        .immediate = entry_slot
+                    });
+            };
+
+        auto body_block = builder->new_block();
+
+        for (size_t probe = 0; probe < memo_probes; ++probe)
+        {
+            auto index = (probe == 0)
+                ? home
+                : binary(ir::Opcode::And,
+                         count_type,
+                         binary(ir::Opcode::Add, count_type, home, count(probe)),
+                         mask);
+
+            auto unused_block = builder->new_block();
+            auto compare_block = builder->new_block();
+            auto next_block = builder->new_block();
+
+            auto is_used = load(memo_address(sub, "used", index));
+
+            builder->branch(binary(ir::Opcode::Equal, bool_type, is_used, zero(used->type.id)),
+                            unused_block,
+                            compare_block);
+
+            builder->set_block(unused_block);
+            store(entry_address(), index);
+            builder->jump(body_block);
+
+            builder->set_block(compare_block);
+
+            for (size_t i = 0; i < arguments.size(); ++i)
+            {
+                auto key = load(memo_address(sub, "key" + std::to_string(i), index));
+                auto same_block = builder->new_block();
+
+                builder->branch(binary(ir::Opcode::Equal, bool_type, key, arguments[i]),
+                                same_block,
+                                next_block);
+                builder->set_block(same_block);
+            }
+
+            builder->add({
+                    .opcode = ir::Opcode::Return,
+                    .a = load(memo_address(sub, "result", index))
+                });
+
+            builder->set_block(next_block);
+        }
+
+        store(entry_address(), home);
+        builder->jump(body_block);
+
+        builder->set_block(body_block);
+
+        return entry_slot;
+    }
+
+
+    void Lowerer::lower_memo_update(typing::SubInfoPtr const& sub,
+                                    std::vector<ir::ValueId> const& arguments,
+                                    uint32_t entry_slot,
+                                    ir::ValueId result)
+    {
+        auto index = load(builder->add({
+                .opcode = ir::Opcode::LocalAddress,
+                .type = context.intern_pointer(count_type),
+                .immediate = entry_slot
+            }));
+
+        auto used_address = memo_address(sub, "used", index);
+
+        store(used_address,
+              builder->constant({
+                      .type = context.element_of((*function)[used_address].type),
+                      .value = uint64_t { 1 }
+                  }));
+
+        for (size_t i = 0; i < arguments.size(); ++i)
+        {
+            store(memo_address(sub, "key" + std::to_string(i), index), arguments[i]);
+        }
+
+        store(memo_address(sub, "result", index), result);
+    }
+
+
+    // Indices into a memo table are masked to its size, so they're never checked.
+    ir::ValueId Lowerer::memo_address(typing::SubInfoPtr const& sub,
+                                      std::string const& table,
+                                      ir::ValueId index)
+    {
+        auto variable = module.find_global(symbols::memo_table_name(sub->name, table));
+        assert(variable);
+
+        auto id = global_id(&module, variable);
+        unit.globals[id].is_cache = true;
+
+        auto array = builder->add({
+                .opcode = ir::Opcode::GlobalAddress,
+                .type = context.intern_pointer(variable->type_id),
+                .immediate = id
+            });
+
+        return builder->add({
+                .opcode = ir::Opcode::ElementAddress,
+                .type = context.intern_pointer(variable->type.id),
+                .a = array,
+                .b = index
+            });
+    }
+
+
+    void Lowerer::begin_function(std::string const& function_name,
+                                 typing::SubInfoPtr const& sub,
+                                 variables::FramePtr const& frame)
+    {
+        unit.functions.push_back({ .name = function_name, .sub = sub });
+
+        function = &unit.functions.back();
+        builder.emplace(*function);
+
+        for (auto const& variable : frame->slots)
+        {
+            function->add_slot(variable->name, variable->type_id);
+        }
+
+        builder->set_block(builder->new_block());
+    }
+
+
+    void Lowerer::end_function(ir::ValueId result)
+    {
+        builder->add({ .opcode = ir::Opcode::Return, .a = result });
+
+        ir::remove_unreachable_blocks(*function);
+
+        builder.reset();
+        function = nullptr;
+
+        subscript_ranges.clear();
+    }
+
+
+    void Lowerer::lower_block(ast::StatementList const& statements)
+    {
+        for (auto const& statement : statements)
+        {
+            lower_statement(statement);
+        }
+    }
+
+
+    void Lowerer::lower_statement(ast::Statement const& statement)
+    {
+        // Declarations of structures, subs, functions and module loads have no code of their own.
+        auto ignore = [](auto const&) {};
+
+        std::visit(ast::StatementHandlers
+            {
+                .assignment_statement = [&](auto const& assignment)
+                    {
+                        auto soa_array = ir::no_id;
+                        auto soa_index = ir::no_id;
+
+                        auto address = lower_address(assignment->symbol,
+                                                     assignment->subscript,
+                                                     assignment->members,
+                                                     assignment->location,
+                                                     soa_array,
+                                                     soa_index);
+
+                        auto value = lower_value(assignment->value, assignment->target_type);
+
+                        if (address == ir::no_id)
+                        {
+                            scatter(soa_array, soa_index, value, assignment->location);
+                        }
+                        else
+                        {
+                            store(address, value);
+                        }
+                    },
+
+                .do_statement = [&](auto const& do_loop)
+                    {
+                        lower_do(do_loop);
+                    },
+
+                .for_statement = [&](auto const& for_loop)
+                    {
+                        lower_for(for_loop);
+                    },
+
+                .function_declaration_statement = ignore,
+
+                .if_statement = [&](auto const& if_statement)
+                    {
+                        lower_if(if_statement);
+                    },
+
+                .load_statement = ignore,
+
+                .loop_statement = [&](auto const& loop)
+                    {
+                        lower_loop(loop);
+                    },
+
+                .select_statement = [&](auto const& select)
+                    {
+                        lower_select(select);
+                    },
+
+                .structure_declaration_statement = ignore,
+
+                .sub_call_statement = [&](auto const& call)
+                    {
+                        lower_call(call->symbol, call->parameters);
+                    },
+
+                .sub_declaration_statement = ignore,
+
+                .variable_declaration_statement = [&](auto const& declaration)
+                    {
+                        lower_declaration(declaration);
+                    }
+            },
+            statement);
+    }
+
+
+    void Lowerer::lower_if(ast::IfStatementPtr const& if_statement)
+    {
+        auto end_block = builder->new_block();
+
+        auto lower_conditional = [&](ast::ConditionalBlock const& block)
+            {
+                auto const& [ test, body ] = block;
+
+                auto then_block = builder->new_block();
+                auto next_block = builder->new_block();
+
+                lower_condition(test, then_block, next_block);
+
+                builder->set_block(then_block);
+                lower_block(body);
+                builder->jump(end_block);
+
+                builder->set_block(next_block);
+            };
+
+        lower_conditional(if_statement->main_block);
+
+        for (auto const& block : if_statement->else_if_blocks)
+        {
+            lower_conditional(block);
+        }
+
+        lower_block(if_statement->else_block);
+        builder->jump(end_block);
+
+        builder->set_block(end_block);
+    }
+
+
+    void Lowerer::lower_do(ast::DoStatementPtr const& do_loop)
+    {
+        auto test_block = builder->new_block();
+        auto body_block = builder->new_block();
+        auto end_block = builder->new_block();
+
+        builder->jump(test_block);
+
+        builder->set_block(test_block);
+
+        if (do_loop->terminator.type == lexing::Type::KeywordWhile)
+        {
+            lower_condition(do_loop->test, body_block, end_block);
+        }
+        else
+        {
+            lower_condition(do_loop->test, end_block, body_block);
+        }
+
+        builder->set_block(body_block);
+        lower_block(do_loop->body);
+        builder->jump(test_block);
+
+        builder->set_block(end_block);
+    }
+
+
+    void Lowerer::lower_loop(ast::LoopStatementPtr const& loop)
+    {
+        auto body_block = builder->new_block();
+
+        builder->jump(body_block);
+
+        builder->set_block(body_block);
+        lower_block(loop->body);
+        builder->jump(body_block);
+
+        // Nothing leaves the loop, so whatever follows it is unreachable.
+        builder->set_block(builder->new_block());
+    }
+
+
+    // The end and step are evaluated once, before the loop starts.  The index is tested against
+    // the end at the top of each iteration, in the direction of the step.  When the step isn't a
+    // constant its direction is only known at run time, so both tests are made and the step's
+    // sign picks between them.
+    void Lowerer::lower_for(ast::ForStatementPtr const& for_loop)
+    {
+        auto const& index = for_loop->index_symbol;
+        auto type = index->variable->type_id;
+
+        auto index_address = [&]()
+            {
+                return variable_address(index);
+            };
+
+        auto start = lower_value(for_loop->start_index, type);
+        auto end = lower_value(for_loop->end_index, type);
+        auto number = context.number_info(type);
+        auto is_float = number->is_floating_point == typing::FloatingPointFlag::IsFloatingPoint;
+
+        auto step = for_loop->step_value
+            ? lower_value(for_loop->step_value.value(), type)
+            : builder->constant(is_float ? ir::Constant { .type = type, .value = 1.0 }
+                                         : ir::Constant { .type = type, .value = uint64_t { 1 } });
+
+        store(index_address(), start);
+
+        auto const step_instruction = (*function)[step];
+
+        // A global index could be changed by any sub the body calls, not just by the body.
+        if (   !is_float
+            && !index->is_global()
+            && (step_instruction.opcode == ir::Opcode::Constant)
+            && (std::get<uint64_t>(function->constants[step_instruction.immediate].value) != 0)
+            && !assigns(for_loop->body, index->variable))
+        {
+            auto const constant_step = function->constants[step_instruction.immediate];
+
+            lower_counted_for(for_loop, start, end, constant_step);
+            return;
+        }
+
+        auto test_block = builder->new_block();
+        auto body_block = builder->new_block();
+        auto step_block = builder->new_block();
+        auto end_block = builder->new_block();
+
+        std::optional<bool> counts_down;
+
+        if (step_instruction.opcode == ir::Opcode::Constant)
+        {
+            counts_down = is_negative(function->constants[step_instruction.immediate]);
+        }
+        else if (!is_float && (number->is_signed == typing::SignedFlag::IsUnsigned))
+        {
+            counts_down = false;
+        }
+
+        auto is_down = counts_down
+            ? ir::no_id
+            : binary(ir::Opcode::Less, bool_type, step, zero(type));
+
+        builder->jump(test_block);
+
+        builder->set_block(test_block);
+
+        auto test_past = [&](ir::Opcode opcode)
+            {
+                auto current = load(index_address());
+                builder->branch(binary(opcode, bool_type, current, end), end_block, body_block);
+            };
+
+        if (counts_down)
+        {
+            test_past(counts_down.value() ? ir::Opcode::Less : ir::Opcode::Greater);
+        }
+        else
+        {
+            auto up_block = builder->new_block();
+            auto down_block = builder->new_block();
+
+            builder->branch(is_down, down_block, up_block);
+
+            builder->set_block(up_block);
+            test_past(ir::Opcode::Greater);
+
+            builder->set_block(down_block);
+            test_past(ir::Opcode::Less);
+        }
+
+        builder->set_block(body_block);
+        lower_block(for_loop->body);
+        builder->jump(step_block);
+
+        builder->set_block(step_block);
+
+        auto current = load(index_address());
+        store(index_address(), binary(ir::Opcode::Add, type, current, step));
+
+        builder->jump(test_block);
+
+        builder->set_block(end_block);
+    }
+
+
+    // With a constant step, the number of times around the loop is known before it starts.  The
+    // loop counts that down rather than comparing the index to the end each time, which leaves
+    // the index free to be strength reduced.  It also ends loops that run up to the largest value
+    // of the index's type, where the index would wrap around before it ever got past the end.
+    void Lowerer::lower_counted_for(ast::ForStatementPtr const& for_loop,
+                                    ir::ValueId start,
+                                    ir::ValueId end,
+                                    ir::Constant const& step)
+    {
+        auto const& index = for_loop->index_symbol;
+        auto type = index->variable->type_id;
+
+        auto index_address = [&]()
+            {
+                return variable_address(index);
+            };
+
+        auto counts_down = is_negative(step);
+        auto bits = std::get<uint64_t>(step.value);
+
+        // The distance is taken in the widest unsigned type, where it can't overflow.
+        auto wide_start = builder->convert(start, count_type);
+        auto wide_end = builder->convert(end, count_type);
+        auto distance = binary(ir::Opcode::Subtract,
+                               count_type,
+                               counts_down ? wide_start : wide_end,
+                               counts_down ? wide_end : wide_start);
+        auto stride = builder->constant({
+                .type = count_type,
+                .value = counts_down ? uint64_t { 0 } - bits : bits
+            });
+
+        auto remaining_slot = function->add_slot("<remaining>", count_type);
+        auto remaining_address = [&]()
+            {
+                return builder->add({
+                        .opcode = ir::Opcode::LocalAddress,
+                        .type = context.intern_pointer(count_type),
+                        .immediate = remaining_slot
+                    });
+            };
+
+        store(remaining_address(), binary(ir::Opcode::Divide, count_type, distance, stride));
+
+        auto body_block = builder->new_block();
+        auto step_block = builder->new_block();
+        auto count_block = builder->new_block();
+        auto end_block = builder->new_block();
+
+        auto is_past = binary(counts_down ? ir::Opcode::Less : ir::Opcode::Greater,
+                              bool_type,
+                              start,
+                              end);
+
+        builder->branch(is_past, end_block, body_block);
+
+        // When the start and end are known, so is every value the index takes in the body.
+        auto start_range = constant_range(*function, start);
+        auto end_range = constant_range(*function, end);
+        auto step_range = ir::range_of_constant(step);
+
+        ir::OptionalRange index_range;
+
+        if (   start_range
+            && end_range
+            && step_range
+            && (step_range->low != std::numeric_limits<int64_t>::min()))
+        {
+            auto first = start_range->low;
+            auto stride = step_range->low;
+            int64_t distance;
+
+            auto overflows = __builtin_sub_overflow(counts_down ? first : end_range->low,
+                                                    counts_down ? end_range->low : first,
+                                                    &distance);
+
+            // Loops that never run have nothing to prove.
+            if (!overflows && (distance >= 0))
+            {
+                auto last = first + ((distance / std::abs(stride)) * stride);
+
+                index_range = { .low = std::min(first, last), .high = std::max(first, last) };
+                index_ranges.push_back({ index->variable.get(), index_range.value() });
+            }
+        }
+
+        builder->set_block(body_block);
+        lower_block(for_loop->body);
+        builder->jump(step_block);
+
+        if (index_range)
+        {
+            index_ranges.pop_back();
+        }
+
+        // The index still steps past the end on the way out, as it does in any other loop.
+        builder->set_block(step_block);
+
+        auto current = load(index_address());
+        store(index_address(), binary(ir::Opcode::Add, type, current, builder->constant(step)));
+
+        auto remaining = load(remaining_address());
+        auto is_done = binary(ir::Opcode::Equal, bool_type, remaining, zero(count_type));
+
+        builder->branch(is_done, end_block, count_block);
+
+        builder->set_block(count_block);
+
+        auto one = builder->constant({ .type = count_type, .value = uint64_t { 1 } });
+        store(remaining_address(), binary(ir::Opcode::Subtract, count_type, remaining, one));
+
+        builder->jump(body_block);
+
+        builder->set_block(end_block);
+    }
+
+
+    // Selects whose cases are all constants, as they nearly always are, dispatch on the test's
+    // value rather than trying each case in turn.  Integers go through a jump table where their
+    // cases are dense enough and a balanced tree of comparisons elsewhere.  Strings are hashed with
+    // a perfect hash found for their cases, leaving a single comparison to confirm the match.
+    void Lowerer::lower_select(ast::SelectStatementPtr const& select)
+    {
+        auto test = lower_expression(select->test);
+        auto type = (*function)[test].type;
+
+        auto end_block = builder->new_block();
+
+        auto number = context.number_info(type);
+        auto is_integer =    number
+                          && (   number->is_floating_point
+                              != typing::FloatingPointFlag::IsFloatingPoint);
+
+        std::vector<ir::Constant> values;
+
+        for (auto const& [ value, body ] : select->conditions)
+        {
+            auto constant = literal_value(value);
+
+            if (!constant || (!is_integer && !context.is_string(type)))
+            {
+                lower_case_chain(select, test, end_block);
+                return;
+            }
+
+            values.push_back(ir::convert_constant(constant.value(), type)
+                                 .value_or(constant.value()));
+        }
+
+        // Only the first of any cases with the same value can ever be taken.
+        std::vector<ir::BlockId> body_blocks;
+        std::vector<ir::SwitchCase> cases;
+
+        for (auto const& value : values)
+        {
+            body_blocks.push_back(builder->new_block());
+
+            auto is_repeat = std::any_of(cases.begin(),
+                                         cases.end(),
+                                         [&](auto const& switch_case)
+                                         {
+                                             auto const& constants = function->constants;
+                                             return constants[switch_case.constant] == value;
+                                         });
+
+            if (!is_repeat)
+            {
+                cases.push_back({ function->add_constant(value), body_blocks.back() });
+            }
+        }
+
+        auto default_block = builder->new_block();
+
+        if (context.is_string(type))
+        {
+            if (!lower_case_hash(test, cases, default_block))
+            {
+                lower_case_tests(test, cases, default_block);
+            }
+        }
+        else
+        {
+            std::sort(cases.begin(),
+                      cases.end(),
+                      [&](auto const& lhs, auto const& rhs)
+                      {
+                          return case_key(function->constants[lhs.constant])
+                                 < case_key(function->constants[rhs.constant]);
+                      });
+
+            lower_case_tree(test, cases, default_block);
+        }
+
+        auto body_block = body_blocks.begin();
+
+        for (auto const& [ value, body ] : select->conditions)
+        {
+            builder->set_block(*body_block++);
+            lower_block(body);
+            builder->jump(end_block);
+        }
+
+        builder->set_block(default_block);
+        lower_block(select->default_condition);
+        builder->jump(end_block);
+
+        builder->set_block(end_block);
+    }
+
+
+    // Cases are tested one after the other, in the order they're written.
+    void Lowerer::lower_case_chain(ast::SelectStatementPtr const& select,
+                                   ir::ValueId test,
+                                   ir::BlockId end_block)
+    {
+        auto type = (*function)[test].type;
+
+        for (auto const& [ value, body ] : select->conditions)
+        {
+            auto case_block = builder->new_block();
+            auto next_block = builder->new_block();
+
+            auto matches = binary(ir::Opcode::Equal, bool_type, test, lower_value(value, type));
+
+            builder->branch(matches, case_block, next_block);
+
+            builder->set_block(case_block);
+            lower_block(body);
+            builder->jump(end_block);
+
+            builder->set_block(next_block);
+        }
+
+        lower_block(select->default_condition);
+        builder->jump(end_block);
+
+        builder->set_block(end_block);
+    }
+
+
+    // A few cases are simply tested in turn.  More than that become a jump table if most of the
+    // table's entries would be cases, otherwise they're split in two around the middle case.
+    void Lowerer::lower_case_tree(ir::ValueId test,
+                                  std::span<ir::SwitchCase const> cases,
+                                  ir::BlockId default_block)
+    {
+        if (cases.size() <= max_case_tests)
+        {
+            lower_case_tests(test, cases, default_block);
+            return;
+        }
+
+        auto spread =   case_key(function->constants[cases.back().constant])
+                      - case_key(function->constants[cases.front().constant]);
+
+        if ((spread / max_table_spread) < cases.size())
+        {
+            builder->switch_on(test,
+                               std::vector<ir::SwitchCase>(cases.begin(), cases.end()),
+                               default_block);
+            return;
+        }
+
+        auto middle = cases.size() / 2;
+        auto lower_block = builder->new_block();
+        auto upper_block = builder->new_block();
+
+        auto is_lower = binary(ir::Opcode::Less,
+                               bool_type,
+                               test,
+                               builder->constant(function->constants[cases[middle].constant]));
+
+        builder->branch(is_lower, lower_block, upper_block);
+
+        builder->set_block(lower_block);
+        lower_case_tree(test, cases.first(middle), default_block);
+
+        builder->set_block(upper_block);
+        lower_case_tree(test, cases.subspan(middle), default_block);
+    }
+
+
+    // Returns false, having added nothing, if there are too few cases to be worth hashing or no
+    // perfect hash for them could be found.
+    bool Lowerer::lower_case_hash(ir::ValueId test,
+                                  std::span<ir::SwitchCase const> cases,
+                                  ir::BlockId default_block)
+    {
+        if (cases.size() <= max_case_tests)
+        {
+            return false;
+        }
+
+        std::vector<std::string> keys;
+
+        for (auto const& switch_case : cases)
+        {
+            keys.push_back(std::get<std::string>(function->constants[switch_case.constant].value));
+        }
+
+        auto perfect_hash = find_perfect_hash(keys);
+
+        if (!perfect_hash)
+        {
+            return false;
+        }
+
+        auto hash = builder->add({
+                .opcode = ir::Opcode::Hash,
+                .type = count_type,
+                .a = test,
+                .immediate = perfect_hash->seed,
+                .extra = perfect_hash->size
+            });
+
+        std::vector<ir::SwitchCase> slots;
+
+        for (auto const& key : keys)
+        {
+            auto slot = ir::hash_string(key, perfect_hash->seed) % perfect_hash->size;
+
+            slots.push_back({
+                    .constant = function->add_constant({ .type = count_type, .value = slot }),
+                    .target = builder->new_block()
+                });
+        }
+
+        builder->switch_on(hash, slots, default_block);
+
+        // Any string can hash to a case's slot, so the case's own string still has to match.
+        for (size_t i = 0; i < cases.size(); ++i)
+        {
+            builder->set_block(slots[i].target);
+
+            auto matches = binary(ir::Opcode::Equal,
+                                  bool_type,
+                                  test,
+                                  builder->constant(function->constants[cases[i].constant]));
+
+            builder->branch(matches, cases[i].target, default_block);
+        }
+
+        return true;
+    }
+
+
+    void Lowerer::lower_case_tests(ir::ValueId test,
+                                   std::span<ir::SwitchCase const> cases,
+                                   ir::BlockId default_block)
+    {
+        for (auto const& switch_case : cases)
+        {
+            auto next_block = builder->new_block();
+
+            auto matches = binary(ir::Opcode::Equal,
+                                  bool_type,
+                                  test,
+                                  builder->constant(function->constants[switch_case.constant]));
+
+            builder->branch(matches, switch_case.target, next_block);
+            builder->set_block(next_block);
+        }
+
+        builder->jump(default_block);
+    }
+
+
+    // Locals start out as zero, or as their initial value, every time their declaration is
+    // reached.  Globals are zeroed before the initializer runs.
+    void Lowerer::lower_declaration(ast::VariableDeclarationStatementPtr const& declaration)
+    {
+        auto const& symbol = declaration->symbol;
+        auto const& variable = symbol->variable;
+
+        if (!declaration->initializer && symbol->is_global())
+        {
+            return;
+        }
+
+        auto address = variable_address(symbol);
+        auto type = variable->type_id;
+
+        if (declaration->initializer)
+        {
+            store(address, lower_value(declaration->initializer.value(), type));
+        }
+        else if (context.is_number(type) || context.is_boolean(type) || context.is_string(type))
+        {
+            store(address, zero(type));
+        }
+        else
+        {
+            builder->add({ .opcode = ir::Opcode::Clear, .a = address });
+        }
+    }
+
+
+    ir::ValueId Lowerer::lower_expression(ast::Expression const& expression)
+    {
+        auto const& base = ast::get_base(expression);
+        auto value = ir::no_id;
+
+        assert(base.type != typing::invalid_type_id);
+
+        if (auto constant = literal_value(expression); constant)
+        {
+            return builder->constant(constant.value());
+        }
+
+        std::visit(ast::ExpressionHandlers
+            {
+                .literal_expression = [&](auto const& literal)
+                    {
+                        assert(false);
+                    },
+
+                .variable_read_expression = [&](auto const& read)
+                    {
+                        auto soa_array = ir::no_id;
+                        auto soa_index = ir::no_id;
+
+                        auto address = lower_address(read->symbol,
+                                                     read->subscript,
+                                                     read->members,
+                                                     read->location,
+                                                     soa_array,
+                                                     soa_index);
+
+                        value = (address == ir::no_id)
+                            ? gather(soa_array, soa_index, read->location)
+                            : load(address);
+                    },
+
+                .prefix_expression = [&](auto const& prefix)
+                    {
+                        auto opcode = prefix->operator_type.type == lexing::Type::KeywordNot
+                            ? ir::Opcode::Not
+                            : ir::Opcode::Negate;
+
+                        value = builder->add({
+                                .opcode = opcode,
+                                .type = base.type,
+                                .a = lower_value(prefix->expression, base.type)
+                            });
+                    },
+
+                .binary_expression = [&](auto const& binary)
+                    {
+                        value = lower_binary(binary);
+                    },
+
+                .postfix_expression = [&](auto const& postfix)
+                    {
+                        assert(false);
+                    },
+
+                .function_call_expression = [&](auto const& call)
+                    {
+                        if (call->symbol->kind == symbols::Kind::Conversion)
+                        {
+                            value = lower_value(call->parameters.front(), base.type);
+                        }
+                        else
+                        {
+                            value = lower_call(call->symbol, call->parameters);
+                        }
+                    }
+            },
+            expression);
+
+        return value;
+    }
+
+
+    ir::ValueId Lowerer::lower_value(ast::Expression const& expression, typing::TypeId type)
+    {
+        // Literals are made directly in the type they're wanted in.
+        if (auto constant = literal_value(expression); constant)
+        {
+            return builder->constant(ir::convert_constant(constant.value(), type)
+                                         .value_or(constant.value()));
+        }
+
+        return builder->convert(lower_expression(expression), type);
+    }
+
+
+    // The value of a literal, or of a negated one, in the type the checker gave it.
+    std::optional<ir::Constant> Lowerer::literal_value(ast::Expression const& expression) const
+    {
+        if (auto prefix = std::get_if<ast::PrefixExpressionPtr>(&expression);
+               prefix
+            && ((*prefix)->operator_type.type == lexing::Type::SymbolMinus))
+        {
+            auto operand = literal_value((*prefix)->expression);
+
+            if (!operand)
+            {
+                return std::nullopt;
+            }
+
+            auto negated = ir::convert_constant(operand.value(), (*prefix)->type).value();
+
+            if (auto real = std::get_if<double>(&negated.value); real)
+            {
+                *real = -*real;
+                return negated;
+            }
+
+            negated.value = uint64_t { 0 } - std::get<uint64_t>(negated.value);
+            return ir::convert_constant(negated, negated.type);
+        }
+
+        auto literal = std::get_if<ast::LiteralExpressionPtr>(&expression);
+
+        if (!literal)
+        {
+            return std::nullopt;
+        }
+
+        auto const& token = (*literal)->value;
+        auto type = (*literal)->type;
+
+        if (token.type == lexing::Type::LiteralString)
+        {
+            return ir::Constant { .type = type, .value = token.text };
+        }
+
+        // The type checker already made sure the value fits its type.
+        if (context.number_info(type)->is_floating_point
+            == typing::FloatingPointFlag::IsFloatingPoint)
+        {
+            return ir::Constant { .type = type, .value = std::stod(token.text) };
+        }
+
+        return ir::Constant { .type = type, .value = uint64_t { std::stoull(token.text) } };
+    }
+
+
+    // The values an integer expression can take, as far as the literals in it and the indices of
+    // the counted loops around it tell.  Nothing if that could be any value of its type.
+    ir::OptionalRange Lowerer::range_of(ast::Expression const& expression) const
+    {
+        if (auto constant = literal_value(expression); constant)
+        {
+            return ir::range_of_constant(constant.value());
+        }
+
+        auto const& base = ast::get_base(expression);
+        ir::OptionalRange range;
+
+        auto range_in = [&](ast::Expression const& operand, typing::TypeId type)
+            {
+                auto operand_range = range_of(operand);
+
+                return operand_range ? ir::convert_range(operand_range.value(), type)
+                                     : ir::OptionalRange {};
+            };
+
+        std::visit(ast::ExpressionHandlers
+            {
+                .literal_expression = [&](auto const& literal)
+                    {
+                    },
+
+                .variable_read_expression = [&](auto const& read)
+                    {
+                        if (read->subscript || !read->members.empty())
+                        {
+                            return;
+                        }
+
+                        auto found = std::find_if(index_ranges.rbegin(),
+                                                  index_ranges.rend(),
+                                                  [&](auto const& index_range)
+                                                  {
+                                                      return    index_range.first
+                                                             == read->symbol->variable.get();
+                                                  });
+
+                        if (found != index_ranges.rend())
+                        {
+                            range = found->second;
+                        }
+                    },
+
+                .prefix_expression = [&](auto const& prefix)
+                    {
+                        auto operand = range_in(prefix->expression, base.type);
+
+                        if (operand && (prefix->operator_type.type == lexing::Type::SymbolMinus))
+                        {
+                            range = ir::combine_ranges(ir::Opcode::Subtract,
+                                                       { .low = 0, .high = 0 },
+                                                       operand.value(),
+                                                       base.type);
+                        }
+                    },
+
+                .binary_expression = [&](auto const& binary)
+                    {
+                        auto lhs = range_in(binary->lhs, binary->operand_type);
+                        auto rhs = range_in(binary->rhs, binary->operand_type);
+
+                        if (lhs && rhs)
+                        {
+                            range = ir::combine_ranges(binary_opcode(binary->operator_type.type),
+                                                       lhs.value(),
+                                                       rhs.value(),
+                                                       binary->type);
+                        }
+                    },
+
+                .postfix_expression = [&](auto const& postfix)
+                    {
+                    },
+
+                .function_call_expression = [&](auto const& call)
+                    {
+                        if (call->symbol->kind == symbols::Kind::Conversion)
+                        {
+                            range = range_in(call->parameters.front(), base.type);
+                        }
+                    }
+            },
+            expression);
+
+        return range;
+    }
+
+
+    // Tests are made with branches straight to where they lead, not turned into a bool that's then
+    // tested again.  The right side of an and or an or is only evaluated when the left side
+    // doesn't already decide the result, and a not swaps the targets.
+    void Lowerer::lower_condition(ast::Expression const& expression,
+                                  ir::BlockId if_true,
+                                  ir::BlockId if_false)
+    {
+        if (auto binary = std::get_if<ast::BinaryExpressionPtr>(&expression);
+               binary
+            && context.is_boolean((*binary)->operand_type)
+            && (   ((*binary)->operator_type.type == lexing::Type::KeywordAnd)
+                || ((*binary)->operator_type.type == lexing::Type::KeywordOr)))
+        {
+            auto rhs_block = builder->new_block();
+
+            if ((*binary)->operator_type.type == lexing::Type::KeywordAnd)
+            {
+                lower_condition((*binary)->lhs, rhs_block, if_false);
+            }
+            else
+            {
+                lower_condition((*binary)->lhs, if_true, rhs_block);
+            }
+
+            builder->set_block(rhs_block);
+            lower_condition((*binary)->rhs, if_true, if_false);
+            return;
+        }
+
+        if (auto prefix = std::get_if<ast::PrefixExpressionPtr>(&expression);
+               prefix
+            && ((*prefix)->operator_type.type == lexing::Type::KeywordNot)
+            && context.is_boolean((*prefix)->type))
+        {
+            lower_condition((*prefix)->expression, if_false, if_true);
+            return;
+        }
+
+        builder->branch(lower_value(expression, bool_type), if_true, if_false);
+    }
+
+
+    // Anywhere else, an and or an or of bools only skips its right side when that side makes a
+    // call, which is the only way evaluating it could be noticed.  Both sides of cheaper ones are
+    // evaluated, which spares a branch.
+    ir::ValueId Lowerer::lower_binary(ast::BinaryExpressionPtr const& binary_expression)
+    {
+        auto operand_type = binary_expression->operand_type;
+        auto opcode = binary_opcode(binary_expression->operator_type.type);
+
+        if (   ((opcode == ir::Opcode::And) || (opcode == ir::Opcode::Or))
+            && context.is_boolean(operand_type)
+            && makes_calls(binary_expression->rhs))
+        {
+            auto slot = function->add_slot("<condition>", bool_type);
+
+            auto slot_address = [&]()
+                {
+                    return builder->add({
+                            .opcode = ir::Opcode::LocalAddress,
+                            .type = context.intern_pointer(bool_type),
+                            .immediate = slot
+                        });
+                };
+
+            auto true_block = builder->new_block();
+            auto false_block = builder->new_block();
+            auto end_block = builder->new_block();
+
+            lower_condition(binary_expression, true_block, false_block);
+
+            for (auto [ block, value ] : { std::pair(true_block, 1), std::pair(false_block, 0) })
+            {
+                builder->set_block(block);
+                store(slot_address(),
+                      builder->constant({ .type = bool_type, .value = uint64_t(value) }));
+                builder->jump(end_block);
+            }
+
+            builder->set_block(end_block);
+            return load(slot_address());
+        }
+
+        if ((opcode == ir::Opcode::Add) && context.is_string(operand_type))
+        {
+            opcode = ir::Opcode::Concatenate;
+        }
+
+        auto lhs = lower_value(binary_expression->lhs, operand_type);
+        auto rhs = lower_value(binary_expression->rhs, operand_type);
+
+        return binary(opcode, binary_expression->type, lhs, rhs);
+    }
+
+
+    // Arguments left out take the parameter's default value, evaluated here at the call.
+    ir::ValueId Lowerer::lower_call(symbols::SymbolPtr const& symbol,
+                                    ast::ExpressionList const& arguments)
+    {
+        auto id = callee_id(symbol);
+        auto const callee = unit.callees[id];
+        auto const& parameters = symbol->sub->parameters;
+
+        std::vector<ir::ValueId> values;
+        auto argument = arguments.begin();
+
+        for (size_t i = 0; i < parameters.size(); ++i)
+        {
+            auto const& expression = (argument != arguments.end())
+                ? *argument++
+                : parameters[i].initializer.value();
+
+            values.push_back(lower_value(expression, callee.parameters[i]));
+        }
+
+        return builder->add({ .opcode = ir::Opcode::Call, .type = callee.result, .immediate = id },
+                            values);
+    }
+
+
+    ir::ValueId Lowerer::lower_address(symbols::SymbolPtr const& symbol,
+                                       ast::OptionalExpression const& subscript,
+                                       lexing::TokenList const& members,
+                                       source::Location const& location,
+                                       ir::ValueId& soa_array,
+                                       ir::ValueId& soa_index)
+    {
+        auto const& variable = symbol->variable;
+
+        auto address = variable_address(symbol);
+        auto type = variable->type_id;
+        auto member = members.begin();
+
+        if (subscript)
+        {
+            auto index = lower_expression(subscript.value());
+
+            if (auto range = range_of(subscript.value()); range)
+            {
+                subscript_ranges.insert({ index, range.value() });
+            }
+
+            type = variable->type.id;
+
+            if (variable->storage == variables::Storage::StructureOfArrays)
+            {
+                if (member == members.end())
+                {
+                    soa_array = address;
+                    soa_index = index;
+
+                    return ir::no_id;
+                }
+
+                auto const& fields = context.structure_info(type)->fields;
+                auto field = context.structure_info(type)->find_field(member->text).value();
+
+                type = fields[field].type.id;
+                address = field_address(ir::Opcode::SoaAddress,
+                                        address,
+                                        index,
+                                        field,
+                                        type,
+                                        location);
+                ++member;
+            }
+            else
+            {
+                address = builder->add({
+                        .opcode = ir::Opcode::ElementAddress,
+                        .flags = check_flags(address, index),
+                        .type = context.intern_pointer(type),
+                        .a = address,
+                        .b = index,
+                        .location = function->add_location(location)
+                    });
+            }
+        }
+
+        for (; member != members.end(); ++member)
+        {
+            auto structure = context.structure_info(type);
+            auto field = structure->find_field(member->text).value();
+
+            type = structure->fields[field].type.id;
+            address = field_address(ir::Opcode::FieldAddress,
+                                    address,
+                                    ir::no_id,
+                                    field,
+                                    type,
+                                    location);
+        }
+
+        return address;
+    }
+
+
+    ir::ValueId Lowerer::variable_address(symbols::SymbolPtr const& symbol)
+    {
+        auto const& variable = symbol->variable;
+        auto pointer = context.intern_pointer(variable->type_id);
+
+        if (symbol->is_global())
+        {
+            return builder->add({
+                    .opcode = ir::Opcode::GlobalAddress,
+                    .type = pointer,
+                    .immediate = global_id(symbol->module, variable)
+                });
+        }
+
+        return builder->add({
+                .opcode = ir::Opcode::LocalAddress,
+                .type = pointer,
+                .immediate = static_cast<uint32_t>(symbol->slot)
+            });
+    }
+
+
+    // A whole element of a [soa] array is put together field by field in a temporary.
+    ir::ValueId Lowerer::gather(ir::ValueId array,
+                                ir::ValueId index,
+                                source::Location const& location)
+    {
+        auto type = context.element_of(context.element_of((*function)[array].type));
+        auto const& fields = context.structure_info(type)->fields;
+
+        auto slot = function->add_slot("<element>", type);
+        auto pointer = context.intern_pointer(type);
+
+        for (size_t i = 0; i < fields.size(); ++i)
+        {
+            auto field_type = fields[i].type.id;
+
+            auto source = field_address(ir::Opcode::SoaAddress,
+                                        array,
+                                        index,
+                                        i,
+                                        field_type,
+                                        location);
+            auto temporary = builder->add({
+                    .opcode = ir::Opcode::LocalAddress,
+                    .type = pointer,
+                    .immediate = slot
+                });
+
+            store(field_address(ir::Opcode::FieldAddress,
+                                temporary,
+                                ir::no_id,
+                                i,
+                                field_type,
+                                location),
+                  load(source));
+        }
+
+        return load(builder->add({
+                .opcode = ir::Opcode::LocalAddress,
+                .type = pointer,
+                .immediate = slot
+            }));
+    }
+
+
+    void Lowerer::scatter(ir::ValueId array,
+                          ir::ValueId index,
+                          ir::ValueId value,
+                          source::Location const& location)
+    {
+        auto type = context.element_of(context.element_of((*function)[array].type));
+        auto const& fields = context.structure_info(type)->fields;
+
+        auto slot = function->add_slot("<element>", type);
+        auto pointer = context.intern_pointer(type);
+
+        auto temporary = [&]()
+            {
+                return builder->add({
+                        .opcode = ir::Opcode::LocalAddress,
+                        .type = pointer,
+                        .immediate = slot
+                    });
+            };
+
+        store(temporary(), value);
+
+        for (size_t i = 0; i < fields.size(); ++i)
+        {
+            auto field_type = fields[i].type.id;
+
+            auto source = field_address(ir::Opcode::FieldAddress,
+                                        temporary(),
+                                        ir::no_id,
+                                        i,
+                                        field_type,
+                                        location);
+
+            store(field_address(ir::Opcode::SoaAddress, array, index, i, field_type, location),
+                  load(source));
+        }
+    }
+
+
+    uint8_t Lowerer::check_flags(ir::ValueId array, ir::ValueId index)
+    {
+        if (!check_bounds)
+        {
+            return ir::NoFlags;
+        }
+
+        ++bounds_checks;
+
+        auto count = context.get(context.element_of((*function)[array].type)).count;
+
+        if (   auto found = subscript_ranges.find(index);
+               (found != subscript_ranges.end()) && ir::is_within(found->second, count))
+        {
+            ++proven_checks;
+            return ir::NoFlags;
+        }
+
+        return ir::BoundsChecked;
+    }
+
+
+    ir::ValueId Lowerer::field_address(ir::Opcode opcode,
+                                       ir::ValueId address,
+                                       ir::ValueId index,
+                                       size_t field,
+                                       typing::TypeId field_type,
+                                       source::Location const& location)
+    {
+        auto is_soa = opcode == ir::Opcode::SoaAddress;
+
+        return builder->add({
+                .opcode = opcode,
+                .flags = is_soa ? check_flags(address, index) : uint8_t { ir::NoFlags },
+                .type = context.intern_pointer(field_type),
+                .a = address,
+                .b = index,
+                .immediate = static_cast<uint32_t>(field),
+                .location = is_soa ? function->add_location(location) : ir::no_id
+            });
+    }
+
+
+    ir::ValueId Lowerer::load(ir::ValueId address)
+    {
+        auto type = context.element_of((*function)[address].type);
+        return builder->add({ .opcode = ir::Opcode::Load, .type = type, .a = address });
+    }
+
+
+    void Lowerer::store(ir::ValueId address, ir::ValueId value)
+    {
+        builder->add({ .opcode = ir::Opcode::Store, .a = address, .b = value });
+    }
+
+
+    ir::ValueId Lowerer::zero(typing::TypeId type)
+    {
+        if (context.is_string(type))
+        {
+            return builder->constant({ .type = type, .value = std::string() });
+        }
+
+        auto number = context.number_info(type);
+
+        if (   number
+            && (number->is_floating_point == typing::FloatingPointFlag::IsFloatingPoint))
+        {
+            return builder->constant({ .type = type, .value = 0.0 });
+        }
+
+        return builder->constant({ .type = type, .value = uint64_t { 0 } });
+    }
+
+
+    ir::ValueId Lowerer::binary(ir::Opcode opcode,
+                                typing::TypeId type,
+                                ir::ValueId lhs,
+                                ir::ValueId rhs)
+    {
+        return builder->add({ .opcode = opcode, .type = type, .a = lhs, .b = rhs });
+    }
+
+
+    uint32_t Lowerer::global_id(modules::Module const* owner, variables::InfoPtr const& variable)
+    {
+        auto key = std::make_pair(owner, variable->slot);
+
+        if (auto found = global_ids.find(key); found != global_ids.end())
+        {
+            return found->second;
+        }
+
+        auto id = static_cast<uint32_t>(unit.globals.size());
+
+        unit.globals.push_back({
+                .name = variable->name,
+                .type = variable->type_id,
+                .module = owner,
+                .slot = variable->slot
+            });
+        global_ids.insert({ key, id });
+
+        return id;
+    }
+
+
+    uint32_t Lowerer::callee_id(symbols::SymbolPtr const& symbol)
+    {
+        auto const& sub = symbol->sub;
+
+        if (auto found = callee_ids.find(sub.get()); found != callee_ids.end())
+        {
+            return found->second;
+        }
+
+        ir::Callee callee
+            {
+                .name = symbol->module->get_name() + "." + sub->name,
+                .module = symbol->module,
+                .sub = sub
+            };
+
+        for (auto const& parameter : sub->parameters)
+        {
+            callee.parameters.push_back(parameter.type.id);
+        }
+
+        if (symbol->kind == symbols::Kind::Function)
+        {
+            callee.result = std::static_pointer_cast<typing::FunctionInfo>(sub)->return_type.id;
+        }
+
+        auto id = static_cast<uint32_t>(unit.callees.size());
+
+        unit.callees.push_back(callee);
+        callee_ids.insert({ sub.get(), id });
+
+        return id;
+    }
+
+
+}
@@ -0,0 +1,177 @@
+
+#pragma once
+
+
+namespace basically::runtime::lowering
+{
+
+
+    // Turns a module's resolved and type checked code into IR, one function for each sub and
+    // function and one for the module's initializer.  Implicit conversions become explicit Convert
+    // instructions here, so from here on every operation sees operands of exactly its own type.
+    class Lowerer
+    {
+        private:
+            modules::Module const& module;
+            ir::Unit& unit;
+
+            typing::TypeContext& context;
+
+            typing::TypeId bool_type;
+            typing::TypeId string_type;
+            typing::TypeId count_type;
+
+            std::map<std::pair<modules::Module const*, size_t>, uint32_t> global_ids;
+            std::unordered_map<typing::SubInfo const*, uint32_t> callee_ids;
+
+            // Without bounds checks every subscript is trusted to be in range.
+            bool check_bounds;
+
+            size_t bounds_checks = 0;
+            size_t proven_checks = 0;
+
+            // The values the indices of the enclosing counted for loops take in their bodies,
+            // innermost last.
+            std::vector<std::pair<variables::Info const*, ir::Range>> index_ranges;
+
+            // The function currently being lowered.
+            ir::Function* function = nullptr;
+            std::optional<ir::Builder> builder;
+
+            // The subscripts of the current function whose values are known to be in a range.
+            std::unordered_map<ir::ValueId, ir::Range> subscript_ranges;
+
+        public:
+            // The module's own globals are added to the unit first, so that their indices in the
+            // unit are their slots.
+            Lowerer(modules::Module const& new_module,
+                    variables::FramePtr const& globals,
+                    ir::Unit& new_unit,
+                    bool new_check_bounds = true);
+            Lowerer(Lowerer const& lowerer) = delete;
+            Lowerer(Lowerer&& lowerer) = delete;
+            ~Lowerer() = default;
+
+        public:
+            Lowerer& operator =(Lowerer const& lowerer) = delete;
+            Lowerer& operator =(Lowerer&& lowerer) = delete;
+
+        public:
+            // The initializer hands back the module's result variable as its exit code.
+            void lower_initializer(ast::StatementList const& statements,
+                                   variables::FramePtr const& frame);
+            void lower_sub(typing::SubInfoPtr const& sub);
+            void lower_function(typing::FunctionInfoPtr const& function_info);
+
+            // How many subscripts needed to be checked against their array's size, and how many
+            // of those were proven to always be in range and went without.
+            size_t get_bounds_checks() const noexcept;
+            size_t get_proven_checks() const noexcept;
+
+        private:
+            void lower_body(typing::SubInfoPtr const& sub, typing::TypeId result_type);
+
+            void begin_function(std::string const& function_name,
+                                typing::SubInfoPtr const& sub,
+                                variables::FramePtr const& frame);
+            void end_function(ir::ValueId result);
+
+            // A [memoize]d function looks for its arguments in its table before running its
+            // body, and keeps its result there afterwards.  The lookup hands back the slot
+            // holding the index of the entry the result goes in.
+            uint32_t lower_memo_lookup(typing::SubInfoPtr const& sub,
+                                       std::vector<ir::ValueId> const& arguments);
+            void lower_memo_update(typing::SubInfoPtr const& sub,
+                                   std::vector<ir::ValueId> const& arguments,
+                                   uint32_t entry_slot,
+                                   ir::ValueId result);
+            ir::ValueId memo_address(typing::SubInfoPtr const& sub,
+                                     std::string const& table,
+                                     ir::ValueId index);
+
+            void lower_block(ast::StatementList const& statements);
+            void lower_statement(ast::Statement const& statement);
+
+            void lower_if(ast::IfStatementPtr const& if_statement);
+            void lower_do(ast::DoStatementPtr const& do_loop);
+            void lower_loop(ast::LoopStatementPtr const& loop);
+            void lower_for(ast::ForStatementPtr const& for_loop);
+            void lower_counted_for(ast::ForStatementPtr const& for_loop,
+                                   ir::ValueId start,
+                                   ir::ValueId end,
+                                   ir::Constant const& step);
+            void lower_select(ast::SelectStatementPtr const& select);
+            void lower_case_chain(ast::SelectStatementPtr const& select,
+                                  ir::ValueId test,
+                                  ir::BlockId end_block);
+
+            // Dispatches to the targets of cases with constant values, sorted by value for
+            // integers.
+            void lower_case_tree(ir::ValueId test,
+                                 std::span<ir::SwitchCase const> cases,
+                                 ir::BlockId default_block);
+            bool lower_case_hash(ir::ValueId test,
+                                 std::span<ir::SwitchCase const> cases,
+                                 ir::BlockId default_block);
+            void lower_case_tests(ir::ValueId test,
+                                  std::span<ir::SwitchCase const> cases,
+                                  ir::BlockId default_block);
+            void lower_declaration(ast::VariableDeclarationStatementPtr const& declaration);
+
+            ir::ValueId lower_expression(ast::Expression const& expression);
+            ir::ValueId lower_value(ast::Expression const& expression, typing::TypeId type);
+            std::optional<ir::Constant> literal_value(ast::Expression const& expression) const;
+            ir::OptionalRange range_of(ast::Expression const& expression) const;
+            ir::ValueId lower_binary(ast::BinaryExpressionPtr const& binary);
+            void lower_condition(ast::Expression const& expression,
+                                 ir::BlockId if_true,
+                                 ir::BlockId if_false);
+
+            ir::ValueId lower_call(symbols::SymbolPtr const& symbol,
+                                   ast::ExpressionList const& arguments);
+
+            // The address of a variable, or of one of its elements or fields.  A whole element of
+            // a [soa] array has no single address, so for those this returns no_id and sets the
+            // array and index through the last two parameters instead.
+            ir::ValueId lower_address(symbols::SymbolPtr const& symbol,
+                                      ast::OptionalExpression const& subscript,
+                                      lexing::TokenList const& members,
+                                      source::Location const& location,
+                                      ir::ValueId& soa_array,
+                                      ir::ValueId& soa_index);
+
+            ir::ValueId variable_address(symbols::SymbolPtr const& symbol);
+
+            ir::ValueId gather(ir::ValueId array,
+                               ir::ValueId index,
+                               source::Location const& location);
+            void scatter(ir::ValueId array,
+                         ir::ValueId index,
+                         ir::ValueId value,
+                         source::Location const& location);
+
+            // BoundsChecked, unless the index was proven to be in the array's range.
+            uint8_t check_flags(ir::ValueId array, ir::ValueId index);
+
+            ir::ValueId field_address(ir::Opcode opcode,
+                                      ir::ValueId address,
+                                      ir::ValueId index,
+                                      size_t field,
+                                      typing::TypeId field_type,
+                                      source::Location const& location);
+
+            ir::ValueId load(ir::ValueId address);
+            void store(ir::ValueId address, ir::ValueId value);
+
+            ir::ValueId zero(typing::TypeId type);
+            ir::ValueId binary(ir::Opcode opcode,
+                               typing::TypeId type,
+                               ir::ValueId lhs,
+                               ir::ValueId rhs);
+
+            uint32_t global_id(modules::Module const* owner, variables::InfoPtr const& variable);
+            uint32_t callee_id(symbols::SymbolPtr const& symbol);
+    };
+
+
+}
@@ -49,10 +49,33 @@ namespace basically::runtime::modules
             add_number_type("f32", is_signed, is_float, 4);
             add_number_type("f64", is_signed, is_float, 8);
 
+            builtins->insert(std::make_shared<typing::TypeInfo>(
+                                                       "string",
+                                                       std::make_shared<typing::StringInfo>(),
+                                                       typing::Visibility::Public));
+
+            builtins->insert(std::make_shared<typing::TypeInfo>(
+                                                       "bool",
+                                                       std::make_shared<typing::BooleanInfo>(),
+                                                       typing::Visibility::Public));
+
             return builtins;
         }
 
 
+        std::vector<ir::Unit const*> units_of(std::vector<Module*> const& modules)
+        {
+            std::vector<ir::Unit const*> units;
+
+            for (auto module : modules)
+            {
+                units.push_back(&module->get_unit());
+            }
+
+            return units;
+        }
+
+
     }
 
 
@@ -69,7 +92,8 @@ namespace basically::runtime::modules
                    Loader& loader)
     : name(new_name),
       base_path(new_base_path),
-      variable_scope(std::make_shared<variables::Scope>())
+      variable_scope(std::make_shared<variables::Scope>()),
+      options(loader.get_options())
     {
         // Construct types, import code.
         process_passs_1(new_ast, loader);
@@ -80,13 +104,109 @@ namespace basically::runtime::modules
 
         // If we get this far, the module is technically correct, so compile what we have to machine
         // code and make sure it's ready to run.
-        process_passs_3();
+        process_passs_3(loader);
     }
 
 
+    // The modules this one loaded are set up first, though only this module's result counts.
     int Module::execute()
     {
-        return init_function();
+        if (init_result)
+        {
+            return init_result.value();
+        }
+
+        init_result = EXIT_SUCCESS;
+
+        for (auto const& [ module_name, module ] : loaded_modules)
+        {
+            module->execute();
+        }
+
+        if (!whole_program && !interpreter)
+        {
+            finish_code();
+        }
+
+        add_string_roots();
+
+        init_result = init_function();
+        return init_result.value();
+    }
+
+
+    std::string const& Module::get_name() const noexcept
+    {
+        return name;
+    }
+
+
+    ModuleMap const& Module::get_loaded_modules() const noexcept
+    {
+        return loaded_modules;
+    }
+
+
+    typing::TypeInfoPtr Module::find_type(std::string const& type_name) const noexcept
+    {
+        auto found = types.find(type_name);
+        return found != types.end() ? found->second : nullptr;
+    }
+
+
+    typing::SubInfoPtr Module::find_sub(std::string const& sub_name) const noexcept
+    {
+        auto found = subs.find(sub_name);
+        return found != subs.end() ? found->second : nullptr;
+    }
+
+
+    typing::FunctionInfoPtr Module::find_function(std::string const& function_name) const noexcept
+    {
+        auto found = functions.find(function_name);
+        return found != functions.end() ? found->second : nullptr;
+    }
+
+
+    variables::InfoPtr Module::find_global(std::string const& variable_name) const noexcept
+    {
+        if (!variable_scope)
+        {
+            return nullptr;
+        }
+
+        auto found = variable_scope->variables.find(variable_name);
+        return found != variable_scope->variables.end() ? found->second : nullptr;
+    }
+
+
+    ir::Unit const& Module::get_unit() const noexcept
+    {
+        return unit;
+    }
+
+
+    jitting::Jit const& Module::get_jit() const noexcept
+    {
+        return jitter;
+    }
+
+
+    interpreting::Interpreter* Module::get_interpreter() const noexcept
+    {
+        return interpreter.get();
+    }
+
+
+    profiling::Profile const* Module::get_profile() const noexcept
+    {
+        return profile ? &profile.value() : nullptr;
+    }
+
+
+    std::string const& Module::get_cache_key() const noexcept
+    {
+        return cache_key;
     }
 
 
@@ -95,7 +215,7 @@ namespace basically::runtime::modules
         auto statement_handlers = ast::StatementHandlers
             {
                 .function_declaration_statement  = bind(&Module::add_function),
-                .load_statement                  = bind(&Module::load_submodule, loader),
+                .load_statement                  = bind(&Module::load_submodule, std::ref(loader)),
                 .structure_declaration_statement = bind(&Module::add_structure),
                 .sub_declaration_statement       = bind(&Module::add_sub),
                 .variable_declaration_statement  = bind(&Module::add_variable),
@@ -123,13 +243,696 @@ namespace basically::runtime::modules
 
     void Module::process_passs_2()
     {
-        // Resolve type/function references...
+        symbols::Resolver resolver(*this);
+
+        for (auto const& [ type_name, type ] : types)
+        {
+            if (auto structure = std::get_if<typing::StructureInfoPtr>(&type->extra); structure)
+            {
+                for (auto& field : (*structure)->fields)
+                {
+                    resolver.resolve_type(field.type);
+                }
+            }
+        }
+
+        for (auto const& [ type_name, type ] : types)
+        {
+            typing::compute_layout(*type);
+
+            if (auto structure = std::get_if<typing::StructureInfoPtr>(&type->extra); structure)
+            {
+                std::cout << "Layout of structure " << name << "." << type_name << ": "
+                          << **structure;
+            }
+        }
+
+        for (auto const& [ variable_name, variable ] : variable_scope->variables)
+        {
+            resolver.resolve_variable(variable);
+
+            if (variable->storage == variables::Storage::StructureOfArrays)
+            {
+                auto& context = typing::get_type_context();
+                auto soa = typing::compute_soa_layout(*variable->structure(),
+                                                      variable->array_count);
+
+                auto const& fields = variable->structure()->fields;
+                std::vector<size_t> order(fields.size());
+
+                std::iota(order.begin(), order.end(), 0);
+                std::sort(order.begin(),
+                          order.end(),
+                          [&](size_t lhs, size_t rhs)
+                          {
+                              return soa.field_offsets[lhs] < soa.field_offsets[rhs];
+                          });
+
+                std::cout << "Storage of " << name << "." << variable_name << ": "
+                          << variable->array_count << " " << variable->type.type_name
+                          << " as a structure of arrays, " << variable->size() << " bytes, "
+                          << variable->array_count * context.size_of(variable->type.id)
+                          << " as an array of structures" << std::endl;
+
+                for (auto index : order)
+                {
+                    std::cout << "    " << soa.field_offsets[index] << ": " << fields[index].name
+                              << "[" << variable->array_count << "]" << std::endl;
+                }
+            }
+        }
+
+        for (auto const& [ sub_name, sub ] : subs)
+        {
+            resolver.resolve_sub(sub, variable_scope);
+        }
+
+        for (auto const& [ function_name, function ] : functions)
+        {
+            resolver.resolve_function(function, variable_scope);
+        }
+
+        startup_frame = std::make_shared<variables::Frame>();
+        resolver.resolve_initializer(startup_ast, variable_scope, startup_frame);
+
+        std::cout << "Resolved " << resolver.resolved() << " references in " << name << "."
+                  << std::endl;
+
+        inference::TypeChecker checker(*this);
+
+        for (auto const& [ sub_name, sub ] : subs)
+        {
+            checker.check_sub(sub);
+        }
+
+        for (auto const& [ function_name, function ] : functions)
+        {
+            checker.check_sub(function);
+        }
+
+        checker.check_initializer(startup_ast);
+
+        std::cout << "Typed " << checker.checked() << " expressions in " << name << ", with "
+                  << checker.conversions() << " implicit conversions." << std::endl;
+    }
+
+
+    void Module::process_passs_3(Loader& loader)
+    {
+        lowering::Lowerer lowerer(*this, variable_scope->frame, unit, options.check_bounds);
+
+        for (auto const& [ sub_name, sub ] : subs)
+        {
+            lowerer.lower_sub(sub);
+        }
+
+        for (auto const& [ function_name, function ] : functions)
+        {
+            lowerer.lower_function(function);
+        }
+
+        lowerer.lower_initializer(startup_ast, startup_frame);
+
+        ir::verify(unit);
+
+        load_profile();
+
+        auto count_instructions = [&]()
+            {
+                size_t instruction_count = 0;
+
+                for (auto const& function : unit.functions)
+                {
+                    for (auto const& block : function.blocks)
+                    {
+                        instruction_count += block.instructions.size();
+                    }
+                }
+
+                return instruction_count;
+            };
+
+        std::cout << "Lowered " << unit.functions.size() << " functions of " << name << " to "
+                  << count_instructions() << " instructions." << std::endl;
+
+        // Callees are measured for inlining once they're optimized, and what's inlined is
+        // optimized again in its new surroundings.  By then what each function does is known, so
+        // the second round can also reuse, hoist and drop calls that don't write anything.
+        optimizing::Optimizer optimizer(options.passes);
+        optimizer.optimize(unit);
+
+        effects::analyze_effects(unit);
+
+        if (options.inline_budget > 0)
+        {
+            inlining::Inliner inliner(unit, options.inline_budget, get_profile());
+            inliner.inline_calls();
+
+            if (inliner.get_inlined() > 0)
+            {
+                std::cout << "Inlined " << inliner.get_inlined() << " calls in " << name << "."
+                          << std::endl;
+            }
+        }
+
+        optimizer.optimize(unit);
+
+        // Code the optimizer removed may have been all that kept a function from being pure.
+        auto effects = effects::analyze_effects(unit);
+
+        symbols::Resolver resolver(*this);
+
+        for (auto const& [ function_name, function ] : functions)
+        {
+            resolver.check_memoized(function);
+        }
+
+        ir::verify(unit);
+
+        if ((effects.pure > 0) || (effects.read_only > 0))
+        {
+            std::cout << "Found " << effects.pure << " pure and " << effects.read_only
+                      << " read only functions in " << name << "." << std::endl;
+        }
+
+        // Whatever the initializer works out from constants alone is done here once, rather
+        // than every time the script starts.  Code that's left may then fold further.
+        if (options.evaluation_budget > 0)
+        {
+            auto progress = evaluating::evaluate_initializer(unit, options.evaluation_budget);
+
+            if (progress.instructions > 0)
+            {
+                optimizer.optimize(unit);
+                ir::verify(unit);
+
+                std::cout << "Evaluated " << progress.instructions << " instructions of " << name
+                          << "'s initializer at compile time"
+                          << (progress.is_complete ? "." : ", the rest runs at startup.")
+                          << std::endl;
+            }
+        }
+
+        if (!options.passes.empty())
+        {
+            std::cout << "Optimized " << name << " to " << count_instructions()
+                      << " instructions, " << optimizer.get_statistics() << "." << std::endl;
+        }
+
+        // The remaining checks include any that came along with inlined code.
+        if (lowerer.get_bounds_checks() > 0)
+        {
+            size_t remaining = 0;
+
+            for (auto const& function : unit.functions)
+            {
+                for (auto const& block : function.blocks)
+                {
+                    remaining += std::count_if(block.instructions.begin(),
+                                               block.instructions.end(),
+                                               [&](auto id)
+                                               {
+                                                   return function[id].flags & ir::BoundsChecked;
+                                               });
+                }
+            }
+
+            auto proven = lowerer.get_proven_checks() + optimizer.get_statistics().checks;
+
+            std::cout << "Proved " << proven << " of the bounds checks in " << name
+                      << " redundant, " << remaining << " remain." << std::endl;
+        }
+        else if (!options.check_bounds)
+        {
+            std::cout << "Compiled " << name << " without bounds checks." << std::endl;
+        }
+
+        if (options.dump_ir)
+        {
+            std::cout << unit;
+        }
+
+        // The code of a whole program, or one compiled ahead of time, is generated for all of
+        // it at once.
+        if (options.is_ahead_of_time || options.is_whole_program)
+        {
+            return;
+        }
+
+        if (options.is_tiered || options.is_lazy)
+        {
+            start_interpreter(loader);
+            return;
+        }
+
+        generate_code(get_jit_options(), loader.get_workers());
+    }
+
+
+    void Module::compile_program(std::fs::path const& path, jitting::OutputKind kind)
+    {
+        auto units = units_of(collect_modules());
+
+        auto jit = jitting::Jit(get_jit_options());
+        jit.compile_program(units, path, kind);
+
+        std::cout << "Compiled " << name << " into " << path.string()
+                  << (units.size() > 1 ? ", along with the modules it loads." : ".") << std::endl;
+    }
+
+
+    // Every module keeps the code alive, and then runs its own part of it.
+    void Module::compile_whole_program()
+    {
+        auto modules = collect_modules();
+        auto program = std::make_shared<jitting::Jit>(get_jit_options());
+
+        program->compile_whole_program(units_of(modules));
+
+        std::cout << "Compiled " << name << " as a whole program of " << modules.size()
+                  << (modules.size() > 1 ? " modules." : " module.") << std::endl;
+
+        for (auto module : modules)
+        {
+            auto entry_point = reinterpret_cast<jitting::EntryPoint>(
+                                        program->get_code(module->unit.initializer()->name));
+
+            module->whole_program = program;
+            module->init_function = [entry_point]() { return jitting::run(entry_point); };
+        }
+    }
+
+
+    // The passes over the IR leave the work at the level of the machine, such as register
+    // allocation and scheduling, to gcc.  The time spent on a whole program is made up for over
+    // the long runs it's meant for, as it is for a module its profile shows working hard, or
+    // with a sub marked [hot].  A function compiled on its own is worked on as hard as its own
+    // heat calls for.
+    jitting::Options Module::get_jit_options(ir::Function const* function) const
+    {
+        auto is_hot = [](ir::Function const& checked)
+            {
+                return checked.sub && (checked.sub->heat == typing::Heat::Hot);
+            };
+
+        auto is_worth_more =    options.is_whole_program
+                             || (profile && profile->is_hot())
+                             || (function ? is_hot(*function)
+                                          : std::any_of(unit.functions.begin(),
+                                                        unit.functions.end(),
+                                                        is_hot));
+
+        std::vector<std::string> command_line_options;
+
+        if (!options.target_arch.empty())
+        {
+            command_line_options.push_back("-march=" + options.target_arch);
+        }
+
+        if (!options.target_tune.empty())
+        {
+            command_line_options.push_back("-mtune=" + options.target_tune);
+        }
+
+        if (options.is_fast_math)
+        {
+            command_line_options.push_back("-ffast-math");
+        }
+
+        return {
+                .progname = name,
+                .optimization_level = options.passes.empty() ? 0 : (is_worth_more ? 3 : 2),
+                .command_line_options = std::move(command_line_options)
+            };
+    }
+
+
+    // Every module in the order execute runs their initializers, this one last.
+    std::vector<Module*> Module::collect_modules()
+    {
+        std::vector<Module*> modules;
+        std::unordered_set<Module*> visited;
+
+        auto visit = [&](auto& self, Module* module) -> void
+            {
+                if (!visited.insert(module).second)
+                {
+                    return;
+                }
+
+                for (auto const& [ module_name, loaded ] : module->loaded_modules)
+                {
+                    self(self, loaded.get());
+                }
+
+                modules.push_back(module);
+            };
+
+        visit(visit, this);
+        return modules;
+    }
+
+
+    // Whatever gcc picks for "native" is only known once it's compiling, far too late for the
+    // key.
+    bool Module::can_cache_code() const noexcept
+    {
+        return    options.cache_path
+               && (options.target_arch != "native")
+               && (options.target_tune != "native");
+    }
+
+
+    // Code from the cache is loaded here and now.  Otherwise the code is generated here, but gcc
+    // takes far longer over it than that took, so it's compiled by the workers while the modules
+    // after this one are loaded.
+    void Module::generate_code(jitting::Options const& jit_options,
+                               threading::WorkerPool& workers)
+    {
+        jitter = jitting::Jit(jit_options);
+
+        std::optional<caching::Cache> cache;
+
+        if (can_cache_code())
+        {
+            cache.emplace(options.cache_path.value(), options.cache_size_limit);
+            cache_key = make_cache_key(jit_options);
+
+            if (auto cached = cache->find(cache_key); cached)
+            {
+                if (jitter.load(unit, cached.value()))
+                {
+                    std::cout << "Loaded the code of " << name << " from the cache." << std::endl;
+                    return;
+                }
+
+                // Damaged somehow, so it's replaced.
+                cache->remove(cache_key);
+            }
+        }
+
+        jitter.generate(unit, options.is_profiling);
+
+        compiled = workers.submit([this, cache]() { return compile_code(cache); }).share();
+    }
+
+
+    // Runs on one of the workers.  If the cache can't be used the code is compiled in memory as
+    // though there were none.  What there is to say about it is said once it's waited for, so
+    // that it isn't mixed up with what's said about the modules being loaded.
+    std::string Module::compile_code(std::optional<caching::Cache> const& cache)
+    {
+        if (!cache)
+        {
+            jitter.compile(unit);
+            return {};
+        }
+
+        std::string note;
+
+        try
+        {
+            auto path = cache->store(cache_key,
+                                     [&](auto const& temporary)
+                                     {
+                                         jitter.compile_to_file(unit, temporary);
+                                     });
+
+            if (jitter.load(unit, path))
+            {
+                return "Cached the code of " + name + ".";
+            }
+
+            cache->remove(cache_key);
+            note = "Could not load the cached code of " + name + ".";
+        }
+        catch (std::fs::filesystem_error const& error)
+        {
+            note = "Could not cache the code of " + name + ", " + error.what() + ".";
+        }
+
+        jitter.compile(unit);
+        return note;
+    }
+
+
+    // By now everything this module uses has been compiled, as it's all executed first.
+    void Module::finish_code()
+    {
+        if (compiled.valid())
+        {
+            if (auto const& note = compiled.get(); !note.empty())
+            {
+                std::cout << note << std::endl;
+            }
+        }
+
+        jitter.link(unit);
+
+        auto entry_point = reinterpret_cast<jitting::EntryPoint>(
+                                                        jitter.get_code(unit.initializer()->name));
+
+        init_function = [entry_point]() { return jitting::run(entry_point); };
+    }
+
+
+    // The strings left in the module's globals outlive its run, as the code of the modules that
+    // load it can still read them.
+    void Module::add_string_roots()
+    {
+        auto const& types = typing::get_type_context();
+
+        for (auto const& global : unit.globals)
+        {
+            if ((global.module != this) || !strings::holds_strings(global.type))
+            {
+                continue;
+            }
+
+            auto storage = interpreter ? interpreter->get_global(global.name)
+                         : whole_program ? whole_program->get_global(name, global.name)
+                                         : jitter.get_global(name, global.name);
+
+            string_roots.emplace_back(storage, types.size_of(global.type));
+        }
+    }
+
+
+    // The source, the options it's compiled with and the keys of the modules it loads, which
+    // cover their sources and what they load in turn.  Any change to what the module can see
+    // of them, or to what of their code it inlines, changes the key.
+    std::string Module::make_cache_key(jitting::Options const& jit_options) const
+    {
+        std::ostringstream text;
+
+        std::ifstream source(base_path, std::ios::binary);
+        std::string source_text { std::istreambuf_iterator<char>(source), {} };
+
+        text << name << "\n" << base_path.string() << "\n" << source_text << "\n";
+
+        for (auto pass : options.passes)
+        {
+            text << pass << ",";
+        }
+
+        text << "\n" << options.inline_budget << " " << options.evaluation_budget << " "
+             << options.check_bounds << " " << jit_options.optimization_level.value_or(-1) << " "
+             << jit_options.debug_info.value_or(false) << " " << options.is_profiling << "\n";
+
+        for (auto const& option : jit_options.command_line_options)
+        {
+            text << option << " ";
+        }
+
+        text << "\n";
+
+        if (profile)
+        {
+            text << *profile;
+        }
+
+        std::map<std::string, std::string> loaded_keys;
+
+        for (auto const& [ module_name, module ] : loaded_modules)
+        {
+            loaded_keys[module_name] = module->get_cache_key();
+        }
+
+        for (auto const& [ module_name, key ] : loaded_keys)
+        {
+            text << module_name << " " << key << "\n";
+        }
+
+        return caching::make_key(text.str());
     }
 
 
-    void Module::process_passs_3()
+    // The source, and the profile keys of the modules it loads, whose sites are inlined into its
+    // code.  The options it's compiled with aren't part of it, as sites are named the same
+    // however the code is compiled.
+    std::string Module::make_profile_key() const
     {
-        // Jit compile all the code...
+        std::ostringstream text;
+
+        std::ifstream source(base_path, std::ios::binary);
+        std::string source_text { std::istreambuf_iterator<char>(source), {} };
+
+        text << "profile\n" << name << "\n" << base_path.string() << "\n" << source_text << "\n";
+
+        std::map<std::string, std::string> loaded_keys;
+
+        for (auto const& [ module_name, module ] : loaded_modules)
+        {
+            loaded_keys[module_name] = module->profile_key;
+        }
+
+        for (auto const& [ module_name, key ] : loaded_keys)
+        {
+            text << module_name << " " << key << "\n";
+        }
+
+        return caching::make_key(text.str());
+    }
+
+
+    // Profiles are kept in the cache, so without one there's nowhere to find them.
+    void Module::load_profile()
+    {
+        if (!options.cache_path)
+        {
+            return;
+        }
+
+        profile_key = make_profile_key();
+
+        if (!options.use_profile)
+        {
+            return;
+        }
+
+        caching::Cache cache(options.cache_path.value(), options.cache_size_limit);
+        profile = profiling::Profile::load(cache.profile_path(profile_key));
+
+        if (profile && profile->is_empty())
+        {
+            profile.reset();
+        }
+
+        if (profile)
+        {
+            std::cout << "Compiling " << name << " as its profile suggests." << std::endl;
+        }
+    }
+
+
+    // Each profile is read again before it's added to, as another run may have added to it
+    // since.
+    void Module::save_profiles()
+    {
+        if (!options.cache_path)
+        {
+            std::cout << "There's no cache to keep the profile of " << name << " in."
+                      << std::endl;
+            return;
+        }
+
+        caching::Cache cache(options.cache_path.value(), options.cache_size_limit);
+
+        for (auto module : collect_modules())
+        {
+            profiling::Profile counted;
+
+            if (!module->jitter.read_profile(module->unit, counted))
+            {
+                continue;
+            }
+
+            auto saved = profiling::Profile::load(cache.profile_path(module->profile_key))
+                             .value_or(profiling::Profile {});
+
+            saved.merge(counted);
+
+            try
+            {
+                cache.store_profile(module->profile_key,
+                                    [&](auto const& temporary) { saved.save(temporary); });
+
+                std::cout << "Saved the profile of " << module->name << "." << std::endl;
+            }
+            catch (std::runtime_error const& error)
+            {
+                std::cout << "Could not save the profile of " << module->name << ", "
+                          << error.what() << "." << std::endl;
+            }
+        }
+    }
+
+
+    // Nothing is compiled up front, and so nothing is cached either.  Compiling lazily is
+    // tiering with every function hot from its first call.
+    void Module::start_interpreter(Loader& loader)
+    {
+        workers = &loader.get_workers();
+        interpreter = std::make_unique<interpreting::Interpreter>(
+                                                    unit,
+                                                    options.is_lazy ? 1 : options.tier_threshold,
+                                                    [this](auto const& function)
+                                                    {
+                                                        return options.is_lazy
+                                                                    ? compile_lazily(function)
+                                                                    : promote(function);
+                                                    });
+
+        init_function = [this]() { return interpreter->run_initializer(); };
+    }
+
+
+    // Called by the interpreter when a function gets hot.  Its code is generated here, as only
+    // this thread reads the type context, and the workers compile it while the interpreter
+    // carries on.  libgccjit is only used by one thread at a time, so rather than have the
+    // interpreter wait on another function's compile, this one is left for later.
+    //
+    // Should the compile fail the function simply stays in the interpreter.
+    bool Module::promote(ir::Function const& function)
+    {
+        if (!workers->is_idle())
+        {
+            return false;
+        }
+
+        std::cout << "Compiling " << function.name << " now that it's hot." << std::endl;
+
+        auto& jit = promoted.emplace_back(get_jit_options(&function));
+        jit.generate_function(unit, function);
+
+        workers->submit([this, &jit, &function]()
+            {
+                jit.compile(unit);
+                jit.link(unit);
+
+                interpreter->set_code(function,
+                                      jit.get_code(function.name),
+                                      jit.get_thunk(function.name));
+            });
+
+        return true;
+    }
+
+
+    // Called by the interpreter on a function's first call, which waits for its code and then
+    // makes the call through it.  Every call after that goes straight to the code, or through
+    // the stubs of the functions that call it.
+    bool Module::compile_lazily(ir::Function const& function)
+    {
+        auto& jit = promoted.emplace_back(get_jit_options(&function));
+
+        jit.generate_function(unit, function);
+        jit.compile(unit);
+        jit.link(unit);
+
+        interpreter->set_code(function, jit.get_code(function.name), jit.get_thunk(function.name));
+
+        return true;
     }
 
 
@@ -184,6 +987,7 @@ namespace basically::runtime::modules
                 return std::make_shared<ast::VariableDeclarationStatement>(source::Location {},
                                                                            name,
                                                                            type,
+                                                                           0,
                                                                            init);
             };
 
@@ -210,13 +1014,20 @@ namespace basically::runtime::modules
     void Module::add_structure(ast::StructureDeclarationStatementPtr const& statement)
     {
         insert_object(types, "structure", statement);
+        typing::get_type_context().intern(types.at(statement->name.text));
     }
 
 
     void Module::add_variable(ast::VariableDeclarationStatementPtr const& statement)
     {
-        // Create a variable declaration in the module's global scope.
-        insert_object(variable_scope->variables, "variable", statement);
+        // Create a variable declaration in the module's global scope, this also gives it its slot
+        // in the module's globals.
+        auto variable = std::make_shared<variables::Info>(statement);
+
+        std::cout << "Add variable " << name << "." << variable->name << "." << std::endl;
+
+        ensure_unique(variable_scope->variables, statement->location, "variable", variable->name);
+        variable_scope->insert(variable);
 
         // If the variable declaration has an initializer expression, add the declaration to the
         // start-up code so that it can be compiled in.
@@ -288,6 +1099,29 @@ namespace basically::runtime::modules
     }
 
 
+    void Loader::set_options(Options const& new_options)
+    {
+        options = new_options;
+    }
+
+
+    Options const& Loader::get_options() const noexcept
+    {
+        return options;
+    }
+
+
+    threading::WorkerPool& Loader::get_workers()
+    {
+        if (!workers)
+        {
+            workers = std::make_unique<threading::WorkerPool>(options.compile_threads);
+        }
+
+        return *workers;
+    }
+
+
     void Loader::push_working_path(std::fs::path const& path)
     {
         auto status = std::fs::status(path);
@@ -368,7 +1202,7 @@ namespace basically::runtime::modules
         auto source_buffer = source::Buffer(module_path);
         auto token_buffer = lexing::Buffer(source_buffer);
 
-        auto ast = parsing::parse_to_ast(token_buffer);
+        auto ast = parsing::parse_to_ast(token_buffer, options.share_expressions);
         std::cout << std::endl << ast << std::endl;
 
         auto name_without_extension = without_extension(name);
@@ -379,7 +1213,7 @@ namespace basically::runtime::modules
 
         loaded_modules.insert({ name_without_extension, new_module });
 
-        return get_builtins_module();
+        return new_module;
     }
 
 
@@ -450,6 +1284,7 @@ namespace basically::runtime::modules
 
     void Module::insert(typing::TypeInfoPtr&& item)
     {
+        typing::get_type_context().intern(item);
         types.emplace(item->name, std::move(item));
     }
 
@@ -16,6 +16,83 @@ namespace basically::runtime::modules
     ModulePtr& get_builtins_module();
 
 
+    struct Options
+    {
+        // Hash-cons structurally identical expressions while parsing module source.
+        bool share_expressions = false;
+
+        // Print each module's IR once it's been lowered.
+        bool dump_ir = false;
+
+        // The optimizations run on the IR, in order.  Empty to hand the IR over as it was lowered.
+        optimizing::PassList passes = optimizing::default_passes();
+
+        // The largest cost of a sub or function whose body is copied into its callers, zero to
+        // never inline.
+        size_t inline_budget = 40;
+
+        // The most instructions of a module's initializer run at compile time, the rest run when
+        // the module is loaded.  Zero to run all of it then.
+        size_t evaluation_budget = 1000000;
+
+        // Check every array subscript that can't be proven in range at run time.  Only trusted
+        // scripts should be run without.
+        bool check_bounds = true;
+
+        // Only take the modules as far as their IR, for compiling into a program of their own
+        // rather than running them here.
+        bool is_ahead_of_time = false;
+
+        // Compile the script and every module it loads into one context, rather than each on its
+        // own, so that gcc can inline and specialize calls between them.
+        bool is_whole_program = false;
+
+        // Start each module in the interpreter, and only compile its functions once they've run
+        // often enough to be worth it.  Not for whole programs, nor for those compiled ahead of
+        // time.
+        bool is_tiered = false;
+
+        // How many times a function is called, or goes around one of its loops, in the
+        // interpreter before it's compiled.
+        size_t tier_threshold = 1000;
+
+        // Compile each function of a module on its first call, in a context of its own, rather
+        // than all of them up front.  Takes the place of tiering if both are asked for.
+        bool is_lazy = false;
+
+        // Have the code of each module count its calls, branches and loops, and add the counts to
+        // the module's profile in the cache once the script has run.  Only modules compiled the
+        // usual way are counted, not those that are tiered, lazy or part of a whole program.
+        bool is_profiling = false;
+
+        // Compile each module as its profile from earlier runs suggests, if it has one.  The calls
+        // that were hot are inlined more readily and those never made not at all, branches are
+        // laid out for the way they went, and modules that did a lot of work get more of gcc's.
+        bool use_profile = true;
+
+        // The processor code is compiled for, and the one it's tuned for, as gcc's -march and
+        // -mtune take them.  Empty for gcc's defaults, "native" for the machine it's running on.
+        // Code for "native" isn't cached, as the cache can be shared with other machines and
+        // nothing in the key would tell them apart.
+        std::string target_arch;
+        std::string target_tune;
+
+        // Let gcc reorder and simplify floating point arithmetic, as -ffast-math does.  Results
+        // can then differ from those worked out at compile time, or by the interpreter.
+        bool is_fast_math = false;
+
+        // Where compiled modules are kept between runs, nothing to compile them every time.
+        OptionalPath cache_path = caching::default_path();
+
+        // The most the cached modules can take up on disk, in bytes.
+        uintmax_t cache_size_limit = 256 * 1024 * 1024;
+
+        // How many threads compile modules in the background.  Zero to compile each one as soon
+        // as it's loaded.
+        size_t compile_threads = std::thread::hardware_concurrency();
+    };
+
+
     class Module
     {
         private:
@@ -31,9 +108,44 @@ namespace basically::runtime::modules
             variables::ScopePtr variable_scope;
 
             ast::StatementList startup_ast;
+            variables::FramePtr startup_frame;
+
+            Options options;
+            ir::Unit unit;
 
             jitting::Jit jitter;
-            std::function<int()> init_function = []() { return EXIT_FAILURE; };
+
+            // Runs the module when it's tiered, until its functions are compiled.  What they're
+            // compiled to is kept here, and it's the workers that compile them, unless they're
+            // compiled lazily.
+            std::unique_ptr<interpreting::Interpreter> interpreter;
+            std::deque<jitting::Jit> promoted;
+            threading::WorkerPool* workers = nullptr;
+
+            // The code of every module of a whole program, shared between them.
+            std::shared_ptr<jitting::Jit> whole_program;
+
+            // Ready once the workers have compiled the code, with anything there is to say
+            // about how that went.  Not valid if it was loaded from the cache instead.
+            std::shared_future<std::string> compiled;
+
+            // Identifies the module's compiled code in the cache, covering everything it was
+            // compiled from.  Empty when the cache isn't used.
+            std::string cache_key;
+
+            // What earlier runs of the module's code counted, kept in the cache under a key of
+            // its own.
+            std::optional<profiling::Profile> profile;
+            std::string profile_key;
+
+            // The globals that can hold strings, which keep them for as long as the module's
+            // code is around.  Let go of before the code is.
+            std::deque<strings::Root> string_roots;
+
+            std::function<int()> init_function = []() { return EXIT_SUCCESS; };
+
+            // Set once the initializer has run, which it only ever does the once.
+            std::optional<int> init_result;
 
         public:
             Module() = default;
@@ -52,10 +164,58 @@ namespace basically::runtime::modules
         public:
             int execute();
 
+            // Compile this module and everything it loads into a program of its own, which runs
+            // them the same way execute would.
+            void compile_program(std::fs::path const& path, jitting::OutputKind kind);
+
+            // Compile this module and everything it loads together, ready to execute, when they
+            // were loaded as a whole program.
+            void compile_whole_program();
+
+            // Add what this module and everything it loads counted while they ran to their
+            // profiles.
+            void save_profiles();
+
+        public:
+            std::string const& get_name() const noexcept;
+            ModuleMap const& get_loaded_modules() const noexcept;
+
+            typing::TypeInfoPtr find_type(std::string const& type_name) const noexcept;
+            typing::SubInfoPtr find_sub(std::string const& sub_name) const noexcept;
+            typing::FunctionInfoPtr find_function(std::string const& function_name) const noexcept;
+            variables::InfoPtr find_global(std::string const& variable_name) const noexcept;
+
+            ir::Unit const& get_unit() const noexcept;
+            jitting::Jit const& get_jit() const noexcept;
+            interpreting::Interpreter* get_interpreter() const noexcept;
+            std::string const& get_cache_key() const noexcept;
+            profiling::Profile const* get_profile() const noexcept;
+
         private:
             void process_passs_1(ast::StatementList const& ast, Loader& loader);
             void process_passs_2();
-            void process_passs_3();
+            void process_passs_3(Loader& loader);
+
+            jitting::Options get_jit_options(ir::Function const* function = nullptr) const;
+
+            std::vector<Module*> collect_modules();
+
+            bool can_cache_code() const noexcept;
+
+            void generate_code(jitting::Options const& jit_options,
+                               threading::WorkerPool& workers);
+            std::string compile_code(std::optional<caching::Cache> const& cache);
+            void finish_code();
+
+            void add_string_roots();
+
+            std::string make_cache_key(jitting::Options const& jit_options) const;
+            std::string make_profile_key() const;
+            void load_profile();
+
+            void start_interpreter(Loader& loader);
+            bool promote(ir::Function const& function);
+            bool compile_lazily(ir::Function const& function);
 
             void load_submodule(ast::LoadStatementPtr const& statement, Loader& loader);
 
@@ -127,14 +287,23 @@ namespace basically::runtime::modules
             std::fs::path system_path;
             std::list<std::fs::path> working_path;
 
+            Options options;
+
             ModuleMap loaded_modules;
 
+            // Started on first use, and stopped before the modules whose code it compiles go.
+            std::unique_ptr<threading::WorkerPool> workers;
+
         public:
             Loader();
             ~Loader() = default;
 
         public:
             void set_system_path(std::fs::path const& path);
+            void set_options(Options const& new_options);
+            Options const& get_options() const noexcept;
+
+            threading::WorkerPool& get_workers();
 
             void push_working_path(std::fs::path const& path);
             void pop_working_path();
@@ -0,0 +1,2023 @@
+
+#include "basically.h"
+
+
+namespace basically::runtime::optimizing
+{
+
+
+    namespace
+    {
+
+
+        // Enough for the passes to feed each other on any realistic function, while bounding the
+        // time spent on pathological ones.
+        const size_t max_rounds = 8;
+
+
+        const std::vector<std::pair<Pass, std::string>> pass_names =
+            {
+                { Pass::FoldConstants,                 "fold"        },
+                { Pass::PropagateVariables,            "propagate"   },
+                { Pass::EliminateCommonSubexpressions, "cse"         },
+                { Pass::EliminateBoundsChecks,         "bounds"      },
+                { Pass::SimplifyBranches,              "branches"    },
+                { Pass::EliminateDeadStores,           "dead-stores" },
+                { Pass::EliminateDeadCode,             "dead-code"   },
+                { Pass::HoistInvariants,               "hoist"       },
+                { Pass::ReduceStrength,                "strength"    }
+            };
+
+
+        bool is_float(typing::TypeId type) noexcept
+        {
+            auto number = typing::get_type_context().number_info(type);
+            return    number
+                   && (number->is_floating_point == typing::FloatingPointFlag::IsFloatingPoint);
+        }
+
+
+        bool is_signed(typing::TypeId type) noexcept
+        {
+            auto number = typing::get_type_context().number_info(type);
+            return number && (number->is_signed == typing::SignedFlag::IsSigned);
+        }
+
+
+        bool is_integer(typing::TypeId type) noexcept
+        {
+            return typing::get_type_context().number_info(type) && !is_float(type);
+        }
+
+
+        std::optional<ir::Constant> constant_of(ir::Function const& function, ir::ValueId value)
+        {
+            if ((value == ir::no_id) || (function[value].opcode != ir::Opcode::Constant))
+            {
+                return std::nullopt;
+            }
+
+            return function.constants[function[value].immediate];
+        }
+
+
+        std::optional<ir::Constant> fold(ir::Function const& function,
+                                         ir::Instruction const& instruction)
+        {
+            auto opcode = instruction.opcode;
+
+            if (   (opcode != ir::Opcode::Convert)
+                && (opcode != ir::Opcode::Hash)
+                && (opcode != ir::Opcode::Negate)
+                && (opcode != ir::Opcode::Not)
+                && !ir::is_binary(opcode)
+                && !ir::is_comparison(opcode))
+            {
+                return std::nullopt;
+            }
+
+            auto lhs = constant_of(function, instruction.a);
+
+            if (!lhs)
+            {
+                return std::nullopt;
+            }
+
+            if (!ir::is_binary(opcode) && !ir::is_comparison(opcode))
+            {
+                return ir::evaluate(instruction, lhs.value());
+            }
+
+            auto rhs = constant_of(function, instruction.b);
+
+            if (!rhs)
+            {
+                return std::nullopt;
+            }
+
+            return ir::evaluate(instruction, lhs.value(), rhs);
+        }
+
+
+        // The most instructions a single call is run for at compile time.  Anything longer is
+        // left to run when the script does.
+        const size_t max_call_evaluation = 10000;
+
+
+        // What a call to a pure function of the unit returns, worked out by running it.
+        std::optional<ir::Constant> fold_call(ir::Unit const& unit,
+                                              ir::Function const& function,
+                                              ir::Instruction const& instruction)
+        {
+            auto const& callee = unit.callees[instruction.immediate];
+
+            if (   !callee.sub
+                || (callee.sub->effect != typing::Effect::Pure)
+                || (callee.module != unit.module))
+            {
+                return std::nullopt;
+            }
+
+            auto called = unit.find_function(callee.sub.get());
+
+            if (!called)
+            {
+                return std::nullopt;
+            }
+
+            std::vector<ir::Constant> arguments;
+
+            for (auto operand : function.operands_of(instruction))
+            {
+                auto argument = constant_of(function, operand);
+
+                if (!argument)
+                {
+                    return std::nullopt;
+                }
+
+                arguments.push_back(argument.value());
+            }
+
+            return evaluating::evaluate_call(unit, *called, arguments, max_call_evaluation);
+        }
+
+
+        // What a call's sub or function does, as far as the effects analysis has worked it out.
+        // Before it has, every call is taken to be effectful.
+        typing::Effect effect_of_call(std::vector<ir::Callee> const& callees,
+                                      ir::Instruction const& instruction)
+        {
+            auto const& sub = callees[instruction.immediate].sub;
+            return sub ? sub->effect : typing::Effect::Effectful;
+        }
+
+
+        bool call_can_fail(std::vector<ir::Callee> const& callees,
+                           ir::Instruction const& instruction)
+        {
+            auto const& sub = callees[instruction.immediate].sub;
+            return !sub || sub->can_fail;
+        }
+
+
+        // Whether an integer division can fail when it runs, by dividing by zero or overflowing.
+        // A signed division by -1 is only safe when its dividend is known not to be the
+        // smallest value of its type.
+        bool can_division_fail(ir::Function const& function, ir::Instruction const& instruction)
+        {
+            auto divisor = constant_of(function, instruction.b);
+
+            if (!divisor || (std::get<uint64_t>(divisor->value) == 0))
+            {
+                return true;
+            }
+
+            if (   !is_signed(instruction.type)
+                || (static_cast<int64_t>(std::get<uint64_t>(divisor->value)) != -1))
+            {
+                return false;
+            }
+
+            auto dividend = constant_of(function, instruction.a);
+            return !dividend || ir::division_fails(*dividend, *divisor);
+        }
+
+
+        // Instructions that have to stay even if nothing uses their value.  Bounds checked
+        // addresses and integer division can fail at run time, and that failure is kept.  Calls
+        // stay unless they neither write anything nor can fail.
+        bool is_effectful(ir::Function const& function,
+                          std::vector<ir::Callee> const& callees,
+                          ir::Instruction const& instruction)
+        {
+            if (instruction.opcode == ir::Opcode::Call)
+            {
+                return    (effect_of_call(callees, instruction) == typing::Effect::Effectful)
+                       || call_can_fail(callees, instruction);
+            }
+
+            if (ir::has_side_effects(instruction.opcode) || (instruction.flags & ir::BoundsChecked))
+            {
+                return true;
+            }
+
+            if ((instruction.opcode == ir::Opcode::Divide) && !is_float(instruction.type))
+            {
+                return can_division_fail(function, instruction);
+            }
+
+            return false;
+        }
+
+
+        // A slot is simple when its address is only ever loaded from, stored to or cleared as a
+        // whole, never offset or passed on.  Nothing but those loads and stores can touch it.
+        struct SlotUse
+        {
+            bool is_simple = true;
+
+            std::vector<ir::ValueId> loads;
+
+            // Stores and clears.
+            std::vector<ir::ValueId> stores;
+        };
+
+
+        uint32_t slot_of(ir::Function const& function, ir::ValueId value) noexcept
+        {
+            if ((value == ir::no_id) || (function[value].opcode != ir::Opcode::LocalAddress))
+            {
+                return ir::no_id;
+            }
+
+            return function[value].immediate;
+        }
+
+
+        std::vector<SlotUse> analyze_slots(ir::Function const& function)
+        {
+            std::vector<SlotUse> slots(function.slots.size());
+
+            auto escape = [&](ir::ValueId value)
+                {
+                    if (auto slot = slot_of(function, value); slot != ir::no_id)
+                    {
+                        slots[slot].is_simple = false;
+                    }
+                };
+
+            for (auto const& block : function.blocks)
+            {
+                for (auto id : block.instructions)
+                {
+                    auto const& instruction = function[id];
+                    auto slot = slot_of(function, instruction.a);
+
+                    switch (instruction.opcode)
+                    {
+                        case ir::Opcode::Load:
+                            if (slot != ir::no_id)
+                            {
+                                slots[slot].loads.push_back(id);
+                            }
+                            break;
+
+                        case ir::Opcode::Store:
+                        case ir::Opcode::Clear:
+                            if (slot != ir::no_id)
+                            {
+                                slots[slot].stores.push_back(id);
+                            }
+
+                            escape(instruction.b);
+                            break;
+
+                        default:
+                            escape(instruction.a);
+                            escape(instruction.b);
+
+                            for (auto operand : function.operands_of(instruction))
+                            {
+                                escape(operand);
+                            }
+                            break;
+                    }
+                }
+            }
+
+            return slots;
+        }
+
+
+        // The global or local address an element or field address is ultimately taken from.  For
+        // an address that was loaded from a variable, that's the load.
+        ir::Instruction const& root_of(ir::Function const& function, ir::ValueId address)
+        {
+            while (   (function[address].opcode == ir::Opcode::ElementAddress)
+                   || (function[address].opcode == ir::Opcode::FieldAddress)
+                   || (function[address].opcode == ir::Opcode::SoaAddress)
+                   || (function[address].opcode == ir::Opcode::Offset))
+            {
+                address = function[address].a;
+            }
+
+            return function[address];
+        }
+
+
+        // Where the value of an instruction can be reused by a later one doing the same thing.
+        // Calculations and pure calls give the same value wherever they run, so anywhere they
+        // dominate.  Calls that only read give the same value until something is written.
+        enum class Reuse
+        {
+            Never,
+            Dominated,
+            UntilWrite
+        };
+
+
+        Reuse reuse_of(std::vector<ir::Callee> const& callees, ir::Instruction const& instruction)
+        {
+            switch (instruction.opcode)
+            {
+                case ir::Opcode::Constant:
+                case ir::Opcode::LocalAddress:
+                case ir::Opcode::GlobalAddress:
+                case ir::Opcode::ElementAddress:
+                case ir::Opcode::FieldAddress:
+                case ir::Opcode::SoaAddress:
+                case ir::Opcode::Offset:
+                case ir::Opcode::Add:
+                case ir::Opcode::Subtract:
+                case ir::Opcode::Multiply:
+                case ir::Opcode::Divide:
+                case ir::Opcode::And:
+                case ir::Opcode::Or:
+                case ir::Opcode::Concatenate:
+                case ir::Opcode::Negate:
+                case ir::Opcode::Not:
+                case ir::Opcode::Equal:
+                case ir::Opcode::NotEqual:
+                case ir::Opcode::Less:
+                case ir::Opcode::Greater:
+                case ir::Opcode::Convert:
+                case ir::Opcode::Hash:
+                    return Reuse::Dominated;
+
+                case ir::Opcode::Call:
+                    switch (effect_of_call(callees, instruction))
+                    {
+                        case typing::Effect::Pure:     return Reuse::Dominated;
+                        case typing::Effect::ReadOnly: return Reuse::UntilWrite;
+                        default:                       return Reuse::Never;
+                    }
+
+                default:
+                    return Reuse::Never;
+            }
+        }
+
+
+        // The values each integer instruction of a function can produce, worked out from constants,
+        // masks, the sizes of types and all of the values stored to simple variables.  A variable
+        // that's stored a value depending on itself, such as a loop's index, could hold anything
+        // its type allows.
+        class RangeAnalysis
+        {
+            private:
+                ir::Function const& function;
+                std::vector<SlotUse> slots;
+
+                std::unordered_map<ir::ValueId, ir::OptionalRange> values;
+                std::unordered_map<uint32_t, ir::OptionalRange> slot_ranges;
+                std::unordered_set<uint32_t> visiting;
+
+            public:
+                RangeAnalysis(ir::Function const& new_function)
+                : function(new_function),
+                  slots(analyze_slots(new_function))
+                {
+                }
+
+            public:
+                ir::OptionalRange range_of(ir::ValueId value)
+                {
+                    if (auto found = values.find(value); found != values.end())
+                    {
+                        return found->second;
+                    }
+
+                    auto range = compute(function[value]);
+
+                    values.insert({ value, range });
+                    return range;
+                }
+
+            private:
+                ir::OptionalRange compute(ir::Instruction const& instruction)
+                {
+                    auto type_range = ir::range_of_type(instruction.type);
+
+                    if (!type_range)
+                    {
+                        return std::nullopt;
+                    }
+
+                    ir::OptionalRange range;
+
+                    switch (instruction.opcode)
+                    {
+                        case ir::Opcode::Constant:
+                            range = ir::range_of_constant(
+                                function.constants[instruction.immediate]);
+                            break;
+
+                        case ir::Opcode::Convert:
+                            if (auto operand = range_of(instruction.a); operand)
+                            {
+                                range = ir::convert_range(operand.value(), instruction.type);
+                            }
+                            break;
+
+                        case ir::Opcode::Add:
+                        case ir::Opcode::Subtract:
+                        case ir::Opcode::Multiply:
+                            {
+                                auto lhs = range_of(instruction.a);
+                                auto rhs = range_of(instruction.b);
+
+                                if (lhs && rhs)
+                                {
+                                    range = ir::combine_ranges(instruction.opcode,
+                                                               lhs.value(),
+                                                               rhs.value(),
+                                                               instruction.type);
+                                }
+                            }
+                            break;
+
+                        // Masking with a positive value gives at most that value.
+                        case ir::Opcode::And:
+                            for (auto operand : { instruction.a, instruction.b })
+                            {
+                                auto mask = range_of(operand);
+
+                                if (   mask
+                                    && (mask->low >= 0)
+                                    && (!range || (mask->high < range->high)))
+                                {
+                                    range = ir::Range { .low = 0, .high = mask->high };
+                                }
+                            }
+                            break;
+
+                        case ir::Opcode::Load:
+                            if (auto slot = slot_of(function, instruction.a); slot != ir::no_id)
+                            {
+                                range = slot_range(slot);
+                            }
+                            break;
+
+                        default:
+                            break;
+                    }
+
+                    return range ? range : type_range;
+                }
+
+                ir::OptionalRange slot_range(uint32_t slot)
+                {
+                    if (auto found = slot_ranges.find(slot); found != slot_ranges.end())
+                    {
+                        return found->second;
+                    }
+
+                    if (!slots[slot].is_simple || visiting.contains(slot))
+                    {
+                        return std::nullopt;
+                    }
+
+                    visiting.insert(slot);
+
+                    // Zero as well, in case it's loaded before anything is stored.
+                    ir::OptionalRange range = ir::Range { .low = 0, .high = 0 };
+
+                    for (auto store : slots[slot].stores)
+                    {
+                        auto const& instruction = function[store];
+
+                        auto stored = instruction.opcode == ir::Opcode::Clear
+                            ? ir::OptionalRange { ir::Range { .low = 0, .high = 0 } }
+                            : range_of(instruction.b);
+
+                        if (!stored)
+                        {
+                            range = std::nullopt;
+                            break;
+                        }
+
+                        range = ir::Range
+                            {
+                                .low = std::min(range->low, stored->low),
+                                .high = std::max(range->high, stored->high)
+                            };
+                    }
+
+                    visiting.erase(slot);
+                    slot_ranges.insert({ slot, range });
+
+                    return range;
+                }
+        };
+
+
+        // Where each instruction is, its block and its position in that block.
+        struct Positions
+        {
+            std::vector<ir::BlockId> block;
+            std::vector<size_t> index;
+        };
+
+
+        Positions find_positions(ir::Function const& function)
+        {
+            Positions positions
+                {
+                    .block = std::vector<ir::BlockId>(function.instructions.size(), ir::no_id),
+                    .index = std::vector<size_t>(function.instructions.size(), 0)
+                };
+
+            for (ir::BlockId block = 0; block < function.blocks.size(); ++block)
+            {
+                auto const& body = function.blocks[block].instructions;
+
+                for (size_t i = 0; i < body.size(); ++i)
+                {
+                    positions.block[body[i]] = block;
+                    positions.index[body[i]] = i;
+                }
+            }
+
+            return positions;
+        }
+
+
+        // Adds instructions to a block, in front of another instruction or in front of the
+        // block's terminator.  The instructions can refer to each other, as they get consecutive
+        // ids starting from the returned one.
+        ir::ValueId insert(ir::Function& function,
+                           ir::BlockId block,
+                           ir::ValueId before,
+                           std::vector<ir::Instruction> const& instructions)
+        {
+            auto first = static_cast<ir::ValueId>(function.instructions.size());
+            auto& body = function.blocks[block].instructions;
+
+            auto at = before == ir::no_id ? body.end() - 1
+                                          : std::find(body.begin(), body.end(), before);
+
+            std::vector<ir::ValueId> ids(instructions.size());
+            std::iota(ids.begin(), ids.end(), first);
+
+            function.instructions.insert(function.instructions.end(),
+                                         instructions.begin(),
+                                         instructions.end());
+            body.insert(at, ids.begin(), ids.end());
+
+            return first;
+        }
+
+
+        // What a loop writes to, by the variables the addresses written are taken from.
+        struct LoopEffects
+        {
+            // Calls anything that could write to a global.
+            bool calls = false;
+
+            // Written through an address that was loaded from a variable, which could be anything.
+            bool writes_anything = false;
+
+            std::set<std::pair<ir::Opcode, uint32_t>> written;
+        };
+
+
+        LoopEffects effects_of(ir::Function const& function,
+                               std::vector<ir::Callee> const& callees,
+                               ir::Loop const& loop)
+        {
+            LoopEffects effects;
+
+            for (auto block : loop.blocks)
+            {
+                for (auto id : function.blocks[block].instructions)
+                {
+                    auto const& instruction = function[id];
+
+                    if (instruction.opcode == ir::Opcode::Call)
+                    {
+                        effects.calls |=    effect_of_call(callees, instruction)
+                                         == typing::Effect::Effectful;
+                    }
+                    else if (   (instruction.opcode == ir::Opcode::Store)
+                             || (instruction.opcode == ir::Opcode::Clear))
+                    {
+                        auto const& root = root_of(function, instruction.a);
+
+                        if (   (root.opcode == ir::Opcode::LocalAddress)
+                            || (root.opcode == ir::Opcode::GlobalAddress))
+                        {
+                            effects.written.insert({ root.opcode, root.immediate });
+                        }
+                        else
+                        {
+                            effects.writes_anything = true;
+                        }
+                    }
+                }
+            }
+
+            return effects;
+        }
+
+
+        // Whether the instruction can run ahead of a loop, even when the loop itself doesn't run,
+        // without changing what the program does.  Nothing that can fail is moved, nor any load
+        // of memory the loop might change.  Calls that can't fail move when they're pure, or when
+        // they only read and the loop writes nothing they could be reading.
+        bool is_movable(ir::Function const& function,
+                        std::vector<ir::Callee> const& callees,
+                        ir::Instruction const& instruction,
+                        LoopEffects const& effects)
+        {
+            switch (instruction.opcode)
+            {
+                case ir::Opcode::Constant:
+                case ir::Opcode::LocalAddress:
+                case ir::Opcode::GlobalAddress:
+                case ir::Opcode::FieldAddress:
+                case ir::Opcode::Offset:
+                case ir::Opcode::Add:
+                case ir::Opcode::Subtract:
+                case ir::Opcode::Multiply:
+                case ir::Opcode::And:
+                case ir::Opcode::Or:
+                case ir::Opcode::Concatenate:
+                case ir::Opcode::Negate:
+                case ir::Opcode::Not:
+                case ir::Opcode::Equal:
+                case ir::Opcode::NotEqual:
+                case ir::Opcode::Less:
+                case ir::Opcode::Greater:
+                case ir::Opcode::Convert:
+                case ir::Opcode::Hash:
+                    return true;
+
+                case ir::Opcode::ElementAddress:
+                case ir::Opcode::SoaAddress:
+                    return !(instruction.flags & ir::BoundsChecked);
+
+                case ir::Opcode::Divide:
+                    if (is_float(instruction.type))
+                    {
+                        return true;
+                    }
+                    else
+                    {
+                        return !can_division_fail(function, instruction);
+                    }
+
+                case ir::Opcode::Load:
+                    {
+                        auto const& root = root_of(function, instruction.a);
+
+                        if (   effects.writes_anything
+                            || effects.written.contains({ root.opcode, root.immediate }))
+                        {
+                            return false;
+                        }
+
+                        return    (root.opcode == ir::Opcode::LocalAddress)
+                               || ((root.opcode == ir::Opcode::GlobalAddress) && !effects.calls);
+                    }
+
+                case ir::Opcode::Call:
+                    if (call_can_fail(callees, instruction))
+                    {
+                        return false;
+                    }
+
+                    switch (effect_of_call(callees, instruction))
+                    {
+                        case typing::Effect::Pure:
+                            return true;
+
+                        case typing::Effect::ReadOnly:
+                            {
+                                auto operands = function.operands_of(instruction);
+                                auto& context = typing::get_type_context();
+
+                                // An address passed along could be to anything the loop writes.
+                                if (std::any_of(operands.begin(),
+                                                operands.end(),
+                                                [&](ir::ValueId operand)
+                                                {
+                                                    auto type = function[operand].type;
+                                                    return context.is_pointer(type);
+                                                }))
+                                {
+                                    return false;
+                                }
+                            }
+
+                            return    !effects.calls
+                                   && !effects.writes_anything
+                                   && std::none_of(effects.written.begin(),
+                                                   effects.written.end(),
+                                                   [](auto const& written)
+                                                   {
+                                                       return    written.first
+                                                              == ir::Opcode::GlobalAddress;
+                                                   });
+
+                        default:
+                            return false;
+                    }
+
+                default:
+                    return false;
+            }
+        }
+
+
+        size_t hoist_out_of(ir::Function& function,
+                            std::vector<ir::Callee> const& callees,
+                            ir::Loop const& loop)
+        {
+            auto effects = effects_of(function, callees, loop);
+            auto positions = find_positions(function);
+
+            auto is_outside = [&](ir::ValueId value)
+                {
+                    return (value == ir::no_id) || !loop.contains(positions.block[value]);
+                };
+
+            auto is_hoistable = [&](ir::ValueId id)
+                {
+                    auto const& instruction = function[id];
+
+                    auto operands = function.operands_of(instruction);
+
+                    return    is_outside(instruction.a)
+                           && is_outside(instruction.b)
+                           && std::all_of(operands.begin(), operands.end(), is_outside)
+                           && is_movable(function, callees, instruction, effects);
+                };
+
+            // Only worth adding a preheader for if there's something to move into it.
+            auto has_invariants = std::any_of(loop.blocks.begin(),
+                                              loop.blocks.end(),
+                                              [&](ir::BlockId block)
+                                              {
+                                                  auto const& body = function.blocks[block];
+
+                                                  return std::any_of(body.instructions.begin(),
+                                                                     body.instructions.end(),
+                                                                     is_hoistable);
+                                              });
+
+            if (!has_invariants)
+            {
+                return 0;
+            }
+
+            auto preheader = ir::insert_preheader(function, loop);
+
+            if (preheader == ir::no_id)
+            {
+                return 0;
+            }
+
+            positions.block.resize(function.instructions.size(), preheader);
+
+            // Whatever moves out makes what depends on it invariant in turn.
+            size_t count = 0;
+
+            for (auto changed = true; changed; )
+            {
+                changed = false;
+
+                for (auto block : loop.blocks)
+                {
+                    auto& body = function.blocks[block].instructions;
+
+                    for (size_t i = 0; i < body.size(); )
+                    {
+                        auto id = body[i];
+
+                        if (!is_hoistable(id))
+                        {
+                            ++i;
+                            continue;
+                        }
+
+                        auto& target = function.blocks[preheader].instructions;
+
+                        body.erase(body.begin() + i);
+                        target.insert(target.end() - 1, id);
+
+                        positions.block[id] = preheader;
+
+                        ++count;
+                        changed = true;
+                    }
+                }
+            }
+
+            return count;
+        }
+
+
+        // A basic induction variable, a simple integer variable the loop stores to just once,
+        // with its own value plus a constant.
+        struct Induction
+        {
+            ir::ValueId store;
+            ir::Constant step;
+        };
+
+
+        std::map<uint32_t, Induction> find_inductions(ir::Function const& function,
+                                                      ir::Loop const& loop,
+                                                      std::vector<SlotUse> const& slots,
+                                                      Positions const& positions)
+        {
+            std::map<uint32_t, Induction> inductions;
+
+            for (uint32_t slot = 0; slot < slots.size(); ++slot)
+            {
+                auto type = function.slots[slot].type;
+
+                if (!slots[slot].is_simple || is_float(type) || !is_integer(type))
+                {
+                    continue;
+                }
+
+                auto store = ir::no_id;
+                size_t stores = 0;
+
+                for (auto id : slots[slot].stores)
+                {
+                    if (loop.contains(positions.block[id]))
+                    {
+                        store = id;
+                        ++stores;
+                    }
+                }
+
+                if ((stores != 1) || (function[store].opcode != ir::Opcode::Store))
+                {
+                    continue;
+                }
+
+                auto is_own_load = [&](ir::ValueId value)
+                    {
+                        return    (function[value].opcode == ir::Opcode::Load)
+                               && (slot_of(function, function[value].a) == slot)
+                               && loop.contains(positions.block[value]);
+                    };
+
+                auto const& value = function[function[store].b];
+                std::optional<ir::Constant> step;
+
+                if (value.opcode == ir::Opcode::Add)
+                {
+                    if (is_own_load(value.a))
+                    {
+                        step = constant_of(function, value.b);
+                    }
+                    else if (is_own_load(value.b))
+                    {
+                        step = constant_of(function, value.a);
+                    }
+                }
+                else if ((value.opcode == ir::Opcode::Subtract) && is_own_load(value.a))
+                {
+                    if (auto subtracted = constant_of(function, value.b); subtracted)
+                    {
+                        step = ir::evaluate({ .opcode = ir::Opcode::Negate,
+                                              .type = subtracted->type },
+                                            subtracted.value());
+                    }
+                }
+
+                if (step)
+                {
+                    inductions.insert({ slot, { .store = store, .step = step.value() } });
+                }
+            }
+
+            return inductions;
+        }
+
+
+        // Finds one multiple of an induction variable, or one unchecked address of an element it
+        // indexes, and gives it a variable of its own.  That variable starts out at the value
+        // before the loop and is stepped right after the index is, so every use just loads it.
+        size_t reduce_in(ir::Function& function, ir::Loop const& loop)
+        {
+            auto& context = typing::get_type_context();
+
+            auto slots = analyze_slots(function);
+            auto positions = find_positions(function);
+            auto inductions = find_inductions(function, loop, slots, positions);
+
+            if (inductions.empty())
+            {
+                return 0;
+            }
+
+            // The induction variable a load in the same block as its use reads, as long as the
+            // variable isn't stepped in between.
+            auto induction_of = [&](ir::ValueId load, ir::ValueId use) -> uint32_t
+                {
+                    if ((load == ir::no_id) || (function[load].opcode != ir::Opcode::Load))
+                    {
+                        return ir::no_id;
+                    }
+
+                    auto slot = slot_of(function, function[load].a);
+                    auto found = inductions.find(slot);
+
+                    if (   (found == inductions.end())
+                        || (positions.block[load] != positions.block[use]))
+                    {
+                        return ir::no_id;
+                    }
+
+                    auto store = found->second.store;
+                    auto is_stepped_between =    (positions.block[store] == positions.block[use])
+                                              && (positions.index[load] < positions.index[store])
+                                              && (positions.index[store] < positions.index[use]);
+
+                    return is_stepped_between ? ir::no_id : slot;
+                };
+
+            // The slot of the induction variable the instruction is based on, and the other
+            // operand, a constant factor or the address of the array.
+            auto candidate_of = [&](ir::ValueId id) -> std::pair<uint32_t, ir::ValueId>
+                {
+                    auto const& instruction = function[id];
+
+                    switch (instruction.opcode)
+                    {
+                        case ir::Opcode::Multiply:
+                            if (!is_integer(instruction.type) || is_float(instruction.type))
+                            {
+                                break;
+                            }
+
+                            if (   constant_of(function, instruction.b)
+                                && (induction_of(instruction.a, id) != ir::no_id))
+                            {
+                                return { induction_of(instruction.a, id), instruction.b };
+                            }
+
+                            if (   constant_of(function, instruction.a)
+                                && (induction_of(instruction.b, id) != ir::no_id))
+                            {
+                                return { induction_of(instruction.b, id), instruction.a };
+                            }
+                            break;
+
+                        case ir::Opcode::ElementAddress:
+                        case ir::Opcode::SoaAddress:
+                            if (   !(instruction.flags & ir::BoundsChecked)
+                                && !loop.contains(positions.block[instruction.a]))
+                            {
+                                return { induction_of(instruction.b, id), instruction.a };
+                            }
+                            break;
+
+                        default:
+                            break;
+                    }
+
+                    return { ir::no_id, ir::no_id };
+                };
+
+            auto first = ir::no_id;
+            std::pair<uint32_t, ir::ValueId> key;
+
+            for (auto block : loop.blocks)
+            {
+                for (auto id : function.blocks[block].instructions)
+                {
+                    if (auto candidate = candidate_of(id);
+                        (first == ir::no_id) && (candidate.first != ir::no_id))
+                    {
+                        first = id;
+                        key = candidate;
+                    }
+                }
+            }
+
+            if (first == ir::no_id)
+            {
+                return 0;
+            }
+
+            // The other uses of the same expression share its variable.
+            auto const model = function[first];
+
+            auto matches = [&](ir::ValueId id)
+                {
+                    auto const& instruction = function[id];
+
+                    if (   (instruction.opcode != model.opcode)
+                        || (instruction.immediate != model.immediate))
+                    {
+                        return false;
+                    }
+
+                    auto candidate = candidate_of(id);
+
+                    if (candidate.first != key.first)
+                    {
+                        return false;
+                    }
+
+                    if (model.opcode != ir::Opcode::Multiply)
+                    {
+                        return candidate.second == key.second;
+                    }
+
+                    return constant_of(function, candidate.second)
+                        == constant_of(function, key.second);
+                };
+
+            std::vector<ir::ValueId> uses;
+
+            for (auto block : loop.blocks)
+            {
+                std::copy_if(function.blocks[block].instructions.begin(),
+                             function.blocks[block].instructions.end(),
+                             std::back_inserter(uses),
+                             matches);
+            }
+
+            auto preheader = ir::insert_preheader(function, loop);
+
+            if (preheader == ir::no_id)
+            {
+                return 0;
+            }
+
+            auto slot = key.first;
+            auto const& induction = inductions.at(slot);
+
+            auto index_type = function.slots[slot].type;
+            auto type = model.type;
+            auto is_multiple = model.opcode == ir::Opcode::Multiply;
+
+            auto reduced = function.add_slot("<" + function.slots[slot].name + " reduced>", type);
+
+            // In front of the loop, the expression on the index's starting value.
+            auto at = static_cast<ir::ValueId>(function.instructions.size());
+
+            std::vector<ir::Instruction> start =
+                {
+                    {
+                        .opcode = ir::Opcode::LocalAddress,
+                        .type = context.intern_pointer(index_type),
+                        .immediate = slot
+                    },
+                    { .opcode = ir::Opcode::Load, .type = index_type, .a = at }
+                };
+
+            if (is_multiple)
+            {
+                auto factor = constant_of(function, key.second).value();
+
+                start.push_back({
+                        .opcode = ir::Opcode::Constant,
+                        .type = factor.type,
+                        .immediate = function.add_constant(factor)
+                    });
+                start.push_back({
+                        .opcode = ir::Opcode::Multiply,
+                        .type = type,
+                        .a = at + 1,
+                        .b = at + 2
+                    });
+            }
+            else
+            {
+                start.push_back({
+                        .opcode = model.opcode,
+                        .type = type,
+                        .a = model.a,
+                        .b = at + 1,
+                        .immediate = model.immediate
+                    });
+            }
+
+            auto initial = at + static_cast<ir::ValueId>(start.size()) - 1;
+
+            start.push_back({
+                    .opcode = ir::Opcode::LocalAddress,
+                    .type = context.intern_pointer(type),
+                    .immediate = reduced
+                });
+            start.push_back({ .opcode = ir::Opcode::Store, .a = initial + 1, .b = initial });
+
+            insert(function, preheader, ir::no_id, start);
+
+            // Stepped along with the index.  Addresses move by the step taken as a signed count
+            // of elements, even for unsigned indices.
+            ir::Constant delta;
+
+            if (is_multiple)
+            {
+                delta = ir::evaluate({ .opcode = ir::Opcode::Multiply, .type = type },
+                                     induction.step,
+                                     constant_of(function, key.second)).value();
+            }
+            else
+            {
+                auto const& builtins = modules::get_builtins_module();
+                auto offset_type = builtins->find_type("i64")->id;
+
+                auto bits = std::get<uint64_t>(induction.step.value);
+                auto width = context.size_of(index_type) * 8;
+
+                if ((width < 64) && ((bits >> (width - 1)) & 1))
+                {
+                    bits |= ~((uint64_t { 1 } << width) - 1);
+                }
+
+                delta = { .type = offset_type, .value = bits };
+            }
+
+            auto const& stepped_body = function.blocks[positions.block[induction.store]];
+            auto after_step = stepped_body.instructions[positions.index[induction.store] + 1];
+
+            at = static_cast<ir::ValueId>(function.instructions.size());
+
+            insert(function,
+                   positions.block[induction.store],
+                   after_step,
+                   {
+                       {
+                           .opcode = ir::Opcode::LocalAddress,
+                           .type = context.intern_pointer(type),
+                           .immediate = reduced
+                       },
+                       { .opcode = ir::Opcode::Load, .type = type, .a = at },
+                       {
+                           .opcode = ir::Opcode::Constant,
+                           .type = delta.type,
+                           .immediate = function.add_constant(delta)
+                       },
+                       {
+                           .opcode = is_multiple ? ir::Opcode::Add : ir::Opcode::Offset,
+                           .type = type,
+                           .a = at + 1,
+                           .b = at + 2
+                       },
+                       { .opcode = ir::Opcode::Store, .a = at, .b = at + 3 }
+                   });
+
+            // And loaded wherever the expression was used.
+            std::vector<ir::ValueId> replacements(function.instructions.size(), ir::no_id);
+            std::vector<bool> removed(function.instructions.size(), false);
+
+            for (auto use : uses)
+            {
+                at = static_cast<ir::ValueId>(function.instructions.size());
+
+                insert(function,
+                       positions.block[use],
+                       use,
+                       {
+                           {
+                               .opcode = ir::Opcode::LocalAddress,
+                               .type = context.intern_pointer(type),
+                               .immediate = reduced
+                           },
+                           { .opcode = ir::Opcode::Load, .type = type, .a = at }
+                       });
+
+                replacements.resize(function.instructions.size(), ir::no_id);
+                replacements[use] = at + 1;
+                removed[use] = true;
+            }
+
+            ir::replace_values(function, replacements);
+            ir::remove_instructions(function, removed);
+
+            return uses.size();
+        }
+
+
+    }
+
+
+    std::ostream& operator <<(std::ostream& stream, Pass pass)
+    {
+        for (auto const& [ known_pass, name ] : pass_names)
+        {
+            if (known_pass == pass)
+            {
+                return stream << name;
+            }
+        }
+
+        return stream << "???";
+    }
+
+
+    PassList default_passes()
+    {
+        return
+            {
+                Pass::FoldConstants,
+                Pass::SimplifyBranches,
+                Pass::PropagateVariables,
+                Pass::EliminateCommonSubexpressions,
+                Pass::EliminateBoundsChecks,
+                Pass::EliminateDeadStores,
+                Pass::EliminateDeadCode,
+                Pass::HoistInvariants,
+                Pass::ReduceStrength
+            };
+    }
+
+
+    PassList parse_passes(std::string const& names)
+    {
+        PassList passes;
+        std::stringstream stream(names);
+        std::string name;
+
+        while (std::getline(stream, name, ','))
+        {
+            if (name.empty())
+            {
+                continue;
+            }
+
+            auto found = std::find_if(pass_names.begin(),
+                                      pass_names.end(),
+                                      [&](auto const& entry) { return entry.second == name; });
+
+            if (found == pass_names.end())
+            {
+                throw std::runtime_error("Unknown optimization pass " + name + ".");
+            }
+
+            passes.push_back(found->first);
+        }
+
+        return passes;
+    }
+
+
+    std::ostream& operator <<(std::ostream& stream, Statistics const& statistics)
+    {
+        stream << "folded " << statistics.folded << " constants, propagated "
+               << statistics.propagated << " loads, reused " << statistics.common
+               << " common values, simplified " << statistics.branches
+               << " branches, removed " << statistics.blocks << " blocks, "
+               << statistics.stores << " dead stores and " << statistics.instructions
+               << " dead instructions, hoisted " << statistics.hoisted << " out of loops, reduced "
+               << statistics.reduced << " induction expressions, removed " << statistics.checks
+               << " bounds checks";
+
+        return stream;
+    }
+
+
+    Optimizer::Optimizer(PassList const& new_passes)
+    : passes(new_passes)
+    {
+    }
+
+
+    void Optimizer::optimize(ir::Unit& new_unit)
+    {
+        unit = &new_unit;
+
+        for (auto& function : new_unit.functions)
+        {
+            for (size_t round = 0; round < max_rounds; ++round)
+            {
+                auto changed = false;
+
+                for (auto pass : passes)
+                {
+                    changed |= run(pass, function);
+                }
+
+                if (!changed)
+                {
+                    break;
+                }
+            }
+
+            ir::compact(function);
+        }
+    }
+
+
+    Statistics const& Optimizer::get_statistics() const noexcept
+    {
+        return statistics;
+    }
+
+
+    bool Optimizer::run(Pass pass, ir::Function& function)
+    {
+        switch (pass)
+        {
+            case Pass::FoldConstants:         return fold_constants(function) > 0;
+            case Pass::PropagateVariables:    return propagate_variables(function) > 0;
+            case Pass::EliminateCommonSubexpressions:
+                return eliminate_common_subexpressions(function) > 0;
+            case Pass::EliminateBoundsChecks: return eliminate_bounds_checks(function) > 0;
+            case Pass::SimplifyBranches:      return simplify_branches(function) > 0;
+            case Pass::EliminateDeadStores:   return eliminate_dead_stores(function) > 0;
+            case Pass::EliminateDeadCode:     return eliminate_dead_code(function) > 0;
+            case Pass::HoistInvariants:       return hoist_invariants(function) > 0;
+            case Pass::ReduceStrength:        return reduce_strength(function) > 0;
+        }
+
+        return false;
+    }
+
+
+    // Folded instructions become constants in place, so their users see the constant without
+    // being rewritten.  Calls to pure functions with constant arguments are folded by running
+    // them.  Blocks are visited in order, so chains of constant operations mostly fold
+    // in a single run.
+    size_t Optimizer::fold_constants(ir::Function& function)
+    {
+        size_t count = 0;
+
+        for (auto const& block : function.blocks)
+        {
+            for (auto id : block.instructions)
+            {
+                auto folded = (function[id].opcode == ir::Opcode::Call)
+                    ? fold_call(*unit, function, function[id])
+                    : fold(function, function[id]);
+
+                if (!folded)
+                {
+                    continue;
+                }
+
+                auto constant = function.add_constant(folded.value());
+                auto& instruction = function[id];
+
+                instruction = ir::Instruction
+                    {
+                        .opcode = ir::Opcode::Constant,
+                        .type = instruction.type,
+                        .immediate = constant,
+                        .location = instruction.location
+                    };
+
+                ++count;
+            }
+        }
+
+        statistics.folded += count;
+        return count;
+    }
+
+
+    // A simple variable stored exactly once, such as a local with an initializer that's never
+    // assigned again, holds that value wherever the store dominates the load.  Elsewhere a load
+    // only gets a value stored, or loaded, earlier in the same block.  Globals can be changed by
+    // any call, or through any address derived from them, so those forget what they know.
+    size_t Optimizer::propagate_variables(ir::Function& function)
+    {
+        auto slots = analyze_slots(function);
+        auto idoms = ir::dominators(function);
+        auto positions = find_positions(function);
+
+        auto comes_before = [&](ir::ValueId earlier, ir::ValueId later)
+            {
+                if (positions.block[earlier] == positions.block[later])
+                {
+                    return positions.index[earlier] < positions.index[later];
+                }
+
+                return ir::dominates(idoms, positions.block[earlier], positions.block[later]);
+            };
+
+        std::vector<ir::ValueId> replacements(function.instructions.size(), ir::no_id);
+        size_t count = 0;
+
+        for (auto const& slot : slots)
+        {
+            if (   !slot.is_simple
+                || (slot.stores.size() != 1)
+                || (function[slot.stores.front()].opcode != ir::Opcode::Store))
+            {
+                continue;
+            }
+
+            auto store = slot.stores.front();
+
+            for (auto load : slot.loads)
+            {
+                if (comes_before(store, load))
+                {
+                    replacements[load] = function[store].b;
+                    ++count;
+                }
+            }
+        }
+
+        for (auto const& block : function.blocks)
+        {
+            std::unordered_map<uint32_t, ir::ValueId> locals;
+            std::unordered_map<uint32_t, ir::ValueId> globals;
+
+            // Which variable an address is all of, if it is.
+            auto known_for = [&](ir::ValueId address) -> std::unordered_map<uint32_t, ir::ValueId>*
+                {
+                    auto const& instruction = function[address];
+
+                    if (   (instruction.opcode == ir::Opcode::LocalAddress)
+                        && slots[instruction.immediate].is_simple)
+                    {
+                        return &locals;
+                    }
+
+                    if (instruction.opcode == ir::Opcode::GlobalAddress)
+                    {
+                        return &globals;
+                    }
+
+                    return nullptr;
+                };
+
+            auto forget = [&](ir::ValueId address)
+                {
+                    auto const& root = root_of(function, address);
+
+                    if (root.opcode == ir::Opcode::GlobalAddress)
+                    {
+                        globals.erase(root.immediate);
+                    }
+                    else if (root.opcode != ir::Opcode::LocalAddress)
+                    {
+                        globals.clear();
+                    }
+                };
+
+            for (auto id : block.instructions)
+            {
+                auto const& instruction = function[id];
+
+                switch (instruction.opcode)
+                {
+                    case ir::Opcode::Store:
+                    case ir::Opcode::Clear:
+                        if (auto known = known_for(instruction.a); known)
+                        {
+                            auto variable = function[instruction.a].immediate;
+
+                            if (instruction.opcode == ir::Opcode::Store)
+                            {
+                                (*known)[variable] = instruction.b;
+                            }
+                            else
+                            {
+                                known->erase(variable);
+                            }
+                        }
+                        else
+                        {
+                            forget(instruction.a);
+                        }
+                        break;
+
+                    case ir::Opcode::Load:
+                        if (auto known = known_for(instruction.a); known)
+                        {
+                            auto variable = function[instruction.a].immediate;
+                            auto found = known->find(variable);
+
+                            if (found == known->end())
+                            {
+                                (*known)[variable] = id;
+                            }
+                            else if (replacements[id] == ir::no_id)
+                            {
+                                replacements[id] = found->second;
+                                ++count;
+                            }
+                        }
+                        break;
+
+                    // Calls that don't write anything leave the globals as they were.
+                    case ir::Opcode::Call:
+                        if (effect_of_call(unit->callees, instruction) == typing::Effect::Effectful)
+                        {
+                            globals.clear();
+                        }
+                        break;
+
+                    default:
+                        break;
+                }
+            }
+        }
+
+        ir::replace_values(function, replacements);
+
+        statistics.propagated += count;
+        return count;
+    }
+
+
+    // Value numbering down the dominator tree.  What a block computes stays available to the
+    // blocks it dominates and is forgotten again once they're done with.  An instruction that
+    // could fail is only ever replaced by an earlier one that would have failed first.
+    size_t Optimizer::eliminate_common_subexpressions(ir::Function& function)
+    {
+        using Key = std::vector<uint32_t>;
+
+        auto idoms = ir::dominators(function);
+        std::vector<std::vector<ir::BlockId>> children(function.blocks.size());
+
+        for (ir::BlockId block = 1; block < function.blocks.size(); ++block)
+        {
+            if (idoms[block] != ir::no_id)
+            {
+                children[idoms[block]].push_back(block);
+            }
+        }
+
+        std::vector<ir::ValueId> replacements(function.instructions.size(), ir::no_id);
+        std::vector<bool> removed(function.instructions.size(), false);
+        std::map<Key, ir::ValueId> available;
+        std::vector<Key> added;
+        size_t count = 0;
+
+        auto resolve = [&](ir::ValueId value)
+            {
+                return ((value != ir::no_id) && (replacements[value] != ir::no_id))
+                    ? replacements[value]
+                    : value;
+            };
+
+        auto key_of = [&](ir::Instruction const& instruction)
+            {
+                Key key
+                    {
+                        static_cast<uint32_t>(instruction.opcode),
+                        instruction.flags,
+                        static_cast<uint32_t>(instruction.type),
+                        resolve(instruction.a),
+                        resolve(instruction.b),
+                        instruction.immediate,
+                        instruction.extra
+                    };
+
+                for (auto operand : function.operands_of(instruction))
+                {
+                    key.push_back(resolve(operand));
+                }
+
+                return key;
+            };
+
+        auto number_block = [&](ir::BlockId block)
+            {
+                std::map<Key, ir::ValueId> reads;
+
+                for (auto id : function.blocks[block].instructions)
+                {
+                    auto const& instruction = function[id];
+                    auto reuse = reuse_of(unit->callees, instruction);
+
+                    if (reuse == Reuse::Never)
+                    {
+                        if (ir::has_side_effects(instruction.opcode))
+                        {
+                            reads.clear();
+                        }
+
+                        continue;
+                    }
+
+                    auto key = key_of(instruction);
+                    auto& values = (reuse == Reuse::Dominated) ? available : reads;
+
+                    if (auto found = values.find(key); found != values.end())
+                    {
+                        replacements[id] = found->second;
+                        removed[id] = true;
+                        ++count;
+                    }
+                    else
+                    {
+                        if (reuse == Reuse::Dominated)
+                        {
+                            added.push_back(key);
+                        }
+
+                        values.emplace(std::move(key), id);
+                    }
+                }
+            };
+
+        // Each block is visited on the way down the tree, and what it added is dropped on the way
+        // back up.
+        struct Visit
+        {
+            ir::BlockId block;
+            size_t mark;
+            bool is_leaving;
+        };
+
+        std::vector<Visit> stack { { 0, 0, false } };
+
+        while (!stack.empty())
+        {
+            auto visit = stack.back();
+            stack.pop_back();
+
+            if (visit.is_leaving)
+            {
+                for (; added.size() > visit.mark; added.pop_back())
+                {
+                    available.erase(added.back());
+                }
+
+                continue;
+            }
+
+            stack.push_back({ visit.block, added.size(), true });
+            number_block(visit.block);
+
+            for (auto child : children[visit.block])
+            {
+                stack.push_back({ child, 0, false });
+            }
+        }
+
+        ir::replace_values(function, replacements);
+        ir::remove_instructions(function, removed);
+
+        statistics.common += count;
+        return count;
+    }
+
+
+    size_t Optimizer::simplify_branches(ir::Function& function)
+    {
+        size_t changes = 0;
+
+        for (auto const& block : function.blocks)
+        {
+            auto& terminator = function[block.instructions.back()];
+            auto target = ir::no_id;
+
+            if (terminator.opcode == ir::Opcode::Branch)
+            {
+                if (auto condition = constant_of(function, terminator.a); condition)
+                {
+                    target = std::get<uint64_t>(condition->value) ? terminator.immediate
+                                                                  : terminator.extra;
+                }
+                else if (terminator.immediate == terminator.extra)
+                {
+                    target = terminator.immediate;
+                }
+            }
+            else if (terminator.opcode == ir::Opcode::Switch)
+            {
+                if (auto value = constant_of(function, terminator.a); value)
+                {
+                    target = terminator.immediate;
+
+                    for (auto const& switch_case : function.cases_of(terminator))
+                    {
+                        if (function.constants[switch_case.constant] == value.value())
+                        {
+                            target = switch_case.target;
+                            break;
+                        }
+                    }
+                }
+            }
+
+            if (target != ir::no_id)
+            {
+                terminator = ir::Instruction { .opcode = ir::Opcode::Jump, .immediate = target };
+
+                ++statistics.branches;
+                ++changes;
+            }
+        }
+
+        // Blocks that only jump on are skipped over.  The entry block always stays first.
+        std::vector<ir::BlockId> forward(function.blocks.size(), ir::no_id);
+
+        for (ir::BlockId block = 1; block < function.blocks.size(); ++block)
+        {
+            auto const& body = function.blocks[block].instructions;
+
+            if ((body.size() == 1) && (function[body.front()].opcode == ir::Opcode::Jump))
+            {
+                forward[block] = function[body.front()].immediate;
+            }
+        }
+
+        auto resolve = [&](ir::BlockId block)
+            {
+                // Bounded, as a loop made only of empty blocks would never end.
+                for (size_t steps = 0;
+                     (forward[block] != ir::no_id) && (steps < forward.size());
+                     ++steps)
+                {
+                    block = forward[block];
+                }
+
+                return block;
+            };
+
+        auto retarget = [&](uint32_t& target)
+            {
+                auto resolved = resolve(target);
+
+                if (resolved != target)
+                {
+                    target = resolved;
+                    ++changes;
+                }
+            };
+
+        for (auto const& block : function.blocks)
+        {
+            auto& terminator = function[block.instructions.back()];
+
+            switch (terminator.opcode)
+            {
+                case ir::Opcode::Jump:
+                    retarget(terminator.immediate);
+                    break;
+
+                case ir::Opcode::Branch:
+                    retarget(terminator.immediate);
+                    retarget(terminator.extra);
+                    break;
+
+                case ir::Opcode::Switch:
+                    retarget(terminator.immediate);
+
+                    for (uint32_t i = 0; i < terminator.count; ++i)
+                    {
+                        retarget(function.cases[terminator.first + i].target);
+                    }
+                    break;
+
+                default:
+                    break;
+            }
+        }
+
+        auto before = function.blocks.size();
+        ir::remove_unreachable_blocks(function);
+
+        // A block that's the only way into the block it jumps to absorbs it.
+        auto predecessors = ir::predecessors(function);
+
+        for (ir::BlockId block = 0; block < function.blocks.size(); ++block)
+        {
+            auto& body = function.blocks[block].instructions;
+
+            while (!body.empty() && (function[body.back()].opcode == ir::Opcode::Jump))
+            {
+                auto target = function[body.back()].immediate;
+
+                if ((target == block) || (target == 0) || (predecessors[target].size() != 1))
+                {
+                    break;
+                }
+
+                auto& absorbed = function.blocks[target].instructions;
+
+                body.pop_back();
+                body.insert(body.end(), absorbed.begin(), absorbed.end());
+                absorbed.clear();
+
+                for (auto successor : function.successors(block))
+                {
+                    std::replace(predecessors[successor].begin(),
+                                 predecessors[successor].end(),
+                                 target,
+                                 block);
+                }
+
+                ++changes;
+            }
+        }
+
+        ir::remove_unreachable_blocks(function);
+
+        statistics.blocks += before - function.blocks.size();
+        changes += before - function.blocks.size();
+
+        return changes;
+    }
+
+
+    // The checks the lowering couldn't prove redundant from the source, which are those of indices
+    // that only become known once values are propagated, along with masked indices and indices of
+    // types too small to reach past the end of their array.
+    size_t Optimizer::eliminate_bounds_checks(ir::Function& function)
+    {
+        auto const& context = typing::get_type_context();
+
+        RangeAnalysis ranges(function);
+        size_t count = 0;
+
+        for (auto const& block : function.blocks)
+        {
+            for (auto id : block.instructions)
+            {
+                auto& instruction = function[id];
+
+                if (!(instruction.flags & ir::BoundsChecked))
+                {
+                    continue;
+                }
+
+                auto size = context.get(context.element_of(function[instruction.a].type)).count;
+
+                if (   auto range = ranges.range_of(instruction.b);
+                       range && ir::is_within(range.value(), size))
+                {
+                    instruction.flags &= ~ir::BoundsChecked;
+                    ++count;
+                }
+            }
+        }
+
+        statistics.checks += count;
+        return count;
+    }
+
+
+    size_t Optimizer::eliminate_dead_stores(ir::Function& function)
+    {
+        auto slots = analyze_slots(function);
+
+        std::vector<bool> removed(function.instructions.size(), false);
+        size_t count = 0;
+
+        for (auto const& slot : slots)
+        {
+            if (slot.is_simple && slot.loads.empty())
+            {
+                for (auto store : slot.stores)
+                {
+                    removed[store] = true;
+                    ++count;
+                }
+            }
+        }
+
+        // A store overwritten in the same block before anything reads it is dead too.
+        for (auto const& block : function.blocks)
+        {
+            std::unordered_map<uint32_t, ir::ValueId> pending;
+
+            for (auto id : block.instructions)
+            {
+                auto const& instruction = function[id];
+                auto slot = slot_of(function, instruction.a);
+
+                if ((slot == ir::no_id) || !slots[slot].is_simple)
+                {
+                    continue;
+                }
+
+                if (   (instruction.opcode == ir::Opcode::Store)
+                    || (instruction.opcode == ir::Opcode::Clear))
+                {
+                    if (auto found = pending.find(slot);
+                        (found != pending.end()) && !removed[found->second])
+                    {
+                        removed[found->second] = true;
+                        ++count;
+                    }
+
+                    pending[slot] = id;
+                }
+                else if (instruction.opcode == ir::Opcode::Load)
+                {
+                    pending.erase(slot);
+                }
+            }
+        }
+
+        ir::remove_instructions(function, removed);
+
+        statistics.stores += count;
+        return count;
+    }
+
+
+    size_t Optimizer::eliminate_dead_code(ir::Function& function)
+    {
+        std::vector<bool> live(function.instructions.size(), false);
+        std::vector<ir::ValueId> work;
+
+        auto mark = [&](ir::ValueId value)
+            {
+                if ((value != ir::no_id) && !live[value])
+                {
+                    live[value] = true;
+                    work.push_back(value);
+                }
+            };
+
+        for (auto const& block : function.blocks)
+        {
+            for (auto id : block.instructions)
+            {
+                if (is_effectful(function, unit->callees, function[id]))
+                {
+                    mark(id);
+                }
+            }
+        }
+
+        while (!work.empty())
+        {
+            auto const& instruction = function[work.back()];
+            work.pop_back();
+
+            mark(instruction.a);
+            mark(instruction.b);
+
+            for (auto operand : function.operands_of(instruction))
+            {
+                mark(operand);
+            }
+        }
+
+        std::vector<bool> removed(function.instructions.size(), false);
+        size_t count = 0;
+
+        for (auto const& block : function.blocks)
+        {
+            for (auto id : block.instructions)
+            {
+                if (!live[id])
+                {
+                    removed[id] = true;
+                    ++count;
+                }
+            }
+        }
+
+        ir::remove_instructions(function, removed);
+
+        statistics.instructions += count;
+        return count;
+    }
+
+
+    size_t Optimizer::hoist_invariants(ir::Function& function)
+    {
+        size_t count = 0;
+        auto loops = ir::find_loops(function);
+
+        // Inner loops come first, so what leaves them can go on to leave the loops around them.
+        for (size_t i = 0; i < loops.size(); ++i)
+        {
+            if (auto hoisted = hoist_out_of(function, unit->callees, loops[i]); hoisted > 0)
+            {
+                count += hoisted;
+                loops = ir::find_loops(function);
+            }
+        }
+
+        statistics.hoisted += count;
+        return count;
+    }
+
+
+    size_t Optimizer::reduce_strength(ir::Function& function)
+    {
+        size_t count = 0;
+        auto loops = ir::find_loops(function);
+
+        for (size_t i = 0; i < loops.size(); )
+        {
+            if (auto reduced = reduce_in(function, loops[i]); reduced > 0)
+            {
+                count += reduced;
+                loops = ir::find_loops(function);
+            }
+            else
+            {
+                ++i;
+            }
+        }
+
+        statistics.reduced += count;
+        return count;
+    }
+
+
+}
@@ -0,0 +1,116 @@
+
+#pragma once
+
+
+namespace basically::runtime::optimizing
+{
+
+
+    // The cheap cleanups run on the IR before it's handed to the JIT, in the order they're listed.
+    enum class Pass : uint8_t
+    {
+        // Evaluate operations, and calls to pure functions, whose operands are all constants.
+        FoldConstants,
+
+        // Replace loads of variables with the value last stored to them, where that's known.
+        PropagateVariables,
+
+        // Reuse the value of an earlier calculation, or of a call to a function without effects,
+        // in place of doing the same thing again where the earlier one always runs first.
+        EliminateCommonSubexpressions,
+
+        // Drop the checks of subscripts whose values are known to be in their array's range.
+        EliminateBoundsChecks,
+
+        // Turn branches on constants into jumps, then drop the blocks no longer reachable and
+        // merge the straight line runs that remain.
+        SimplifyBranches,
+
+        // Remove stores to variables that are never read afterwards.
+        EliminateDeadStores,
+
+        // Remove instructions whose values are never used and that have no effect of their own.
+        EliminateDeadCode,
+
+        // Move the calculations that give the same value on every trip around a loop out in front
+        // of it.
+        HoistInvariants,
+
+        // Replace multiples of a loop's index, and the addresses of the elements it indexes, with
+        // variables stepped along with the index.
+        ReduceStrength
+    };
+
+
+    using PassList = std::vector<Pass>;
+
+
+    std::ostream& operator <<(std::ostream& stream, Pass pass);
+
+
+    PassList default_passes();
+
+    // A comma separated list of pass names, such as "fold,propagate,dead-code".
+    PassList parse_passes(std::string const& names);
+
+
+    struct Statistics
+    {
+        size_t folded = 0;
+        size_t propagated = 0;
+        size_t common = 0;
+        size_t branches = 0;
+        size_t blocks = 0;
+        size_t stores = 0;
+        size_t instructions = 0;
+        size_t hoisted = 0;
+        size_t reduced = 0;
+        size_t checks = 0;
+    };
+
+
+    std::ostream& operator <<(std::ostream& stream, Statistics const& statistics);
+
+
+    // Runs the passes over every function of a unit, over and over until none of them finds
+    // anything more to do.
+    class Optimizer
+    {
+        private:
+            PassList passes;
+            Statistics statistics;
+
+            // The unit being optimized, for what its calls go to.
+            ir::Unit const* unit = nullptr;
+
+        public:
+            Optimizer(PassList const& new_passes);
+            Optimizer(Optimizer const& optimizer) = delete;
+            Optimizer(Optimizer&& optimizer) = delete;
+            ~Optimizer() = default;
+
+        public:
+            Optimizer& operator =(Optimizer const& optimizer) = delete;
+            Optimizer& operator =(Optimizer&& optimizer) = delete;
+
+        public:
+            void optimize(ir::Unit& unit);
+
+            Statistics const& get_statistics() const noexcept;
+
+        private:
+            bool run(Pass pass, ir::Function& function);
+
+            size_t fold_constants(ir::Function& function);
+            size_t propagate_variables(ir::Function& function);
+            size_t eliminate_common_subexpressions(ir::Function& function);
+            size_t eliminate_bounds_checks(ir::Function& function);
+            size_t simplify_branches(ir::Function& function);
+            size_t eliminate_dead_stores(ir::Function& function);
+            size_t eliminate_dead_code(ir::Function& function);
+            size_t hoist_invariants(ir::Function& function);
+            size_t reduce_strength(ir::Function& function);
+    };
+
+
+}
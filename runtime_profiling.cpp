@@ -0,0 +1,239 @@
+#include "basically.h"
+
+
+namespace basically::runtime::profiling
+{
+
+
+    namespace
+    {
+
+
+        // Fewer times than this and a branch could have gone either way by chance.
+        const uint64_t min_branch_reached = 100;
+
+        // A branch is expected to go the way it went at least this many times in twenty.
+        const uint64_t expected_in_twenty = 19;
+
+        // A call is hot if it was made at least this fraction of the times the most frequent one
+        // was.
+        const uint64_t hot_call_divisor = 100;
+
+        // Calls and loop iterations across the whole of a module for it to be hot.
+        const uint64_t hot_module_work = 1000000;
+
+
+    }
+
+
+    std::optional<Profile> Profile::load(std::fs::path const& path)
+    {
+        std::ifstream file(path);
+
+        if (!file)
+        {
+            return std::nullopt;
+        }
+
+        Profile profile;
+        std::string line;
+
+        while (std::getline(file, line))
+        {
+            std::istringstream fields(line);
+            std::string kind;
+            std::string name;
+            uint64_t first = 0;
+            uint64_t second = 0;
+
+            fields >> kind >> first;
+
+            if ((kind == "function") || (kind == "branch"))
+            {
+                fields >> second;
+            }
+
+            fields >> name;
+
+            if (fields.fail() || name.empty())
+            {
+                return std::nullopt;
+            }
+
+            if (kind == "function")
+            {
+                profile.count_function(name, first, second);
+            }
+            else if (kind == "branch")
+            {
+                profile.count_branch(name, first, second);
+            }
+            else if (kind == "call")
+            {
+                profile.count_call(name, first);
+            }
+            else
+            {
+                return std::nullopt;
+            }
+        }
+
+        return profile;
+    }
+
+
+    void Profile::save(std::fs::path const& path) const
+    {
+        std::ofstream file(path);
+
+        file << *this;
+
+        if (!file.flush())
+        {
+            throw std::runtime_error("Could not write the profile " + path.string() + ".");
+        }
+    }
+
+
+    bool Profile::is_empty() const noexcept
+    {
+        return functions.empty() && branches.empty() && calls.empty();
+    }
+
+
+    void Profile::count_function(std::string const& name, uint64_t calls, uint64_t iterations)
+    {
+        auto& counts = functions[name];
+
+        counts.calls += calls;
+        counts.iterations += iterations;
+    }
+
+
+    // Copies of a branch inlined in more than one place are all counted under the one site.
+    void Profile::count_branch(std::string const& site, uint64_t taken, uint64_t reached)
+    {
+        auto& counts = branches[site];
+
+        counts.taken += taken;
+        counts.reached += reached;
+    }
+
+
+    void Profile::count_call(std::string const& site, uint64_t count)
+    {
+        auto& counted = calls[site];
+
+        counted += count;
+        hottest_call = std::max(hottest_call, counted);
+    }
+
+
+    void Profile::merge(Profile const& profile)
+    {
+        for (auto const& [ name, counts ] : profile.functions)
+        {
+            count_function(name, counts.calls, counts.iterations);
+        }
+
+        for (auto const& [ site, counts ] : profile.branches)
+        {
+            count_branch(site, counts.taken, counts.reached);
+        }
+
+        for (auto const& [ site, count ] : profile.calls)
+        {
+            count_call(site, count);
+        }
+    }
+
+
+    OptionalBool Profile::expected_branch(std::string const& site) const
+    {
+        auto found = branches.find(site);
+
+        if ((found == branches.end()) || (found->second.reached < min_branch_reached))
+        {
+            return std::nullopt;
+        }
+
+        auto const& counts = found->second;
+
+        if (counts.taken * 20 >= counts.reached * expected_in_twenty)
+        {
+            return true;
+        }
+
+        if ((counts.reached - counts.taken) * 20 >= counts.reached * expected_in_twenty)
+        {
+            return false;
+        }
+
+        return std::nullopt;
+    }
+
+
+    std::optional<uint64_t> Profile::calls_at(std::string const& site) const
+    {
+        auto found = calls.find(site);
+
+        if (found == calls.end())
+        {
+            return std::nullopt;
+        }
+
+        return found->second;
+    }
+
+
+    bool Profile::is_hot_call(std::string const& site) const
+    {
+        auto count = calls_at(site);
+        return count && (*count > 0) && (*count * hot_call_divisor >= hottest_call);
+    }
+
+
+    bool Profile::is_cold(std::string const& name) const
+    {
+        auto found = functions.find(name);
+        return (found != functions.end()) && (found->second.calls == 0);
+    }
+
+
+    bool Profile::is_hot() const
+    {
+        uint64_t work = 0;
+
+        for (auto const& [ name, counts ] : functions)
+        {
+            work += counts.calls + counts.iterations;
+        }
+
+        return work >= hot_module_work;
+    }
+
+
+    // A line for each function, branch and call, with its counts ahead of its name.
+    std::ostream& operator <<(std::ostream& stream, Profile const& profile)
+    {
+        for (auto const& [ name, counts ] : profile.functions)
+        {
+            stream << "function " << counts.calls << " " << counts.iterations << " " << name
+                   << "\n";
+        }
+
+        for (auto const& [ site, counts ] : profile.branches)
+        {
+            stream << "branch " << counts.taken << " " << counts.reached << " " << site << "\n";
+        }
+
+        for (auto const& [ site, count ] : profile.calls)
+        {
+            stream << "call " << count << " " << site << "\n";
+        }
+
+        return stream;
+    }
+
+
+}
@@ -0,0 +1,84 @@
+
+#pragma once
+
+
+// What a module's code did when it ran: how often each function was called and went around its
+// loops, which way each branch went and how often each call was made.  Code compiled to count all
+// of that adds it to the module's profile once the script has run, and the profile then guides
+// how the module is compiled from then on.
+//
+// Branches and calls are known by their IR sites, functions by their IR names.
+namespace basically::runtime::profiling
+{
+
+
+    class Profile;
+
+    // The text save writes, which is also what the profile adds to a module's cache key.
+    std::ostream& operator <<(std::ostream& stream, Profile const& profile);
+
+
+    class Profile
+    {
+        public:
+            struct FunctionCounts
+            {
+                uint64_t calls = 0;
+                uint64_t iterations = 0;
+            };
+
+            struct BranchCounts
+            {
+                uint64_t taken = 0;
+                uint64_t reached = 0;
+            };
+
+        private:
+            // Ordered, so that the same counts always read back as the same text.
+            std::map<std::string, FunctionCounts> functions;
+            std::map<std::string, BranchCounts> branches;
+            std::map<std::string, uint64_t> calls;
+
+            uint64_t hottest_call = 0;
+
+        public:
+            // Read a profile written by save.  Nothing if there isn't one, or it can't be read,
+            // in which case the module is simply compiled without.
+            static std::optional<Profile> load(std::fs::path const& path);
+
+            void save(std::fs::path const& path) const;
+
+        public:
+            bool is_empty() const noexcept;
+
+            void count_function(std::string const& name, uint64_t calls, uint64_t iterations);
+            void count_branch(std::string const& site, uint64_t taken, uint64_t reached);
+            void count_call(std::string const& site, uint64_t count);
+
+            void merge(Profile const& profile);
+
+        public:
+            // Which way a branch went nearly every time it was reached, if it was reached often
+            // enough to tell.
+            OptionalBool expected_branch(std::string const& site) const;
+
+            // How many times a call was made, nothing if it wasn't profiled at all.
+            std::optional<uint64_t> calls_at(std::string const& site) const;
+
+            // Whether a call was made at least a hundredth as often as the most frequent call in
+            // the profile.
+            bool is_hot_call(std::string const& site) const;
+
+            // A function that was profiled and never called.
+            bool is_cold(std::string const& name) const;
+
+            // Whether the module's code ran long enough for gcc to be worth spending more time
+            // on.
+            bool is_hot() const;
+
+        public:
+            friend std::ostream& operator <<(std::ostream& stream, Profile const& profile);
+    };
+
+
+}
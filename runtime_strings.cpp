@@ -0,0 +1,236 @@
+#include "basically.h"
+
+
+namespace basically::runtime::strings
+{
+
+
+    namespace
+    {
+
+
+        // Collect once this much has been built since the last time, or as much again as was
+        // still in use after it, whichever is more.
+        const size_t min_collected_size = 1024 * 1024;
+
+
+        struct Block
+        {
+            std::unique_ptr<char[]> text;
+            size_t size;
+
+            bool is_reached = false;
+        };
+
+
+        struct Heap
+        {
+            // By address, so that a pointer anywhere into a string finds it.
+            std::map<uintptr_t, Block> blocks;
+
+            std::map<void const*, size_t> roots;
+
+            // Where the outermost Running is, null while no code is running.
+            void const* stack_top = nullptr;
+
+            size_t built = 0;
+            size_t in_use = 0;
+        };
+
+
+        Heap& get_heap() noexcept
+        {
+            static Heap heap;
+            return heap;
+        }
+
+
+        char const* text_of(char const* text) noexcept
+        {
+            return text ? text : "";
+        }
+
+
+        // At every byte offset, as the fields of [packed] structures can be anywhere.
+        void reach_from(Heap& heap, void const* start, size_t size) noexcept
+        {
+            if (heap.blocks.empty() || (size < sizeof(uintptr_t)))
+            {
+                return;
+            }
+
+            auto lowest = heap.blocks.begin()->first;
+            auto const& [ last, last_block ] = *heap.blocks.rbegin();
+            auto highest = last + last_block.size;
+
+            auto bytes = static_cast<uint8_t const*>(start);
+
+            for (size_t offset = 0; offset + sizeof(uintptr_t) <= size; ++offset)
+            {
+                uintptr_t pointer;
+                std::memcpy(&pointer, bytes + offset, sizeof(pointer));
+
+                if ((pointer < lowest) || (pointer >= highest))
+                {
+                    continue;
+                }
+
+                auto found = std::prev(heap.blocks.upper_bound(pointer));
+
+                if (pointer < found->first + found->second.size)
+                {
+                    found->second.is_reached = true;
+                }
+            }
+        }
+
+
+        // Whoever calls this has to have its callee saved registers on the stack by then, so
+        // that the strings only they point to are found.  Everything from this frame up to the
+        // outermost Running is looked through, along with the roots and the strings given.
+        [[gnu::noinline]]
+        void collect(Heap& heap, char const* a, char const* b) noexcept
+        {
+            if (heap.stack_top)
+            {
+                auto bottom = static_cast<uint8_t const*>(__builtin_frame_address(0));
+                auto top = static_cast<uint8_t const*>(heap.stack_top);
+
+                reach_from(heap, bottom, top - bottom);
+            }
+
+            for (auto const& [ address, size ] : heap.roots)
+            {
+                reach_from(heap, address, size);
+            }
+
+            reach_from(heap, &a, sizeof(a));
+            reach_from(heap, &b, sizeof(b));
+
+            heap.in_use = 0;
+
+            for (auto iterator = heap.blocks.begin(); iterator != heap.blocks.end(); )
+            {
+                auto& block = iterator->second;
+
+                if (!block.is_reached)
+                {
+                    iterator = heap.blocks.erase(iterator);
+                    continue;
+                }
+
+                block.is_reached = false;
+                heap.in_use += block.size;
+
+                ++iterator;
+            }
+
+            heap.built = 0;
+        }
+
+
+    }
+
+
+    char const* concatenate(char const* a, char const* b)
+    {
+        auto& heap = get_heap();
+
+        // Only collected while code's running, as only then is it known how much of the stack to
+        // look through.
+        if (heap.stack_top && (heap.built > std::max(min_collected_size, heap.in_use)))
+        {
+            __builtin_unwind_init();
+            collect(heap, a, b);
+        }
+
+        auto text_a = text_of(a);
+        auto text_b = text_of(b);
+        auto size_a = std::strlen(text_a);
+        auto size_b = std::strlen(text_b);
+        auto size = size_a + size_b + 1;
+
+        auto text = std::make_unique<char[]>(size);
+
+        std::memcpy(text.get(), text_a, size_a);
+        std::memcpy(text.get() + size_a, text_b, size_b + 1);
+
+        auto address = reinterpret_cast<uintptr_t>(text.get());
+
+        heap.blocks.emplace(address, Block { .text = std::move(text), .size = size });
+        heap.built += size;
+
+        return reinterpret_cast<char const*>(address);
+    }
+
+
+    bool holds_strings(typing::TypeId type)
+    {
+        auto const& types = typing::get_type_context();
+
+        if (types.is_string(type))
+        {
+            return true;
+        }
+
+        if (types.is_array(type))
+        {
+            return holds_strings(types.element_of(type));
+        }
+
+        if (auto structure = types.structure_info(type); structure)
+        {
+            return std::any_of(structure->fields.begin(),
+                               structure->fields.end(),
+                               [](auto const& field) { return holds_strings(field.type.id); });
+        }
+
+        return false;
+    }
+
+
+    Root::Root(void const* new_address, size_t size)
+    : address(size > 0 ? new_address : nullptr)
+    {
+        if (address)
+        {
+            get_heap().roots.emplace(address, size);
+        }
+    }
+
+
+    Root::~Root() noexcept
+    {
+        if (address)
+        {
+            get_heap().roots.erase(address);
+        }
+    }
+
+
+    Running::Running() noexcept
+    : is_outermost(get_heap().stack_top == nullptr)
+    {
+        if (is_outermost)
+        {
+            get_heap().stack_top = this;
+        }
+    }
+
+
+    // Nothing is left on the stack to hold a string once the outermost run is over.
+    Running::~Running() noexcept
+    {
+        if (!is_outermost)
+        {
+            return;
+        }
+
+        auto& heap = get_heap();
+
+        heap.stack_top = nullptr;
+        collect(heap, nullptr, nullptr);
+    }
+
+
+}
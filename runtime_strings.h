@@ -0,0 +1,68 @@
+
+#pragma once
+
+
+// The strings code builds as it runs, by concatenating others.  Each is kept for as long as the
+// code can still reach it: from the globals of a module that has run, from memory the interpreter
+// is working in, or from the stack of the code that's running.  Once enough has been built since
+// the last time, everything that can't be reached any more is freed, and when the outermost run or
+// call into the code returns, everything the globals don't hold goes too.
+//
+// Compiled code's frames can't be read by type, so the stack and everything else is looked
+// through conservatively, and anything that happens to look like a pointer into a string keeps
+// it.  All of this happens on the one thread that runs the code.
+//
+// A program compiled on its own has no such heap, and keeps every string it builds until it
+// exits.
+namespace basically::runtime::strings
+{
+
+
+    // A new string of the text of one followed by the other, either of which can be null for the
+    // empty string.
+    char const* concatenate(char const* a, char const* b);
+
+
+    // Whether a value of the type holds a string, itself or in any of its fields or elements.
+    bool holds_strings(typing::TypeId type);
+
+
+    // Memory other than the stack that can hold strings, such as a module's globals or the
+    // interpreter's frames, looked through for as long as the Root is kept.
+    class Root
+    {
+        private:
+            void const* address;
+
+        public:
+            Root(void const* new_address, size_t size);
+            Root(Root const& root) = delete;
+            Root(Root&& root) = delete;
+            ~Root() noexcept;
+
+        public:
+            Root& operator =(Root const& root) = delete;
+            Root& operator =(Root&& root) = delete;
+    };
+
+
+    // Kept on the stack wherever the code is entered from outside of it, as the outermost one
+    // marks how far up the stack is looked through.
+    class Running
+    {
+        private:
+            bool is_outermost;
+
+        public:
+            Running() noexcept;
+            Running(Running const& running) = delete;
+            Running(Running&& running) = delete;
+            ~Running() noexcept;
+
+        public:
+            Running& operator =(Running const& running) = delete;
+            Running& operator =(Running&& running) = delete;
+    };
+
+
+}
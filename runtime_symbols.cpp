@@ -0,0 +1,708 @@
+
+#include "basically.h"
+
+
+namespace basically::runtime::symbols
+{
+
+
+    namespace
+    {
+
+
+        // Entries in each [memoize]d function's table, a power of two.
+        const size_t memo_capacity = 1024;
+
+
+        template <typename ItemType>
+        bool is_public(ItemType const& item) noexcept
+        {
+            return typing::check_visibility<typing::Visibility::Public>(item->visibility,
+                                                                        typing::Visibility::Public);
+        }
+
+
+    }
+
+
+    std::string memo_table_name(std::string const& function_name, std::string const& table)
+    {
+        return "<" + function_name + "." + table + ">";
+    }
+
+
+    bool Symbol::is_global() const noexcept
+    {
+        return (kind == Kind::Variable) && (depth == 0);
+    }
+
+
+    bool Symbol::is_function() const noexcept
+    {
+        return kind == Kind::Function;
+    }
+
+
+    std::ostream& operator <<(std::ostream& stream, Symbol const& symbol)
+    {
+        switch (symbol.kind)
+        {
+            case Kind::Variable:
+                stream << "variable " << symbol.name
+                       << (symbol.is_global() ? " global " : " local ") << symbol.slot;
+                break;
+
+            case Kind::Sub:
+                stream << "sub " << symbol.name;
+                break;
+
+            case Kind::Function:
+                stream << "function " << symbol.name;
+                break;
+
+            case Kind::Conversion:
+                stream << "conversion to " << symbol.name;
+                break;
+        }
+
+        if (symbol.module != nullptr)
+        {
+            stream << " in " << symbol.module->get_name();
+        }
+
+        return stream;
+    }
+
+
+    Resolver::Resolver(modules::Module const& new_module)
+    : module(new_module)
+    {
+    }
+
+
+    void Resolver::resolve_type(typing::TypeRef& type) const
+    {
+        // Types left unnamed, like those of implicitly declared loop indices, are inferred later.
+        if (type.resolved_type || type.type_name.empty())
+        {
+            return;
+        }
+
+        find_type(type);
+
+        assert(type.resolved_type->id != typing::invalid_type_id);
+        type.id = type.resolved_type->id;
+    }
+
+
+    void Resolver::find_type(typing::TypeRef& type) const
+    {
+        if (auto found = module.find_type(type.type_name); found)
+        {
+            type.resolved_type = found;
+            return;
+        }
+
+        if (auto found = modules::get_builtins_module()->find_type(type.type_name); found)
+        {
+            type.resolved_type = found;
+            return;
+        }
+
+        for (auto const& [ alias, loaded ] : module.get_loaded_modules())
+        {
+            auto found = loaded->find_type(type.type_name);
+
+            if (!found || !is_public(found))
+            {
+                continue;
+            }
+
+            if (type.resolved_type && (type.resolved_type->id != found->id))
+            {
+                resolve_error(type.ref_location, "The type " + type.type_name + " is ambiguous.");
+            }
+
+            type.resolved_type = found;
+        }
+
+        if (!type.resolved_type)
+        {
+            resolve_error(type.ref_location, "Unknown type " + type.type_name + ".");
+        }
+    }
+
+
+    void Resolver::resolve_variable(variables::InfoPtr const& variable) const
+    {
+        resolve_type(variable->type);
+        variable->check_storage();
+
+        variable->type_id = variable->is_array()
+            ? typing::get_type_context().intern_array(
+                                      variable->type.id,
+                                      variable->array_count,
+                                      variable->storage == variables::Storage::StructureOfArrays)
+            : variable->type.id;
+    }
+
+
+    void Resolver::resolve_initializer(ast::StatementList const& statements,
+                                       variables::ScopePtr const& module_scope,
+                                       variables::FramePtr const& frame)
+    {
+        auto scope = std::make_shared<variables::Scope>(module_scope, frame);
+
+        for (auto const& statement : statements)
+        {
+            resolve_statement(statement, scope, true);
+        }
+    }
+
+
+    void Resolver::resolve_sub(typing::SubInfoPtr const& sub,
+                               variables::ScopePtr const& module_scope)
+    {
+        resolve_body(sub, module_scope, nullptr);
+    }
+
+
+    void Resolver::resolve_function(typing::FunctionInfoPtr const& function,
+                                    variables::ScopePtr const& module_scope)
+    {
+        resolve_type(function->return_type);
+        resolve_body(function, module_scope, &function->return_type);
+
+        // Memo tables hash their keys and compare them for equality.
+        if (function->is_memoized)
+        {
+            auto& context = typing::get_type_context();
+
+            for (auto const& parameter : function->parameters)
+            {
+                auto number = context.number_info(parameter.type.id);
+
+                if (   !context.is_string(parameter.type.id)
+                    && (   !number
+                        || (   number->is_floating_point
+                            == typing::FloatingPointFlag::IsFloatingPoint)))
+                {
+                    resolve_error(parameter.type.ref_location,
+                                  "Memoized functions only take integers and strings.");
+                }
+            }
+
+            // The table's columns are arrays among the module's globals, which start out zeroed,
+            // so with every entry unused.
+            auto add_table = [&](std::string const& table, typing::TypeRef const& type)
+                {
+                    auto variable = std::make_shared<variables::Info>(
+                                                        memo_table_name(function->name, table),
+                                                        "",
+                                                        memo_capacity,
+                                                        false);
+
+                    variable->type = type;
+                    variable->visibility = typing::Visibility::Private;
+                    resolve_variable(variable);
+
+                    module_scope->insert(variable);
+                };
+
+            add_table("used", typing::TypeRef("u8"));
+
+            for (size_t i = 0; i < function->parameters.size(); ++i)
+            {
+                add_table("key" + std::to_string(i), function->parameters[i].type);
+            }
+
+            add_table("result", function->return_type);
+        }
+    }
+
+
+    size_t Resolver::resolved() const noexcept
+    {
+        return resolved_count;
+    }
+
+
+    void Resolver::resolve_body(typing::SubInfoPtr const& sub,
+                                variables::ScopePtr const& module_scope,
+                                typing::TypeRef const* result_type)
+    {
+        auto scope = variables::make_frame_scope(module_scope);
+        sub->frame = scope->frame;
+
+        for (auto& parameter : sub->parameters)
+        {
+            resolve_type(parameter.type);
+
+            // Default values are evaluated by the caller, so they can only see the module.
+            resolve_optional(parameter.initializer, module_scope);
+
+            if (scope->variables.find(parameter.name) != scope->variables.end())
+            {
+                resolve_error(parameter.type.ref_location,
+                              "Duplicate definition for parameter, " + parameter.name + ".");
+            }
+
+            auto variable = std::make_shared<variables::Info>(parameter);
+
+            resolve_variable(variable);
+            scope->insert(variable);
+        }
+
+        // Functions hand back whatever was last assigned to their result variable.
+        if (result_type != nullptr)
+        {
+            auto result = std::make_shared<variables::Info>("result", "", 0, false);
+
+            result->type = *result_type;
+            result->visibility = typing::Visibility::Private;
+            resolve_variable(result);
+
+            scope->insert(result);
+        }
+
+        for (auto const& statement : sub->body)
+        {
+            resolve_statement(statement, scope, false);
+        }
+    }
+
+
+    void Resolver::resolve_block(ast::StatementList const& statements,
+                                 variables::ScopePtr const& parent)
+    {
+        auto scope = variables::make_scope(parent);
+
+        for (auto const& statement : statements)
+        {
+            resolve_statement(statement, scope, false);
+        }
+    }
+
+
+    void Resolver::resolve_statement(ast::Statement const& statement,
+                                     variables::ScopePtr const& scope,
+                                     bool is_module_level)
+    {
+        auto module_level_only = [&](auto const& declaration, std::string const& what)
+            {
+                if (!is_module_level)
+                {
+                    resolve_error(declaration->location,
+                                  "A " + what + " can only be declared at the top of a module.");
+                }
+            };
+
+        auto resolve_conditional = [&](ast::ConditionalBlock const& block)
+            {
+                auto const& [ test, body ] = block;
+
+                resolve_expression(test, scope);
+                resolve_block(body, scope);
+            };
+
+        std::visit(ast::StatementHandlers
+            {
+                .assignment_statement = [&](auto const& assignment)
+                    {
+                        resolve_optional(assignment->subscript, scope);
+                        resolve_expression(assignment->value, scope);
+                        bind(assignment->symbol, find_variable(assignment->name, scope));
+                    },
+
+                .do_statement = [&](auto const& do_loop)
+                    {
+                        resolve_expression(do_loop->test, scope);
+                        resolve_block(do_loop->body, scope);
+                    },
+
+                .for_statement = [&](auto const& for_loop)
+                    {
+                        resolve_expression(for_loop->start_index, scope);
+                        resolve_expression(for_loop->end_index, scope);
+                        resolve_optional(for_loop->step_value, scope);
+
+                        auto body_scope = variables::make_scope(scope);
+                        auto const& index_name = for_loop->index_name;
+
+                        // Loop over an existing variable if there is one, otherwise the index is
+                        // local to the loop.
+                        if (auto existing = scope->find(index_name.text); existing)
+                        {
+                            bind(for_loop->index_symbol, variable_symbol(existing, &module));
+                        }
+                        else
+                        {
+                            auto index = std::make_shared<variables::Info>(index_name.text,
+                                                                           "",
+                                                                           0,
+                                                                           false);
+
+                            index->type.ref_location = index_name.location;
+                            body_scope->insert(index);
+
+                            bind(for_loop->index_symbol, variable_symbol(index, &module));
+                        }
+
+                        for (auto const& body_statement : for_loop->body)
+                        {
+                            resolve_statement(body_statement, body_scope, false);
+                        }
+                    },
+
+                .function_declaration_statement = [&](auto const& declaration)
+                    {
+                        module_level_only(declaration, "function");
+                    },
+
+                .if_statement = [&](auto const& if_statement)
+                    {
+                        resolve_conditional(if_statement->main_block);
+
+                        for (auto const& block : if_statement->else_if_blocks)
+                        {
+                            resolve_conditional(block);
+                        }
+
+                        resolve_block(if_statement->else_block, scope);
+                    },
+
+                .load_statement = [&](auto const& load)
+                    {
+                        module_level_only(load, "module load");
+                    },
+
+                .loop_statement = [&](auto const& loop)
+                    {
+                        resolve_block(loop->body, scope);
+                    },
+
+                .select_statement = [&](auto const& select)
+                    {
+                        resolve_expression(select->test, scope);
+
+                        for (auto const& condition : select->conditions)
+                        {
+                            resolve_conditional(condition);
+                        }
+
+                        resolve_block(select->default_condition, scope);
+                    },
+
+                .structure_declaration_statement = [&](auto const& declaration)
+                    {
+                        module_level_only(declaration, "structure");
+                    },
+
+                .sub_call_statement = [&](auto const& call)
+                    {
+                        resolve_list(call->parameters, scope);
+                        bind(call->symbol, find_callable(call->name, false));
+                    },
+
+                .sub_declaration_statement = [&](auto const& declaration)
+                    {
+                        module_level_only(declaration, "sub");
+                    },
+
+                .variable_declaration_statement = [&](auto const& declaration)
+                    {
+                        if (!is_module_level)
+                        {
+                            declare_local(declaration, scope);
+                            return;
+                        }
+
+                        // Module level variables were all created by pass 1.
+                        auto global = module.find_global(declaration->name.text);
+                        assert(global);
+
+                        resolve_optional(declaration->initializer, scope);
+                        bind(declaration->symbol, variable_symbol(global, &module));
+                    }
+            },
+            statement);
+    }
+
+
+    void Resolver::resolve_expression(ast::Expression const& expression,
+                                      variables::ScopePtr const& scope)
+    {
+        std::visit(ast::ExpressionHandlers
+            {
+                .literal_expression = [&](auto const& literal)
+                    {
+                    },
+
+                .variable_read_expression = [&](auto const& read)
+                    {
+                        resolve_optional(read->subscript, scope);
+                        bind(read->symbol, find_variable(read->name, scope));
+                    },
+
+                .prefix_expression = [&](auto const& prefix)
+                    {
+                        resolve_expression(prefix->expression, scope);
+                    },
+
+                .binary_expression = [&](auto const& binary)
+                    {
+                        resolve_expression(binary->lhs, scope);
+                        resolve_expression(binary->rhs, scope);
+                    },
+
+                .postfix_expression = [&](auto const& postfix)
+                    {
+                        resolve_expression(postfix->expression, scope);
+                    },
+
+                .function_call_expression = [&](auto const& call)
+                    {
+                        resolve_list(call->parameters, scope);
+
+                        auto conversion = find_conversion(call->name);
+                        bind(call->symbol, conversion ? conversion
+                                                      : find_callable(call->name, true));
+                    }
+            },
+            expression);
+    }
+
+
+    void Resolver::resolve_optional(ast::OptionalExpression const& expression,
+                                    variables::ScopePtr const& scope)
+    {
+        if (expression)
+        {
+            resolve_expression(expression.value(), scope);
+        }
+    }
+
+
+    void Resolver::resolve_list(ast::ExpressionList const& expressions,
+                                variables::ScopePtr const& scope)
+    {
+        for (auto const& expression : expressions)
+        {
+            resolve_expression(expression, scope);
+        }
+    }
+
+
+    void Resolver::declare_local(ast::VariableDeclarationStatementPtr const& statement,
+                                 variables::ScopePtr const& scope)
+    {
+        auto const& name = statement->name;
+
+        // The initializer is resolved first, as the new name isn't visible until after the
+        // declaration.
+        resolve_optional(statement->initializer, scope);
+
+        if (scope->variables.find(name.text) != scope->variables.end())
+        {
+            resolve_error(name.location, "Duplicate definition for variable, " + name.text + ".");
+        }
+
+        auto variable = std::make_shared<variables::Info>(statement);
+
+        variable->visibility = typing::Visibility::Private;
+        resolve_variable(variable);
+
+        scope->insert(variable);
+        bind(statement->symbol, variable_symbol(variable, &module));
+    }
+
+
+    SymbolPtr Resolver::find_variable(lexing::Token const& name,
+                                      variables::ScopePtr const& scope)
+    {
+        if (auto variable = scope->find(name.text); variable)
+        {
+            return variable_symbol(variable, &module);
+        }
+
+        SymbolPtr found;
+
+        for (auto const& [ alias, loaded ] : module.get_loaded_modules())
+        {
+            auto global = loaded->find_global(name.text);
+
+            if (!global || !is_public(global))
+            {
+                continue;
+            }
+
+            if (found && (found->variable != global))
+            {
+                resolve_error(name.location, "The variable " + name.text + " is ambiguous.");
+            }
+
+            found = variable_symbol(global, loaded.get());
+        }
+
+        if (!found)
+        {
+            resolve_error(name.location, "Undefined variable " + name.text + ".");
+        }
+
+        return found;
+    }
+
+
+    SymbolPtr Resolver::find_callable(lexing::Token const& name, bool needs_result)
+    {
+        auto search = [&](modules::Module const& candidate, bool is_local) -> SymbolPtr
+            {
+                if (auto function = candidate.find_function(name.text);
+                    function && (is_local || is_public(function)))
+                {
+                    return sub_symbol(function, &candidate, true);
+                }
+
+                if (auto sub = candidate.find_sub(name.text); sub && (is_local || is_public(sub)))
+                {
+                    return sub_symbol(sub, &candidate, false);
+                }
+
+                return nullptr;
+            };
+
+        auto found = search(module, true);
+
+        if (!found)
+        {
+            for (auto const& [ alias, loaded ] : module.get_loaded_modules())
+            {
+                auto candidate = search(*loaded, false);
+
+                if (!candidate)
+                {
+                    continue;
+                }
+
+                if (found && (found->sub != candidate->sub))
+                {
+                    resolve_error(name.location, "The call to " + name.text + " is ambiguous.");
+                }
+
+                found = candidate;
+            }
+        }
+
+        if (!found)
+        {
+            resolve_error(name.location, "Undefined sub or function " + name.text + ".");
+        }
+
+        if (needs_result && !found->is_function())
+        {
+            resolve_error(name.location, "The sub " + name.text + " does not return a value.");
+        }
+
+        return found;
+    }
+
+
+    SymbolPtr Resolver::find_conversion(lexing::Token const& name)
+    {
+        auto& symbol = conversion_symbols[name.text];
+
+        if (!symbol)
+        {
+            // Structure types can share names with functions, only builtin types are conversions.
+            auto found = modules::get_builtins_module()->find_type(name.text);
+
+            if (!found)
+            {
+                return nullptr;
+            }
+
+            symbol = std::make_shared<Symbol>(Symbol
+                {
+                    .kind = Kind::Conversion,
+                    .name = name.text,
+                    .type = found
+                });
+        }
+
+        return symbol;
+    }
+
+
+    SymbolPtr Resolver::variable_symbol(variables::InfoPtr const& variable,
+                                        modules::Module const* owner)
+    {
+        auto& symbol = variable_symbols[variable.get()];
+
+        if (!symbol)
+        {
+            symbol = std::make_shared<Symbol>(Symbol
+                {
+                    .kind = Kind::Variable,
+                    .name = variable->name,
+                    .module = owner,
+                    .depth = variable->depth,
+                    .slot = variable->slot,
+                    .variable = variable
+                });
+        }
+
+        return symbol;
+    }
+
+
+    SymbolPtr Resolver::sub_symbol(typing::SubInfoPtr const& sub,
+                                   modules::Module const* owner,
+                                   bool is_function)
+    {
+        auto& symbol = sub_symbols[sub.get()];
+
+        if (!symbol)
+        {
+            symbol = std::make_shared<Symbol>(Symbol
+                {
+                    .kind = is_function ? Kind::Function : Kind::Sub,
+                    .name = sub->name,
+                    .module = owner,
+                    .sub = sub
+                });
+        }
+
+        return symbol;
+    }
+
+
+    void Resolver::bind(SymbolPtr& target, SymbolPtr const& symbol)
+    {
+        // Hash-consed nodes may be reached more than once, but they always resolve the same way.
+        assert(!target || (target == symbol));
+
+        target = symbol;
+        ++resolved_count;
+    }
+
+
+    void Resolver::check_memoized(typing::FunctionInfoPtr const& function) const
+    {
+        if (function->is_memoized && (function->effect != typing::Effect::Pure))
+        {
+            resolve_error(function->location, "Only pure functions can be memoized.");
+        }
+    }
+
+
+    void Resolver::resolve_error(source::Location const& location,
+                                 std::string const& message) const
+    {
+        std::stringstream stream;
+
+        stream << "Error in " << location << ": " << message;
+        throw std::runtime_error(stream.str());
+    }
+
+
+}
@@ -0,0 +1,144 @@
+
+#pragma once
+
+
+namespace basically::runtime::modules
+{
+
+
+    class Module;
+
+
+}
+
+
+namespace basically::runtime::symbols
+{
+
+
+    enum class Kind
+    {
+        Variable,
+        Sub,
+        Function,
+
+        // A call through a type's name, such as i32(x), explicitly converts its argument.
+        Conversion
+    };
+
+
+    struct Symbol
+    {
+        Kind kind;
+        std::string name;
+
+        // The module that declared the symbol.
+        modules::Module const* module = nullptr;
+
+        // For variables, a depth of 0 is a global of the declaring module and the slot indexes
+        // that module's globals.  Deeper variables live in the frame of the enclosing sub,
+        // function or module initializer, and the slot indexes that frame.
+        size_t depth = 0;
+        size_t slot = 0;
+
+        variables::InfoPtr variable;
+        typing::SubInfoPtr sub;
+        typing::TypeInfoPtr type;
+
+        bool is_global() const noexcept;
+        bool is_function() const noexcept;
+    };
+
+
+    std::ostream& operator <<(std::ostream& stream, Symbol const& symbol);
+
+
+    // The name of one of the globals holding a [memoize]d function's table.  The table is "used",
+    // "result" or "key" followed by the parameter's index, and the brackets keep the name out of
+    // reach of scripts.
+    std::string memo_table_name(std::string const& function_name, std::string const& table);
+
+
+    // Binds every name used by a module's code to its symbol.  Variables are looked up through the
+    // scope chain and subs, functions and types through the module, the builtins and then the
+    // modules it loaded.  Each lookup happens exactly once, at compile time.
+    class Resolver
+    {
+        private:
+            modules::Module const& module;
+
+            std::unordered_map<variables::Info const*, SymbolPtr> variable_symbols;
+            std::unordered_map<typing::SubInfo const*, SymbolPtr> sub_symbols;
+            std::unordered_map<std::string, SymbolPtr> conversion_symbols;
+
+            size_t resolved_count = 0;
+
+        public:
+            Resolver(modules::Module const& new_module);
+            Resolver(Resolver const& resolver) = delete;
+            Resolver(Resolver&& resolver) = delete;
+            ~Resolver() = default;
+
+        public:
+            Resolver& operator =(Resolver const& resolver) = delete;
+            Resolver& operator =(Resolver&& resolver) = delete;
+
+        public:
+            void resolve_type(typing::TypeRef& type) const;
+            void resolve_variable(variables::InfoPtr const& variable) const;
+
+            void resolve_initializer(ast::StatementList const& statements,
+                                     variables::ScopePtr const& module_scope,
+                                     variables::FramePtr const& frame);
+            void resolve_sub(typing::SubInfoPtr const& sub,
+                             variables::ScopePtr const& module_scope);
+            void resolve_function(typing::FunctionInfoPtr const& function,
+                                  variables::ScopePtr const& module_scope);
+
+            size_t resolved() const noexcept;
+
+            // Only once the module's code is lowered and its effects worked out is it known
+            // whether a [memoize]d function is pure, as it has to be.
+            void check_memoized(typing::FunctionInfoPtr const& function) const;
+
+        private:
+            void resolve_body(typing::SubInfoPtr const& sub,
+                              variables::ScopePtr const& module_scope,
+                              typing::TypeRef const* result_type);
+            void resolve_block(ast::StatementList const& statements,
+                               variables::ScopePtr const& parent);
+            void resolve_statement(ast::Statement const& statement,
+                                   variables::ScopePtr const& scope,
+                                   bool is_module_level);
+            void resolve_expression(ast::Expression const& expression,
+                                    variables::ScopePtr const& scope);
+            void resolve_optional(ast::OptionalExpression const& expression,
+                                  variables::ScopePtr const& scope);
+            void resolve_list(ast::ExpressionList const& expressions,
+                              variables::ScopePtr const& scope);
+
+            void find_type(typing::TypeRef& type) const;
+
+            void declare_local(ast::VariableDeclarationStatementPtr const& statement,
+                               variables::ScopePtr const& scope);
+
+            SymbolPtr find_variable(lexing::Token const& name,
+                                    variables::ScopePtr const& scope);
+            SymbolPtr find_callable(lexing::Token const& name, bool needs_result);
+            SymbolPtr find_conversion(lexing::Token const& name);
+
+            SymbolPtr variable_symbol(variables::InfoPtr const& variable,
+                                      modules::Module const* owner);
+            SymbolPtr sub_symbol(typing::SubInfoPtr const& sub,
+                                 modules::Module const* owner,
+                                 bool is_function);
+
+            void bind(SymbolPtr& target, SymbolPtr const& symbol);
+
+            [[noreturn]]
+            void resolve_error(source::Location const& location,
+                               std::string const& message) const;
+    };
+
+
+}
@@ -0,0 +1,73 @@
+#include "basically.h"
+
+
+namespace basically::runtime::threading
+{
+
+
+    WorkerPool::WorkerPool(size_t count)
+    {
+        for (size_t index = 0; index < count; ++index)
+        {
+            workers.emplace_back(&WorkerPool::work, this);
+        }
+    }
+
+
+    WorkerPool::~WorkerPool() noexcept
+    {
+        {
+            std::lock_guard<std::mutex> guard(lock);
+
+            is_stopping = true;
+            tasks.clear();
+        }
+
+        wake.notify_all();
+
+        for (auto& worker : workers)
+        {
+            worker.join();
+        }
+    }
+
+
+    bool WorkerPool::is_idle()
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        return tasks.empty() && (running == 0);
+    }
+
+
+    void WorkerPool::work()
+    {
+        while (true)
+        {
+            std::function<void()> task;
+
+            {
+                std::unique_lock<std::mutex> guard(lock);
+
+                wake.wait(guard, [&]() { return is_stopping || !tasks.empty(); });
+
+                if (is_stopping)
+                {
+                    return;
+                }
+
+                task = std::move(tasks.front());
+                tasks.pop_front();
+
+                ++running;
+            }
+
+            // A packaged task keeps whatever it throws for its future.
+            task();
+
+            std::lock_guard<std::mutex> guard(lock);
+            --running;
+        }
+    }
+
+
+}
@@ -0,0 +1,72 @@
+
+#pragma once
+
+
+namespace basically::runtime::threading
+{
+
+
+    // A fixed set of threads that run the tasks handed to them in the order they're submitted,
+    // as many at a time as there are threads.  Each task's result, or the exception it threw, is
+    // handed back through its future.
+    class WorkerPool
+    {
+        private:
+            std::mutex lock;
+            std::condition_variable wake;
+
+            std::deque<std::function<void()>> tasks;
+            std::vector<std::thread> workers;
+
+            size_t running = 0;
+            bool is_stopping = false;
+
+        public:
+            // Without any threads, tasks run as soon as they're submitted, on the submitting
+            // thread.
+            WorkerPool(size_t count);
+            WorkerPool(WorkerPool const& pool) = delete;
+            WorkerPool(WorkerPool&& pool) = delete;
+
+            // Waits for the tasks already running.  Those that haven't started are dropped, and
+            // their futures report a broken promise.
+            ~WorkerPool() noexcept;
+
+        public:
+            WorkerPool& operator =(WorkerPool const& pool) = delete;
+            WorkerPool& operator =(WorkerPool&& pool) = delete;
+
+        public:
+            // Whether every task submitted so far has finished.
+            bool is_idle();
+
+            template <typename FunctionType>
+            auto submit(FunctionType&& function)
+            {
+                using ResultType = std::invoke_result_t<FunctionType>;
+
+                auto task = std::make_shared<std::packaged_task<ResultType()>>(
+                                                            std::forward<FunctionType>(function));
+                auto future = task->get_future();
+
+                if (workers.empty())
+                {
+                    (*task)();
+                    return future;
+                }
+
+                {
+                    std::lock_guard<std::mutex> guard(lock);
+                    tasks.push_back([task]() { (*task)(); });
+                }
+
+                wake.notify_one();
+                return future;
+            }
+
+        private:
+            void work();
+    };
+
+
+}
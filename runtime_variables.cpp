@@ -6,6 +6,42 @@ namespace basically::runtime::variables
 {
 
 
+    namespace
+    {
+
+
+        [[noreturn]]
+        void storage_error(source::Location const& location, std::string const& message)
+        {
+            std::stringstream stream;
+
+            stream << "Error in " << location << ": " << message;
+            throw std::runtime_error(stream.str());
+        }
+
+
+        Storage storage_for(ast::VariableDeclarationStatementPtr const& declaration)
+        {
+            auto storage = Storage::ArrayOfStructures;
+
+            for (auto const& attribute : declaration->attributes)
+            {
+                if (attribute.name.text != "soa")
+                {
+                    storage_error(attribute.name.location,
+                                  "Unknown variable attribute " + attribute.name.text + ".");
+                }
+
+                storage = Storage::StructureOfArrays;
+            }
+
+            return storage;
+        }
+
+
+    }
+
+
     Info::Info(std::string const& new_name,
                std::string const& new_type_name,
                size_t new_array_count,
@@ -22,40 +58,119 @@ namespace basically::runtime::variables
     : name(declaration->name.text),
       type(declaration->type_name),
       initializer(declaration->initializer),
-      array_count(0),
+      array_count(declaration->array_count),
       is_const(false),
+      storage(storage_for(declaration)),
+      location(declaration->location),
       visibility(typing::Visibility::Default)
     {
     }
 
 
+    Info::Info(typing::ParameterInfo const& parameter)
+    : name(parameter.name),
+      type(parameter.type),
+      initializer(parameter.initializer),
+      array_count(0),
+      is_const(false),
+      location(parameter.type.ref_location),
+      visibility(typing::Visibility::Private)
+    {
+    }
+
+
     bool Info::is_array() const noexcept
     {
         return array_count != 0;
     }
 
 
-    size_t Info::size() const noexcept
+    typing::StructureInfoPtr Info::structure() const noexcept
     {
         assert(type.resolved_type);
 
-        auto computed_size = type.resolved_type->size();
+        auto found = std::get_if<typing::StructureInfoPtr>(&type.resolved_type->extra);
+        return found ? *found : nullptr;
+    }
+
+
+    size_t Info::size() const
+    {
+        assert(type_id != typing::invalid_type_id);
+        return typing::get_type_context().size_of(type_id);
+    }
 
-        if (is_array())
+
+    size_t Info::alignment() const
+    {
+        assert(type_id != typing::invalid_type_id);
+        return typing::get_type_context().alignment_of(type_id);
+    }
+
+
+    void Info::check_storage() const
+    {
+        if (is_array() && initializer)
         {
-            return array_count * computed_size;
+            storage_error(location, "The array " + name + " can not have an initializer.");
         }
 
-        return computed_size;
+        if (   (storage == Storage::StructureOfArrays)
+            && (!is_array() || !structure()))
+        {
+            storage_error(location,
+                          "Only arrays of structures can be stored as [soa], " + name
+                          + " is not one.");
+        }
+    }
+
+
+    std::optional<FieldAccess> Info::field_access(std::string const& field_name) const
+    {
+        auto found_structure = structure();
+
+        if (!found_structure)
+        {
+            return std::nullopt;
+        }
+
+        auto index = found_structure->find_field(field_name);
+
+        if (!index)
+        {
+            return std::nullopt;
+        }
+
+        auto const& field = found_structure->fields[index.value()];
+        auto field_size = field.type.resolved_type->size();
+
+        if (storage == Storage::StructureOfArrays)
+        {
+            auto soa = typing::compute_soa_layout(*found_structure, array_count);
+            return FieldAccess { soa.field_offsets[index.value()], field_size, field_size };
+        }
+
+        return FieldAccess { field.offset, found_structure->layout.size, field_size };
     }
 
 
     Scope::Scope(ScopePtr& parent)
-    : parent(parent)
+    : parent(parent),
+      depth(parent ? parent->depth + 1 : 0),
+      frame(parent ? parent->frame : std::make_shared<Frame>())
     {
     }
 
 
+    Scope::Scope(ScopePtr const& parent, FramePtr const& new_frame)
+    : parent(parent),
+      depth(parent ? parent->depth + 1 : 0),
+      frame(new_frame)
+    {
+        assert(frame);
+    }
+
+
     InfoPtr Scope::find(std::string const& name) const noexcept
     {
         auto found = variables.find(name);
@@ -83,6 +198,10 @@ namespace basically::runtime::variables
             throw std::runtime_error("Duplicate definition for " + variable->name);
         }
 
+        variable->depth = depth;
+        variable->slot = frame->slots.size();
+
+        frame->slots.push_back(variable);
         variables.insert({ variable->name, variable });
     }
 
@@ -6,6 +6,28 @@ namespace basically::runtime::variables
 {
 
 
+    // How the elements of an array of structures are stored.
+    enum class Storage
+    {
+        // Each element is a whole structure, one after the other.
+        ArrayOfStructures,
+
+        // Each field gets its own array, selected by [soa].  Loops that only look at a few of the
+        // fields then only touch the memory holding those fields.
+        StructureOfArrays
+    };
+
+
+    // Where each element's copy of a field lives within a variable's storage, at
+    // offset + index * stride.
+    struct FieldAccess
+    {
+        size_t offset;
+        size_t stride;
+        size_t size;
+    };
+
+
     struct Info
     {
         std::string name;
@@ -16,16 +38,36 @@ namespace basically::runtime::variables
         size_t array_count;
         bool is_const;
 
+        Storage storage = Storage::ArrayOfStructures;
+        source::Location location;
+
+        // The type of the whole variable, so for arrays the array type, once it is resolved.
+        typing::TypeId type_id = typing::invalid_type_id;
+
         typing::Visibility visibility;
 
+        // Assigned when the variable is inserted into a scope.  The depth is that of the declaring
+        // scope, and the slot is the variable's index within the frame that scope belongs to.
+        size_t depth = 0;
+        size_t slot = 0;
+
         Info(std::string const& new_name,
              std::string const& new_type_name,
              size_t new_array_count,
              bool new_is_const);
         Info(ast::VariableDeclarationStatementPtr const& declaration);
+        Info(typing::ParameterInfo const& parameter);
 
         bool is_array() const noexcept;
-        size_t size() const noexcept;
+        typing::StructureInfoPtr structure() const noexcept;
+
+        size_t size() const;
+        size_t alignment() const;
+
+        // Check the declaration makes sense for the variable's type, which must be resolved.
+        void check_storage() const;
+
+        std::optional<FieldAccess> field_access(std::string const& field_name) const;
     };
 
 
@@ -35,6 +77,18 @@ namespace basically::runtime::variables
     using InfoList = std::vector<InfoPtr>;
 
 
+    // The storage for one activation: a module's globals, or the locals of a sub, function or
+    // module initializer.  Every variable declared in any of the nested scopes of that activation
+    // gets its own slot.
+    struct Frame
+    {
+        InfoList slots;
+    };
+
+
+    using FramePtr = std::shared_ptr<Frame>;
+
+
     class Scope;
     using ScopePtr = std::shared_ptr<Scope>;
 
@@ -45,9 +99,13 @@ namespace basically::runtime::variables
             ScopePtr parent;
             InfoMap variables;
 
+            size_t depth = 0;
+            FramePtr frame = std::make_shared<Frame>();
+
         public:
             Scope() = default;
             Scope(ScopePtr& parent);
+            Scope(ScopePtr const& parent, FramePtr const& new_frame);
             Scope(Scope const& scope) = default;
             Scope(Scope&& scope) = default;
             ~Scope() = default;
@@ -68,4 +126,10 @@ namespace basically::runtime::variables
     }
 
 
+    inline ScopePtr make_frame_scope(ScopePtr const& parent)
+    {
+        return std::make_shared<Scope>(parent, std::make_shared<Frame>());
+    }
+
+
 }
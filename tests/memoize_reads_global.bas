@@ -0,0 +1,13 @@
+# error: Only pure functions can be memoized.
+
+# The second call would find the first one's result in the table, and so never see the new g.
+var g as i64 = 0
+
+[memoize]
+function side(n as i64) as i64
+    result = n + g
+end function
+
+var first as i64 = side(1)
+g = 5
+result = i8(side(1) - first)
@@ -6,6 +6,147 @@ namespace basically::typing
 {
 
 
+    namespace
+    {
+
+
+        const size_t cache_line_size = 64;
+
+
+        struct Placement
+        {
+            Layout layout;
+            std::vector<size_t> offsets;
+        };
+
+
+        [[noreturn]]
+        void type_error(source::Location const& location, std::string const& message)
+        {
+            std::stringstream stream;
+
+            stream << "Error in " << location << ": " << message;
+            throw std::runtime_error(stream.str());
+        }
+
+
+        LayoutMode layout_mode_for(ast::StructureDeclarationStatementPtr const& declaration)
+        {
+            auto mode = LayoutMode::Natural;
+
+            for (auto const& attribute : declaration->attributes)
+            {
+                auto new_mode = LayoutMode::Natural;
+
+                if (attribute.name.text == "packed")
+                {
+                    new_mode = LayoutMode::Packed;
+                }
+                else if (attribute.name.text == "reorder")
+                {
+                    new_mode = LayoutMode::Reordered;
+                }
+                else
+                {
+                    type_error(attribute.name.location,
+                               "Unknown structure attribute " + attribute.name.text + ".");
+                }
+
+                if ((mode != LayoutMode::Natural) && (mode != new_mode))
+                {
+                    type_error(attribute.name.location,
+                               "A structure can not be both packed and reordered.");
+                }
+
+                mode = new_mode;
+            }
+
+            return mode;
+        }
+
+
+        size_t align_up(size_t value, size_t alignment) noexcept
+        {
+            assert(alignment > 0);
+            return ((value + alignment - 1) / alignment) * alignment;
+        }
+
+
+        std::vector<size_t> declaration_order(FieldInfoList const& fields)
+        {
+            std::vector<size_t> order(fields.size());
+
+            std::iota(order.begin(), order.end(), 0);
+
+            return order;
+        }
+
+
+        std::vector<size_t> alignment_order(FieldInfoList const& fields)
+        {
+            auto order = declaration_order(fields);
+
+            auto alignment_of = [&](size_t index)
+                {
+                    return fields[index].type.resolved_type->alignment();
+                };
+
+            std::stable_sort(order.begin(),
+                             order.end(),
+                             [&](size_t lhs, size_t rhs)
+                             {
+                                 return alignment_of(lhs) > alignment_of(rhs);
+                             });
+
+            return order;
+        }
+
+
+        // Place the fields one after the other in the given order, noting the padding needed
+        // between them to keep each one aligned.
+        Placement place_fields(FieldInfoList const& fields,
+                               std::vector<size_t> const& order,
+                               bool is_packed)
+        {
+            Placement placement;
+            auto& layout = placement.layout;
+
+            size_t offset = 0;
+
+            placement.offsets.resize(fields.size());
+
+            for (auto index : order)
+            {
+                auto const& type = *fields[index].type.resolved_type;
+
+                auto alignment = is_packed ? 1 : type.alignment();
+                auto field_offset = align_up(offset, alignment);
+
+                if (field_offset > offset)
+                {
+                    layout.holes.push_back({ offset, field_offset - offset });
+                }
+
+                placement.offsets[index] = field_offset;
+
+                offset = field_offset + type.size();
+                layout.alignment = std::max(layout.alignment, alignment);
+            }
+
+            layout.size = align_up(offset, layout.alignment);
+
+            if (layout.size > offset)
+            {
+                layout.holes.push_back({ offset, layout.size - offset });
+            }
+
+            return placement;
+        }
+
+
+    }
+
+
     TypeRef::TypeRef(lexing::Token const& ref_token)
     : ref_location(ref_token.location),
       type_name(ref_token.text),
@@ -63,14 +204,18 @@ namespace basically::typing
 
                 .structure = [&](auto const& value)
                     {
-                        size_t size_sum = 0;
+                        assert(value->layout_state == StructureInfo::LayoutState::Done);
+                        new_size = value->layout.size;
+                    },
 
-                        for (auto const& field : value->fields)
-                        {
-                            size_sum = field.type.resolved_type->size();
-                        }
+                .string = [&](auto const& value)
+                    {
+                        new_size = sizeof(char const*);
+                    },
 
-                        new_size = size_sum;
+                .boolean = [&](auto const& value)
+                    {
+                        new_size = 1;
                     }
             };
 
@@ -80,16 +225,322 @@ namespace basically::typing
     }
 
 
+    size_t TypeInfo::alignment() const noexcept
+    {
+        size_t new_alignment;
+
+        ExtraInfoHandler handler =
+            {
+                .number = [&](auto const& value)
+                    {
+                        new_alignment = value->size;
+                    },
+
+                .structure = [&](auto const& value)
+                    {
+                        assert(value->layout_state == StructureInfo::LayoutState::Done);
+                        new_alignment = value->layout.alignment;
+                    },
+
+                .string = [&](auto const& value)
+                    {
+                        new_alignment = alignof(char const*);
+                    },
+
+                .boolean = [&](auto const& value)
+                    {
+                        new_alignment = 1;
+                    }
+            };
+
+        std::visit(handler, extra);
+
+        return new_alignment;
+    }
+
+
+    FieldInfo::FieldInfo(ast::VariableDeclarationStatementPtr const& declaration)
+    : name(declaration->name.text),
+      type(declaration->type_name),
+      initializer(declaration->initializer)
+    {
+        if (!declaration->attributes.empty())
+        {
+            type_error(declaration->location, "Structure fields don't take attributes.");
+        }
+
+        if (declaration->array_count != 0)
+        {
+            type_error(declaration->location, "Structure fields can not be arrays.");
+        }
+    }
+
+
+    size_t Layout::padding() const noexcept
+    {
+        size_t total = 0;
+
+        for (auto const& hole : holes)
+        {
+            total += hole.size;
+        }
+
+        return total;
+    }
+
+
+    size_t Layout::cache_lines() const noexcept
+    {
+        return (size + cache_line_size - 1) / cache_line_size;
+    }
+
+
     StructureInfo::StructureInfo(ast::StructureDeclarationStatementPtr const& declaration)
+    : name(declaration->name.text),
+      location(declaration->location),
+      fields(declaration->members.begin(), declaration->members.end()),
+      layout_mode(layout_mode_for(declaration))
     {
+        std::unordered_set<std::string> names;
+
+        for (auto const& field : fields)
+        {
+            if (!names.insert(field.name).second)
+            {
+                type_error(field.type.ref_location,
+                           "Duplicate field " + field.name + " in structure " + name + ".");
+            }
+        }
+    }
+
+
+    std::vector<size_t> StructureInfo::placement_order() const
+    {
+        auto order = declaration_order(fields);
+
+        std::stable_sort(order.begin(),
+                         order.end(),
+                         [&](size_t lhs, size_t rhs)
+                         {
+                             return fields[lhs].offset < fields[rhs].offset;
+                         });
+
+        return order;
+    }
+
+
+    std::optional<size_t> StructureInfo::find_field(std::string const& field_name) const noexcept
+    {
+        for (size_t i = 0; i < fields.size(); ++i)
+        {
+            if (fields[i].name == field_name)
+            {
+                return i;
+            }
+        }
+
+        return std::nullopt;
+    }
+
+
+    std::ostream& operator <<(std::ostream& stream, StructureInfo const& structure)
+    {
+        auto const& layout = structure.layout;
+
+        stream << "size " << layout.size << ", alignment " << layout.alignment << ", "
+               << layout.padding() << " bytes of padding in " << layout.holes.size() << " holes, "
+               << layout.cache_lines() << " cache lines" << std::endl;
+
+        auto hole = layout.holes.begin();
+
+        auto write_holes_before = [&](size_t offset)
+            {
+                for (; (hole != layout.holes.end()) && (hole->offset < offset); ++hole)
+                {
+                    stream << "    " << hole->offset << ": " << hole->size << " byte hole"
+                           << std::endl;
+                }
+            };
+
+        for (auto index : structure.placement_order())
+        {
+            auto const& field = structure.fields[index];
+
+            write_holes_before(field.offset);
+
+            stream << "    " << field.offset << ": " << field.name << " as " << field.type.type_name
+                   << ", " << field.type.resolved_type->size() << " bytes" << std::endl;
+        }
+
+        write_holes_before(layout.size);
+
+        if (structure.layout_mode == LayoutMode::Natural)
+        {
+            auto reordered = place_fields(structure.fields,
+                                          alignment_order(structure.fields),
+                                          false);
+
+            if (reordered.layout.size < layout.size)
+            {
+                stream << "    [reorder] would shrink it to " << reordered.layout.size
+                       << " bytes." << std::endl;
+            }
+        }
+
+        return stream;
+    }
+
+
+    void compute_layout(TypeInfo const& type)
+    {
+        auto found = std::get_if<StructureInfoPtr>(&type.extra);
+
+        if (found == nullptr)
+        {
+            return;
+        }
+
+        auto& structure = **found;
+
+        switch (structure.layout_state)
+        {
+            case StructureInfo::LayoutState::Done:
+                return;
+
+            case StructureInfo::LayoutState::InProgress:
+                type_error(structure.location,
+                           "The structure " + structure.name + " contains itself.");
+
+            case StructureInfo::LayoutState::Pending:
+                break;
+        }
+
+        structure.layout_state = StructureInfo::LayoutState::InProgress;
+
+        for (auto const& field : structure.fields)
+        {
+            assert(field.type.resolved_type);
+            compute_layout(*field.type.resolved_type);
+        }
+
+        auto order = structure.layout_mode == LayoutMode::Reordered
+            ? alignment_order(structure.fields)
+            : declaration_order(structure.fields);
+
+        auto placement = place_fields(structure.fields,
+                                      order,
+                                      structure.layout_mode == LayoutMode::Packed);
+
+        for (size_t i = 0; i < structure.fields.size(); ++i)
+        {
+            structure.fields[i].offset = placement.offsets[i];
+        }
+
+        structure.layout = placement.layout;
+        structure.layout_state = StructureInfo::LayoutState::Done;
+    }
+
+
+    SoaLayout compute_soa_layout(StructureInfo const& structure, size_t count)
+    {
+        assert(structure.layout_state == StructureInfo::LayoutState::Done);
+
+        SoaLayout soa;
+        auto& layout = soa.layout;
+
+        size_t offset = 0;
+
+        soa.field_offsets.resize(structure.fields.size());
+
+        for (auto index : alignment_order(structure.fields))
+        {
+            auto const& type = *structure.fields[index].type.resolved_type;
+            auto field_offset = align_up(offset, type.alignment());
+
+            if (field_offset > offset)
+            {
+                layout.holes.push_back({ offset, field_offset - offset });
+            }
+
+            soa.field_offsets[index] = field_offset;
+
+            offset = field_offset + (count * type.size());
+            layout.alignment = std::max(layout.alignment, type.alignment());
+        }
+
+        layout.size = align_up(offset, layout.alignment);
+
+        if (layout.size > offset)
+        {
+            layout.holes.push_back({ offset, layout.size - offset });
+        }
+
+        return soa;
+    }
+
+
+    ParameterInfo::ParameterInfo(ast::VariableDeclarationStatementPtr const& declaration)
+    : name(declaration->name.text),
+      type(declaration->type_name),
+      initializer(declaration->initializer)
+    {
+        if (!declaration->attributes.empty())
+        {
+            type_error(declaration->location, "Parameters don't take attributes.");
+        }
+
+        if (declaration->array_count != 0)
+        {
+            type_error(declaration->location, "Parameters can not be arrays.");
+        }
     }
 
 
     SubInfo::SubInfo(ast::SubDeclarationStatementPtr const& declaration)
     : name(declaration->name.text),
-      parameters(),
-      body()
+      location(declaration->name.location),
+      parameters(declaration->parameters.begin(), declaration->parameters.end()),
+      body(declaration->body)
     {
+        for (auto const& attribute : declaration->attributes)
+        {
+            if (attribute.name.text == "noinline")
+            {
+                is_inlinable = false;
+            }
+            else if (attribute.name.text == "memoize")
+            {
+                if (!std::dynamic_pointer_cast<ast::FunctionDeclarationStatement>(declaration))
+                {
+                    type_error(attribute.name.location, "Only functions can be memoized.");
+                }
+
+                // Every call has to go through the table for it to be any use.
+                is_memoized = true;
+                is_inlinable = false;
+            }
+            else if ((attribute.name.text == "hot") || (attribute.name.text == "cold"))
+            {
+                auto new_heat = attribute.name.text == "hot" ? Heat::Hot : Heat::Cold;
+
+                if ((heat != Heat::Normal) && (heat != new_heat))
+                {
+                    type_error(attribute.name.location, "A sub can't be both hot and cold.");
+                }
+
+                heat = new_heat;
+
+                if (heat == Heat::Cold)
+                {
+                    is_inlinable = false;
+                }
+            }
+            else
+            {
+                type_error(attribute.name.location,
+                           "Unknown sub attribute " + attribute.name.text + ".");
+            }
+        }
     }
 
 
@@ -100,4 +551,261 @@ namespace basically::typing
     }
 
 
+    size_t TypeContext::ArrayKeyHash::operator ()(ArrayKey const& key) const noexcept
+    {
+        auto hash = std::hash<TypeId>()(key.element);
+
+        hash ^= std::hash<size_t>()(key.count) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+        hash ^= std::hash<bool>()(key.is_soa) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+
+        return hash;
+    }
+
+
+    TypeId TypeContext::intern(TypeInfoPtr const& type)
+    {
+        assert(type);
+
+        if (auto found = named_ids.find(type.get()); found != named_ids.end())
+        {
+            return found->second;
+        }
+
+        auto id = static_cast<TypeId>(entries.size());
+
+        entries.push_back({ .kind = TypeKind::Named, .info = type });
+        named_ids.insert({ type.get(), id });
+
+        type->id = id;
+
+        return id;
+    }
+
+
+    TypeId TypeContext::intern_array(TypeId element, size_t count, bool is_soa)
+    {
+        assert(element < entries.size());
+        assert(count > 0);
+
+        auto key = ArrayKey { element, count, is_soa };
+
+        if (auto found = array_ids.find(key); found != array_ids.end())
+        {
+            return found->second;
+        }
+
+        auto id = static_cast<TypeId>(entries.size());
+
+        entries.push_back({ .kind = TypeKind::Array,
+                            .element = element,
+                            .count = count,
+                            .is_soa = is_soa });
+        array_ids.insert({ key, id });
+
+        return id;
+    }
+
+
+    TypeId TypeContext::intern_pointer(TypeId element)
+    {
+        assert(element < entries.size());
+
+        if (auto found = pointer_ids.find(element); found != pointer_ids.end())
+        {
+            return found->second;
+        }
+
+        auto id = static_cast<TypeId>(entries.size());
+
+        entries.push_back({ .kind = TypeKind::Pointer, .element = element });
+        pointer_ids.insert({ element, id });
+
+        return id;
+    }
+
+
+    TypeEntry const& TypeContext::get(TypeId id) const noexcept
+    {
+        assert(id < entries.size());
+        return entries[id];
+    }
+
+
+    size_t TypeContext::count() const noexcept
+    {
+        return entries.size();
+    }
+
+
+    std::string TypeContext::name_of(TypeId id) const
+    {
+        if (id == invalid_type_id)
+        {
+            return "<unknown>";
+        }
+
+        auto const& entry = get(id);
+
+        if (entry.kind == TypeKind::Named)
+        {
+            return entry.info->name;
+        }
+
+        if (entry.kind == TypeKind::Pointer)
+        {
+            return name_of(entry.element) + "*";
+        }
+
+        return   (entry.is_soa ? "[soa] " : "")
+               + name_of(entry.element) + "[" + std::to_string(entry.count) + "]";
+    }
+
+
+    bool TypeContext::is_number(TypeId id) const noexcept
+    {
+        return number_info(id) != nullptr;
+    }
+
+
+    bool TypeContext::is_boolean(TypeId id) const noexcept
+    {
+        auto const& entry = get(id);
+
+        return    (entry.kind == TypeKind::Named)
+               && std::holds_alternative<BooleanInfoPtr>(entry.info->extra);
+    }
+
+
+    bool TypeContext::is_string(TypeId id) const noexcept
+    {
+        auto const& entry = get(id);
+
+        return    (entry.kind == TypeKind::Named)
+               && std::holds_alternative<StringInfoPtr>(entry.info->extra);
+    }
+
+
+    bool TypeContext::is_structure(TypeId id) const noexcept
+    {
+        return structure_info(id) != nullptr;
+    }
+
+
+    bool TypeContext::is_array(TypeId id) const noexcept
+    {
+        return get(id).kind == TypeKind::Array;
+    }
+
+
+    bool TypeContext::is_pointer(TypeId id) const noexcept
+    {
+        return get(id).kind == TypeKind::Pointer;
+    }
+
+
+    TypeId TypeContext::element_of(TypeId id) const noexcept
+    {
+        return get(id).element;
+    }
+
+
+    NumberInfoPtr TypeContext::number_info(TypeId id) const noexcept
+    {
+        auto const& entry = get(id);
+
+        if (entry.kind != TypeKind::Named)
+        {
+            return nullptr;
+        }
+
+        auto found = std::get_if<NumberInfoPtr>(&entry.info->extra);
+        return found ? *found : nullptr;
+    }
+
+
+    StructureInfoPtr TypeContext::structure_info(TypeId id) const noexcept
+    {
+        auto const& entry = get(id);
+
+        if (entry.kind != TypeKind::Named)
+        {
+            return nullptr;
+        }
+
+        auto found = std::get_if<StructureInfoPtr>(&entry.info->extra);
+        return found ? *found : nullptr;
+    }
+
+
+    size_t TypeContext::size_of(TypeId id) const
+    {
+        if (auto found = sizes.find(id); found)
+        {
+            return *found;
+        }
+
+        auto const& entry = get(id);
+        size_t size = 0;
+
+        if (entry.kind == TypeKind::Named)
+        {
+            size = entry.info->size();
+        }
+        else if (entry.kind == TypeKind::Pointer)
+        {
+            size = sizeof(void*);
+        }
+        else if (entry.is_soa)
+        {
+            size = compute_soa_layout(*structure_info(entry.element), entry.count).layout.size;
+        }
+        else
+        {
+            size = entry.count * size_of(entry.element);
+        }
+
+        return sizes.set(id, size);
+    }
+
+
+    size_t TypeContext::alignment_of(TypeId id) const
+    {
+        if (auto found = alignments.find(id); found)
+        {
+            return *found;
+        }
+
+        auto const& entry = get(id);
+
+        size_t alignment = 0;
+
+        if (entry.kind == TypeKind::Named)
+        {
+            alignment = entry.info->alignment();
+        }
+        else if (entry.kind == TypeKind::Pointer)
+        {
+            alignment = alignof(void*);
+        }
+        else if (entry.is_soa)
+        {
+            alignment = compute_soa_layout(*structure_info(entry.element),
+                                           entry.count).layout.alignment;
+        }
+        else
+        {
+            alignment = alignment_of(entry.element);
+        }
+
+        return alignments.set(id, alignment);
+    }
+
+
+    TypeContext& get_type_context()
+    {
+        static TypeContext context;
+        return context;
+    }
+
+
 }
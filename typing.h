@@ -2,6 +2,17 @@
 #pragma once
 
 
+namespace basically::runtime::variables
+{
+
+
+    struct Frame;
+    using FramePtr = std::shared_ptr<Frame>;
+
+
+}
+
+
 namespace basically::typing
 {
 
@@ -12,7 +23,16 @@ namespace basically::typing
     struct StructureInfo;
     using StructureInfoPtr = std::shared_ptr<StructureInfo>;
 
-    using TypeExtraInfo = std::variant<NumberInfoPtr, StructureInfoPtr>;
+    struct StringInfo;
+    using StringInfoPtr = std::shared_ptr<StringInfo>;
+
+    struct BooleanInfo;
+    using BooleanInfoPtr = std::shared_ptr<BooleanInfo>;
+
+    using TypeExtraInfo = std::variant<NumberInfoPtr,
+                                       StructureInfoPtr,
+                                       StringInfoPtr,
+                                       BooleanInfoPtr>;
 
     struct TypeInfo;
     using TypeInfoPtr = std::shared_ptr<TypeInfo>;
@@ -25,6 +45,7 @@ namespace basically::typing
 
         std::string type_name;
         TypeInfoPtr resolved_type;
+        TypeId id = invalid_type_id;
 
         TypeRef() = default;
         TypeRef(lexing::Token const& ref_token);
@@ -68,6 +89,9 @@ namespace basically::typing
         TypeExtraInfo extra;
         Visibility visibility = Visibility::Default;
 
+        // Assigned when the type is interned into the type context.
+        TypeId id = invalid_type_id;
+
         TypeInfo() = default;
         TypeInfo(ast::StructureDeclarationStatementPtr const& declaration);
         TypeInfo(std::string const& new_name,
@@ -75,6 +99,7 @@ namespace basically::typing
                  Visibility new_visibility = Visibility::Default);
 
         size_t size() const noexcept;
+        size_t alignment() const noexcept;
     };
 
 
@@ -82,6 +107,8 @@ namespace basically::typing
     {
         std::function<void(NumberInfoPtr const&)> number;
         std::function<void(StructureInfoPtr const&)> structure;
+        std::function<void(StringInfoPtr const&)> string;
+        std::function<void(BooleanInfoPtr const&)> boolean;
 
         inline void operator ()(NumberInfoPtr const& value) const
         {
@@ -92,6 +119,16 @@ namespace basically::typing
         {
             structure(value);
         }
+
+        inline void operator ()(StringInfoPtr const& value) const
+        {
+            string(value);
+        }
+
+        inline void operator ()(BooleanInfoPtr const& value) const
+        {
+            boolean(value);
+        }
     };
 
 
@@ -122,49 +159,198 @@ namespace basically::typing
     };
 
 
+    // Strings are immutable and passed around by reference to their character data.
+    struct StringInfo
+    {
+    };
+
+
+    // The result of comparisons and the type of conditions.  Bools don't mix with numbers.
+    struct BooleanInfo
+    {
+    };
+
+
     struct FieldInfo
     {
         std::string name;
         TypeRef type;
 
-        size_t offset;
+        size_t offset = 0;
+
+        ast::OptionalExpression initializer;
 
-        ast::Expression initializer;
+        FieldInfo(ast::VariableDeclarationStatementPtr const& declaration);
     };
 
 
     using FieldInfoList = std::vector<FieldInfo>;
 
 
-    struct StructureInfo : public TypeInfo
+    enum class LayoutMode
     {
+        // Fields in declaration order, each at its natural alignment.
+        Natural,
+
+        // Fields in declaration order with no padding at all, selected by [packed].
+        Packed,
+
+        // Fields at their natural alignment, but placed most strictly aligned first so that as
+        // little padding as possible is needed, selected by [reorder].
+        Reordered
+    };
+
+
+    // A run of padding bytes within a structure, including any padding at its tail.
+    struct Hole
+    {
+        size_t offset;
+        size_t size;
+    };
+
+
+    using HoleList = std::vector<Hole>;
+
+
+    struct Layout
+    {
+        size_t size = 0;
+        size_t alignment = 1;
+
+        HoleList holes;
+
+        size_t padding() const noexcept;
+        size_t cache_lines() const noexcept;
+    };
+
+
+    struct StructureInfo
+    {
+        enum class LayoutState
+        {
+            Pending,
+            InProgress,
+            Done
+        };
+
+        std::string name;
+        source::Location location;
+
         FieldInfoList fields;
 
+        LayoutMode layout_mode = LayoutMode::Natural;
+        LayoutState layout_state = LayoutState::Pending;
+        Layout layout;
+
         StructureInfo(ast::StructureDeclarationStatementPtr const& declaration);
+
+        // Field indices in the order the fields are placed in memory.
+        std::vector<size_t> placement_order() const;
+
+        std::optional<size_t> find_field(std::string const& field_name) const noexcept;
     };
 
 
+    std::ostream& operator <<(std::ostream& stream, StructureInfo const& structure);
+
+
+    // Compute the size, alignment, field offsets and padding of a structure type, and of any
+    // structures used by its fields.  The field types must already be resolved.  Other types need
+    // no layout, so for them this does nothing.
+    void compute_layout(TypeInfo const& type);
+
+
+    // The storage of an array of structures kept as a structure of arrays, one array per field.
+    // The field arrays are placed most strictly aligned first so that no padding is needed
+    // between them.
+    struct SoaLayout
+    {
+        Layout layout;
+
+        // Byte offsets of each field's array, indexed as the structure's fields are.
+        std::vector<size_t> field_offsets;
+    };
+
+
+    // The structure's own layout must already be computed.
+    SoaLayout compute_soa_layout(StructureInfo const& structure, size_t count);
+
+
     struct ParameterInfo
     {
         std::string name;
         TypeRef type;
 
-        ast::Expression initializer;
+        ast::OptionalExpression initializer;
+
+        ParameterInfo(ast::VariableDeclarationStatementPtr const& declaration);
     };
 
 
     using ParameterList = std::vector<ParameterInfo>;
 
 
+    // How much of a program's time a sub is expected to take, set by the [hot] and [cold]
+    // attributes.
+    enum class Heat : uint8_t
+    {
+        Normal,
+
+        // Worth as much work from gcc as it can give.
+        Hot,
+
+        // Rarely called, so compiled to be small and kept away from the code that runs.
+        Cold
+    };
+
+
+    // What calling a sub or function can do besides handing back a result, from least to most.
+    enum class Effect : uint8_t
+    {
+        // The result depends on nothing but the arguments.
+        Pure,
+
+        // Variables other than its own are read, but none are changed.
+        ReadOnly,
+
+        // Variables other than its own may be changed.
+        Effectful
+    };
+
+
     struct SubInfo
     {
         std::string name;
+        source::Location location;
 
         ParameterList parameters;
         ast::StatementList body;
 
         Visibility visibility = Visibility::Default;
 
+        // Cleared by the [noinline] and [memoize] attributes, which keep calls to the sub as real
+        // calls.
+        bool is_inlinable = true;
+
+        // Set by the [memoize] attribute.  The function keeps the results of its calls in a table
+        // keyed on the arguments, and returns those again when called with the same arguments.
+        // Only a pure function can be memoized, as reading anything but its arguments could give
+        // it a different result for the same ones.  Its own table doesn't count against that.
+        bool is_memoized = false;
+
+        // A cold sub isn't inlined either, so that its callers stay small.
+        Heat heat = Heat::Normal;
+
+        // Worked out once the sub's module is lowered.  Until then nothing is assumed.
+        Effect effect = Effect::Effectful;
+
+        // Whether a call can stop the program, through a bounds check or a division by zero.
+        bool can_fail = true;
+
+        // Filled in by symbol resolution, the slots for the parameters and every local declared in
+        // the body.
+        runtime::variables::FramePtr frame;
+
         SubInfo(ast::SubDeclarationStatementPtr const& declaration);
     };
 
@@ -185,4 +371,144 @@ namespace basically::typing
     using FunctionInfoMap = std::unordered_map<std::string, FunctionInfoPtr>;
 
 
+    enum class TypeKind : uint8_t
+    {
+        // A builtin or structure type, described by its TypeInfo.
+        Named,
+
+        // A fixed number of elements of another type.
+        Array,
+
+        // The address of a value of another type.
+        Pointer
+    };
+
+
+    struct TypeEntry
+    {
+        TypeKind kind;
+
+        // Set for named types.
+        TypeInfoPtr info;
+
+        // Set for array and pointer types.
+        TypeId element = invalid_type_id;
+
+        // Set for array types.
+        size_t count = 0;
+        bool is_soa = false;
+    };
+
+
+    // A per-type value, such as a size or the JIT's version of the type, kept in a dense array
+    // indexed by type id.
+    template <typename ValueType>
+    class TypeTable
+    {
+        private:
+            std::vector<std::optional<ValueType>> values;
+
+        public:
+            ValueType const* find(TypeId id) const noexcept
+            {
+                if ((id >= values.size()) || !values[id])
+                {
+                    return nullptr;
+                }
+
+                return &values[id].value();
+            }
+
+            ValueType& set(TypeId id, ValueType const& value)
+            {
+                assert(id != invalid_type_id);
+
+                if (id >= values.size())
+                {
+                    values.resize(id + 1);
+                }
+
+                values[id] = value;
+                return values[id].value();
+            }
+
+            void clear() noexcept
+            {
+                values.clear();
+            }
+    };
+
+
+    // Every type used by any loaded module gets exactly one entry here, so type identity comes
+    // down to comparing ids, even between types found through different modules.
+    class TypeContext
+    {
+        private:
+            struct ArrayKey
+            {
+                TypeId element;
+                size_t count;
+                bool is_soa;
+
+                bool operator ==(ArrayKey const& key) const noexcept = default;
+            };
+
+            struct ArrayKeyHash
+            {
+                size_t operator ()(ArrayKey const& key) const noexcept;
+            };
+
+            std::vector<TypeEntry> entries;
+
+            std::unordered_map<TypeInfo const*, TypeId> named_ids;
+            std::unordered_map<ArrayKey, TypeId, ArrayKeyHash> array_ids;
+            std::unordered_map<TypeId, TypeId> pointer_ids;
+
+            mutable TypeTable<size_t> sizes;
+            mutable TypeTable<size_t> alignments;
+
+        public:
+            TypeContext() = default;
+            TypeContext(TypeContext const& context) = delete;
+            TypeContext(TypeContext&& context) = delete;
+            ~TypeContext() = default;
+
+        public:
+            TypeContext& operator =(TypeContext const& context) = delete;
+            TypeContext& operator =(TypeContext&& context) = delete;
+
+        public:
+            // Interning the same type again gives back the same id.
+            TypeId intern(TypeInfoPtr const& type);
+            TypeId intern_array(TypeId element, size_t count, bool is_soa = false);
+            TypeId intern_pointer(TypeId element);
+
+            TypeEntry const& get(TypeId id) const noexcept;
+            size_t count() const noexcept;
+
+            std::string name_of(TypeId id) const;
+
+            bool is_number(TypeId id) const noexcept;
+            bool is_boolean(TypeId id) const noexcept;
+            bool is_string(TypeId id) const noexcept;
+            bool is_structure(TypeId id) const noexcept;
+            bool is_array(TypeId id) const noexcept;
+            bool is_pointer(TypeId id) const noexcept;
+
+            // The element type of an array or the type a pointer points to.
+            TypeId element_of(TypeId id) const noexcept;
+
+            NumberInfoPtr number_info(TypeId id) const noexcept;
+            StructureInfoPtr structure_info(TypeId id) const noexcept;
+
+            // Sizes can only be asked for once any structure layouts involved are computed.  They
+            // are cached from then on.
+            size_t size_of(TypeId id) const;
+            size_t alignment_of(TypeId id) const;
+    };
+
+
+    TypeContext& get_type_context();
+
+
 }